@@ -0,0 +1,71 @@
+// ---------------------------------------------------------------------------------
+// LED animations - Header
+// ---------------------------------------------------------------------------------
+// Fades each LED run from its last colour to a new one in fixed point, with the
+// fade curve shaped by a gamma table. Every running fade is advanced in one pass
+// over the map on each LED timer tick.
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+
+#pragma once
+#ifndef ANIMATION_H
+#define ANIMATION_H
+
+#include "pico/stdlib.h"
+#include "indicators.h"
+
+// Build options
+//  ANIMATION_FRAME_MS=<n>      LED timer period of animated maps, which must divide
+//                              INDICATOR_PHASE_MS
+//  ANIMATION_GAMMA=<x>         Gamma of the fade curve
+//  ANIMATION_BUDGET_US=<n>     Frames that take longer are counted as over budget
+#ifndef ANIMATION_FRAME_MS
+#define ANIMATION_FRAME_MS          20
+#endif
+#ifndef ANIMATION_GAMMA
+#define ANIMATION_GAMMA             2.2f
+#endif
+#ifndef ANIMATION_BUDGET_US
+#define ANIMATION_BUDGET_US         1000
+#endif
+
+// Waveforms
+#define ANIMATION_STEP              0       // Change at the next frame
+#define ANIMATION_FADE              1       // Follow the gamma curve
+
+// Constants
+#define ANIMATION_DONE              0xFF00  // Progress at the end of a fade, 255.0 in 8.8 fixed point
+#define ANIMATION_FRAMES_PER_PHASE  (INDICATOR_PHASE_MS / ANIMATION_FRAME_MS)
+
+// Types
+typedef struct
+{
+    uint32_t    from;                   // Colour word the fade started from
+    uint32_t    to;                     // Colour word being faded to
+    uint16_t    progress;               // 8.8 fixed point, up to ANIMATION_DONE
+    uint16_t    rate;                   // Added to progress each frame
+    uint8_t     waveform;
+} animation_t;
+
+typedef struct
+{
+    uint32_t    frames;
+    uint32_t    running;                // Fades advanced, over all frames
+    uint32_t    last_us;                // Time taken to advance the fades of the last frame
+    uint32_t    max_us;
+    uint32_t    over_budget;            // Frames that took longer than ANIMATION_BUDGET_US
+} animation_stats_t;
+
+// Setup (core 0, before the LED timer is started)
+void animation_initialize(void);
+void animation_hold(animation_t* animation, uint32_t colour);
+
+// LED timer. Colours are words in any byte order, such as LEDSTRIP_WORD().
+void animation_start(animation_t* animation, uint32_t from, uint32_t to, uint16_t fade_ms);
+bool animation_step(animation_t* animations, uint32_t* colours, uint16_t count);
+const animation_stats_t* animation_get_stats(void);
+
+#endif // ANIMATION_H
@@ -0,0 +1,429 @@
+// ---------------------------------------------------------------------------------
+// Binary SNON framing
+// ---------------------------------------------------------------------------------
+// COBS framed messages with a CRC16, addressing entities by handle instead of
+// by eID. Entered with the "binary" command, and left with an exit frame.
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+#include <stdio.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+
+#include "binframe.h"
+#include "entities.h"
+#include "arena.h"
+#include "uart.h"
+#include "snon/snon_utils.h"
+
+// Constants
+#define BINFRAME_JSON_SIZE      ((255 * 6) + 5)
+
+// Private prototypes
+void binframe_respond(writer_t* writer, uint8_t* response, uint16_t length);
+void binframe_nak(writer_t* writer, uint8_t sequence, uint8_t error);
+int16_t binframe_item_length(const uint8_t* item, uint16_t remaining);
+bool binframe_set_item(const uint8_t* item, char* text, char* json_buffer, uint16_t json_size);
+
+// =================================================================================
+// Codec
+
+uint16_t binframe_crc16(const uint8_t* data, uint16_t length)
+{
+    uint16_t    crc = 0xFFFF;
+    uint8_t     bit = 0;
+
+    while(length != 0)
+    {
+        crc = crc ^ ((uint16_t) *data << 8);
+
+        bit = 0;
+        while(bit != 8)
+        {
+            if((crc & 0x8000) != 0)
+            {
+                crc = (crc << 1) ^ 0x1021;
+            }
+            else
+            {
+                crc = crc << 1;
+            }
+
+            bit = bit + 1;
+        }
+
+        data = data + 1;
+        length = length - 1;
+    }
+
+    return(crc);
+}
+
+// Returns the decoded length, or zero if the encoding is not valid
+uint16_t binframe_cobs_decode(const uint8_t* encoded, uint16_t length, uint8_t* decoded)
+{
+    uint16_t    in = 0;
+    uint16_t    out = 0;
+    uint8_t     code = 0;
+    uint8_t     counter = 0;
+
+    while(in != length)
+    {
+        code = encoded[in];
+        in = in + 1;
+
+        if((code == 0) || (in + code - 1 > length))
+        {
+            return(0);
+        }
+
+        counter = 1;
+        while(counter != code)
+        {
+            decoded[out] = encoded[in];
+            out = out + 1;
+            in = in + 1;
+            counter = counter + 1;
+        }
+
+        // A short block stands for a zero, except at the end of the frame
+        if((code != 0xFF) && (in != length))
+        {
+            decoded[out] = 0;
+            out = out + 1;
+        }
+    }
+
+    return(out);
+}
+
+// Writes data COBS encoded, followed by the zero delimiter
+void binframe_cobs_write(writer_t* writer, const uint8_t* data, uint16_t length)
+{
+    uint16_t    block_start = 0;
+    uint16_t    block_length = 0;
+    uint16_t    counter = 0;
+
+    while(true)
+    {
+        // Find the end of the next block
+        block_length = 0;
+        while((block_start + block_length < length) && (data[block_start + block_length] != 0) && (block_length != 254))
+        {
+            block_length = block_length + 1;
+        }
+
+        writer_putc(writer, block_length + 1);
+
+        counter = 0;
+        while(counter != block_length)
+        {
+            writer_putc(writer, data[block_start + counter]);
+            counter = counter + 1;
+        }
+
+        block_start = block_start + block_length;
+
+        if(block_length == 254)
+        {
+            // Full block, no zero to skip
+            if(block_start == length)
+            {
+                break;
+            }
+        }
+        else if(block_start == length)
+        {
+            break;
+        }
+        else
+        {
+            // Skip the zero
+            block_start = block_start + 1;
+        }
+    }
+
+    writer_putc(writer, 0);
+}
+
+// =================================================================================
+// Frames
+
+// Appends the CRC to a response and sends it
+void binframe_respond(writer_t* writer, uint8_t* response, uint16_t length)
+{
+    uint16_t    crc = binframe_crc16(response, length);
+
+    response[length] = crc >> 8;
+    response[length + 1] = crc & 0xFF;
+
+    binframe_cobs_write(writer, response, length + 2);
+    writer_flush(writer);
+}
+
+void binframe_nak(writer_t* writer, uint8_t sequence, uint8_t error)
+{
+    uint8_t response[5];
+
+    response[0] = BINFRAME_NAK;
+    response[1] = sequence;
+    response[2] = error;
+
+    binframe_respond(writer, response, 3);
+}
+
+// Returns the length of a set item, or a negative error
+int16_t binframe_item_length(const uint8_t* item, uint16_t remaining)
+{
+    int16_t     length = 0;
+
+    if(remaining < 4)
+    {
+        return(-BINFRAME_ERROR_LENGTH);
+    }
+
+    if(((item[0] << 8) | item[1]) >= entity_get_count())
+    {
+        return(-BINFRAME_ERROR_HANDLE);
+    }
+
+    if(item[2] == BINFRAME_TYPE_STRING)
+    {
+        length = 4 + item[3];
+    }
+    else if((item[2] == BINFRAME_TYPE_INT32) || (item[2] == BINFRAME_TYPE_FLOAT32))
+    {
+        length = 7;
+    }
+    else if(item[2] == BINFRAME_TYPE_BOOL)
+    {
+        length = 4;
+    }
+    else
+    {
+        return(-BINFRAME_ERROR_TYPE);
+    }
+
+    if(length > remaining)
+    {
+        return(-BINFRAME_ERROR_LENGTH);
+    }
+
+    return(length);
+}
+
+// Sets an entity the same way as a JSON fragment with a one element "v" array
+bool binframe_set_item(const uint8_t* item, char* text, char* json_buffer, uint16_t json_size)
+{
+    writer_t        json;
+    entity_handle_t handle = (item[0] << 8) | item[1];
+    uint32_t        raw = 0;
+    float           real = 0;
+
+    if((item[2] == BINFRAME_TYPE_INT32) || (item[2] == BINFRAME_TYPE_FLOAT32))
+    {
+        raw = ((uint32_t) item[3] << 24) | ((uint32_t) item[4] << 16) | ((uint32_t) item[5] << 8) | item[6];
+    }
+
+    if(item[2] == BINFRAME_TYPE_STRING)
+    {
+        memcpy(text, &item[4], item[3]);
+        text[item[3]] = 0;
+    }
+    else if(item[2] == BINFRAME_TYPE_INT32)
+    {
+        snprintf(text, 256, "%ld", (long) (int32_t) raw);
+    }
+    else if(item[2] == BINFRAME_TYPE_FLOAT32)
+    {
+        memcpy(&real, &raw, sizeof(real));
+        snprintf(text, 256, "%g", real);
+    }
+    else
+    {
+        strcpy(text, (item[3] != 0) ? "true" : "false");
+    }
+
+    // Quoted and escaped, so the store sees exactly what the JSON path would give it
+    writer_init_buffer(&json, json_buffer, json_size, WRITER_MODE_RAW);
+    writer_putc(&json, '[');
+    writer_json_string(&json, text);
+    writer_putc(&json, ']');
+
+    if(writer_flush(&json) == false)
+    {
+        return(false);
+    }
+
+    return(entity_set_values(entity_get_eid(handle), json_buffer));
+}
+
+bool binframe_process(const uint8_t* encoded, uint16_t length, writer_t* writer)
+{
+    uint8_t*    frame = arena_alloc(&scratch_arena, length);
+    uint8_t     response[BINFRAME_MAX_RESPONSE + 2];
+    uint16_t    frame_length = 0;
+    uint16_t    response_length = 0;
+    uint16_t    position = 0;
+    uint16_t    handle = 0;
+    int16_t     item_length = 0;
+    uint8_t     sequence = 0;
+    uint8_t     set_count = 0;
+    char*       text = NULL;
+    char*       json_buffer = NULL;
+
+    if(frame == NULL)
+    {
+        binframe_nak(writer, 0, BINFRAME_ERROR_MEMORY);
+        return(false);
+    }
+
+    frame_length = binframe_cobs_decode(encoded, length, frame);
+
+    if(frame_length < 4)
+    {
+        binframe_nak(writer, 0, BINFRAME_ERROR_FRAMING);
+        return(false);
+    }
+
+    sequence = frame[1];
+
+    if(binframe_crc16(frame, frame_length - 2) != ((frame[frame_length - 2] << 8) | frame[frame_length - 1]))
+    {
+        binframe_nak(writer, sequence, BINFRAME_ERROR_CRC);
+        return(false);
+    }
+
+    frame_length = frame_length - 2;
+    response[1] = sequence;
+
+    if(frame[0] == BINFRAME_SET)
+    {
+        // Check every item before applying any of them, as for a JSON batch
+        position = 2;
+        while(position != frame_length)
+        {
+            item_length = binframe_item_length(&frame[position], frame_length - position);
+
+            if(item_length < 0)
+            {
+                binframe_nak(writer, sequence, -item_length);
+                return(false);
+            }
+
+            position = position + item_length;
+        }
+
+        // Worst case every character is escaped as \u00XX
+        text = arena_alloc(&scratch_arena, 256);
+        json_buffer = arena_alloc(&scratch_arena, BINFRAME_JSON_SIZE);
+
+        if((text == NULL) || (json_buffer == NULL))
+        {
+            binframe_nak(writer, sequence, BINFRAME_ERROR_MEMORY);
+            return(false);
+        }
+
+        // Applied with one generation, and drawn as one update
+        entity_batch_begin();
+
+        position = 2;
+        while(position != frame_length)
+        {
+            if(binframe_set_item(&frame[position], text, json_buffer, BINFRAME_JSON_SIZE) == true)
+            {
+                set_count = set_count + 1;
+            }
+
+            position = position + binframe_item_length(&frame[position], frame_length - position);
+        }
+
+        entity_batch_end();
+
+        response[0] = BINFRAME_ACK;
+        response[2] = set_count;
+        binframe_respond(writer, response, 3);
+
+        return(set_count != 0);
+    }
+    else if(frame[0] == BINFRAME_GET)
+    {
+        response[0] = BINFRAME_VALUES;
+        response_length = 2;
+
+        position = 2;
+        while(position + 1 < frame_length)
+        {
+            handle = (frame[position] << 8) | frame[position + 1];
+
+            if(handle >= entity_get_count())
+            {
+                binframe_nak(writer, sequence, BINFRAME_ERROR_HANDLE);
+                return(false);
+            }
+
+            if(response_length + 4 + ENTITY_VALUE_LENGTH > BINFRAME_MAX_RESPONSE)
+            {
+                binframe_nak(writer, sequence, BINFRAME_ERROR_LENGTH);
+                return(false);
+            }
+
+            response[response_length] = handle >> 8;
+            response[response_length + 1] = handle & 0xFF;
+            response[response_length + 2] = BINFRAME_TYPE_STRING;
+            entity_get_value(handle, (char*) &response[response_length + 4], ENTITY_VALUE_LENGTH);
+            response[response_length + 3] = strlen((char*) &response[response_length + 4]);
+            response_length = response_length + 4 + response[response_length + 3];
+
+            position = position + 2;
+        }
+
+        binframe_respond(writer, response, response_length);
+    }
+    else if(frame[0] == BINFRAME_LIST)
+    {
+        // As many entities as fit, starting from the requested handle
+        handle = 0;
+        if(frame_length >= 4)
+        {
+            handle = (frame[2] << 8) | frame[3];
+        }
+
+        response[0] = BINFRAME_ENTITIES;
+        response[2] = entity_get_count() >> 8;
+        response[3] = entity_get_count() & 0xFF;
+        response_length = 4;
+
+        while((handle < entity_get_count()) && (response_length + 3 + (SNON_URN_LENGTH - 1) <= BINFRAME_MAX_RESPONSE))
+        {
+            response[response_length] = handle >> 8;
+            response[response_length + 1] = handle & 0xFF;
+            response[response_length + 2] = strlen(entity_get_eid(handle));
+            memcpy(&response[response_length + 3], entity_get_eid(handle), response[response_length + 2]);
+            response_length = response_length + 3 + response[response_length + 2];
+
+            handle = handle + 1;
+        }
+
+        binframe_respond(writer, response, response_length);
+    }
+    else if(frame[0] == BINFRAME_EXIT)
+    {
+        response[0] = BINFRAME_ACK;
+        response[2] = 0;
+        binframe_respond(writer, response, 3);
+
+        // The acknowledgement must leave before newline translation is back on
+        uart_tx_flush();
+        uart_set_binary_mode(false);
+    }
+    else
+    {
+        binframe_nak(writer, sequence, BINFRAME_ERROR_TYPE);
+    }
+
+    return(false);
+}
@@ -0,0 +1,62 @@
+// ---------------------------------------------------------------------------------
+// Binary SNON framing - Header
+// ---------------------------------------------------------------------------------
+// COBS framed messages with a CRC16, addressing entities by handle instead of
+// by eID. Entered with the "binary" command, and left with an exit frame.
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+
+#pragma once
+#ifndef BINFRAME_H
+#define BINFRAME_H
+
+#include "pico/stdlib.h"
+#include "writer.h"
+
+// Frame layout, before COBS encoding:
+//   Byte 0:       Frame type
+//   Byte 1:       Sequence number, echoed in the response
+//   Bytes 2-n:    Payload
+//   Last 2 bytes: CRC16-CCITT (0x1021, initial 0xFFFF) of everything before it, MSB first
+// Multi-byte fields are MSB first. Encoded frames end with a zero byte.
+
+// Request frame types
+#define BINFRAME_SET            0x01    // Items of handle(2), value type(1), value
+#define BINFRAME_GET            0x02    // Handles(2)
+#define BINFRAME_LIST           0x03    // First handle(2)
+#define BINFRAME_EXIT           0x7F    // Return to text commands
+
+// Response frame types
+#define BINFRAME_ACK            0x81    // Number of values set(1)
+#define BINFRAME_VALUES         0x82    // Items of handle(2), BINFRAME_TYPE_STRING, length(1), value
+#define BINFRAME_ENTITIES       0x83    // Entity count(2), then items of handle(2), length(1), eID
+#define BINFRAME_NAK            0xFF    // Error(1)
+
+// Value types
+#define BINFRAME_TYPE_STRING    0x01    // Length(1), characters
+#define BINFRAME_TYPE_INT32     0x02    // Signed, 4 bytes
+#define BINFRAME_TYPE_FLOAT32   0x03    // IEEE 754 single, 4 bytes
+#define BINFRAME_TYPE_BOOL      0x04    // 1 byte
+
+// Errors
+#define BINFRAME_ERROR_FRAMING  0x01    // Bad COBS encoding or too short
+#define BINFRAME_ERROR_CRC      0x02
+#define BINFRAME_ERROR_TYPE     0x03    // Unknown frame or value type
+#define BINFRAME_ERROR_HANDLE   0x04    // Entity handle out of range
+#define BINFRAME_ERROR_LENGTH   0x05    // Payload ends inside an item
+#define BINFRAME_ERROR_MEMORY   0x06
+
+#define BINFRAME_MAX_RESPONSE   250
+
+// Codec
+uint16_t binframe_crc16(const uint8_t* data, uint16_t length);
+uint16_t binframe_cobs_decode(const uint8_t* encoded, uint16_t length, uint8_t* decoded);
+void binframe_cobs_write(writer_t* writer, const uint8_t* data, uint16_t length);
+
+// Handles a received frame (without its zero delimiter). Returns true if values were set.
+bool binframe_process(const uint8_t* encoded, uint16_t length, writer_t* writer);
+
+#endif // BINFRAME_H
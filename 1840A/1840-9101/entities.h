@@ -0,0 +1,77 @@
+// ---------------------------------------------------------------------------------
+// SNON entity handles - Header
+// ---------------------------------------------------------------------------------
+// Table of the SNON entities rendered by the panel, with change notification
+// from the command loop (core 0) to the HMI (core 1), and copies of their
+// values that can be read from either core or from interrupt handlers
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+
+#pragma once
+#ifndef ENTITIES_H
+#define ENTITIES_H
+
+#include "pico/stdlib.h"
+#include "json_tok.h"
+
+// Build options
+//  ENTITY_MAX_COUNT=<n>    Size of the entity table, which holds two copies of each value
+#ifndef ENTITY_MAX_COUNT
+#define ENTITY_MAX_COUNT        160
+#endif
+
+// Constants
+#define ENTITY_VALUE_LENGTH     32
+#define ENTITY_INVALID          0xFFFF
+
+// Change records pushed through the inter-core FIFO
+// Bits 31-17: Entity handle, Bit 16: Last record of an update, Bits 15-0: Generation
+#define ENTITY_RECORD(handle, last, generation)     (((uint32_t) (handle) << 17) | ((last) ? (1u << 16) : 0) | ((generation) & 0xFFFF))
+#define ENTITY_RECORD_HANDLE(record)                ((uint16_t) ((record) >> 17))
+#define ENTITY_RECORD_LAST(record)                  (((record) & (1u << 16)) != 0)
+#define ENTITY_RECORD_GENERATION(record)            ((uint16_t) ((record) & 0xFFFF))
+
+// Types
+typedef uint16_t entity_handle_t;
+
+typedef struct
+{
+    uint32_t    updates;            // Number of times core 1 woke up to redraw
+    uint32_t    records;            // Number of change records received
+    uint32_t    duplicates;         // Change records for a generation already drawn
+    uint32_t    overflows;          // Times the FIFO was full and a full redraw was forced
+    uint32_t    truncated;          // Values cut short to fit ENTITY_VALUE_LENGTH
+    uint32_t    latency_last_us;    // Set-to-glass latency of the most recent update
+    uint32_t    latency_max_us;     // Worst set-to-glass latency seen
+    uint64_t    idle_us;            // Time core 1 has spent waiting for changes
+    uint64_t    start_us;           // When core 1 started waiting for changes
+} entity_stats_t;
+
+// Registration (core 0, before core 1 is launched)
+entity_handle_t entity_register(const char* name, uint32_t widgets);
+
+// Lookups (any core)
+entity_handle_t entity_find_eid(const char* eid);
+entity_handle_t entity_find_name(const char* name);
+const char* entity_get_eid(entity_handle_t handle);
+uint16_t entity_get_count(void);
+
+// Updates (core 0)
+bool entity_set_values(const char* eid, const char* values);
+bool entity_set_tokens(const char* eid, const char* json, const json_tok_t* tokens, int16_t count, int16_t values);
+void entity_batch_begin(void);
+void entity_batch_end(void);
+
+// Values (any core, including interrupt handlers)
+bool entity_get_value(entity_handle_t handle, char* buffer, uint16_t length);
+double entity_get_value_as_double(entity_handle_t handle);
+
+// Notification (core 1)
+uint32_t entity_wait_changes(void);
+void entity_changes_drawn(void);
+const entity_stats_t* entity_get_stats(void);
+
+#endif // ENTITIES_H
@@ -0,0 +1,334 @@
+// ---------------------------------------------------------------------------------
+// SNON fragments
+// ---------------------------------------------------------------------------------
+// Sets entity values from the SNON lines the host sends, either one
+// {"eID":...,"v":[...]} fragment or a [...] batch of them, and writes the reply
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+#include <stdio.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+
+#include "fragment.h"
+#include "arena.h"
+#include "entities.h"
+#include "indicators.h"
+#include "json_tok.h"
+#include "logger.h"
+#include "reply.h"
+#include "store.h"
+#include "subscribe.h"
+#include "snon/snon_utils.h"
+
+// Types
+
+// A batch acknowledgement that may be finished from the command loop. The batch
+// line and its tokens stay where they are until it has gone, as no other line is
+// taken and the scratch arena isn't reset while a response is pending.
+typedef struct
+{
+    const char*         batch;
+    const json_tok_t*   tokens;
+    int16_t             token_count;
+    const int16_t*      objects;            // Token of each fragment
+    const uint8_t*      errors;             // Result of each fragment
+} fragment_ack_t;
+
+// Global variables
+bool            fragment_changed = false;           // Values were set by the line being handled
+fragment_ack_t  fragment_ack;
+
+// Private prototypes
+uint8_t fragment_set_values(const char* fragment, const json_tok_t* tokens, int16_t count, int16_t object, char* eid);
+bool fragment_values_valid(const char* fragment, const json_tok_t* tokens, int16_t count, int16_t object, const char* eid);
+int16_t fragment_tokenize(const char* fragment, json_tok_t** tokens);
+bool fragment_ack_next(writer_t* writer, uint32_t* cursor, const void* argument);
+
+// =================================================================================
+
+// Sets the values in one {"eID":...,"v":[...]} object. Returns 0, or the reply
+// error if it has no eID, the values aren't allowed, or they couldn't be stored.
+uint8_t fragment_set_values(const char* fragment, const json_tok_t* tokens, int16_t count, int16_t object, char* eid)
+{
+    int16_t     eid_token = json_tok_find_key(fragment, tokens, count, object, "eID");
+    int16_t     value_token = json_tok_find_key(fragment, tokens, count, object, "v");
+
+    if((eid_token == -1) || (tokens[eid_token].type != JSON_TOK_STRING))
+    {
+        return(REPLY_ERROR_NO_EID);
+    }
+
+    json_tok_copy(fragment, &tokens[eid_token], eid, SNON_URN_LENGTH);
+
+    if((value_token != -1) && (tokens[value_token].type == JSON_TOK_ARRAY))
+    {
+        if(indicator_check_tokens(eid, fragment, tokens, count, value_token) == false)
+        {
+            logger_log_text(LOGGER_WARNING, "Invalid indicator state for eID %s", eid, 0);
+            return(REPLY_ERROR_BAD_VALUE);
+        }
+
+        // Update the value. The values array is copied into the store straight
+        // from the fragment, as it was received.
+        logger_log_text(LOGGER_INFO, "New value for eID %s (%lu characters)", eid, 1, (uint32_t) (tokens[value_token].end - tokens[value_token].start));
+
+        if(entity_set_tokens(eid, fragment, tokens, count, value_token) == false)
+        {
+            if(store_find(eid) == STORE_INVALID)
+            {
+                return(REPLY_ERROR_NOT_FOUND);
+            }
+
+            logger_log_text(LOGGER_WARNING, "Unable to store the value of %s", eid, 0);
+            return(REPLY_ERROR_NO_MEMORY);
+        }
+
+        fragment_changed = true;
+    }
+
+    return(0);
+}
+
+// Checks the values in one {"eID":...,"v":[...]} object without setting them
+bool fragment_values_valid(const char* fragment, const json_tok_t* tokens, int16_t count, int16_t object, const char* eid)
+{
+    int16_t     value_token = json_tok_find_key(fragment, tokens, count, object, "v");
+
+    if((value_token == -1) || (tokens[value_token].type != JSON_TOK_ARRAY))
+    {
+        return(true);
+    }
+
+    return(indicator_check_tokens(eid, fragment, tokens, count, value_token));
+}
+
+// Tokenizes a fragment into tokens allocated from the scratch arena
+int16_t fragment_tokenize(const char* fragment, json_tok_t** tokens)
+{
+    uint16_t    length = strlen(fragment);
+    uint16_t    token_count = (length / 2) + 2;
+
+    // A token takes at least two characters of the fragment
+    if(token_count > FRAGMENT_TOKEN_MAX)
+    {
+        token_count = FRAGMENT_TOKEN_MAX;
+    }
+
+    *tokens = arena_alloc(&scratch_arena, sizeof(json_tok_t) * token_count);
+
+    if(*tokens == NULL)
+    {
+        return(JSON_TOK_ERROR_NOMEM);
+    }
+
+    return(json_tok_parse(fragment, length, *tokens, token_count));
+}
+
+// Acknowledges the fragments of a batch from the cursor on, until the writer is
+// busy. Returns true once the array has been closed.
+bool fragment_ack_next(writer_t* writer, uint32_t* cursor, const void* argument)
+{
+    const fragment_ack_t*   ack = (const fragment_ack_t*) argument;
+    int16_t                 object = 0;
+    int16_t                 eid_token = 0;
+    char                    eid[SNON_URN_LENGTH];
+    reply_rid_t             rid;
+
+    while(*cursor != ack->tokens[0].size)
+    {
+        if(writer_busy(writer) == true)
+        {
+            return(false);
+        }
+
+        object = ack->objects[*cursor];
+        eid_token = json_tok_find_key(ack->batch, ack->tokens, ack->token_count, object, "eID");
+        json_tok_copy(ack->batch, &ack->tokens[eid_token], eid, SNON_URN_LENGTH);
+        reply_get_rid(ack->batch, ack->tokens, ack->token_count, object, &rid);
+
+        if(*cursor != 0)
+        {
+            writer_putc(writer, ',');
+        }
+
+        if(ack->errors[*cursor] != 0)
+        {
+            reply_error(writer, ack->errors[*cursor], &rid);
+        }
+        else if(reply_entity(writer, eid, &rid) == false)
+        {
+            reply_error(writer, REPLY_ERROR_NOT_FOUND, &rid);
+        }
+
+        *cursor = *cursor + 1;
+    }
+
+    writer_putc(writer, ']');
+
+    return(true);
+}
+
+// =================================================================================
+
+// Sets the values in one fragment, or subscribes to entities, and replies with
+// the entity or an error
+bool fragment_process(writer_t* writer, const char* fragment)
+{
+    // Tokenize once, and work from slices of the fragment
+    json_tok_t* tokens = NULL;
+    int16_t     token_count = fragment_tokenize(fragment, &tokens);
+    uint8_t     error = 0;
+    char        eid[SNON_URN_LENGTH];
+    reply_rid_t rid;
+
+    fragment_changed = false;
+
+    if((token_count < 1) || (tokens[0].type != JSON_TOK_OBJECT))
+    {
+        logger_log(LOGGER_WARNING, "Invalid SNON fragment (%ld)", 1, (int32_t) token_count);
+        reply_error(writer, REPLY_ERROR_INVALID, NULL);
+    }
+    else if(subscribe_fragment(writer, fragment, tokens, token_count) == true)
+    {
+        // Subscription requests are answered by subscribe_fragment()
+    }
+    else
+    {
+        reply_get_rid(fragment, tokens, token_count, 0, &rid);
+        error = fragment_set_values(fragment, tokens, token_count, 0, eid);
+
+        if(error == REPLY_ERROR_NO_EID)
+        {
+            logger_log(LOGGER_WARNING, "Unable to find eID", 0);
+            reply_error(writer, REPLY_ERROR_NO_EID, &rid);
+        }
+        else if(error != 0)
+        {
+            reply_error(writer, error, &rid);
+        }
+        else if(reply_entity(writer, eid, &rid) == false)
+        {
+            logger_log_text(LOGGER_WARNING, "Unable to find entity with eID %s", eid, 0);
+            reply_error(writer, REPLY_ERROR_NOT_FOUND, &rid);
+        }
+    }
+
+    return(fragment_changed);
+}
+
+// Sets the values in a batch of fragments, applied together and drawn as one
+// update, and replies with an array of the entities. Nothing is set unless every
+// fragment is valid.
+bool fragment_process_batch(writer_t* writer, const char* batch)
+{
+    json_tok_t* tokens = NULL;
+    int16_t     token_count = fragment_tokenize(batch, &tokens);
+    int16_t     token = 1;
+    int16_t     eid_token = 0;
+    uint16_t    counter = 0;
+    uint32_t    cursor = 0;
+    bool        batch_valid = true;
+    uint8_t     batch_error = REPLY_ERROR_INVALID;
+    uint8_t*    batch_errors = NULL;
+    int16_t*    batch_objects = NULL;
+    char        eid[SNON_URN_LENGTH];
+    reply_rid_t rid;
+
+    fragment_changed = false;
+
+    if((token_count < 1) || (tokens[0].type != JSON_TOK_ARRAY))
+    {
+        logger_log(LOGGER_WARNING, "Invalid SNON batch (%ld)", 1, (int32_t) token_count);
+        batch_valid = false;
+    }
+
+    // Check every fragment before applying any of them. The request ID of the
+    // first bad fragment is kept for the error.
+    rid.present = false;
+    while((batch_valid == true) && (counter != tokens[0].size))
+    {
+        eid_token = json_tok_find_key(batch, tokens, token_count, token, "eID");
+        reply_get_rid(batch, tokens, token_count, token, &rid);
+
+        if((eid_token == -1) || (tokens[eid_token].type != JSON_TOK_STRING))
+        {
+            logger_log(LOGGER_WARNING, "Batch fragment %lu has no eID", 1, (uint32_t) counter);
+            batch_error = REPLY_ERROR_NO_EID;
+            batch_valid = false;
+        }
+        else
+        {
+            json_tok_copy(batch, &tokens[eid_token], eid, SNON_URN_LENGTH);
+
+            if(store_find(eid) == STORE_INVALID)
+            {
+                logger_log_text(LOGGER_WARNING, "Unable to find entity with eID %s", eid, 0);
+                batch_error = REPLY_ERROR_NOT_FOUND;
+                batch_valid = false;
+            }
+            else if(fragment_values_valid(batch, tokens, token_count, token, eid) == false)
+            {
+                logger_log_text(LOGGER_WARNING, "Invalid indicator state for eID %s", eid, 0);
+                batch_error = REPLY_ERROR_BAD_VALUE;
+                batch_valid = false;
+            }
+        }
+
+        token = json_tok_skip(tokens, token_count, token);
+        counter = counter + 1;
+    }
+
+    // Where each fragment is, and its result, kept for the acknowledgement
+    if(batch_valid == true)
+    {
+        batch_errors = arena_alloc(&scratch_arena, tokens[0].size);
+        batch_objects = arena_alloc(&scratch_arena, sizeof(int16_t) * tokens[0].size);
+
+        if((batch_errors == NULL) || (batch_objects == NULL))
+        {
+            batch_error = REPLY_ERROR_NO_MEMORY;
+            batch_valid = false;
+        }
+    }
+
+    if(batch_valid == false)
+    {
+        reply_error(writer, batch_error, &rid);
+        return(false);
+    }
+
+    entity_batch_begin();
+
+    token = 1;
+    counter = 0;
+    while(counter != tokens[0].size)
+    {
+        batch_objects[counter] = token;
+        batch_errors[counter] = fragment_set_values(batch, tokens, token_count, token, eid);
+
+        token = json_tok_skip(tokens, token_count, token);
+        counter = counter + 1;
+    }
+
+    entity_batch_end();
+
+    // Acknowledge with the updated entities
+    fragment_ack.batch = batch;
+    fragment_ack.tokens = tokens;
+    fragment_ack.token_count = token_count;
+    fragment_ack.objects = batch_objects;
+    fragment_ack.errors = batch_errors;
+
+    writer_putc(writer, '[');
+
+    if(fragment_ack_next(writer, &cursor, &fragment_ack) == false)
+    {
+        writer_defer(writer, fragment_ack_next, cursor, &fragment_ack);
+    }
+
+    return(fragment_changed);
+}
@@ -0,0 +1,28 @@
+// ---------------------------------------------------------------------------------
+// SNON fragments - Header
+// ---------------------------------------------------------------------------------
+// Sets entity values from the SNON lines the host sends, either one
+// {"eID":...,"v":[...]} fragment or a [...] batch of them, and writes the reply
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+
+#pragma once
+#ifndef FRAGMENT_H
+#define FRAGMENT_H
+
+#include "pico/stdlib.h"
+#include "writer.h"
+
+// Constants
+#define FRAGMENT_TOKEN_MAX      256
+
+// Handle a line (core 0). Tokens come from the scratch arena, so it has to be
+// reset once the line, and any of the reply left for the command loop, is done
+// with. Both return true if values were set.
+bool fragment_process(writer_t* writer, const char* fragment);
+bool fragment_process_batch(writer_t* writer, const char* batch);
+
+#endif // FRAGMENT_H
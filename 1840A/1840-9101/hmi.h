@@ -9,6 +9,8 @@
 // ---------------------------------------------------------------------------------
 
 // Utility routines
+void init_gen_entities(void);
+void init_gen_leds(void);
 void init_gen_screens(void);
 void update_gen_screens(void);
 bool draw_gen_leds(struct repeating_timer *t);
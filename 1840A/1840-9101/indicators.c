@@ -0,0 +1,431 @@
+// ---------------------------------------------------------------------------------
+// VITA 40 indicators
+// ---------------------------------------------------------------------------------
+// Indicator states are checked and turned into a small state number when they
+// are set, so the LED timer only has to look up a colour in a blink table
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+
+#include "indicators.h"
+#include "json_tok.h"
+#include "store.h"
+#include "snon/snon_utils.h"
+#include "pico-utils/ws2812.h"
+
+// Blink patterns, one bit per phase of the blink cycle
+#define BLINK_STEADY            0b1111111111
+#define BLINK_FAST              0b0101010101
+#define BLINK_SLOW              0b0000011111
+#define BLINK_STANDBY           0b0000000001
+
+// Types
+typedef struct
+{
+    const char* name;
+    uint8_t     red;
+    uint8_t     green;
+    uint8_t     blue;
+    uint16_t    blink;
+    uint16_t    fade_ms;            // Time taken to fade to a new colour, on animated LED maps
+} indicator_definition_t;
+
+typedef struct
+{
+    char        eid[SNON_URN_LENGTH];
+    uint32_t    eid_hash;
+} indicator_t;
+
+// Global variables
+const indicator_definition_t indicator_definitions[INDICATOR_STATE_COUNT] =
+{
+    { "vita40_off",             0,  0,  0,  BLINK_STEADY,   250 },
+    { "vita40_red_steady",      10, 0,  0,  BLINK_STEADY,   250 },
+    { "vita40_white_steady",    8,  8,  10, BLINK_STEADY,   250 },
+    { "vita40_white_fast",      8,  8,  10, BLINK_FAST,     40 },
+    { "vita40_blue_steady",     0,  0,  10, BLINK_STEADY,   250 },
+    { "vita40_amber_steady",    10, 10, 0,  BLINK_STEADY,   250 },
+    { "vita40_amber_slow",      10, 10, 0,  BLINK_SLOW,     500 },
+    { "vita40_green_steady",    0,  10, 0,  BLINK_STEADY,   250 },
+    { "vita40_green_slow",      0,  10, 0,  BLINK_SLOW,     500 },
+    { "vita40_green_standby",   0,  10, 0,  BLINK_STANDBY,  40 },
+    { "vita40_green_feedback",  0,  10, 0,  BLINK_STEADY,   250 }
+};
+
+uint32_t            indicator_frames[INDICATOR_STATE_COUNT][INDICATOR_PHASE_COUNT];
+uint16_t            indicator_flips[INDICATOR_STATE_COUNT];    // Phases where the colour differs from the phase before
+indicator_t         indicators[INDICATOR_MAX_COUNT];
+volatile uint8_t    indicator_states[INDICATOR_MAX_COUNT];     // Written by core 0, read by the LED timer
+volatile bool       indicator_dirty[INDICATOR_MAX_COUNT];      // Set when the state is written, cleared by the LED timer
+uint16_t            indicator_count = 0;
+indicator_stats_t   indicator_stats;
+
+// Private prototypes
+uint32_t indicator_hash(const char* eid);
+uint8_t indicator_parse_values(const char* values);
+
+// =================================================================================
+// Setup
+
+// Works out the colour of every state in every phase of the blink cycle, and
+// the phases where it changes
+void indicators_initialize(void)
+{
+    const indicator_definition_t*   definition = NULL;
+    uint8_t                         state = 0;
+    uint8_t                         phase = 0;
+    uint8_t                         previous = 0;
+
+    while(state != INDICATOR_STATE_COUNT)
+    {
+        definition = &indicator_definitions[state];
+
+        phase = 0;
+        while(phase != INDICATOR_PHASE_COUNT)
+        {
+            if((definition->blink & (1 << phase)) != 0)
+            {
+                indicator_frames[state][phase] = urgb_u32(definition->red, definition->green, definition->blue);
+            }
+            else
+            {
+                indicator_frames[state][phase] = urgb_u32(0, 0, 0);
+            }
+
+            phase = phase + 1;
+        }
+
+        indicator_flips[state] = 0;
+        phase = 0;
+        while(phase != INDICATOR_PHASE_COUNT)
+        {
+            previous = (phase + INDICATOR_PHASE_COUNT - 1) % INDICATOR_PHASE_COUNT;
+
+            if(indicator_frames[state][phase] != indicator_frames[state][previous])
+            {
+                indicator_flips[state] = indicator_flips[state] | (1 << phase);
+            }
+
+            phase = phase + 1;
+        }
+
+        state = state + 1;
+    }
+}
+
+// FNV-1a hash of an eID, used to skip most string compares during lookups
+uint32_t indicator_hash(const char* eid)
+{
+    uint32_t hash = 2166136261u;
+
+    while(*eid != 0)
+    {
+        hash = (hash ^ (uint8_t) *eid) * 16777619u;
+        eid = eid + 1;
+    }
+
+    return(hash);
+}
+
+// Adds an SNON value entity drawn as an indicator. Its current value is used as
+// the starting state, or off if it isn't a valid state.
+indicator_handle_t indicator_register(const char* name)
+{
+    indicator_t*    indicator = NULL;
+    uint8_t         state = INDICATOR_STATE_INVALID;
+    const char*     value = NULL;
+
+    if(indicator_count == INDICATOR_MAX_COUNT)
+    {
+        printf("Indicator table full, unable to add \"%s\"\n", name);
+        return(INDICATOR_NONE);
+    }
+
+    indicator = &indicators[indicator_count];
+    snon_name_to_eid((char*) name, indicator->eid);
+    indicator->eid_hash = indicator_hash(indicator->eid);
+
+    value = store_get_value(store_find(name));
+    if(value != NULL)
+    {
+        state = indicator_parse(value);
+    }
+
+    if(state == INDICATOR_STATE_INVALID)
+    {
+        state = INDICATOR_OFF;
+    }
+
+    indicator_states[indicator_count] = state;
+    indicator_dirty[indicator_count] = true;
+    indicator_count = indicator_count + 1;
+
+    return(indicator_count - 1);
+}
+
+indicator_handle_t indicator_find_eid(const char* eid)
+{
+    uint32_t            hash = indicator_hash(eid);
+    indicator_handle_t  handle = 0;
+
+    while(handle != indicator_count)
+    {
+        if((indicators[handle].eid_hash == hash) && (strcmp(indicators[handle].eid, eid) == 0))
+        {
+            return(handle);
+        }
+
+        handle = handle + 1;
+    }
+
+    return(INDICATOR_NONE);
+}
+
+// =================================================================================
+// States
+
+uint8_t indicator_parse(const char* state)
+{
+    uint8_t counter = 0;
+
+    while(counter != INDICATOR_STATE_COUNT)
+    {
+        if(strcmp(state, indicator_definitions[counter].name) == 0)
+        {
+            return(counter);
+        }
+
+        counter = counter + 1;
+    }
+
+    return(INDICATOR_STATE_INVALID);
+}
+
+const char* indicator_state_name(uint8_t state)
+{
+    if(state >= INDICATOR_STATE_COUNT)
+    {
+        return("unknown");
+    }
+
+    return(indicator_definitions[state].name);
+}
+
+// Parses the first string in a values array
+uint8_t indicator_parse_values(const char* values)
+{
+    char        state[INDICATOR_VALUES_LENGTH];
+    const char* start = strchr(values, '"');
+    const char* end = NULL;
+
+    if(start == NULL)
+    {
+        return(INDICATOR_STATE_INVALID);
+    }
+
+    start = start + 1;
+    end = strchr(start, '"');
+
+    if((end == NULL) || ((end - start) >= INDICATOR_VALUES_LENGTH))
+    {
+        return(INDICATOR_STATE_INVALID);
+    }
+
+    memcpy(state, start, end - start);
+    state[end - start] = 0;
+
+    return(indicator_parse(state));
+}
+
+// =================================================================================
+// Updates
+
+// Checks the values before they are stored, so that the LEDs are only changed
+// once the store has taken them
+bool indicator_check_values(const char* eid, const char* values)
+{
+    if(indicator_find_eid(eid) == INDICATOR_NONE)
+    {
+        return(true);
+    }
+
+    if(indicator_parse_values(values) == INDICATOR_STATE_INVALID)
+    {
+        indicator_stats.rejected = indicator_stats.rejected + 1;
+        return(false);
+    }
+
+    return(true);
+}
+
+// As above, for a values array that has already been tokenized. The state has
+// to be the first item.
+bool indicator_check_tokens(const char* eid, const char* json, const json_tok_t* tokens, int16_t count, int16_t values)
+{
+    const json_tok_t*   first = &tokens[values + 1];
+    char                state[INDICATOR_VALUES_LENGTH];
+
+    if(indicator_find_eid(eid) == INDICATOR_NONE)
+    {
+        return(true);
+    }
+
+    if((values + 1 < count) && (tokens[values].size != 0) && (first->type == JSON_TOK_STRING) && ((first->end - first->start) < INDICATOR_VALUES_LENGTH))
+    {
+        json_tok_copy(json, first, state, INDICATOR_VALUES_LENGTH);
+
+        if(indicator_parse(state) != INDICATOR_STATE_INVALID)
+        {
+            return(true);
+        }
+    }
+
+    indicator_stats.rejected = indicator_stats.rejected + 1;
+    return(false);
+}
+
+// Unknown states are refused here, rather than being drawn as off
+bool indicator_set_values(const char* eid, const char* values)
+{
+    indicator_handle_t  handle = indicator_find_eid(eid);
+    uint8_t             state = 0;
+
+    if(handle == INDICATOR_NONE)
+    {
+        return(true);
+    }
+
+    state = indicator_parse_values(values);
+
+    if(state == INDICATOR_STATE_INVALID)
+    {
+        indicator_stats.rejected = indicator_stats.rejected + 1;
+        return(false);
+    }
+
+    // The state is stored before it is marked, so the LED timer never clears the
+    // mark without seeing the new state
+    indicator_states[handle] = state;
+    indicator_dirty[handle] = true;
+
+    return(true);
+}
+
+// For states worked out on the panel, such as by the annunciator sequences
+bool indicator_set_state(indicator_handle_t handle, uint8_t state)
+{
+    if((handle >= indicator_count) || (state >= INDICATOR_STATE_COUNT))
+    {
+        return(false);
+    }
+
+    indicator_states[handle] = state;
+    indicator_dirty[handle] = true;
+
+    return(true);
+}
+
+uint8_t indicator_get_state(indicator_handle_t handle)
+{
+    if(handle >= indicator_count)
+    {
+        return(INDICATOR_STATE_INVALID);
+    }
+
+    return(indicator_states[handle]);
+}
+
+// =================================================================================
+// LED timer
+
+uint8_t indicator_phase(uint32_t counter)
+{
+    return(counter % INDICATOR_PHASE_COUNT);
+}
+
+// True if the indicator was written since it was last drawn, or on the first
+// frame of a phase where its colour changes. Clears the written mark.
+bool indicator_needs_update(indicator_handle_t handle, uint8_t phase, bool new_phase)
+{
+    if(handle >= indicator_count)
+    {
+        return(false);
+    }
+
+    if(indicator_dirty[handle] == true)
+    {
+        indicator_dirty[handle] = false;
+        return(true);
+    }
+
+    if(new_phase == false)
+    {
+        return(false);
+    }
+
+    return((indicator_flips[indicator_states[handle]] & (1 << phase)) != 0);
+}
+
+uint32_t indicator_colour(indicator_handle_t handle, uint8_t phase)
+{
+    if(handle >= indicator_count)
+    {
+        return(indicator_frames[INDICATOR_OFF][phase]);
+    }
+
+    return(indicator_frames[indicator_states[handle]][phase]);
+}
+
+uint32_t indicator_state_colour(uint8_t state, uint8_t phase)
+{
+    if(state >= INDICATOR_STATE_COUNT)
+    {
+        state = INDICATOR_OFF;
+    }
+
+    return(indicator_frames[state][phase]);
+}
+
+// Slow blinks take a whole half cycle to fade, so they pulse rather than flash
+uint16_t indicator_fade_ms(indicator_handle_t handle)
+{
+    if(handle >= indicator_count)
+    {
+        return(0);
+    }
+
+    return(indicator_definitions[indicator_states[handle]].fade_ms);
+}
+
+// Records how long the colours of a frame took to work out, how many were
+// worked out, and whether the frame had to be sent
+void indicator_frame_done(uint32_t elapsed_us, uint16_t recomputed, bool changed)
+{
+    indicator_stats.frames = indicator_stats.frames + 1;
+    indicator_stats.recomputed = indicator_stats.recomputed + recomputed;
+
+    if(changed == false)
+    {
+        indicator_stats.unchanged = indicator_stats.unchanged + 1;
+    }
+
+    indicator_stats.last_us = elapsed_us;
+    indicator_stats.total_us = indicator_stats.total_us + elapsed_us;
+
+    if(elapsed_us > indicator_stats.max_us)
+    {
+        indicator_stats.max_us = elapsed_us;
+    }
+}
+
+const indicator_stats_t* indicator_get_stats(void)
+{
+    return(&indicator_stats);
+}
@@ -0,0 +1,534 @@
+// ---------------------------------------------------------------------------------
+// WS2812 LED strips
+// ---------------------------------------------------------------------------------
+// Sends LED frames by DMA, so the LED timer no longer waits for the pixels to
+// be clocked out with interrupts blocked. Run-length strips chain DMA control
+// blocks, so that a run of pixels is sent from one colour word. A spin lock
+// guards claiming a strip, as frames may be submitted from either core and from
+// interrupts.
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "hardware/pio.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+
+#include "ledstrip.h"
+#include "ledstats.h"
+#include "pico-utils/ws2812.h"
+#include "ws2812.pio.h"
+
+// Global variables
+ledstrip_t*         ledstrips[LEDSTRIP_MAX];
+uint8_t             ledstrip_count = 0;
+ledstrip_stats_t    ledstrip_stats;
+int                 ledstrip_serial_offsets[2] = { -1, -1 };       // ws2812 program in each PIO
+int                 ledstrip_parallel_offsets[2] = { -1, -1 };     // ws2812_parallel program in each PIO
+spin_lock_t*        ledstrip_lock = NULL;
+
+// Private prototypes
+int ledstrip_load(PIO pio, const pio_program_t* program, int* offsets);
+bool ledstrip_start(ledstrip_t* strip, PIO pio, uint pin, float freq, uint8_t bits_per_word, uint16_t words);
+void ledstrip_dma_isr(void);
+int64_t ledstrip_latched(alarm_id_t id, void* user_data);
+void ledstrip_sent(ledstrip_t* strip);
+bool ledstrip_claim(ledstrip_t* strip);
+
+// =================================================================================
+// Setup
+
+bool ledstrip_init(ledstrip_t* strip, PIO pio, uint pin, float freq, uint32_t* buffer_a, uint32_t* buffer_b, uint16_t pixel_count)
+{
+    int         offset = ledstrip_load(pio, &ws2812_program, ledstrip_serial_offsets);
+
+    if(offset < 0)
+    {
+        return(false);
+    }
+
+    strip->buffers[0] = buffer_a;
+    strip->buffers[1] = buffer_b;
+    strip->planes = NULL;
+    strip->pixel_count = pixel_count;
+    strip->lane_pixels = pixel_count;
+    strip->lanes = 1;
+
+    memset(buffer_a, 0, pixel_count * sizeof(uint32_t));
+    memset(buffer_b, 0, pixel_count * sizeof(uint32_t));
+
+    if(ledstrip_start(strip, pio, pin, freq, LEDSTRIP_BITS, pixel_count) == false)
+    {
+        return(false);
+    }
+
+    // The state machine is set up once, and keeps its pin
+    ws2812_program_init(pio, strip->sm, offset, pin, freq, false);
+
+    return(true);
+}
+
+bool ledstrip_init_parallel(ledstrip_t* strip, PIO pio, uint pin_base, uint8_t lanes, float freq, uint32_t* frame, uint32_t* planes, uint16_t pixel_count)
+{
+    int         offset = 0;
+
+    if((lanes == 0) || (lanes > LEDSTRIP_MAX_LANES))
+    {
+        printf("LED strips can be split across 1 to %u chains, not %u\n", LEDSTRIP_MAX_LANES, lanes);
+        return(false);
+    }
+
+    offset = ledstrip_load(pio, &ws2812_parallel_program, ledstrip_parallel_offsets);
+    if(offset < 0)
+    {
+        return(false);
+    }
+
+    // The frame is copied into the bit planes when it is shown, so it can be
+    // drawn into again straight away
+    strip->buffers[0] = frame;
+    strip->buffers[1] = frame;
+    strip->planes = planes;
+    strip->pixel_count = pixel_count;
+    strip->lane_pixels = LEDSTRIP_LANE_PIXELS(pixel_count, lanes);
+    strip->lanes = lanes;
+
+    memset(frame, 0, pixel_count * sizeof(uint32_t));
+    memset(planes, 0, LEDSTRIP_PLANE_WORDS(pixel_count, lanes) * sizeof(uint32_t));
+
+    if(ledstrip_start(strip, pio, pin_base, freq, 1, LEDSTRIP_PLANE_WORDS(pixel_count, lanes)) == false)
+    {
+        return(false);
+    }
+
+    ws2812_parallel_program_init(pio, strip->sm, offset, pin_base, lanes, freq);
+
+    return(true);
+}
+
+bool ledstrip_init_runs(ledstrip_t* strip, PIO pio, uint pin, float freq, ledstrip_run_t* runs, uint32_t* colours, uint16_t run_count)
+{
+    dma_channel_config  config;
+    int                 offset = 0;
+    int                 control_channel = 0;
+    uint16_t            counter = 0;
+
+    offset = ledstrip_load(pio, &ws2812_program, ledstrip_serial_offsets);
+    if(offset < 0)
+    {
+        return(false);
+    }
+
+    control_channel = dma_claim_unused_channel(false);
+    if(control_channel < 0)
+    {
+        printf("No free DMA channel for the LED runs on pin %u\n", pin);
+        return(false);
+    }
+
+    strip->buffers[0] = NULL;
+    strip->buffers[1] = NULL;
+    strip->planes = NULL;
+    strip->pixel_count = 0;
+    strip->lane_pixels = 0;
+    strip->lanes = 1;
+
+    if(ledstrip_start(strip, pio, pin, freq, LEDSTRIP_BITS, 0) == false)
+    {
+        dma_channel_unclaim(control_channel);
+        return(false);
+    }
+
+    strip->control_channel = control_channel;
+    strip->runs = runs;
+    strip->run_colours = colours;
+    strip->run_count = run_count;
+
+    // Every run starts empty, so nothing is sent until runs are set
+    while(counter <= run_count)
+    {
+        runs[counter].count = 0;
+        runs[counter].colour = NULL;
+
+        if(counter != run_count)
+        {
+            colours[counter] = 0;
+        }
+
+        counter = counter + 1;
+    }
+
+    // The data channel sends the same colour word for the whole run, then hands
+    // back to the control channel. It only interrupts when an empty run is loaded,
+    // as writing NULL to its read address trigger ends the chain.
+    config = dma_channel_get_default_config(strip->dma_channel);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_32);
+    channel_config_set_read_increment(&config, false);
+    channel_config_set_write_increment(&config, false);
+    channel_config_set_dreq(&config, pio_get_dreq(pio, strip->sm, true));
+    channel_config_set_chain_to(&config, control_channel);
+    channel_config_set_irq_quiet(&config, true);
+    dma_channel_configure(strip->dma_channel, &config, &pio->txf[strip->sm], NULL, 0, false);
+
+    // The control channel writes one run to the count and the read address trigger
+    // of the data channel, with the write address wrapping after the two words
+    config = dma_channel_get_default_config(control_channel);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_32);
+    channel_config_set_read_increment(&config, true);
+    channel_config_set_write_increment(&config, true);
+    channel_config_set_ring(&config, true, 3);
+    dma_channel_configure(control_channel, &config, &dma_hw->ch[strip->dma_channel].al3_transfer_count, runs, 2, false);
+
+    ws2812_program_init(pio, strip->sm, offset, pin, freq, false);
+
+    return(true);
+}
+
+// Runs must be set in order, before the LED timer is started. A count of 0 ends
+// the frame at that run.
+void ledstrip_set_run(ledstrip_t* strip, uint16_t run, uint16_t count)
+{
+    if(run >= strip->run_count)
+    {
+        return;
+    }
+
+    strip->pixel_count = strip->pixel_count - strip->runs[run].count + count;
+    strip->lane_pixels = strip->pixel_count;
+    strip->runs[run].count = count;
+
+    if(count != 0)
+    {
+        strip->runs[run].colour = &strip->run_colours[run];
+    }
+    else
+    {
+        strip->runs[run].colour = NULL;
+    }
+}
+
+void ledstrip_set_timed(ledstrip_t* strip, bool timed)
+{
+    strip->timed = timed;
+}
+
+// Loads a program into the PIO the first time a strip there needs it, so that
+// every strip using it shares one copy. Returns the offset, or -1 if there is no
+// room.
+int ledstrip_load(PIO pio, const pio_program_t* program, int* offsets)
+{
+    uint8_t     pio_index = pio_get_index(pio);
+
+    if(offsets[pio_index] == -1)
+    {
+        if(pio_can_add_program(pio, program) == false)
+        {
+            printf("No room for the LED program in PIO %u\n", pio_index);
+            return(-1);
+        }
+
+        offsets[pio_index] = pio_add_program(pio, program);
+    }
+
+    return(offsets[pio_index]);
+}
+
+// Claims a state machine and a DMA channel that sends words to it
+bool ledstrip_start(ledstrip_t* strip, PIO pio, uint pin, float freq, uint8_t bits_per_word, uint16_t words)
+{
+    dma_channel_config  config;
+    int                 sm = 0;
+
+    if(ledstrip_count == LEDSTRIP_MAX)
+    {
+        printf("Too many LED strips, unable to add pin %u\n", pin);
+        return(false);
+    }
+
+    sm = pio_claim_unused_sm(pio, false);
+    if(sm < 0)
+    {
+        printf("No free state machine for the LED strip on pin %u\n", pin);
+        return(false);
+    }
+
+    strip->dma_channel = dma_claim_unused_channel(false);
+    if(strip->dma_channel < 0)
+    {
+        printf("No free DMA channel for the LED strip on pin %u\n", pin);
+        pio_sm_unclaim(pio, sm);
+        return(false);
+    }
+
+    strip->pio = pio;
+    strip->sm = sm;
+    strip->control_channel = -1;
+    strip->runs = NULL;
+    strip->run_colours = NULL;
+    strip->run_count = 0;
+    strip->back = 0;
+    strip->pin = pin;
+    strip->busy = false;
+    strip->timed = true;
+    strip->frames = 0;
+    strip->skipped = 0;
+    strip->latch_us = ((LEDSTRIP_FIFO_DEPTH * bits_per_word * 1000000) / (uint32_t) freq) + LEDSTRIP_LATCH_US;
+
+    config = dma_channel_get_default_config(strip->dma_channel);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_32);
+    channel_config_set_read_increment(&config, true);
+    channel_config_set_write_increment(&config, false);
+    channel_config_set_dreq(&config, pio_get_dreq(pio, sm, true));
+    dma_channel_configure(strip->dma_channel, &config, &pio->txf[sm], NULL, words, false);
+
+    dma_channel_set_irq0_enabled(strip->dma_channel, true);
+
+    if(ledstrip_count == 0)
+    {
+        ledstrip_lock = spin_lock_init(spin_lock_claim_unused(true));
+        irq_add_shared_handler(DMA_IRQ_0, ledstrip_dma_isr, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+        irq_set_enabled(DMA_IRQ_0, true);
+    }
+
+    ledstrips[ledstrip_count] = strip;
+    ledstrip_count = ledstrip_count + 1;
+
+    return(true);
+}
+
+// =================================================================================
+// Bit planes
+
+// Turns the frame into one word for each bit time, holding that bit for every
+// chain. Chain n is bit n of the word. Chains past the end of the frame are sent
+// as off.
+void ledstrip_transpose(const uint32_t* frame, uint16_t pixel_count, uint8_t lanes, uint32_t* planes)
+{
+    uint16_t    lane_pixels = LEDSTRIP_LANE_PIXELS(pixel_count, lanes);
+    uint32_t    pixels[LEDSTRIP_MAX_LANES];
+    uint32_t    upper = 0;
+    uint32_t    lower = 0;
+    uint32_t    swap = 0;
+    uint16_t    pixel = 0;
+    uint16_t    index = 0;
+    uint8_t     lane = 0;
+    uint8_t     shift = 0;
+
+    while(pixel != lane_pixels)
+    {
+        lane = 0;
+        index = pixel;
+        while(lane != LEDSTRIP_MAX_LANES)
+        {
+            if((lane < lanes) && (index < pixel_count))
+            {
+                pixels[lane] = frame[index];
+            }
+            else
+            {
+                pixels[lane] = 0;
+            }
+
+            index = index + lane_pixels;
+            lane = lane + 1;
+        }
+
+        // Transpose each byte of the eight pixels as an 8x8 bit matrix (Hacker's
+        // Delight, transpose8rS32), with chain 7 as the first row so that chain n
+        // ends up in bit n
+        shift = 24;
+        while(shift != 0)
+        {
+            upper = (((pixels[7] >> shift) & 0xFF) << 24) | (((pixels[6] >> shift) & 0xFF) << 16) |
+                    (((pixels[5] >> shift) & 0xFF) << 8) | ((pixels[4] >> shift) & 0xFF);
+            lower = (((pixels[3] >> shift) & 0xFF) << 24) | (((pixels[2] >> shift) & 0xFF) << 16) |
+                    (((pixels[1] >> shift) & 0xFF) << 8) | ((pixels[0] >> shift) & 0xFF);
+
+            swap = (upper ^ (upper >> 7)) & 0x00AA00AA;
+            upper = upper ^ swap ^ (swap << 7);
+            swap = (lower ^ (lower >> 7)) & 0x00AA00AA;
+            lower = lower ^ swap ^ (swap << 7);
+
+            swap = (upper ^ (upper >> 14)) & 0x0000CCCC;
+            upper = upper ^ swap ^ (swap << 14);
+            swap = (lower ^ (lower >> 14)) & 0x0000CCCC;
+            lower = lower ^ swap ^ (swap << 14);
+
+            swap = (upper & 0xF0F0F0F0) | ((lower >> 4) & 0x0F0F0F0F);
+            lower = ((upper << 4) & 0xF0F0F0F0) | (lower & 0x0F0F0F0F);
+            upper = swap;
+
+            // Most significant bit first
+            planes[0] = upper >> 24;
+            planes[1] = (upper >> 16) & 0xFF;
+            planes[2] = (upper >> 8) & 0xFF;
+            planes[3] = upper & 0xFF;
+            planes[4] = lower >> 24;
+            planes[5] = (lower >> 16) & 0xFF;
+            planes[6] = (lower >> 8) & 0xFF;
+            planes[7] = lower & 0xFF;
+
+            planes = planes + 8;
+            shift = shift - 8;
+        }
+
+        pixel = pixel + 1;
+    }
+}
+
+// =================================================================================
+// Interrupts
+
+// DMA has put the last pixel in the FIFO. The strip stays busy until the FIFO has
+// drained and the line has been low long enough to latch.
+void ledstrip_dma_isr(void)
+{
+    uint8_t     counter = 0;
+    ledstrip_t* strip = NULL;
+
+    while(counter != ledstrip_count)
+    {
+        strip = ledstrips[counter];
+
+        if(dma_channel_get_irq0_status(strip->dma_channel) == true)
+        {
+            dma_channel_acknowledge_irq0(strip->dma_channel);
+
+            if(add_alarm_in_us(strip->latch_us, ledstrip_latched, strip, true) < 0)
+            {
+                // No alarm free, so give up on the latch time rather than stall the strip
+                ledstrip_sent(strip);
+            }
+        }
+
+        counter = counter + 1;
+    }
+}
+
+int64_t ledstrip_latched(alarm_id_t id, void* user_data)
+{
+    (void) id;
+
+    ledstrip_sent((ledstrip_t*) user_data);
+
+    return(0);
+}
+
+void ledstrip_sent(ledstrip_t* strip)
+{
+    if(strip->timed == true)
+    {
+        ledstats_record(LEDSTATS_TRANSMIT, time_us_32() - strip->show_us);
+    }
+
+    strip->busy = false;
+}
+
+// =================================================================================
+// LED timer
+
+// Marks the strip busy for the caller, so that only one of two contexts
+// submitting at once starts DMA. Returns false if a frame is still being sent.
+bool ledstrip_claim(ledstrip_t* strip)
+{
+    uint32_t    irq_state = spin_lock_blocking(ledstrip_lock);
+    bool        claimed = false;
+
+    if(strip->busy == false)
+    {
+        strip->busy = true;
+        strip->show_us = time_us_32();
+        strip->frames = strip->frames + 1;
+        claimed = true;
+    }
+    else
+    {
+        strip->skipped = strip->skipped + 1;
+    }
+
+    spin_unlock(ledstrip_lock, irq_state);
+
+    return(claimed);
+}
+
+uint32_t* ledstrip_back_buffer(ledstrip_t* strip)
+{
+    return(strip->buffers[strip->back]);
+}
+
+// Sends the back buffer, and makes the other buffer the back buffer. Returns false
+// if the last frame is still being sent, in which case the same back buffer is kept.
+bool ledstrip_show(ledstrip_t* strip)
+{
+    if(ledstrip_claim(strip) == false)
+    {
+        return(false);
+    }
+
+    if(strip->planes != NULL)
+    {
+        ledstrip_transpose(strip->buffers[0], strip->pixel_count, strip->lanes, strip->planes);
+        dma_channel_set_read_addr(strip->dma_channel, strip->planes, true);
+    }
+    else
+    {
+        dma_channel_set_read_addr(strip->dma_channel, strip->buffers[strip->back], true);
+        strip->back = strip->back ^ 1;
+    }
+
+    return(true);
+}
+
+// Copies the colour of each run, so the caller can change them straight away, and
+// starts the control channel on the first run. Returns false if the last frame is
+// still being sent.
+bool ledstrip_show_runs(ledstrip_t* strip, const uint32_t* colours)
+{
+    if(ledstrip_claim(strip) == false)
+    {
+        return(false);
+    }
+
+    memcpy(strip->run_colours, colours, strip->run_count * sizeof(uint32_t));
+    dma_channel_set_read_addr(strip->control_channel, strip->runs, true);
+
+    return(true);
+}
+
+void ledstrip_callback_done(uint32_t elapsed_us)
+{
+    ledstats_record(LEDSTATS_COMPUTE, elapsed_us);
+    ledstrip_stats.last_us = elapsed_us;
+
+    if(elapsed_us > ledstrip_stats.max_us)
+    {
+        ledstrip_stats.max_us = elapsed_us;
+    }
+}
+
+const ledstrip_stats_t* ledstrip_get_stats(void)
+{
+    return(&ledstrip_stats);
+}
+
+uint8_t ledstrip_get_count(void)
+{
+    return(ledstrip_count);
+}
+
+const ledstrip_t* ledstrip_get(uint8_t strip)
+{
+    if(strip >= ledstrip_count)
+    {
+        return(NULL);
+    }
+
+    return(ledstrips[strip]);
+}
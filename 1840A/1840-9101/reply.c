@@ -0,0 +1,166 @@
+// ---------------------------------------------------------------------------------
+// SNON replies
+// ---------------------------------------------------------------------------------
+// Replies to SNON fragments, echoing the optional request ID ("rID") so that a
+// host can keep several requests in flight, and reporting failures as error
+// objects instead of an empty fragment.
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+
+#include "reply.h"
+#include "json_tok.h"
+#include "writer.h"
+#include "store.h"
+
+// Global variables
+const char* reply_messages[REPLY_ERROR_COUNT] =
+{
+    "Unknown error",
+    "Invalid fragment",
+    "Missing eID",
+    "Entity not found",
+    "Out of memory",
+    "Too many subscriptions",
+    "Invalid value"
+};
+
+// Private prototypes
+void reply_write_rid(writer_t* writer, const reply_rid_t* rid);
+
+// =================================================================================
+// Request IDs
+
+// Reads the "rID" of the object at the given token. Request IDs are unsigned
+// integers. Returns false if there isn't one.
+bool reply_get_rid(const char* fragment, const json_tok_t* tokens, int16_t count, int16_t object, reply_rid_t* rid)
+{
+    int16_t     rid_token = json_tok_find_key(fragment, tokens, count, object, "rID");
+    uint16_t    position = 0;
+    uint32_t    id = 0;
+
+    rid->present = false;
+    rid->id = 0;
+
+    if((rid_token == -1) || (tokens[rid_token].type != JSON_TOK_PRIMITIVE))
+    {
+        return(false);
+    }
+
+    position = tokens[rid_token].start;
+    while(position != tokens[rid_token].end)
+    {
+        if((fragment[position] < '0') || (fragment[position] > '9'))
+        {
+            return(false);
+        }
+
+        id = (id * 10) + (fragment[position] - '0');
+        position = position + 1;
+    }
+
+    rid->present = true;
+    rid->id = id;
+
+    return(true);
+}
+
+// As above, for callers that haven't tokenized the fragment themselves
+bool reply_find_rid(const char* fragment, reply_rid_t* rid)
+{
+    json_tok_t  tokens[REPLY_TOKEN_MAX];
+    int16_t     token_count = json_tok_parse(fragment, strlen(fragment), tokens, REPLY_TOKEN_MAX);
+
+    rid->present = false;
+    rid->id = 0;
+
+    if((token_count < 1) || (tokens[0].type != JSON_TOK_OBJECT))
+    {
+        return(false);
+    }
+
+    return(reply_get_rid(fragment, tokens, token_count, 0, rid));
+}
+
+// =================================================================================
+// Replies
+
+void reply_write_rid(writer_t* writer, const reply_rid_t* rid)
+{
+    writer_puts(writer, "\"rID\":");
+    writer_uint(writer, rid->id);
+}
+
+// Writes out the SNON JSON of an entity, with the request ID added as the last
+// member. Writes nothing and returns false if the entity doesn't exist.
+bool reply_entity(writer_t* writer, const char* eid, const reply_rid_t* rid)
+{
+    store_handle_t  handle = store_find(eid);
+
+    if(handle == STORE_INVALID)
+    {
+        return(false);
+    }
+
+    if((rid != NULL) && (rid->present == true))
+    {
+        store_write_json(writer, handle, false);
+        writer_putc(writer, ',');
+        reply_write_rid(writer, rid);
+        writer_putc(writer, '}');
+    }
+    else
+    {
+        store_write_json(writer, handle, true);
+    }
+
+    return(true);
+}
+
+void reply_error(writer_t* writer, uint8_t error, const reply_rid_t* rid)
+{
+    const char* message = reply_messages[0];
+
+    if(error < REPLY_ERROR_COUNT)
+    {
+        message = reply_messages[error];
+    }
+
+    writer_putc(writer, '{');
+
+    if((rid != NULL) && (rid->present == true))
+    {
+        reply_write_rid(writer, rid);
+        writer_putc(writer, ',');
+    }
+
+    writer_puts(writer, "\"error\":");
+    writer_uint(writer, error);
+    writer_puts(writer, ",\"message\":\"");
+    writer_puts(writer, message);
+    writer_puts(writer, "\"}");
+}
+
+// Writes {"rID":<id>,"<key>":<count>}
+void reply_count(writer_t* writer, const char* key, uint32_t count, const reply_rid_t* rid)
+{
+    writer_putc(writer, '{');
+
+    if((rid != NULL) && (rid->present == true))
+    {
+        reply_write_rid(writer, rid);
+        writer_putc(writer, ',');
+    }
+
+    writer_json_string(writer, key);
+    writer_putc(writer, ':');
+    writer_uint(writer, count);
+    writer_putc(writer, '}');
+}
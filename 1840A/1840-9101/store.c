@@ -0,0 +1,448 @@
+// ---------------------------------------------------------------------------------
+// SNON value store
+// ---------------------------------------------------------------------------------
+// Holds the values of every SNON entity in value pool blocks, with the rest of
+// each entity's SNON JSON kept from boot, so that entities can be written out
+// and their values set without using the heap
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+
+#include "store.h"
+#include "arena.h"
+#include "json_tok.h"
+#include "writer.h"
+#include "snon/snon_utils.h"
+
+// Types
+
+// SNON is asked for the JSON of each entity once, at boot. Everything before and
+// after its "v" array is kept in the boot arena, and the values themselves are
+// kept here from then on. SNON's own copies of the values stay as they were at
+// boot.
+typedef struct
+{
+    char        eid[SNON_URN_LENGTH];
+    uint32_t    eid_hash;
+    char*       name;
+    uint32_t    name_hash;
+    char*       prefix;             // JSON up to the values
+    char*       suffix;             // JSON after the values, ending with the closing brace
+    uint16_t    prefix_length;
+    uint16_t    suffix_length;
+    char*       values;             // A value pool block, or a boot arena block for long values set at boot
+    uint16_t    capacity;
+} store_entry_t;
+
+// Global variables
+store_entry_t*  store_entries[STORE_MAX_COUNT];     // Allocated from the boot arena
+uint16_t        store_count = 0;
+store_stats_t   store_stats;
+json_tok_t      store_tokens[STORE_TOKEN_MAX];
+char            store_value[VALUE_MAX_LENGTH];      // Returned by store_get_value()
+
+// Private prototypes
+uint32_t store_hash(const char* string);
+int16_t store_tokenize(const char* json, json_tok_t** tokens);
+char* store_copy(const char* first, uint16_t first_length, const char* second);
+bool store_add(const char* eid);
+bool store_write(store_entry_t* entry, const char* values, uint16_t length, bool boot);
+
+// =================================================================================
+// Setup
+
+// FNV-1a hash of a name or eID, used to skip most string compares during lookups
+uint32_t store_hash(const char* string)
+{
+    uint32_t hash = 2166136261u;
+
+    while(*string != 0)
+    {
+        hash = (hash ^ (uint8_t) *string) * 16777619u;
+        string = string + 1;
+    }
+
+    return(hash);
+}
+
+// Tokenizes JSON from SNON into tokens on the heap. Only used while booting.
+int16_t store_tokenize(const char* json, json_tok_t** tokens)
+{
+    uint16_t    length = strlen(json);
+    uint16_t    token_count = (length / 2) + 2;
+
+    *tokens = malloc(sizeof(json_tok_t) * token_count);
+
+    if(*tokens == NULL)
+    {
+        return(JSON_TOK_ERROR_NOMEM);
+    }
+
+    return(json_tok_parse(json, length, *tokens, token_count));
+}
+
+// Copies the first characters of one string and all of another into the boot arena
+char* store_copy(const char* first, uint16_t first_length, const char* second)
+{
+    uint16_t    second_length = strlen(second);
+    char*       copy = arena_alloc(&boot_arena, first_length + second_length + 1);
+
+    if(copy != NULL)
+    {
+        memcpy(copy, first, first_length);
+        memcpy(&copy[first_length], second, second_length + 1);
+    }
+
+    return(copy);
+}
+
+// Adds an entity, splitting its SNON JSON around the values
+bool store_add(const char* eid)
+{
+    char*           json = snon_get_json((char*) eid);
+    char*           name = snon_get_name((char*) eid);
+    json_tok_t*     tokens = NULL;
+    store_entry_t*  entry = NULL;
+    int16_t         count = 0;
+    int16_t         value_token = -1;
+    uint16_t        length = 0;
+    uint16_t        end = 0;
+    bool            added = false;
+
+    if((json == NULL) || (name == NULL) || (store_count == STORE_MAX_COUNT))
+    {
+        free(json);
+        return(false);
+    }
+
+    length = strlen(json);
+    count = store_tokenize(json, &tokens);
+
+    if((count > 0) && (tokens[0].type == JSON_TOK_OBJECT))
+    {
+        value_token = json_tok_find_key(json, tokens, count, 0, "v");
+        entry = arena_alloc(&boot_arena, sizeof(store_entry_t));
+    }
+
+    if(entry != NULL)
+    {
+        strncpy(entry->eid, eid, SNON_URN_LENGTH - 1);
+        entry->eid[SNON_URN_LENGTH - 1] = 0;
+        entry->eid_hash = store_hash(entry->eid);
+        entry->name = arena_strdup(&boot_arena, name);
+        entry->name_hash = store_hash(name);
+        entry->values = NULL;
+        entry->capacity = 0;
+
+        if((value_token != -1) && (tokens[value_token].type == JSON_TOK_ARRAY))
+        {
+            entry->prefix = store_copy(json, tokens[value_token].start, "");
+            entry->suffix = store_copy(&json[tokens[value_token].end], length - tokens[value_token].end, "");
+            added = store_write(entry, &json[tokens[value_token].start], tokens[value_token].end - tokens[value_token].start, true);
+        }
+        else
+        {
+            // No values yet, so they are added as the last member
+            end = tokens[0].end - 1;
+            entry->prefix = store_copy(json, end, (tokens[0].size != 0) ? ",\"v\":" : "\"v\":");
+            entry->suffix = store_copy("}", 1, "");
+            added = store_write(entry, "[]", 2, true);
+        }
+
+        added = added && (entry->name != NULL) && (entry->prefix != NULL) && (entry->suffix != NULL);
+    }
+
+    if(added == true)
+    {
+        entry->prefix_length = strlen(entry->prefix);
+        entry->suffix_length = strlen(entry->suffix);
+        store_entries[store_count] = entry;
+        store_count = store_count + 1;
+    }
+
+    free(tokens);
+    free(json);
+
+    return(added);
+}
+
+// Takes every entity in the SNON "Entities" list. This is the only time the
+// store asks SNON for JSON, which SNON allocates on the heap.
+void store_initialize(void)
+{
+    char*       list = snon_get_values("Entities");
+    json_tok_t* tokens = NULL;
+    int16_t     count = 0;
+    int16_t     token = 1;
+    uint16_t    counter = 0;
+    char        eid[SNON_URN_LENGTH];
+
+    store_count = 0;
+
+    if(list == NULL)
+    {
+        printf("No SNON entities to store\n");
+        return;
+    }
+
+    count = store_tokenize(list, &tokens);
+
+    if((count > 0) && (tokens[0].type == JSON_TOK_ARRAY))
+    {
+        while(counter != tokens[0].size)
+        {
+            if(tokens[token].type == JSON_TOK_STRING)
+            {
+                json_tok_copy(list, &tokens[token], eid, SNON_URN_LENGTH);
+
+                if(store_add(eid) == false)
+                {
+                    printf("Unable to store \"%s\"\n", eid);
+                    store_stats.boot_failures = store_stats.boot_failures + 1;
+                }
+            }
+
+            token = json_tok_skip(tokens, count, token);
+            counter = counter + 1;
+        }
+    }
+
+    free(tokens);
+    free(list);
+}
+
+// =================================================================================
+// Lookups
+
+store_handle_t store_find(const char* key)
+{
+    uint32_t        hash = store_hash(key);
+    store_handle_t  handle = 0;
+    store_entry_t*  entry = NULL;
+
+    while(handle != store_count)
+    {
+        entry = store_entries[handle];
+
+        if(((entry->eid_hash == hash) && (strcmp(entry->eid, key) == 0)) || ((entry->name_hash == hash) && (strcmp(entry->name, key) == 0)))
+        {
+            return(handle);
+        }
+
+        handle = handle + 1;
+    }
+
+    return(STORE_INVALID);
+}
+
+uint16_t store_get_count(void)
+{
+    return(store_count);
+}
+
+const char* store_get_eid(store_handle_t handle)
+{
+    if(handle >= store_count)
+    {
+        return(NULL);
+    }
+
+    return(store_entries[handle]->eid);
+}
+
+const char* store_get_name(store_handle_t handle)
+{
+    if(handle >= store_count)
+    {
+        return(NULL);
+    }
+
+    return(store_entries[handle]->name);
+}
+
+// =================================================================================
+// Values
+
+// Returns the values as a JSON array, until they are next set
+const char* store_get_values(store_handle_t handle)
+{
+    if(handle >= store_count)
+    {
+        return(NULL);
+    }
+
+    return(store_entries[handle]->values);
+}
+
+// Returns the first value without quotes, as snon_get_value() does, until the
+// next call
+const char* store_get_value(store_handle_t handle)
+{
+    const char* values = store_get_values(handle);
+    uint16_t    length = 0;
+
+    if(values == NULL)
+    {
+        return(NULL);
+    }
+
+    if(*values == '[')
+    {
+        values = values + 1;
+    }
+
+    while(*values == ' ')
+    {
+        values = values + 1;
+    }
+
+    if(*values == '"')
+    {
+        values = values + 1;
+
+        while((values[length] != 0) && (values[length] != '"') && (length != VALUE_MAX_LENGTH - 1))
+        {
+            // Escaped characters are kept as they are
+            if((values[length] == '\\') && (values[length + 1] != 0) && (length != VALUE_MAX_LENGTH - 2))
+            {
+                store_value[length] = values[length];
+                length = length + 1;
+            }
+
+            store_value[length] = values[length];
+            length = length + 1;
+        }
+    }
+    else
+    {
+        while((values[length] != 0) && (strchr(",] ", values[length]) == NULL) && (length != VALUE_MAX_LENGTH - 1))
+        {
+            store_value[length] = values[length];
+            length = length + 1;
+        }
+    }
+
+    store_value[length] = 0;
+
+    return(store_value);
+}
+
+// Copies values into the entry, moving to the smallest value pool block they
+// fit. Values set at boot that are too long for any pool get a boot arena block,
+// which later values can reuse but which is never handed back.
+bool store_write(store_entry_t* entry, const char* values, uint16_t length, bool boot)
+{
+    uint16_t    block_size = value_block_size(entry->values);
+    char*       block = NULL;
+
+    if((entry->values == NULL) || (length + 1 > entry->capacity) || ((block_size > value_pools[0].block_size) && (block_size >= (length + 1) * 2)))
+    {
+        if(length + 1 <= VALUE_MAX_LENGTH)
+        {
+            block = value_alloc(length + 1);
+        }
+        else if(boot == true)
+        {
+            block = arena_alloc(&boot_arena, length + 1);
+        }
+
+        if(block != NULL)
+        {
+            // value_free() leaves boot arena blocks alone
+            if(entry->values != NULL)
+            {
+                value_free(entry->values);
+            }
+
+            entry->values = block;
+            entry->capacity = value_block_size(block);
+
+            if(entry->capacity == 0)
+            {
+                entry->capacity = length + 1;
+            }
+        }
+        else if(length + 1 > entry->capacity)
+        {
+            return(false);
+        }
+    }
+
+    memcpy(entry->values, values, length);
+    entry->values[length] = 0;
+
+    return(true);
+}
+
+// Sets the values from a JSON array, which is checked for being valid JSON
+bool store_set_values(store_handle_t handle, const char* values)
+{
+    int16_t     count = 0;
+
+    if((handle >= store_count) || (values == NULL))
+    {
+        store_stats.refused = store_stats.refused + 1;
+        return(false);
+    }
+
+    count = json_tok_parse(values, strlen(values), store_tokens, STORE_TOKEN_MAX);
+
+    return(store_set_tokens(handle, values, store_tokens, count, 0));
+}
+
+// Sets the values from the array at the given token, copied as it was received
+bool store_set_tokens(store_handle_t handle, const char* json, const json_tok_t* tokens, int16_t count, int16_t values)
+{
+    const json_tok_t*   array = &tokens[values];
+
+    if((handle >= store_count) || (values < 0) || (values >= count) || (array->type != JSON_TOK_ARRAY))
+    {
+        store_stats.refused = store_stats.refused + 1;
+        return(false);
+    }
+
+    if(store_write(store_entries[handle], &json[array->start], array->end - array->start, false) == false)
+    {
+        store_stats.refused = store_stats.refused + 1;
+        return(false);
+    }
+
+    store_stats.sets = store_stats.sets + 1;
+
+    return(true);
+}
+
+// =================================================================================
+// Output
+
+// Writes out the SNON JSON of an entity. Without close, the closing brace is
+// left off, so the caller can add more members.
+bool store_write_json(writer_t* writer, store_handle_t handle, bool close)
+{
+    store_entry_t*  entry = NULL;
+
+    if(handle >= store_count)
+    {
+        return(false);
+    }
+
+    entry = store_entries[handle];
+
+    writer_putn(writer, entry->prefix, entry->prefix_length);
+    writer_puts(writer, entry->values);
+    writer_putn(writer, entry->suffix, (close == true) ? entry->suffix_length : entry->suffix_length - 1);
+
+    return(true);
+}
+
+const store_stats_t* store_get_stats(void)
+{
+    return(&store_stats);
+}
@@ -0,0 +1,452 @@
+// ---------------------------------------------------------------------------------
+// Change subscriptions
+// ---------------------------------------------------------------------------------
+// Pushes the values of subscribed entities to the host when they change, so it
+// doesn't have to poll for them
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+
+#include "subscribe.h"
+#include "json_tok.h"
+#include "reply.h"
+#include "uart.h"
+#include "writer.h"
+#include "store.h"
+#include "snon/snon_utils.h"
+
+// Constants
+#define SUBSCRIBE_TARGET_LENGTH     64
+
+// Types
+typedef struct
+{
+    char        eid[SNON_URN_LENGTH];
+    const char* name;
+    uint16_t    store;              // Store handle, for the values
+    uint32_t    interval_us;
+    uint32_t    sent_us;
+    uint32_t    hash;               // Of the values last pushed
+    bool        sent;
+    bool        changed;            // Set since the values were last pushed
+    bool        held;               // Changed, but waiting for the interval to pass
+} subscription_t;
+
+// Global variables
+subscription_t      subscriptions[SUBSCRIBE_MAX];
+uint8_t             subscription_count = 0;
+uint8_t             subscription_cursor = 0;
+subscribe_stats_t   subscribe_stats;
+
+// Private prototypes
+bool subscribe_entity(store_handle_t handle, uint32_t interval_ms);
+uint32_t subscribe_hash(const char* string);
+void subscribe_push(subscription_t* subscription, const char* values);
+
+// =================================================================================
+// Requests
+
+bool subscribe_fragment(writer_t* writer, const char* fragment, const json_tok_t* tokens, int16_t token_count)
+{
+    int16_t     list_token = -1;
+    int16_t     interval_token = -1;
+    int16_t     token = 0;
+    uint16_t    counter = 0;
+    uint32_t    interval_ms = SUBSCRIBE_INTERVAL_MS;
+    uint32_t    count = 0;
+    bool        subscribing = true;
+    bool        full = false;
+    char        target[SUBSCRIBE_TARGET_LENGTH];
+    char        number[12];
+    reply_rid_t rid;
+
+    if((token_count < 1) || (tokens[0].type != JSON_TOK_OBJECT))
+    {
+        return(false);
+    }
+
+    list_token = json_tok_find_key(fragment, tokens, token_count, 0, "subscribe");
+
+    if(list_token == -1)
+    {
+        list_token = json_tok_find_key(fragment, tokens, token_count, 0, "unsubscribe");
+        subscribing = false;
+    }
+
+    if(list_token == -1)
+    {
+        return(false);
+    }
+
+    reply_get_rid(fragment, tokens, token_count, 0, &rid);
+
+    interval_token = json_tok_find_key(fragment, tokens, token_count, 0, "interval");
+    if((interval_token != -1) && (tokens[interval_token].type == JSON_TOK_PRIMITIVE))
+    {
+        json_tok_copy(fragment, &tokens[interval_token], number, sizeof(number));
+        interval_ms = strtoul(number, NULL, 10);
+    }
+
+    // A single target may be given on its own, instead of in a list
+    if(tokens[list_token].type == JSON_TOK_STRING)
+    {
+        json_tok_copy(fragment, &tokens[list_token], target, SUBSCRIBE_TARGET_LENGTH);
+
+        if(subscribing == true)
+        {
+            count = subscribe_add(target, interval_ms, &full);
+        }
+        else
+        {
+            count = subscribe_remove(target);
+        }
+    }
+    else if(tokens[list_token].type == JSON_TOK_ARRAY)
+    {
+        // An empty unsubscribe list removes everything
+        if((subscribing == false) && (tokens[list_token].size == 0))
+        {
+            count = subscription_count;
+            subscribe_clear();
+        }
+
+        token = list_token + 1;
+        while(counter != tokens[list_token].size)
+        {
+            if(tokens[token].type == JSON_TOK_STRING)
+            {
+                json_tok_copy(fragment, &tokens[token], target, SUBSCRIBE_TARGET_LENGTH);
+
+                if(subscribing == true)
+                {
+                    count = count + subscribe_add(target, interval_ms, &full);
+                }
+                else
+                {
+                    count = count + subscribe_remove(target);
+                }
+            }
+
+            token = json_tok_skip(tokens, token_count, token);
+            counter = counter + 1;
+        }
+    }
+    else
+    {
+        reply_error(writer, REPLY_ERROR_INVALID, &rid);
+        return(true);
+    }
+
+    if(full == true)
+    {
+        reply_error(writer, REPLY_ERROR_TABLE_FULL, &rid);
+    }
+    else if((subscribing == true) && (count == 0))
+    {
+        reply_error(writer, REPLY_ERROR_NOT_FOUND, &rid);
+    }
+    else
+    {
+        reply_count(writer, (subscribing == true) ? "subscribed" : "unsubscribed", count, &rid);
+    }
+
+    return(true);
+}
+
+// =================================================================================
+// Subscriptions
+
+// Adds or updates one entity. Returns false if the table is full.
+bool subscribe_entity(store_handle_t handle, uint32_t interval_ms)
+{
+    subscription_t* subscription = NULL;
+    const char*     eid = store_get_eid(handle);
+    uint8_t         counter = 0;
+
+    // Keeps the interval in microseconds within 32 bits
+    if(interval_ms < SUBSCRIBE_INTERVAL_MIN_MS)
+    {
+        interval_ms = SUBSCRIBE_INTERVAL_MIN_MS;
+    }
+    else if(interval_ms > SUBSCRIBE_INTERVAL_MAX_MS)
+    {
+        interval_ms = SUBSCRIBE_INTERVAL_MAX_MS;
+    }
+
+    while(counter != subscription_count)
+    {
+        if(strcmp(subscriptions[counter].eid, eid) == 0)
+        {
+            subscriptions[counter].interval_us = interval_ms * 1000;
+            return(true);
+        }
+
+        counter = counter + 1;
+    }
+
+    if(subscription_count == SUBSCRIBE_MAX)
+    {
+        return(false);
+    }
+
+    subscription = &subscriptions[subscription_count];
+    strncpy(subscription->eid, eid, SNON_URN_LENGTH - 1);
+    subscription->eid[SNON_URN_LENGTH - 1] = 0;
+    subscription->name = store_get_name(handle);
+    subscription->store = handle;
+    subscription->interval_us = interval_ms * 1000;
+    subscription->sent_us = 0;
+    subscription->hash = 0;
+    subscription->sent = false;
+    subscription->changed = true;
+    subscription->held = false;
+
+    subscription_count = subscription_count + 1;
+
+    return(true);
+}
+
+// Subscribes to an eID, or to every entity whose name starts with the target.
+// Returns the number of entities subscribed to.
+uint8_t subscribe_add(const char* target, uint32_t interval_ms, bool* full)
+{
+    store_handle_t  handle = 0;
+    uint16_t        length = strlen(target);
+    uint8_t         count = 0;
+
+    if(strncmp(target, "urn:uuid:", 9) == 0)
+    {
+        handle = store_find(target);
+
+        if(handle == STORE_INVALID)
+        {
+            return(0);
+        }
+
+        if(subscribe_entity(handle, interval_ms) == false)
+        {
+            *full = true;
+            return(0);
+        }
+
+        return(1);
+    }
+
+    while(handle != store_get_count())
+    {
+        if(strncmp(store_get_name(handle), target, length) == 0)
+        {
+            if(subscribe_entity(handle, interval_ms) == true)
+            {
+                count = count + 1;
+            }
+            else
+            {
+                *full = true;
+            }
+        }
+
+        handle = handle + 1;
+    }
+
+    return(count);
+}
+
+// Removes an eID, or every entity whose name starts with the target
+uint8_t subscribe_remove(const char* target)
+{
+    uint16_t    length = strlen(target);
+    uint8_t     counter = 0;
+    uint8_t     count = 0;
+
+    while(counter != subscription_count)
+    {
+        if((strcmp(subscriptions[counter].eid, target) == 0) || (strncmp(subscriptions[counter].name, target, length) == 0))
+        {
+            // Keep the table packed
+            subscription_count = subscription_count - 1;
+            subscriptions[counter] = subscriptions[subscription_count];
+            count = count + 1;
+        }
+        else
+        {
+            counter = counter + 1;
+        }
+    }
+
+    subscription_cursor = 0;
+
+    return(count);
+}
+
+void subscribe_clear(void)
+{
+    subscription_count = 0;
+    subscription_cursor = 0;
+}
+
+// =================================================================================
+// Change detection
+
+// Marks the subscriptions to an entity, given by eID or name, as changed. Called
+// wherever values are set, so that subscribe_service() only has to fetch the
+// values of entities that have changed.
+void subscribe_changed(const char* entity)
+{
+    uint8_t     counter = 0;
+
+    while(counter != subscription_count)
+    {
+        if((strcmp(subscriptions[counter].eid, entity) == 0) || (strcmp(subscriptions[counter].name, entity) == 0))
+        {
+            subscriptions[counter].changed = true;
+        }
+
+        counter = counter + 1;
+    }
+}
+
+// FNV-1a, enough to notice that a value has changed
+uint32_t subscribe_hash(const char* string)
+{
+    uint32_t    hash = 2166136261u;
+
+    while(*string != 0)
+    {
+        hash = (hash ^ (uint8_t) *string) * 16777619u;
+        string = string + 1;
+    }
+
+    return(hash);
+}
+
+// Sends {"seq":<n>,"eID":"<eID>","v":[...]}
+void subscribe_push(subscription_t* subscription, const char* values)
+{
+    writer_t    writer;
+
+    subscribe_stats.sequence = subscribe_stats.sequence + 1;
+    subscribe_stats.pushes = subscribe_stats.pushes + 1;
+
+    writer_init_uart(&writer, WRITER_MODE_RAW);
+    writer_puts(&writer, "{\"seq\":");
+    writer_uint(&writer, subscribe_stats.sequence);
+    writer_puts(&writer, ",\"eID\":");
+    writer_json_string(&writer, subscription->eid);
+    writer_puts(&writer, ",\"v\":");
+    writer_puts(&writer, values);
+    writer_puts(&writer, "}\r\n");
+    writer_flush(&writer);
+}
+
+// Pushes a few of the subscribed entities that have changed. Only the latest
+// value of an entity is pushed, and no more often than its interval.
+void subscribe_service(void)
+{
+    subscription_t* subscription = NULL;
+    const char*     values = NULL;
+    uint32_t        hash = 0;
+    uint32_t        now_us = time_us_32();
+    uint8_t         checked = 0;
+    uint8_t         fetched = 0;
+
+    // Panels on a shared bus only speak when spoken to
+    if((subscription_count == 0) || (uart_in_binary_mode() == true) || (uart_in_multidrop_mode() == true))
+    {
+        return;
+    }
+
+    // Pushes never land inside a response that is still going out
+    if((uart_tx_free() < SUBSCRIBE_TX_RESERVE) || (uart_response_pending() == true))
+    {
+        return;
+    }
+
+    while((fetched != SUBSCRIBE_CHECK_COUNT) && (checked != subscription_count))
+    {
+        if(subscription_cursor >= subscription_count)
+        {
+            subscription_cursor = 0;
+        }
+
+        subscription = &subscriptions[subscription_cursor];
+
+        if(subscription->changed == false)
+        {
+            // Nothing to do
+        }
+        else if((subscription->sent == true) && ((now_us - subscription->sent_us) < subscription->interval_us))
+        {
+            if(subscription->held == false)
+            {
+                subscribe_stats.deferred = subscribe_stats.deferred + 1;
+                subscription->held = true;
+            }
+        }
+        else
+        {
+            values = store_get_values(subscription->store);
+            fetched = fetched + 1;
+
+            if(values != NULL)
+            {
+                // Setting an entity to the value it already had isn't pushed
+                hash = subscribe_hash(values);
+
+                if((subscription->sent == false) || (hash != subscription->hash))
+                {
+                    subscribe_push(subscription, values);
+
+                    subscription->hash = hash;
+                    subscription->sent_us = now_us;
+                    subscription->sent = true;
+                }
+            }
+
+            subscription->changed = false;
+            subscription->held = false;
+        }
+
+        subscription_cursor = subscription_cursor + 1;
+        checked = checked + 1;
+    }
+}
+
+void subscribe_list(writer_t* writer)
+{
+    uint8_t     counter = 0;
+
+    writer_puts(writer, "\r\nSubscriptions: ");
+    writer_uint(writer, subscription_count);
+    writer_puts(writer, ", pushes: ");
+    writer_uint(writer, subscribe_stats.pushes);
+    writer_puts(writer, ", deferred: ");
+    writer_uint(writer, subscribe_stats.deferred);
+
+    while(counter != subscription_count)
+    {
+        writer_puts(writer, "\r\n");
+        writer_puts(writer, subscriptions[counter].eid);
+        writer_puts(writer, " - ");
+        writer_puts(writer, subscriptions[counter].name);
+        writer_puts(writer, " (");
+        writer_uint(writer, subscriptions[counter].interval_us / 1000);
+        writer_puts(writer, " ms)");
+
+        counter = counter + 1;
+    }
+
+    writer_puts(writer, "\r\n");
+}
+
+const subscribe_stats_t* subscribe_get_stats(void)
+{
+    return(&subscribe_stats);
+}
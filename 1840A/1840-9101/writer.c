@@ -0,0 +1,336 @@
+// ---------------------------------------------------------------------------------
+// Streaming output writer
+// ---------------------------------------------------------------------------------
+// Emits command responses and JSON incrementally through a small fixed buffer
+// into a bounded sink, without using the heap
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+#include <stdio.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+
+#include "writer.h"
+#include "uart.h"
+
+// Global variables
+
+// The response handed to the command loop, if any
+writer_t        writer_deferred;
+writer_resume_t writer_deferred_resume = NULL;
+uint32_t        writer_deferred_cursor = 0;
+const void*     writer_deferred_argument = NULL;
+bool            writer_deferred_active = false;
+bool            writer_deferred_finished = false;
+char            writer_tail[WRITER_TAIL_SIZE];      // Written after the response was deferred
+
+// Private prototypes
+uint16_t writer_uart_sink(writer_t* writer, const char* data, uint16_t length);
+uint16_t writer_buffer_sink(writer_t* writer, const char* data, uint16_t length);
+void writer_send(writer_t* writer);
+void writer_put_raw(writer_t* writer, char character);
+
+// =================================================================================
+// Sinks
+
+// Queues as much of the data as the TX ring has room for, without waiting
+uint16_t writer_uart_sink(writer_t* writer, const char* data, uint16_t length)
+{
+    // There is one UART, so nothing is needed from the writer
+    (void) writer;
+
+    return(uart_send_data(data, length));
+}
+
+// Fills a caller supplied buffer, keeping it null terminated
+uint16_t writer_buffer_sink(writer_t* writer, const char* data, uint16_t length)
+{
+    char*   buffer = (char*) writer->context;
+
+    if(writer->total + length + 1 > writer->capacity)
+    {
+        return(0);
+    }
+
+    memcpy(&buffer[writer->total], data, length);
+    buffer[writer->total + length] = 0;
+
+    return(length);
+}
+
+void writer_init_uart(writer_t* writer, uint8_t mode)
+{
+    writer->sink = writer_uart_sink;
+    writer->context = NULL;
+    writer->mode = mode;
+    writer->retry = true;
+    writer->failed = false;
+    writer->length = 0;
+    writer->total = 0;
+    writer->capacity = 0;
+}
+
+void writer_init_buffer(writer_t* writer, char* buffer, uint32_t size, uint8_t mode)
+{
+    writer->sink = writer_buffer_sink;
+    writer->context = buffer;
+    writer->mode = mode;
+    writer->retry = false;
+    writer->failed = false;
+    writer->length = 0;
+    writer->total = 0;
+    writer->capacity = size;
+
+    if(size != 0)
+    {
+        buffer[0] = 0;
+    }
+}
+
+// =================================================================================
+// Output
+
+// Passes the buffer to the sink, keeping whatever a UART writer's sink refuses
+void writer_send(writer_t* writer)
+{
+    uint16_t    taken = 0;
+
+    if((writer->length != 0) && (writer->failed == false))
+    {
+        taken = writer->sink(writer, writer->buffer, writer->length);
+        writer->total = writer->total + taken;
+
+        if(taken == writer->length)
+        {
+            writer->length = 0;
+        }
+        else if(writer->retry == true)
+        {
+            memmove(writer->buffer, &writer->buffer[taken], writer->length - taken);
+            writer->length = writer->length - taken;
+        }
+        else
+        {
+            writer->failed = true;
+        }
+    }
+
+    if(writer->failed == true)
+    {
+        writer->length = 0;
+    }
+}
+
+// Sends what is buffered. Anything the TX ring has no room for yet is handed to
+// the command loop, to follow once it drains. Returns false if the sink has
+// stopped accepting data.
+bool writer_flush(writer_t* writer)
+{
+    writer_send(writer);
+
+    if((writer->retry == true) && (writer->length != 0))
+    {
+        writer_defer(writer, NULL, 0, NULL);
+    }
+
+    return(!writer->failed);
+}
+
+// Adds a character without translation. If the sink still refuses a full buffer,
+// the response has run past what the TX ring can hold without writer_busy()
+// being checked, and the writer fails.
+void writer_put_raw(writer_t* writer, char character)
+{
+    if(writer->length == WRITER_BUFFER_SIZE)
+    {
+        writer_send(writer);
+
+        if(writer->length == WRITER_BUFFER_SIZE)
+        {
+            writer->failed = true;
+            writer->length = 0;
+        }
+    }
+
+    if(writer->failed == false)
+    {
+        writer->buffer[writer->length] = character;
+        writer->length = writer->length + 1;
+    }
+}
+
+void writer_putc(writer_t* writer, char character)
+{
+    if(((writer->mode & WRITER_MODE_CRLF) != 0) && (character == '\n'))
+    {
+        writer_put_raw(writer, '\r');
+    }
+
+    writer_put_raw(writer, character);
+
+    if(((writer->mode & WRITER_MODE_COMMA_BREAK) != 0) && (character == ','))
+    {
+        writer_put_raw(writer, '\r');
+        writer_put_raw(writer, '\n');
+    }
+}
+
+void writer_puts(writer_t* writer, const char* string)
+{
+    while(*string != 0)
+    {
+        writer_putc(writer, *string);
+        string = string + 1;
+    }
+}
+
+void writer_putn(writer_t* writer, const char* string, uint16_t length)
+{
+    while((length != 0) && (*string != 0))
+    {
+        writer_putc(writer, *string);
+
+        string = string + 1;
+        length = length - 1;
+    }
+}
+
+// Writes a quoted JSON string, escaping as needed
+void writer_json_string(writer_t* writer, const char* string)
+{
+    const char* hex_digits = "0123456789ABCDEF";
+
+    writer_put_raw(writer, '"');
+
+    while(*string != 0)
+    {
+        if((*string == '"') || (*string == '\\'))
+        {
+            writer_put_raw(writer, '\\');
+            writer_put_raw(writer, *string);
+        }
+        else if((uint8_t) *string < 0x20)
+        {
+            writer_put_raw(writer, '\\');
+            writer_put_raw(writer, 'u');
+            writer_put_raw(writer, '0');
+            writer_put_raw(writer, '0');
+            writer_put_raw(writer, hex_digits[((uint8_t) *string) >> 4]);
+            writer_put_raw(writer, hex_digits[((uint8_t) *string) & 0x0F]);
+        }
+        else
+        {
+            writer_put_raw(writer, *string);
+        }
+
+        string = string + 1;
+    }
+
+    writer_put_raw(writer, '"');
+}
+
+void writer_uint(writer_t* writer, uint32_t value)
+{
+    char    digits[10];
+    uint8_t count = 0;
+
+    do
+    {
+        digits[count] = '0' + (value % 10);
+        value = value / 10;
+        count = count + 1;
+    }
+    while(value != 0);
+
+    while(count != 0)
+    {
+        count = count - 1;
+        writer_put_raw(writer, digits[count]);
+    }
+}
+
+// =================================================================================
+// Long responses
+
+// True once a long response should stop, so the command loop can carry on with it
+// as the TX ring drains. Writers to a buffer never are.
+bool writer_busy(writer_t* writer)
+{
+    if((writer->retry == false) || (writer->failed == true))
+    {
+        return(false);
+    }
+
+    return(uart_tx_free() < WRITER_UNIT_SPACE + writer->length);
+}
+
+// Hands the rest of a response to the command loop, which writes it with resume()
+// from the cursor on, or only sends what is buffered if there is no resume(). The
+// argument has to outlive the response. Anything else written to the writer is
+// kept, up to WRITER_TAIL_SIZE, and sent after the response has finished.
+void writer_defer(writer_t* writer, writer_resume_t resume, uint32_t cursor, const void* argument)
+{
+    // Only one response can wait at a time, and no other command is taken while
+    // it does
+    if((writer->retry == false) || (writer_deferred_active == true))
+    {
+        writer->failed = true;
+        return;
+    }
+
+    writer_deferred = *writer;
+    writer_deferred_resume = resume;
+    writer_deferred_cursor = cursor;
+    writer_deferred_argument = argument;
+    writer_deferred_active = true;
+    writer_deferred_finished = false;
+    uart_set_response_pending(true);
+
+    writer_init_buffer(writer, writer_tail, WRITER_TAIL_SIZE, writer->mode);
+}
+
+// Writes more of the deferred response, if there is one. Returns true while some
+// of it is still to go.
+bool writer_resume(void)
+{
+    uint16_t    counter = 0;
+
+    if(writer_deferred_active == false)
+    {
+        return(false);
+    }
+
+    // Whatever the TX ring refused last time goes first
+    writer_send(&writer_deferred);
+
+    if((writer_deferred_finished == false) && (writer_busy(&writer_deferred) == false))
+    {
+        if((writer_deferred_resume == NULL) || (writer_deferred_resume(&writer_deferred, &writer_deferred_cursor, writer_deferred_argument) == true))
+        {
+            writer_deferred_finished = true;
+
+            // Then what was written after the response was deferred, which has
+            // already been translated
+            while(writer_tail[counter] != 0)
+            {
+                writer_put_raw(&writer_deferred, writer_tail[counter]);
+                counter = counter + 1;
+            }
+        }
+
+        writer_send(&writer_deferred);
+    }
+
+    if((writer_deferred_finished == false) || (writer_deferred.length != 0))
+    {
+        return(true);
+    }
+
+    writer_deferred_active = false;
+    uart_set_response_pending(false);
+
+    return(false);
+}
@@ -0,0 +1,88 @@
+# generates an LED map header for the 1840A, 1841A and 1870A firmware
+#
+# Usage: ruby led-map.rb <map.csv> <map.h> [<pixel count>]
+#
+# Each CSV line is "<first pixel>,<pixel count>,<entity>[,<brightness>]", with
+# brightness out of 255 (255 if left out). Lines starting with "#" are comments.
+# Pixels not listed are always off. The header is named after the output file,
+# so front_panel_leds.h defines front_panel_leds[], FRONT_PANEL_LEDS_ENTRIES
+# and FRONT_PANEL_LEDS_PIXELS.
+if ARGV.length < 2
+  print "Usage: ruby led-map.rb <map.csv> <map.h> [<pixel count>]\n"
+  exit 1
+end
+
+csv_name, header_name, pixel_count = ARGV
+runs = []
+
+File.readlines(csv_name).each_with_index do |line, number|
+  line = line.strip
+  next if line.empty? || line.start_with?("#")
+
+  first, count, entity, brightness = line.split(",").map(&:strip)
+  run = { first: Integer(first), count: Integer(count), entity: entity, brightness: Integer(brightness || "255") }
+
+  if run[:count] < 1 || run[:brightness] < 0 || run[:brightness] > 255 || entity.nil? || entity.empty?
+    abort "#{csv_name}:#{number + 1}: invalid line \"#{line}\""
+  end
+
+  runs << run
+end
+
+# Put runs in pixel order, and fill the gaps with runs that are always off
+runs.sort_by! { |run| run[:first] }
+entries = []
+next_pixel = 0
+
+runs.each do |run|
+  if run[:first] < next_pixel
+    abort "#{csv_name}: #{run[:entity]} overlaps the run before it at pixel #{run[:first]}"
+  end
+
+  if run[:first] > next_pixel
+    entries << { first: next_pixel, count: run[:first] - next_pixel, entity: nil, brightness: 255 }
+  end
+
+  entries << run
+  next_pixel = run[:first] + run[:count]
+end
+
+pixel_count = pixel_count ? Integer(pixel_count) : next_pixel
+
+if next_pixel > pixel_count
+  abort "#{csv_name}: runs end at pixel #{next_pixel}, past the #{pixel_count} pixel chain"
+elsif next_pixel < pixel_count
+  entries << { first: next_pixel, count: pixel_count - next_pixel, entity: nil, brightness: 255 }
+end
+
+name = File.basename(header_name, ".h")
+prefix = name.upcase
+
+File.open(header_name, "w") do |header|
+  header.print "// ---------------------------------------------------------------------------------\n"
+  header.print "// LED map - Generated by 1840-9110/led-map.rb from #{File.basename(csv_name)}. Do not edit.\n"
+  header.print "// ---------------------------------------------------------------------------------\n"
+  header.print "// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)\n"
+  header.print "// SPDX-FileAttributionText: https://github.com/dslik/powersim/\n"
+  header.print "// SPDX-License-Identifier: CERN-OHL-S-2.0\n"
+  header.print "// ---------------------------------------------------------------------------------\n\n"
+  header.print "#pragma once\n"
+  header.print "#ifndef #{prefix}_H\n"
+  header.print "#define #{prefix}_H\n\n"
+  header.print "#include \"ledmap.h\"\n\n"
+  header.print "#define #{prefix}_PIXELS".ljust(36) + " #{pixel_count}\n"
+  header.print "#define #{prefix}_ENTRIES".ljust(36) + " #{entries.length}\n\n"
+  header.print "static const ledmap_entry_t #{name}[#{prefix}_ENTRIES] =\n{\n"
+
+  entries.each_with_index do |entry, index|
+    entity = entry[:entity] ? "\"#{entry[:entity]}\"" : "NULL"
+    brightness = entry[:brightness] == 255 ? "LEDMAP_FULL" : entry[:brightness].to_s
+    separator = index == entries.length - 1 ? "" : ","
+    header.print "    { #{(entity + ",").ljust(32)} #{(entry[:first].to_s + ",").ljust(5)} #{(entry[:count].to_s + ",").ljust(4)} #{brightness} }#{separator}\n"
+  end
+
+  header.print "};\n\n"
+  header.print "#endif // #{prefix}_H\n"
+end
+
+print "#{header_name}: #{entries.length} entries, #{pixel_count} pixels\n"
@@ -0,0 +1,164 @@
+# sets 1840A SNON values using binary frames
+#
+# Usage: ruby snon-binary.rb <eID> <value> [<eID> <value> ...]
+#
+# Frames are COBS encoded and end with a zero byte. Before encoding, a frame is
+# a type byte, a sequence byte, the payload and a CRC16-CCITT of everything before
+# it. Entities are addressed by the handles listed by the device.
+require "socket"
+
+module SnonBinary
+  SET      = 0x01
+  GET      = 0x02
+  LIST     = 0x03
+  EXIT     = 0x7F
+  ACK      = 0x81
+  VALUES   = 0x82
+  ENTITIES = 0x83
+  NAK      = 0xFF
+
+  TYPE_STRING  = 0x01
+  TYPE_INT32   = 0x02
+  TYPE_FLOAT32 = 0x03
+  TYPE_BOOL    = 0x04
+
+  def self.crc16(bytes)
+    crc = 0xFFFF
+    bytes.each do |byte|
+      crc ^= byte << 8
+      8.times do
+        crc = (crc & 0x8000) != 0 ? ((crc << 1) ^ 0x1021) : (crc << 1)
+        crc &= 0xFFFF
+      end
+    end
+    crc
+  end
+
+  def self.cobs_encode(bytes)
+    output = []
+    block = []
+    bytes.each do |byte|
+      if byte == 0
+        output << block.length + 1
+        output.concat(block)
+        block = []
+      else
+        block << byte
+        if block.length == 254
+          output << 255
+          output.concat(block)
+          block = []
+        end
+      end
+    end
+    output << block.length + 1
+    output.concat(block)
+    output << 0
+    output
+  end
+
+  def self.cobs_decode(bytes)
+    output = []
+    position = 0
+    while position < bytes.length
+      code = bytes[position]
+      raise "Bad COBS block" if code == 0 || position + code > bytes.length
+      output.concat(bytes[position + 1, code - 1])
+      position += code
+      output << 0 if code != 0xFF && position < bytes.length
+    end
+    output
+  end
+
+  def self.frame(type, sequence, payload)
+    body = [type, sequence & 0xFF] + payload
+    crc = crc16(body)
+    cobs_encode(body + [crc >> 8, crc & 0xFF]).pack("C*")
+  end
+
+  # Returns [type, sequence, payload] from a received frame, without its zero byte
+  def self.parse(data)
+    body = cobs_decode(data.unpack("C*"))
+    raise "Short frame" if body.length < 4
+    crc = (body[-2] << 8) | body[-1]
+    raise "CRC mismatch" if crc16(body[0...-2]) != crc
+    [body[0], body[1], body[2...-2]]
+  end
+
+  def self.string_item(handle, value)
+    bytes = value.to_s.bytes
+    [handle >> 8, handle & 0xFF, TYPE_STRING, bytes.length] + bytes
+  end
+
+  def self.int_item(handle, value)
+    [handle >> 8, handle & 0xFF, TYPE_INT32] + [value].pack("l>").unpack("C*")
+  end
+
+  def self.float_item(handle, value)
+    [handle >> 8, handle & 0xFF, TYPE_FLOAT32] + [value].pack("g").unpack("C*")
+  end
+
+  class Connection
+    def initialize(socket)
+      @socket = socket
+      @sequence = 0
+    end
+
+    def request(type, payload)
+      @sequence = (@sequence + 1) & 0xFF
+      @socket.print(SnonBinary.frame(type, @sequence, payload))
+      type, sequence, payload = SnonBinary.parse(@socket.gets("\0").chomp("\0"))
+      raise "Device error #{payload[0]}" if type == NAK
+      raise "Out of sequence response" if sequence != @sequence
+      [type, payload]
+    end
+
+    # Returns a hash of eID to handle
+    def handles
+      handles = {}
+      total = 1
+      while handles.length < total
+        type, payload = request(LIST, [handles.length >> 8, handles.length & 0xFF])
+        total = (payload[0] << 8) | payload[1]
+        position = 2
+        while position < payload.length
+          handle = (payload[position] << 8) | payload[position + 1]
+          length = payload[position + 2]
+          handles[payload[position + 3, length].pack("C*")] = handle
+          position += 3 + length
+        end
+      end
+      handles
+    end
+
+    # Sets all of the items in one frame, so they are drawn as one update
+    def set(items)
+      type, payload = request(SET, items.flatten)
+      payload[0]
+    end
+
+    def exit
+      request(EXIT, [])
+    end
+  end
+end
+
+if __FILE__ == $0
+  print "Connecting to SNON device\n";
+  socket = TCPSocket.open("192.168.88.101", "200");
+  socket.print("binary\r");
+  print socket.gets;
+  print socket.gets;
+
+  connection = SnonBinary::Connection.new(socket)
+  handles = connection.handles
+
+  items = ARGV.each_slice(2).map do |eid, value|
+    raise "Entity #{eid} is not on the panel" unless handles.key?(eid)
+    SnonBinary.string_item(handles[eid], value)
+  end
+
+  print "Set #{connection.set(items)} values\n";
+  connection.exit
+  socket.close;
+end
@@ -0,0 +1,700 @@
+// ---------------------------------------------------------------------------------
+// SNON client
+// ---------------------------------------------------------------------------------
+// Keeps one connection to a panel open, and keeps several requests in flight on
+// it. Each request carries a request ID ("rID"), which the panel echoes in its
+// reply. Replies come back in the order the requests were sent.
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+#include <cstdlib>
+
+#include "client.h"
+
+namespace snon
+{
+
+// Constants
+static const int    reader_poll_ms = 50;
+
+client::client(std::unique_ptr<transport> link, const client_options& options) : link(std::move(link)), options(options)
+{
+    if(this->options.window == 0)
+    {
+        this->options.window = 1;
+    }
+
+    if(this->options.batch_max == 0)
+    {
+        this->options.batch_max = 1;
+    }
+}
+
+client::~client()
+{
+    stop();
+}
+
+// =================================================================================
+// Connection
+
+bool client::start(void)
+{
+    if(link->open() == false)
+    {
+        return(false);
+    }
+
+    connected = true;
+    stopping = false;
+    reader_thread = std::thread(&client::reader, this);
+
+    return(true);
+}
+
+void client::stop(void)
+{
+    completions_t   completions;
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+
+    if(reader_thread.joinable() == true)
+    {
+        reader_thread.join();
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+
+        while(in_flight.empty() == false)
+        {
+            fail(in_flight.front(), CLIENT_ERROR_STOPPED, "Client stopped", completions);
+            in_flight.pop_front();
+        }
+
+        while(pending.empty() == false)
+        {
+            completions.push_back({ pending.front().done, reply_t { CLIENT_ERROR_STOPPED, "Client stopped", json_value() } });
+            pending.pop_front();
+        }
+
+        link->close();
+        connected = false;
+    }
+
+    for(auto& completion : completions)
+    {
+        if(completion.first)
+        {
+            completion.first(completion.second);
+        }
+    }
+
+    idle.notify_all();
+}
+
+// Tries until connected or stopped, backing off between attempts
+bool client::reconnect(void)
+{
+    int     delay_ms = options.reconnect_ms;
+    int     waited_ms = 0;
+
+    while(true)
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if(stopping == true)
+            {
+                return(false);
+            }
+        }
+
+        if(link->open() == true)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+
+            connected = true;
+            broken = false;
+            stats.reconnects = stats.reconnects + 1;
+            pump();
+
+            return(true);
+        }
+
+        waited_ms = 0;
+        while(waited_ms < delay_ms)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(reader_poll_ms));
+            waited_ms = waited_ms + reader_poll_ms;
+
+            std::lock_guard<std::mutex> guard(lock);
+            if(stopping == true)
+            {
+                return(false);
+            }
+        }
+
+        delay_ms = delay_ms * 2;
+        if(delay_ms > options.reconnect_max_ms)
+        {
+            delay_ms = options.reconnect_max_ms;
+        }
+    }
+}
+
+// Setting and getting values can safely be repeated, so requests that were in
+// flight go out again once the connection is back
+void client::disconnect(void)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    link->close();
+    connected = false;
+
+    while(in_flight.empty() == false)
+    {
+        line_t& line = in_flight.back();
+
+        for(auto request = line.requests.rbegin(); request != line.requests.rend(); ++request)
+        {
+            pending.push_front(*request);
+            stats.resent = stats.resent + 1;
+        }
+
+        in_flight.pop_back();
+    }
+}
+
+// =================================================================================
+// Requests
+
+void client::queue(request_t request)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    if(stopping == true)
+    {
+        return;
+    }
+
+    stats.requests = stats.requests + 1;
+    pending.push_back(std::move(request));
+    pump();
+}
+
+// Sends queued requests while there is room in the window. Batches only fill up
+// while the window is full, so a lone request isn't held back waiting for more.
+// The lock must be held.
+void client::pump(void)
+{
+    std::string text;
+
+    while((connected == true) && (broken == false) && (pending.empty() == false) && (in_flight.size() < options.window))
+    {
+        line_t  line;
+
+        if(holding == true)
+        {
+            return;
+        }
+
+        if((options.batch_max > 1) && (pending.size() < options.batch_max) && (in_flight.empty() == false) && (flushing == false))
+        {
+            return;
+        }
+
+        // Listings are always sent on their own
+        if(pending.front().listing == true)
+        {
+            line.requests.push_back(std::move(pending.front()));
+            pending.pop_front();
+            text = line.requests[0].fragment;
+        }
+        else
+        {
+            while((pending.empty() == false) && (pending.front().listing == false) && (line.requests.size() < options.batch_max))
+            {
+                line.requests.push_back(std::move(pending.front()));
+                pending.pop_front();
+            }
+
+            if(line.requests.size() == 1)
+            {
+                text = line.requests[0].fragment;
+            }
+            else
+            {
+                text = "[";
+                for(const auto& request : line.requests)
+                {
+                    if(text.length() != 1)
+                    {
+                        text.push_back(',');
+                    }
+
+                    text.append(request.fragment);
+                }
+
+                text.push_back(']');
+            }
+        }
+
+        text.push_back('\r');
+        line.sent = clock_t::now();
+        in_flight.push_back(std::move(line));
+        stats.lines = stats.lines + 1;
+
+        // The reader notices and reconnects
+        if(link->write(text) == false)
+        {
+            broken = true;
+        }
+    }
+
+    if(pending.empty() == true)
+    {
+        flushing = false;
+    }
+}
+
+void client::set_async(const std::string& eid, const std::vector<std::string>& values, completion_t done)
+{
+    request_t   request;
+    bool        first = true;
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        request.rid = next_rid;
+        next_rid = next_rid + 1;
+    }
+
+    request.fragment = "{\"eID\":" + json_quote(eid) + ",\"v\":[";
+    for(const auto& value : values)
+    {
+        if(first == false)
+        {
+            request.fragment.push_back(',');
+        }
+
+        request.fragment.append(json_quote(value));
+        first = false;
+    }
+
+    request.fragment.append("],\"rID\":" + std::to_string(request.rid) + "}");
+    request.done = std::move(done);
+    request.listing = false;
+
+    queue(std::move(request));
+}
+
+void client::get_async(const std::string& eid, completion_t done)
+{
+    request_t   request;
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        request.rid = next_rid;
+        next_rid = next_rid + 1;
+    }
+
+    request.fragment = "{\"eID\":" + json_quote(eid) + ",\"rID\":" + std::to_string(request.rid) + "}";
+    request.done = std::move(done);
+    request.listing = false;
+
+    queue(std::move(request));
+}
+
+// The panels answer "{}" without a request ID
+void client::list_async(completion_t done)
+{
+    request_t   request;
+
+    request.rid = 0;
+    request.fragment = "{}";
+    request.done = std::move(done);
+    request.listing = true;
+
+    queue(std::move(request));
+}
+
+std::future<reply_t> client::set(const std::string& eid, const std::vector<std::string>& values)
+{
+    auto    promise = std::make_shared<std::promise<reply_t>>();
+
+    set_async(eid, values, [promise](const reply_t& reply) { promise->set_value(reply); });
+
+    return(promise->get_future());
+}
+
+std::future<reply_t> client::get(const std::string& eid)
+{
+    auto    promise = std::make_shared<std::promise<reply_t>>();
+
+    get_async(eid, [promise](const reply_t& reply) { promise->set_value(reply); });
+
+    return(promise->get_future());
+}
+
+void client::hold(void)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    holding = true;
+}
+
+void client::flush(void)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    holding = false;
+    if(pending.empty() == false)
+    {
+        flushing = true;
+        pump();
+    }
+}
+
+bool client::wait_idle(int timeout_ms)
+{
+    std::unique_lock<std::mutex> guard(lock);
+
+    holding = false;
+    if(pending.empty() == false)
+    {
+        flushing = true;
+        pump();
+    }
+
+    return(idle.wait_for(guard, std::chrono::milliseconds(timeout_ms),
+                         [this]() { return((pending.empty() == true) && (in_flight.empty() == true)); }));
+}
+
+void client::on_push(std::function<void(const json_value& push)> handler)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    push_handler = std::move(handler);
+}
+
+client_stats client::get_stats(void)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    return(stats);
+}
+
+// =================================================================================
+// Names
+
+void client::set_namespace(const uuid_t& new_namespace)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    name_space = new_namespace;
+    has_namespace = true;
+}
+
+void client::learn_names(const json_value& listing)
+{
+    for(const auto& entity : listing.items)
+    {
+        const json_value*   eid = entity.find("eID");
+        const json_value*   name = entity.find("eN");
+
+        if((eid != NULL) && (name != NULL))
+        {
+            names[name->text] = eid->text;
+        }
+    }
+}
+
+bool client::resolve(const std::string& target, std::string& eid)
+{
+    std::future<reply_t>    listed;
+
+    if(is_eid(target) == true)
+    {
+        eid = target;
+        return(true);
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+
+        if(has_namespace == true)
+        {
+            eid = name_to_eid(name_space, target);
+            return(true);
+        }
+
+        if(names.count(target) != 0)
+        {
+            eid = names[target];
+            return(true);
+        }
+    }
+
+    auto promise = std::make_shared<std::promise<reply_t>>();
+    list_async([promise](const reply_t& reply) { promise->set_value(reply); });
+
+    listed = promise->get_future();
+    if(listed.get().error != 0)
+    {
+        return(false);
+    }
+
+    std::lock_guard<std::mutex> guard(lock);
+
+    if(names.count(target) == 0)
+    {
+        return(false);
+    }
+
+    eid = names[target];
+
+    return(true);
+}
+
+// =================================================================================
+// Replies
+
+void client::fail(line_t& line, int error, const std::string& message, completions_t& completions)
+{
+    for(auto& request : line.requests)
+    {
+        completions.push_back({ request.done, reply_t { error, message, json_value() } });
+    }
+
+    stats.errors = stats.errors + line.requests.size();
+}
+
+void client::complete(line_t& line, const json_value& reply, completions_t& completions)
+{
+    const json_value*   error = reply.find("error");
+    const json_value*   message = reply.find("message");
+    size_t              counter = 0;
+
+    // A failed batch isn't applied at all
+    if(error != NULL)
+    {
+        fail(line, atoi(error->text.c_str()), (message != NULL) ? message->text : "", completions);
+        return;
+    }
+
+    if(line.requests[0].listing == true)
+    {
+        learn_names(reply);
+        completions.push_back({ line.requests[0].done, reply_t { 0, "", reply } });
+        stats.replies = stats.replies + 1;
+        return;
+    }
+
+    if(line.requests.size() == 1)
+    {
+        completions.push_back({ line.requests[0].done, reply_t { 0, "", reply } });
+        stats.replies = stats.replies + 1;
+        return;
+    }
+
+    if((reply.type != json_value::JSON_ARRAY) || (reply.items.size() != line.requests.size()))
+    {
+        fail(line, CLIENT_ERROR_REPLY, "Batch reply doesn't match the request", completions);
+        return;
+    }
+
+    while(counter != line.requests.size())
+    {
+        error = reply.items[counter].find("error");
+
+        if(error != NULL)
+        {
+            message = reply.items[counter].find("message");
+            completions.push_back({ line.requests[counter].done, reply_t { atoi(error->text.c_str()), (message != NULL) ? message->text : "", json_value() } });
+            stats.errors = stats.errors + 1;
+        }
+        else
+        {
+            completions.push_back({ line.requests[counter].done, reply_t { 0, "", reply.items[counter] } });
+            stats.replies = stats.replies + 1;
+        }
+
+        counter = counter + 1;
+    }
+}
+
+void client::handle_line(const std::string& text, completions_t& completions)
+{
+    json_value          reply;
+    const json_value*   rid = NULL;
+    long                id = -1;
+    size_t              match = 0;
+    bool                found = false;
+
+    // Prompts and log output aren't JSON
+    if((text[0] != '{') && (text[0] != '['))
+    {
+        return;
+    }
+
+    if(json_parse(text, reply) == false)
+    {
+        return;
+    }
+
+    if(reply.find("seq") != NULL)
+    {
+        stats.pushes = stats.pushes + 1;
+
+        if(push_handler)
+        {
+            push_handler(reply);
+        }
+
+        return;
+    }
+
+    if(in_flight.empty() == true)
+    {
+        return;
+    }
+
+    if(reply.type == json_value::JSON_OBJECT)
+    {
+        rid = reply.find("rID");
+    }
+    else if((reply.type == json_value::JSON_ARRAY) && (reply.items.size() != 0))
+    {
+        rid = reply.items[0].find("rID");
+    }
+
+    if(rid != NULL)
+    {
+        id = atol(rid->text.c_str());
+    }
+
+    // Replies without a request ID belong to the oldest line
+    if(id == -1)
+    {
+        found = true;
+    }
+
+    while((found == false) && (match != in_flight.size()))
+    {
+        for(const auto& request : in_flight[match].requests)
+        {
+            if((request.listing == false) && ((long) request.rid == id))
+            {
+                found = true;
+            }
+        }
+
+        if(found == false)
+        {
+            match = match + 1;
+        }
+    }
+
+    // Probably the late reply to a line that already timed out
+    if(found == false)
+    {
+        return;
+    }
+
+    // Anything older than the matching line was dropped by the panel
+    while(match != 0)
+    {
+        fail(in_flight.front(), CLIENT_ERROR_LOST, "No reply", completions);
+        in_flight.pop_front();
+        match = match - 1;
+    }
+
+    complete(in_flight.front(), reply, completions);
+    in_flight.pop_front();
+}
+
+void client::expire(completions_t& completions)
+{
+    clock_t::time_point now = clock_t::now();
+
+    while((in_flight.empty() == false) && ((now - in_flight.front().sent) > std::chrono::milliseconds(options.timeout_ms)))
+    {
+        fail(in_flight.front(), CLIENT_ERROR_TIMEOUT, "Timed out", completions);
+        stats.timeouts = stats.timeouts + in_flight.front().requests.size();
+        in_flight.pop_front();
+    }
+}
+
+void client::reader(void)
+{
+    std::string     text;
+    completions_t   completions;
+    transport::read_t   result = transport::READ_TIMEOUT;
+    bool            lost = false;
+
+    while(true)
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+
+            if(stopping == true)
+            {
+                return;
+            }
+
+            lost = (connected == false) || (broken == true);
+        }
+
+        if(lost == true)
+        {
+            disconnect();
+
+            if(reconnect() == false)
+            {
+                return;
+            }
+        }
+
+        result = link->read_line(text, reader_poll_ms);
+
+        if(result == transport::READ_CLOSED)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            broken = true;
+            continue;
+        }
+
+        {
+            std::lock_guard<std::mutex> guard(lock);
+
+            if(result == transport::READ_LINE)
+            {
+                handle_line(text, completions);
+            }
+
+            expire(completions);
+            pump();
+        }
+
+        // Completions may queue more requests, so they're called without the lock
+        for(auto& completion : completions)
+        {
+            if(completion.first)
+            {
+                completion.first(completion.second);
+            }
+        }
+
+        if(completions.empty() == false)
+        {
+            completions.clear();
+            idle.notify_all();
+        }
+    }
+}
+
+} // namespace snon
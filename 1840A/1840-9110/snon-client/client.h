@@ -0,0 +1,164 @@
+// ---------------------------------------------------------------------------------
+// SNON client - Header
+// ---------------------------------------------------------------------------------
+// Keeps one connection to a panel open, and keeps several requests in flight on
+// it. Each request carries a request ID ("rID"), which the panel echoes in its
+// reply. Replies come back in the order the requests were sent.
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+
+#pragma once
+#ifndef SNON_CLIENT_H
+#define SNON_CLIENT_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "eid.h"
+#include "json.h"
+#include "transport.h"
+
+namespace snon
+{
+
+// Errors detected by the client. Errors reported by the panel are positive.
+#define CLIENT_ERROR_TIMEOUT    -1      // No reply in time
+#define CLIENT_ERROR_LOST       -2      // A later request was answered first, so the panel dropped this one
+#define CLIENT_ERROR_STOPPED    -3
+#define CLIENT_ERROR_REPLY      -4      // The reply didn't make sense
+
+struct reply_t
+{
+    int         error = 0;
+    std::string message;
+    json_value  body;                   // The entity, or for listings, every entity
+};
+
+typedef std::function<void(const reply_t& reply)> completion_t;
+
+struct client_options
+{
+    size_t      window = 32;            // Lines in flight. The panels queue up to 32 received lines.
+    size_t      batch_max = 1;          // Requests per line. More than one are sent as a batch.
+    int         timeout_ms = 2000;
+    int         reconnect_ms = 250;     // First delay between reconnect attempts, doubled up to the maximum
+    int         reconnect_max_ms = 5000;
+};
+
+struct client_stats
+{
+    uint64_t    requests = 0;
+    uint64_t    lines = 0;
+    uint64_t    replies = 0;
+    uint64_t    errors = 0;
+    uint64_t    timeouts = 0;
+    uint64_t    resent = 0;             // Requests sent again after a reconnect
+    uint64_t    reconnects = 0;
+    uint64_t    pushes = 0;
+};
+
+class client
+{
+public:
+    explicit client(std::unique_ptr<transport> link, const client_options& options = client_options());
+    ~client();
+
+    // Connects, and starts the thread that reads replies and reconnects
+    bool start(void);
+    void stop(void);
+
+    // Names are turned into eIDs with the namespace if there is one, or else by
+    // looking for them in the panel's entity list
+    void set_namespace(const uuid_t& name_space);
+    bool resolve(const std::string& target, std::string& eid);
+
+    // Completions are called from the reader thread, and may queue more requests
+    void set_async(const std::string& eid, const std::vector<std::string>& values, completion_t done);
+    void get_async(const std::string& eid, completion_t done);
+    void list_async(completion_t done);
+
+    std::future<reply_t> set(const std::string& eid, const std::vector<std::string>& values);
+    std::future<reply_t> get(const std::string& eid);
+
+    // Requests are held back from hold() until flush(), so they can go out together
+    void hold(void);
+
+    // Sends held requests and partly filled batches now. wait_idle() does the same,
+    // then waits for every reply.
+    void flush(void);
+    bool wait_idle(int timeout_ms);
+
+    // Called with subscription pushes ({"seq":<n>,...})
+    void on_push(std::function<void(const json_value& push)> handler);
+
+    client_stats get_stats(void);
+
+private:
+    typedef std::chrono::steady_clock clock_t;
+
+    struct request_t
+    {
+        uint32_t        rid;
+        std::string     fragment;
+        completion_t    done;
+        bool            listing;
+    };
+
+    struct line_t
+    {
+        std::vector<request_t>  requests;
+        clock_t::time_point     sent;
+    };
+
+    typedef std::vector<std::pair<completion_t, reply_t>> completions_t;
+
+    void queue(request_t request);
+    void pump(void);
+    void reader(void);
+    bool reconnect(void);
+    void disconnect(void);
+    void expire(completions_t& completions);
+    void handle_line(const std::string& text, completions_t& completions);
+    void complete(line_t& line, const json_value& reply, completions_t& completions);
+    void fail(line_t& line, int error, const std::string& message, completions_t& completions);
+    void learn_names(const json_value& listing);
+
+    std::unique_ptr<transport>      link;
+    client_options                  options;
+    client_stats                    stats;
+
+    std::mutex                      lock;
+    std::condition_variable         idle;
+    std::thread                     reader_thread;
+    std::deque<request_t>           pending;
+    std::deque<line_t>              in_flight;
+    bool                            connected = false;
+    bool                            stopping = false;
+    bool                            broken = false;
+    bool                            flushing = false;
+    bool                            holding = false;
+    uint32_t                        next_rid = 1;
+
+    bool                            has_namespace = false;
+    uuid_t                          name_space;
+    std::map<std::string, std::string>  names;
+
+    std::function<void(const json_value&)>  push_handler;
+};
+
+} // namespace snon
+
+#endif // SNON_CLIENT_H
@@ -0,0 +1,109 @@
+// ---------------------------------------------------------------------------------
+// SNON entity IDs
+// ---------------------------------------------------------------------------------
+// Entity names map to eIDs as name-based (version 5) UUIDs, like snon_name_to_eid()
+// on the panels, so hosts can address entities by name without asking for them
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+#include <cstdio>
+#include <cstring>
+
+#include "eid.h"
+#include "sha1.h"
+
+namespace snon
+{
+
+// Constants
+static const char   eid_prefix[] = "urn:uuid:";
+
+static int hex_value(char character)
+{
+    if((character >= '0') && (character <= '9'))
+    {
+        return(character - '0');
+    }
+    else if((character >= 'A') && (character <= 'F'))
+    {
+        return(character - 'A' + 10);
+    }
+    else if((character >= 'a') && (character <= 'f'))
+    {
+        return(character - 'a' + 10);
+    }
+
+    return(-1);
+}
+
+bool uuid_parse(const std::string& text, uuid_t& uuid)
+{
+    size_t  position = 0;
+    size_t  count = 0;
+    int     high = 0;
+    int     low = 0;
+
+    if(text.compare(0, strlen(eid_prefix), eid_prefix) == 0)
+    {
+        position = strlen(eid_prefix);
+    }
+
+    if(text.length() - position != 36)
+    {
+        return(false);
+    }
+
+    while(count != 16)
+    {
+        if(text[position] == '-')
+        {
+            position = position + 1;
+        }
+
+        high = hex_value(text[position]);
+        low = hex_value(text[position + 1]);
+
+        if((high < 0) || (low < 0))
+        {
+            return(false);
+        }
+
+        uuid[count] = (uint8_t) ((high << 4) | low);
+        position = position + 2;
+        count = count + 1;
+    }
+
+    return(position == text.length());
+}
+
+std::string name_to_eid(const uuid_t& name_space, const std::string& name)
+{
+    sha1        hash;
+    uint8_t     digest[20];
+    char        eid[sizeof(eid_prefix) + 36];
+
+    hash.update(name_space.data(), name_space.size());
+    hash.update(name.data(), name.length());
+    hash.final(digest);
+
+    // Version 5, RFC 4122 variant
+    digest[6] = (digest[6] & 0x0F) | 0x50;
+    digest[8] = (digest[8] & 0x3F) | 0x80;
+
+    snprintf(eid, sizeof(eid), "%s%02X%02X%02X%02X-%02X%02X-%02X%02X-%02X%02X-%02X%02X%02X%02X%02X%02X", eid_prefix,
+             digest[0], digest[1], digest[2], digest[3], digest[4], digest[5], digest[6], digest[7],
+             digest[8], digest[9], digest[10], digest[11], digest[12], digest[13], digest[14], digest[15]);
+
+    return(eid);
+}
+
+bool is_eid(const std::string& text)
+{
+    uuid_t  uuid;
+
+    return((text.compare(0, strlen(eid_prefix), eid_prefix) == 0) && (uuid_parse(text, uuid) == true));
+}
+
+} // namespace snon
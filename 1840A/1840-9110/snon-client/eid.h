@@ -0,0 +1,35 @@
+// ---------------------------------------------------------------------------------
+// SNON entity IDs - Header
+// ---------------------------------------------------------------------------------
+// Entity names map to eIDs as name-based (version 5) UUIDs, like snon_name_to_eid()
+// on the panels, so hosts can address entities by name without asking for them
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+
+#pragma once
+#ifndef SNON_EID_H
+#define SNON_EID_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+namespace snon
+{
+
+typedef std::array<uint8_t, 16> uuid_t;
+
+// Accepts "XXXXXXXX-XXXX-XXXX-XXXX-XXXXXXXXXXXX", with or without "urn:uuid:"
+bool uuid_parse(const std::string& text, uuid_t& uuid);
+
+// Returns "urn:uuid:XXXXXXXX-XXXX-5XXX-XXXX-XXXXXXXXXXXX", in upper case like the panels
+std::string name_to_eid(const uuid_t& name_space, const std::string& name);
+
+bool is_eid(const std::string& text);
+
+} // namespace snon
+
+#endif // SNON_EID_H
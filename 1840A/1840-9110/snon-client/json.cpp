@@ -0,0 +1,317 @@
+// ---------------------------------------------------------------------------------
+// Minimal JSON
+// ---------------------------------------------------------------------------------
+// Just enough JSON to read SNON replies and build SNON fragments
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+#include <cstdio>
+
+#include "json.h"
+
+namespace snon
+{
+
+// Constants
+static const int    json_depth_max = 16;
+
+// Private prototypes
+static bool parse_value(const std::string& input, size_t& position, json_value& value, int depth);
+
+// =================================================================================
+// Parsing
+
+static void skip_space(const std::string& input, size_t& position)
+{
+    while((position < input.length()) && ((input[position] == ' ') || (input[position] == '\t') ||
+                                           (input[position] == '\r') || (input[position] == '\n')))
+    {
+        position = position + 1;
+    }
+}
+
+static bool parse_string(const std::string& input, size_t& position, std::string& text)
+{
+    char    character = 0;
+
+    // Skip the opening quote
+    position = position + 1;
+    text.clear();
+
+    while(position < input.length())
+    {
+        character = input[position];
+        position = position + 1;
+
+        if(character == '"')
+        {
+            return(true);
+        }
+        else if(character == '\\')
+        {
+            if(position >= input.length())
+            {
+                return(false);
+            }
+
+            character = input[position];
+            position = position + 1;
+
+            if(character == 'n')
+            {
+                text.push_back('\n');
+            }
+            else if(character == 'r')
+            {
+                text.push_back('\r');
+            }
+            else if(character == 't')
+            {
+                text.push_back('\t');
+            }
+            else if(character == 'u')
+            {
+                // The panels only send ASCII, so anything else is kept as-is
+                if(position + 4 > input.length())
+                {
+                    return(false);
+                }
+
+                unsigned int code = 0;
+                if((sscanf(input.c_str() + position, "%4x", &code) == 1) && (code < 0x80))
+                {
+                    text.push_back((char) code);
+                }
+                else
+                {
+                    text.append(input, position - 2, 6);
+                }
+
+                position = position + 4;
+            }
+            else
+            {
+                text.push_back(character);
+            }
+        }
+        else
+        {
+            text.push_back(character);
+        }
+    }
+
+    return(false);
+}
+
+static bool parse_value(const std::string& input, size_t& position, json_value& value, int depth)
+{
+    size_t  start = 0;
+
+    if(depth > json_depth_max)
+    {
+        return(false);
+    }
+
+    skip_space(input, position);
+
+    if(position >= input.length())
+    {
+        return(false);
+    }
+
+    if(input[position] == '{')
+    {
+        value.type = json_value::JSON_OBJECT;
+        position = position + 1;
+        skip_space(input, position);
+
+        if((position < input.length()) && (input[position] == '}'))
+        {
+            position = position + 1;
+            return(true);
+        }
+
+        while(position < input.length())
+        {
+            std::pair<std::string, json_value>  member;
+
+            skip_space(input, position);
+            if((position >= input.length()) || (input[position] != '"') || (parse_string(input, position, member.first) == false))
+            {
+                return(false);
+            }
+
+            skip_space(input, position);
+            if((position >= input.length()) || (input[position] != ':'))
+            {
+                return(false);
+            }
+
+            position = position + 1;
+            if(parse_value(input, position, member.second, depth + 1) == false)
+            {
+                return(false);
+            }
+
+            value.members.push_back(std::move(member));
+
+            skip_space(input, position);
+            if(position >= input.length())
+            {
+                return(false);
+            }
+
+            position = position + 1;
+            if(input[position - 1] == '}')
+            {
+                return(true);
+            }
+            else if(input[position - 1] != ',')
+            {
+                return(false);
+            }
+        }
+
+        return(false);
+    }
+    else if(input[position] == '[')
+    {
+        value.type = json_value::JSON_ARRAY;
+        position = position + 1;
+        skip_space(input, position);
+
+        if((position < input.length()) && (input[position] == ']'))
+        {
+            position = position + 1;
+            return(true);
+        }
+
+        while(position < input.length())
+        {
+            json_value  item;
+
+            if(parse_value(input, position, item, depth + 1) == false)
+            {
+                return(false);
+            }
+
+            value.items.push_back(std::move(item));
+
+            skip_space(input, position);
+            if(position >= input.length())
+            {
+                return(false);
+            }
+
+            position = position + 1;
+            if(input[position - 1] == ']')
+            {
+                return(true);
+            }
+            else if(input[position - 1] != ',')
+            {
+                return(false);
+            }
+        }
+
+        return(false);
+    }
+    else if(input[position] == '"')
+    {
+        value.type = json_value::JSON_STRING;
+        return(parse_string(input, position, value.text));
+    }
+
+    // Numbers, booleans and null
+    start = position;
+    while((position < input.length()) && (input[position] != ',') && (input[position] != '}') &&
+          (input[position] != ']') && (input[position] != ' ') && (input[position] != '\r') && (input[position] != '\n'))
+    {
+        position = position + 1;
+    }
+
+    value.text = input.substr(start, position - start);
+
+    if(value.text == "null")
+    {
+        value.type = json_value::JSON_NULL;
+    }
+    else if((value.text == "true") || (value.text == "false"))
+    {
+        value.type = json_value::JSON_BOOL;
+    }
+    else if((value.text.length() != 0) && (value.text.find_first_not_of("0123456789+-.eE") == std::string::npos))
+    {
+        value.type = json_value::JSON_NUMBER;
+    }
+    else
+    {
+        return(false);
+    }
+
+    return(true);
+}
+
+bool json_parse(const std::string& input, json_value& value)
+{
+    size_t  position = 0;
+
+    value = json_value();
+
+    if(parse_value(input, position, value, 0) == false)
+    {
+        return(false);
+    }
+
+    skip_space(input, position);
+
+    return(position == input.length());
+}
+
+// =================================================================================
+// Building
+
+const json_value* json_value::find(const std::string& key) const
+{
+    for(const auto& member : members)
+    {
+        if(member.first == key)
+        {
+            return(&member.second);
+        }
+    }
+
+    return(NULL);
+}
+
+std::string json_quote(const std::string& text)
+{
+    std::string quoted = "\"";
+    char        escape[8];
+
+    for(char character : text)
+    {
+        if((character == '"') || (character == '\\'))
+        {
+            quoted.push_back('\\');
+            quoted.push_back(character);
+        }
+        else if((unsigned char) character < 0x20)
+        {
+            snprintf(escape, sizeof(escape), "\\u%04x", (unsigned char) character);
+            quoted.append(escape);
+        }
+        else
+        {
+            quoted.push_back(character);
+        }
+    }
+
+    quoted.push_back('"');
+
+    return(quoted);
+}
+
+} // namespace snon
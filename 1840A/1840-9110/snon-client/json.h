@@ -0,0 +1,42 @@
+// ---------------------------------------------------------------------------------
+// Minimal JSON - Header
+// ---------------------------------------------------------------------------------
+// Just enough JSON to read SNON replies and build SNON fragments
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+
+#pragma once
+#ifndef SNON_JSON_H
+#define SNON_JSON_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace snon
+{
+
+struct json_value
+{
+    enum type_t { JSON_NULL, JSON_BOOL, JSON_NUMBER, JSON_STRING, JSON_ARRAY, JSON_OBJECT };
+
+    type_t                                          type = JSON_NULL;
+    std::string                                     text;       // Strings (unescaped), numbers and booleans
+    std::vector<json_value>                         items;
+    std::vector<std::pair<std::string, json_value>> members;
+
+    // Returns NULL if this isn't an object, or it has no such key
+    const json_value* find(const std::string& key) const;
+};
+
+bool json_parse(const std::string& input, json_value& value);
+
+// Returns the string quoted and escaped
+std::string json_quote(const std::string& text);
+
+} // namespace snon
+
+#endif // SNON_JSON_H
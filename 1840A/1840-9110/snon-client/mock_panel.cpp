@@ -0,0 +1,312 @@
+// ---------------------------------------------------------------------------------
+// Mock SNON panel
+// ---------------------------------------------------------------------------------
+// Answers SNON fragments and batches the way the panels do, so the client can be
+// exercised and benchmarked without hardware
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+#include <cerrno>
+#include <chrono>
+#include <thread>
+
+#include <unistd.h>
+
+#include "mock_panel.h"
+
+namespace snon
+{
+
+// Constants, matching reply.h on the panels
+#define MOCK_ERROR_INVALID      1
+#define MOCK_ERROR_NO_EID       2
+#define MOCK_ERROR_NOT_FOUND    3
+
+static const char*  mock_messages[] =
+{
+    "Unknown error",
+    "Invalid fragment",
+    "Missing eID",
+    "Entity not found"
+};
+
+// Any fixed namespace will do for the mock. This is the RFC 4122 URL namespace.
+const uuid_t mock_panel::default_namespace =
+{
+    0x6B, 0xA7, 0xB8, 0x11, 0x9D, 0xAD, 0x11, 0xD1, 0x80, 0xB4, 0x00, 0xC0, 0x4F, 0xD4, 0x30, 0xC8
+};
+
+mock_panel::mock_panel(const uuid_t& name_space) : name_space(name_space), baud(0), lines(0)
+{
+}
+
+std::string mock_panel::add_entity(const std::string& name, const std::vector<std::string>& values)
+{
+    std::lock_guard<std::mutex> guard(entities_lock);
+    std::string                 eid = name_to_eid(name_space, name);
+
+    entities[eid] = entity_t { name, values };
+
+    return(eid);
+}
+
+void mock_panel::set_baud(uint32_t new_baud)
+{
+    baud = new_baud;
+}
+
+uint64_t mock_panel::get_lines(void) const
+{
+    return(lines);
+}
+
+// =================================================================================
+// Replies
+
+std::string mock_panel::entity_json(const std::string& eid, const entity_t& entity, const json_value* rid) const
+{
+    std::string output = "{\"eID\":" + json_quote(eid) + ",\"eN\":" + json_quote(entity.name) + ",\"v\":[";
+    bool        first = true;
+
+    for(const auto& value : entity.values)
+    {
+        if(first == false)
+        {
+            output.push_back(',');
+        }
+
+        output.append(json_quote(value));
+        first = false;
+    }
+
+    output.push_back(']');
+
+    if(rid != NULL)
+    {
+        output.append(",\"rID\":" + rid->text);
+    }
+
+    output.push_back('}');
+
+    return(output);
+}
+
+std::string mock_panel::error_json(int error, const json_value* rid) const
+{
+    std::string output = "{";
+
+    if(rid != NULL)
+    {
+        output.append("\"rID\":" + rid->text + ",");
+    }
+
+    output.append("\"error\":" + std::to_string(error) + ",\"message\":" + json_quote(mock_messages[error]) + "}");
+
+    return(output);
+}
+
+// =================================================================================
+// Requests
+
+std::string mock_panel::handle_fragment(const json_value& fragment)
+{
+    std::lock_guard<std::mutex> guard(entities_lock);
+    const json_value*           rid = fragment.find("rID");
+    const json_value*           eid = fragment.find("eID");
+    const json_value*           values = fragment.find("v");
+
+    if((rid != NULL) && (rid->type != json_value::JSON_NUMBER))
+    {
+        rid = NULL;
+    }
+
+    if((eid == NULL) || (eid->type != json_value::JSON_STRING))
+    {
+        return(error_json(MOCK_ERROR_NO_EID, rid));
+    }
+
+    auto entity = entities.find(eid->text);
+    if(entity == entities.end())
+    {
+        return(error_json(MOCK_ERROR_NOT_FOUND, rid));
+    }
+
+    if((values != NULL) && (values->type == json_value::JSON_ARRAY))
+    {
+        entity->second.values.clear();
+
+        for(const auto& value : values->items)
+        {
+            entity->second.values.push_back(value.text);
+        }
+    }
+
+    return(entity_json(entity->first, entity->second, rid));
+}
+
+// Every fragment is checked before any are applied, like the panels do
+std::string mock_panel::handle_batch(const json_value& batch)
+{
+    std::string output = "[";
+
+    {
+        std::lock_guard<std::mutex> guard(entities_lock);
+
+        for(const auto& fragment : batch.items)
+        {
+            const json_value*   rid = fragment.find("rID");
+            const json_value*   eid = fragment.find("eID");
+
+            if((rid != NULL) && (rid->type != json_value::JSON_NUMBER))
+            {
+                rid = NULL;
+            }
+
+            if(fragment.type != json_value::JSON_OBJECT)
+            {
+                return(error_json(MOCK_ERROR_INVALID, NULL));
+            }
+            else if((eid == NULL) || (eid->type != json_value::JSON_STRING))
+            {
+                return(error_json(MOCK_ERROR_NO_EID, rid));
+            }
+            else if(entities.count(eid->text) == 0)
+            {
+                return(error_json(MOCK_ERROR_NOT_FOUND, rid));
+            }
+        }
+    }
+
+    for(const auto& fragment : batch.items)
+    {
+        if(output.length() != 1)
+        {
+            output.push_back(',');
+        }
+
+        output.append(handle_fragment(fragment));
+    }
+
+    output.push_back(']');
+
+    return(output);
+}
+
+std::string mock_panel::handle_line(const std::string& line)
+{
+    json_value  request;
+    std::string output;
+
+    if(line.length() == 0)
+    {
+        return("");
+    }
+
+    lines = lines + 1;
+
+    // Command lines aren't answered outside command mode
+    if((line[0] != '{') && (line[0] != '['))
+    {
+        return("");
+    }
+
+    if(json_parse(line, request) == false)
+    {
+        return(error_json(MOCK_ERROR_INVALID, NULL));
+    }
+
+    if(request.type == json_value::JSON_ARRAY)
+    {
+        return(handle_batch(request));
+    }
+
+    // "{}" lists every entity
+    if(request.members.size() == 0)
+    {
+        std::lock_guard<std::mutex> guard(entities_lock);
+
+        output = "[";
+        for(const auto& entity : entities)
+        {
+            if(output.length() != 1)
+            {
+                output.push_back(',');
+            }
+
+            output.append(entity_json(entity.first, entity.second, NULL));
+        }
+
+        output.push_back(']');
+
+        return(output);
+    }
+
+    return(handle_fragment(request));
+}
+
+void mock_panel::serve(int fd)
+{
+    std::string received;
+    std::string reply;
+    char        chunk[4096];
+    ssize_t     result = 0;
+    size_t      end = 0;
+    size_t      sent = 0;
+
+    while(true)
+    {
+        result = read(fd, chunk, sizeof(chunk));
+        if(result <= 0)
+        {
+            if((result < 0) && (errno == EINTR))
+            {
+                continue;
+            }
+
+            return;
+        }
+
+        received.append(chunk, result);
+
+        end = received.find_first_of("\r\n");
+        while(end != std::string::npos)
+        {
+            reply = handle_line(received.substr(0, end));
+            received.erase(0, end + 1);
+
+            if(reply.length() != 0)
+            {
+                reply.append("\r\n");
+
+                // 10 bits per character on the wire
+                if(baud != 0)
+                {
+                    std::this_thread::sleep_for(std::chrono::microseconds((uint64_t) reply.length() * 10000000 / baud));
+                }
+
+                sent = 0;
+                while(sent != reply.length())
+                {
+                    result = write(fd, reply.data() + sent, reply.length() - sent);
+                    if(result <= 0)
+                    {
+                        if((result < 0) && (errno == EINTR))
+                        {
+                            continue;
+                        }
+
+                        return;
+                    }
+
+                    sent = sent + result;
+                }
+            }
+
+            end = received.find_first_of("\r\n");
+        }
+    }
+}
+
+} // namespace snon
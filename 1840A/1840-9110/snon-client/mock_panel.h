@@ -0,0 +1,73 @@
+// ---------------------------------------------------------------------------------
+// Mock SNON panel - Header
+// ---------------------------------------------------------------------------------
+// Answers SNON fragments and batches the way the panels do, so the client can be
+// exercised and benchmarked without hardware
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+
+#pragma once
+#ifndef SNON_MOCK_PANEL_H
+#define SNON_MOCK_PANEL_H
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "eid.h"
+#include "json.h"
+
+namespace snon
+{
+
+class mock_panel
+{
+public:
+    // Used when no namespace is given
+    static const uuid_t default_namespace;
+
+    explicit mock_panel(const uuid_t& name_space = default_namespace);
+
+    // Returns the eID of the entity
+    std::string add_entity(const std::string& name, const std::vector<std::string>& values);
+
+    // Replies are held back as long as they would take to send at this rate.
+    // Zero replies as fast as possible.
+    void set_baud(uint32_t baud);
+
+    // Handles one line. Returns the reply, or an empty string if there isn't one.
+    std::string handle_line(const std::string& line);
+
+    // Answers lines until the descriptor is closed
+    void serve(int fd);
+
+    uint64_t get_lines(void) const;
+
+private:
+    struct entity_t
+    {
+        std::string                 name;
+        std::vector<std::string>    values;
+    };
+
+    std::string entity_json(const std::string& eid, const entity_t& entity, const json_value* rid) const;
+    std::string error_json(int error, const json_value* rid) const;
+    std::string handle_fragment(const json_value& fragment);
+    std::string handle_batch(const json_value& batch);
+
+    uuid_t                              name_space;
+    std::map<std::string, entity_t>     entities;       // By eID
+    std::mutex                          entities_lock;
+    std::atomic<uint32_t>               baud;
+    std::atomic<uint64_t>               lines;
+};
+
+} // namespace snon
+
+#endif // SNON_MOCK_PANEL_H
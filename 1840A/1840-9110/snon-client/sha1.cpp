@@ -0,0 +1,159 @@
+// ---------------------------------------------------------------------------------
+// SHA-1
+// ---------------------------------------------------------------------------------
+// Only used to derive name-based (version 5) UUIDs, the same way the panels do
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+#include <cstring>
+
+#include "sha1.h"
+
+namespace snon
+{
+
+static uint32_t rotate_left(uint32_t value, int bits)
+{
+    return((value << bits) | (value >> (32 - bits)));
+}
+
+sha1::sha1()
+{
+    state[0] = 0x67452301;
+    state[1] = 0xEFCDAB89;
+    state[2] = 0x98BADCFE;
+    state[3] = 0x10325476;
+    state[4] = 0xC3D2E1F0;
+    length_bits = 0;
+    buffered = 0;
+}
+
+void sha1::transform(const uint8_t block[64])
+{
+    uint32_t    words[80];
+    uint32_t    a = state[0];
+    uint32_t    b = state[1];
+    uint32_t    c = state[2];
+    uint32_t    d = state[3];
+    uint32_t    e = state[4];
+    uint32_t    f = 0;
+    uint32_t    k = 0;
+    uint32_t    temp = 0;
+    int         counter = 0;
+
+    while(counter != 16)
+    {
+        words[counter] = ((uint32_t) block[counter * 4] << 24) | ((uint32_t) block[counter * 4 + 1] << 16) |
+                         ((uint32_t) block[counter * 4 + 2] << 8) | (uint32_t) block[counter * 4 + 3];
+        counter = counter + 1;
+    }
+
+    while(counter != 80)
+    {
+        words[counter] = rotate_left(words[counter - 3] ^ words[counter - 8] ^ words[counter - 14] ^ words[counter - 16], 1);
+        counter = counter + 1;
+    }
+
+    counter = 0;
+    while(counter != 80)
+    {
+        if(counter < 20)
+        {
+            f = (b & c) | (~b & d);
+            k = 0x5A827999;
+        }
+        else if(counter < 40)
+        {
+            f = b ^ c ^ d;
+            k = 0x6ED9EBA1;
+        }
+        else if(counter < 60)
+        {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8F1BBCDC;
+        }
+        else
+        {
+            f = b ^ c ^ d;
+            k = 0xCA62C1D6;
+        }
+
+        temp = rotate_left(a, 5) + f + e + k + words[counter];
+        e = d;
+        d = c;
+        c = rotate_left(b, 30);
+        b = a;
+        a = temp;
+
+        counter = counter + 1;
+    }
+
+    state[0] = state[0] + a;
+    state[1] = state[1] + b;
+    state[2] = state[2] + c;
+    state[3] = state[3] + d;
+    state[4] = state[4] + e;
+}
+
+void sha1::update(const void* data, size_t length)
+{
+    const uint8_t*  bytes = (const uint8_t*) data;
+    size_t          chunk = 0;
+
+    length_bits = length_bits + ((uint64_t) length * 8);
+
+    while(length != 0)
+    {
+        chunk = 64 - buffered;
+        if(chunk > length)
+        {
+            chunk = length;
+        }
+
+        memcpy(buffer + buffered, bytes, chunk);
+        buffered = buffered + chunk;
+        bytes = bytes + chunk;
+        length = length - chunk;
+
+        if(buffered == 64)
+        {
+            transform(buffer);
+            buffered = 0;
+        }
+    }
+}
+
+void sha1::final(uint8_t digest[20])
+{
+    uint64_t    total_bits = length_bits;
+    uint8_t     padding = 0x80;
+    uint8_t     length_bytes[8];
+    int         counter = 0;
+
+    update(&padding, 1);
+
+    padding = 0;
+    while(buffered != 56)
+    {
+        update(&padding, 1);
+    }
+
+    while(counter != 8)
+    {
+        length_bytes[counter] = (uint8_t) (total_bits >> (56 - counter * 8));
+        counter = counter + 1;
+    }
+
+    update(length_bytes, 8);
+
+    counter = 0;
+    while(counter != 20)
+    {
+        digest[counter] = (uint8_t) (state[counter / 4] >> (24 - (counter % 4) * 8));
+        counter = counter + 1;
+    }
+}
+
+} // namespace snon
@@ -0,0 +1,40 @@
+// ---------------------------------------------------------------------------------
+// SHA-1 - Header
+// ---------------------------------------------------------------------------------
+// Only used to derive name-based (version 5) UUIDs, the same way the panels do
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+
+#pragma once
+#ifndef SNON_SHA1_H
+#define SNON_SHA1_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace snon
+{
+
+class sha1
+{
+public:
+    sha1();
+
+    void update(const void* data, size_t length);
+    void final(uint8_t digest[20]);
+
+private:
+    void transform(const uint8_t block[64]);
+
+    uint32_t    state[5];
+    uint64_t    length_bits;
+    uint8_t     buffer[64];
+    size_t      buffered;
+};
+
+} // namespace snon
+
+#endif // SNON_SHA1_H
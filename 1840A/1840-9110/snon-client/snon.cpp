@@ -0,0 +1,580 @@
+// ---------------------------------------------------------------------------------
+// SNON command line client
+// ---------------------------------------------------------------------------------
+// Sets and gets panel values over one persistent connection, and benchmarks the
+// client against the mock panel.
+//
+// Usage: snon [options] <command>
+//   set <name|eID> <value> [<value> ...]
+//   batch <name|eID>=<value> [...]        Applied together, with one redraw
+//   get <name|eID>
+//   list
+//   eid <name>
+//   bench [--count <n>] [--baud <rate>]   Against the mock panel
+//
+// Options:
+//   --help, -h             Print usage and exit
+//   --link <spec>          tcp:<host>:<port>, serial:<device>[@<baud>] or mock
+//                          (default tcp:192.168.88.101:200)
+//   --namespace <uuid>     eID namespace, for resolving names without asking the panel
+//                          (default $SNON_NAMESPACE)
+//   --window <n>           Lines in flight (default 32)
+//   --batch <n>            Requests per line (default 1)
+//   --timeout <ms>         (default 2000)
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "client.h"
+#include "eid.h"
+#include "mock_panel.h"
+#include "transport.h"
+
+using namespace snon;
+
+// Constants
+#define BENCH_COUNT_DEFAULT     10000
+#define BENCH_ENTITIES          16
+#define WAIT_MS                 10000
+
+// Types
+struct options_t
+{
+    std::string     link = "tcp:192.168.88.101:200";
+    bool            link_given = false;
+    std::string     name_space;
+    client_options  client;
+    bool            window_given = false;
+    bool            batch_given = false;
+    uint32_t        count = BENCH_COUNT_DEFAULT;
+    uint32_t        baud = 0;
+};
+
+// =================================================================================
+// Output
+
+// Asked for usage goes to stdout, anything else is a mistake and goes to stderr
+static void usage(FILE* stream = stderr)
+{
+    fprintf(stream, "Usage: snon [--help] [--link <spec>] [--namespace <uuid>] [--window <n>] [--batch <n>] [--timeout <ms>] <command>\n"
+                    "  set <name|eID> <value> [<value> ...]\n"
+                    "  batch <name|eID>=<value> [...]\n"
+                    "  get <name|eID>\n"
+                    "  list\n"
+                    "  eid <name>\n"
+                    "  bench [--count <n>] [--baud <rate>]\n"
+                    "Links are tcp:<host>:<port>, serial:<device>[@<baud>] or mock\n");
+}
+
+static void print_entity(const json_value& entity)
+{
+    const json_value*   eid = entity.find("eID");
+    const json_value*   name = entity.find("eN");
+    const json_value*   values = entity.find("v");
+    bool                first = true;
+
+    printf("%s", (eid != NULL) ? eid->text.c_str() : "?");
+
+    if(name != NULL)
+    {
+        printf(" - %s", name->text.c_str());
+    }
+
+    printf(":");
+
+    if(values != NULL)
+    {
+        for(const auto& value : values->items)
+        {
+            printf("%s%s", (first == true) ? " " : ", ", value.text.c_str());
+            first = false;
+        }
+    }
+
+    printf("\n");
+}
+
+static bool check_reply(const reply_t& reply)
+{
+    if(reply.error != 0)
+    {
+        fprintf(stderr, "Failed: %s (%d)\n", reply.message.c_str(), reply.error);
+        return(false);
+    }
+
+    return(true);
+}
+
+// =================================================================================
+// Commands
+
+static int command_set(client& panel, const std::vector<std::string>& arguments)
+{
+    std::string eid;
+
+    if(arguments.size() < 2)
+    {
+        usage();
+        return(1);
+    }
+
+    if(panel.resolve(arguments[0], eid) == false)
+    {
+        fprintf(stderr, "Unknown entity \"%s\"\n", arguments[0].c_str());
+        return(1);
+    }
+
+    reply_t reply = panel.set(eid, std::vector<std::string>(arguments.begin() + 1, arguments.end())).get();
+    if(check_reply(reply) == false)
+    {
+        return(1);
+    }
+
+    print_entity(reply.body);
+
+    return(0);
+}
+
+static int command_batch(client& panel, const std::vector<std::string>& arguments)
+{
+    std::vector<reply_t>    replies(arguments.size());
+    std::string             eid;
+    size_t                  separator = 0;
+    size_t                  counter = 0;
+    int                     result = 0;
+
+    if(arguments.size() == 0)
+    {
+        usage();
+        return(1);
+    }
+
+    // Resolve everything first, since a name lookup needs the connection to itself
+    std::vector<std::string> eids;
+    for(const auto& argument : arguments)
+    {
+        separator = argument.find('=');
+        if((separator == std::string::npos) || (panel.resolve(argument.substr(0, separator), eid) == false))
+        {
+            fprintf(stderr, "Unknown entity in \"%s\"\n", argument.c_str());
+            return(1);
+        }
+
+        eids.push_back(eid);
+    }
+
+    panel.hold();
+
+    while(counter != arguments.size())
+    {
+        separator = arguments[counter].find('=');
+        panel.set_async(eids[counter], { arguments[counter].substr(separator + 1) },
+                        [&replies, counter](const reply_t& reply) { replies[counter] = reply; });
+        counter = counter + 1;
+    }
+
+    if(panel.wait_idle(WAIT_MS) == false)
+    {
+        fprintf(stderr, "Timed out\n");
+        return(1);
+    }
+
+    for(const auto& reply : replies)
+    {
+        if(check_reply(reply) == true)
+        {
+            print_entity(reply.body);
+        }
+        else
+        {
+            result = 1;
+        }
+    }
+
+    return(result);
+}
+
+static int command_get(client& panel, const std::vector<std::string>& arguments)
+{
+    std::string eid;
+
+    if(arguments.size() != 1)
+    {
+        usage();
+        return(1);
+    }
+
+    if(panel.resolve(arguments[0], eid) == false)
+    {
+        fprintf(stderr, "Unknown entity \"%s\"\n", arguments[0].c_str());
+        return(1);
+    }
+
+    reply_t reply = panel.get(eid).get();
+    if(check_reply(reply) == false)
+    {
+        return(1);
+    }
+
+    print_entity(reply.body);
+
+    return(0);
+}
+
+static int command_list(client& panel)
+{
+    auto    promise = std::make_shared<std::promise<reply_t>>();
+
+    panel.list_async([promise](const reply_t& reply) { promise->set_value(reply); });
+
+    reply_t reply = promise->get_future().get();
+    if(check_reply(reply) == false)
+    {
+        return(1);
+    }
+
+    for(const auto& entity : reply.body.items)
+    {
+        print_entity(entity);
+    }
+
+    return(0);
+}
+
+static int command_eid(client& panel, const std::vector<std::string>& arguments)
+{
+    std::string eid;
+
+    if(arguments.size() != 1)
+    {
+        usage();
+        return(1);
+    }
+
+    if(panel.resolve(arguments[0], eid) == false)
+    {
+        fprintf(stderr, "Unknown entity \"%s\"\n", arguments[0].c_str());
+        return(1);
+    }
+
+    printf("%s\n", eid.c_str());
+
+    return(0);
+}
+
+// =================================================================================
+// Benchmark
+
+// Keeps window * batch updates outstanding, so the latency measured is that of
+// the link rather than of an ever-growing queue
+static bool bench_run(std::unique_ptr<transport> link, const client_options& settings, const std::vector<std::string>& eids, uint32_t count)
+{
+    typedef std::chrono::steady_clock   clock_t;
+
+    client                          panel(std::move(link), settings);
+    std::vector<clock_t::time_point>    started(count);
+    std::vector<double>             latencies(count);
+    std::mutex                      lock;
+    std::condition_variable         done;
+    std::atomic<uint32_t>           failed(0);
+    uint32_t                        completed = 0;
+    uint32_t                        outstanding = 0;
+    uint32_t                        outstanding_max = settings.window * settings.batch_max;
+    uint32_t                        counter = 0;
+    clock_t::time_point             start;
+    double                          elapsed = 0;
+
+    if(panel.start() == false)
+    {
+        fprintf(stderr, "Unable to connect\n");
+        return(false);
+    }
+
+    start = clock_t::now();
+
+    while(counter != count)
+    {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            done.wait(guard, [&]() { return(outstanding < outstanding_max); });
+            outstanding = outstanding + 1;
+        }
+
+        started[counter] = clock_t::now();
+        panel.set_async(eids[counter % eids.size()], { std::to_string(counter) },
+                        [&, counter](const reply_t& reply)
+                        {
+                            latencies[counter] = std::chrono::duration<double, std::micro>(clock_t::now() - started[counter]).count();
+
+                            if(reply.error != 0)
+                            {
+                                failed = failed + 1;
+                            }
+
+                            std::lock_guard<std::mutex> guard(lock);
+                            outstanding = outstanding - 1;
+                            completed = completed + 1;
+                            done.notify_all();
+                        });
+
+        counter = counter + 1;
+    }
+
+    {
+        std::unique_lock<std::mutex> guard(lock);
+
+        // Partly filled batches go out once the window drains
+        if(done.wait_for(guard, std::chrono::milliseconds(WAIT_MS), [&]() { return(completed == count); }) == false)
+        {
+            guard.unlock();
+            panel.flush();
+            guard.lock();
+            done.wait_for(guard, std::chrono::milliseconds(WAIT_MS), [&]() { return(completed == count); });
+        }
+    }
+
+    elapsed = std::chrono::duration<double>(clock_t::now() - start).count();
+    client_stats stats = panel.get_stats();
+    panel.stop();
+
+    std::sort(latencies.begin(), latencies.end());
+
+    printf("window %3zu, batch %3zu: %9.0f updates/s, latency p50 %8.1f us, p99 %8.1f us, max %8.1f us, %lu lines, %u failed\n",
+           settings.window, settings.batch_max, count / elapsed, latencies[count / 2], latencies[(count * 99) / 100],
+           latencies[count - 1], (unsigned long) stats.lines, failed.load());
+
+    return(failed == 0);
+}
+
+static int command_bench(const options_t& options, mock_panel& mock)
+{
+    struct { size_t window; size_t batch; } configurations[] = { { 1, 1 }, { 8, 1 }, { 32, 1 }, { 32, 8 } };
+    std::vector<std::string>    eids;
+    uint32_t                    counter = 0;
+    bool                        passed = true;
+
+    if(options.count == 0)
+    {
+        usage();
+        return(1);
+    }
+
+    // A real panel's entities would have to be named on the command line
+    if((options.link_given == true) && (options.link != "mock"))
+    {
+        fprintf(stderr, "Only the mock panel can be benchmarked\n");
+        return(1);
+    }
+
+    mock.set_baud(options.baud);
+
+    while(counter != BENCH_ENTITIES)
+    {
+        eids.push_back(mock.add_entity("Bench " + std::to_string(counter), { "0" }));
+        counter = counter + 1;
+    }
+
+    printf("%u updates against the mock panel", options.count);
+    if(options.baud != 0)
+    {
+        printf(" at %u baud", options.baud);
+    }
+    printf("\n");
+
+    // Run one configuration if one was given, or else compare a few
+    for(const auto& configuration : configurations)
+    {
+        client_options  settings = options.client;
+
+        if((options.window_given == false) && (options.batch_given == false))
+        {
+            settings.window = configuration.window;
+            settings.batch_max = configuration.batch;
+        }
+
+        if(bench_run(transport_from_spec("mock", &mock), settings, eids, options.count) == false)
+        {
+            passed = false;
+        }
+
+        if((options.window_given == true) || (options.batch_given == true))
+        {
+            break;
+        }
+    }
+
+    return((passed == true) ? 0 : 1);
+}
+
+// =================================================================================
+// Main
+
+int main(int argc, char* argv[])
+{
+    options_t                   options;
+    std::vector<std::string>    arguments;
+    std::string                 command;
+    mock_panel                  mock;
+    uuid_t                      name_space;
+    int                         counter = 1;
+    int                         result = 0;
+
+    if(getenv("SNON_NAMESPACE") != NULL)
+    {
+        options.name_space = getenv("SNON_NAMESPACE");
+    }
+
+    while(counter < argc)
+    {
+        std::string argument = argv[counter];
+
+        if((argument == "--help") || (argument == "-h"))
+        {
+            usage(stdout);
+            return(0);
+        }
+
+        if((argument.compare(0, 2, "--") == 0) && (counter + 1 < argc))
+        {
+            std::string value = argv[counter + 1];
+
+            if(argument == "--link")
+            {
+                options.link = value;
+                options.link_given = true;
+            }
+            else if(argument == "--namespace")
+            {
+                options.name_space = value;
+            }
+            else if(argument == "--window")
+            {
+                options.client.window = strtoul(value.c_str(), NULL, 10);
+                options.window_given = true;
+            }
+            else if(argument == "--batch")
+            {
+                options.client.batch_max = strtoul(value.c_str(), NULL, 10);
+                options.batch_given = true;
+            }
+            else if(argument == "--timeout")
+            {
+                options.client.timeout_ms = atoi(value.c_str());
+            }
+            else if(argument == "--count")
+            {
+                options.count = strtoul(value.c_str(), NULL, 10);
+            }
+            else if(argument == "--baud")
+            {
+                options.baud = strtoul(value.c_str(), NULL, 10);
+            }
+            else
+            {
+                usage();
+                return(1);
+            }
+
+            counter = counter + 2;
+        }
+        else
+        {
+            arguments.push_back(argument);
+            counter = counter + 1;
+        }
+    }
+
+    if(arguments.size() == 0)
+    {
+        usage();
+        return(1);
+    }
+
+    command = arguments[0];
+    arguments.erase(arguments.begin());
+
+    if(command == "bench")
+    {
+        return(command_bench(options, mock));
+    }
+
+    // Checked before connecting, so a typo doesn't wait on a panel that isn't there
+    if((command != "set") && (command != "batch") && (command != "get") && (command != "list") && (command != "eid"))
+    {
+        usage();
+        return(1);
+    }
+
+    // Something to talk to when trying out the client without a panel
+    mock.add_entity("Title", { "Mock panel" });
+    mock.add_entity("Status", { "vita40_green_steady" });
+
+    std::unique_ptr<transport> link = transport_from_spec(options.link, &mock);
+    if(link == NULL)
+    {
+        fprintf(stderr, "Invalid link \"%s\"\n", options.link.c_str());
+        return(1);
+    }
+
+    // A batch has to fit in one line
+    if(command == "batch")
+    {
+        options.client.batch_max = std::max(options.client.batch_max, arguments.size());
+    }
+
+    client panel(std::move(link), options.client);
+
+    if(options.name_space.length() != 0)
+    {
+        if(uuid_parse(options.name_space, name_space) == false)
+        {
+            fprintf(stderr, "Invalid namespace \"%s\"\n", options.name_space.c_str());
+            return(1);
+        }
+
+        panel.set_namespace(name_space);
+    }
+
+    if(panel.start() == false)
+    {
+        fprintf(stderr, "Unable to connect to %s\n", options.link.c_str());
+        return(1);
+    }
+
+    if(command == "set")
+    {
+        result = command_set(panel, arguments);
+    }
+    else if(command == "batch")
+    {
+        result = command_batch(panel, arguments);
+    }
+    else if(command == "get")
+    {
+        result = command_get(panel, arguments);
+    }
+    else if(command == "list")
+    {
+        result = command_list(panel);
+    }
+    else
+    {
+        result = command_eid(panel, arguments);
+    }
+
+    panel.stop();
+
+    return(result);
+}
@@ -0,0 +1,204 @@
+// ---------------------------------------------------------------------------------
+// Host benchmark - LED animations
+// ---------------------------------------------------------------------------------
+// Checks that fades follow the gamma curve to their target in the number of frames
+// asked for. Then times animation_step() over the front panels of the 1840A (108
+// LEDs) and the 1870A (270 LEDs), with every LED fading, with one in ten fading,
+// and with none, against the ANIMATION_BUDGET_US frame budget.
+//
+//   bench_animation [frames]
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "pico/stdlib.h"
+
+#include "animation.h"
+#include "host.h"
+
+// Constants
+#define BENCH_FRAMES        20000
+#define BENCH_LEDS_MAX      270
+#define BENCH_FADE_MS       500
+#define BENCH_RESTART       (BENCH_FADE_MS / ANIMATION_FRAME_MS)    // Frames between new fades, so fades are always running
+
+// Global variables
+extern uint8_t  animation_gamma[256];
+animation_t     bench_animations[BENCH_LEDS_MAX];
+uint32_t        bench_colours[BENCH_LEDS_MAX];
+
+// Private prototypes
+void bench_fades(void);
+uint64_t bench_now_ns(void);
+void bench_start(uint16_t count, uint16_t every, uint32_t round);
+void bench_time(const char* name, uint16_t count, uint16_t every, uint32_t frames);
+
+// =================================================================================
+
+// A fade reaches its target exactly, in the frames asked for, with each colour
+// byte only ever moving towards the target
+void bench_fades(void)
+{
+    animation_t animation;
+    uint32_t    colour = 0;
+    uint32_t    previous = 0;
+    uint32_t    frames = 0;
+    uint32_t    wrong = 0;
+    uint8_t     shift = 0;
+
+    HOST_CHECK(animation_gamma[0] == 0);
+    HOST_CHECK(animation_gamma[255] == 255);
+    HOST_CHECK(animation_gamma[128] < 128);
+
+    // Up from off
+    animation_hold(&animation, 0);
+    animation_start(&animation, 0, 0x0AFF8000, BENCH_FADE_MS);
+
+    while((animation.progress != ANIMATION_DONE) && (frames != 1000))
+    {
+        previous = colour;
+        animation_step(&animation, &colour, 1);
+
+        for(shift = 0; shift != 32; shift = shift + 8)
+        {
+            wrong = wrong + ((((colour >> shift) & 0xFF) < ((previous >> shift) & 0xFF)) ? 1 : 0);
+        }
+
+        frames = frames + 1;
+    }
+
+    printf("Fade up: %lu frames, %08lX\n", (unsigned long) frames, (unsigned long) colour);
+    HOST_CHECK(wrong == 0);
+    HOST_CHECK(colour == 0x0AFF8000);
+    HOST_CHECK(frames == (BENCH_FADE_MS + ANIMATION_FRAME_MS - 1) / ANIMATION_FRAME_MS);
+
+    // Back down, from wherever it was
+    animation_start(&animation, colour, 0x00004000, BENCH_FADE_MS);
+    frames = 0;
+
+    while((animation.progress != ANIMATION_DONE) && (frames != 1000))
+    {
+        previous = colour;
+        animation_step(&animation, &colour, 1);
+
+        for(shift = 0; shift != 32; shift = shift + 8)
+        {
+            wrong = wrong + ((((colour >> shift) & 0xFF) > ((previous >> shift) & 0xFF)) ? 1 : 0);
+        }
+
+        frames = frames + 1;
+    }
+
+    printf("Fade down: %lu frames, %08lX\n", (unsigned long) frames, (unsigned long) colour);
+    HOST_CHECK(wrong == 0);
+    HOST_CHECK(colour == 0x00004000);
+
+    // Asking for the same colour again leaves it alone
+    animation_start(&animation, colour, 0x00004000, BENCH_FADE_MS);
+    HOST_CHECK(animation.progress == ANIMATION_DONE);
+    HOST_CHECK(animation_step(&animation, &colour, 1) == false);
+
+    // Fades no longer than a frame are a step
+    animation_start(&animation, colour, 0xFF000000, ANIMATION_FRAME_MS);
+    HOST_CHECK(animation_step(&animation, &colour, 1) == true);
+    HOST_CHECK(colour == 0xFF000000);
+    HOST_CHECK(animation.progress == ANIMATION_DONE);
+}
+
+uint64_t bench_now_ns(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return((uint64_t) now.tv_sec * 1000000000ull + now.tv_nsec);
+}
+
+// Starts a fade on every one of every LEDs, to a different colour each round
+void bench_start(uint16_t count, uint16_t every, uint32_t round)
+{
+    uint16_t    led = 0;
+
+    for(led = 0; led != count; led++)
+    {
+        if((every != 0) && ((led % every) == 0))
+        {
+            animation_start(&bench_animations[led], bench_colours[led], ((round + led) & 1) ? 0xFF804000 : 0x10FF2000, BENCH_FADE_MS);
+        }
+    }
+}
+
+void bench_time(const char* name, uint16_t count, uint16_t every, uint32_t frames)
+{
+    const animation_stats_t*    stats = animation_get_stats();
+    uint32_t                    first_frame = stats->frames;
+    uint32_t                    first_running = stats->running;
+    uint32_t                    frame = 0;
+    uint64_t                    elapsed = 0;
+    uint64_t                    start = 0;
+    uint16_t                    led = 0;
+
+    for(led = 0; led != count; led++)
+    {
+        bench_colours[led] = 0;
+        animation_hold(&bench_animations[led], 0);
+    }
+
+    while(frame != frames)
+    {
+        if((frame % BENCH_RESTART) == 0)
+        {
+            bench_start(count, every, frame / BENCH_RESTART);
+        }
+
+        start = bench_now_ns();
+        animation_step(bench_animations, bench_colours, count);
+        elapsed = elapsed + (bench_now_ns() - start);
+
+        frame = frame + 1;
+    }
+
+    printf("%5u LEDs  %-14s %8.2f us/frame  %6.1f ns/LED  %6.1f fading  %5.2f%% of budget\n", count, name, elapsed / 1000.0 / frames,
+           (double) elapsed / frames / count, (double) (stats->running - first_running) / (stats->frames - first_frame),
+           elapsed / 10.0 / frames / ANIMATION_BUDGET_US);
+
+    HOST_CHECK(stats->frames - first_frame == frames);
+}
+
+int main(int argc, char* argv[])
+{
+    const animation_stats_t*    stats = NULL;
+    const uint16_t              counts[] = {108, 270, 0};
+    uint32_t                    frames = BENCH_FRAMES;
+    uint8_t                     counter = 0;
+
+    if(argc > 1)
+    {
+        frames = strtoul(argv[1], NULL, 10);
+    }
+
+    animation_initialize();
+    bench_fades();
+
+    printf("%u ms frames, %u ms fades, %u us budget\n", ANIMATION_FRAME_MS, BENCH_FADE_MS, ANIMATION_BUDGET_US);
+
+    while(counts[counter] != 0)
+    {
+        bench_time("all fading", counts[counter], 1, frames);
+        bench_time("1 in 10 fading", counts[counter], 10, frames);
+        bench_time("none fading", counts[counter], 0, frames);
+        counter = counter + 1;
+    }
+
+    stats = animation_get_stats();
+    printf("Longest frame %lu us, %lu over budget\n", (unsigned long) stats->max_us, (unsigned long) stats->over_budget);
+    HOST_CHECK(stats->over_budget == 0);
+
+    return(host_result());
+}
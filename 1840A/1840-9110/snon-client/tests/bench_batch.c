@@ -0,0 +1,500 @@
+// ---------------------------------------------------------------------------------
+// Host benchmark - Batched SNON updates
+// ---------------------------------------------------------------------------------
+// Runs the 1840A fragment handling behind the UART code on a pty, with a thread
+// standing in for the HMI on core 1, and sets three entities at a time the way
+// set-values.rb does: first as three lines, waiting for each reply, and then as
+// one batch line. The host takes a millisecond to act on each reply, as it does
+// through a USB serial adapter. Every reply has to carry the new values. Prints
+// updates/s and redraws per batch for both. Core 1 has to redraw at most once for
+// each batch, and every change record has to reach it.
+//
+// The number of rounds can be given on the command line.
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "hardware/irq.h"
+#include "hardware/uart.h"
+#include "snon/snon_utils.h"
+
+#include "arena.h"
+#include "entities.h"
+#include "fragment.h"
+#include "store.h"
+#include "uart.h"
+#include "writer.h"
+#include "host.h"
+
+// Constants
+#define TEST_ROUNDS         2000
+#define TEST_BATCH          3                       // Entities set together, as by set-values.rb
+#define TEST_LINE_MAX       1024
+#define TEST_FIFO_SIZE      32                      // Bytes the UART holds between interrupts
+#define TEST_CORE_FIFO      8                       // Records the inter-core FIFO holds
+#define TEST_DR_EMPTY       0x100                   // Nothing written to the UART data register
+#define TEST_REPLY_US       2000000
+#define TEST_TURNAROUND_US  1000                    // Host time between a reply and the next line
+
+// Types
+typedef struct
+{
+    const char* name;
+    double      updates_per_s;
+    double      redraws_per_batch;
+} test_result_t;
+
+// Global variables
+const char*         test_names[TEST_BATCH] = {"=P01=PFA01", "=P01=PFA02", "=P01=PFA03"};
+char                test_eids[TEST_BATCH][SNON_URN_LENGTH];
+int                 test_master = -1;
+int                 test_slave = -1;
+volatile bool       test_running = true;
+
+// Panel state, panel thread only
+uint8_t             test_fifo[TEST_FIFO_SIZE];
+int                 test_fifo_length = 0;
+int                 test_fifo_position = 0;
+
+// Inter-core FIFO
+pthread_mutex_t     test_core_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t      test_core_cond = PTHREAD_COND_INITIALIZER;
+uint32_t            test_core_fifo[TEST_CORE_FIFO];
+uint8_t             test_core_head = 0;
+uint8_t             test_core_count = 0;
+
+// Core 1 thread only
+volatile uint32_t   test_redraws = 0;
+
+// Private prototypes
+void test_panel_tx(void);
+void* test_panel(void* unused);
+void* test_core1(void* unused);
+void test_open_pty(void);
+void test_send(const char* line);
+bool test_receive(char* line);
+void test_entity_json(char* json, uint8_t entity, const char* value);
+void test_wait_drawn(void);
+test_result_t test_lines(uint32_t rounds);
+test_result_t test_batch(uint32_t rounds);
+
+// =================================================================================
+// Inter-core FIFO, holding as many records as the RP2040's does
+
+bool multicore_fifo_wready(void)
+{
+    bool    ready = false;
+
+    pthread_mutex_lock(&test_core_mutex);
+    ready = (test_core_count != TEST_CORE_FIFO);
+    pthread_mutex_unlock(&test_core_mutex);
+
+    return(ready);
+}
+
+bool multicore_fifo_rvalid(void)
+{
+    bool    valid = false;
+
+    pthread_mutex_lock(&test_core_mutex);
+    valid = (test_core_count != 0);
+    pthread_mutex_unlock(&test_core_mutex);
+
+    return(valid);
+}
+
+void multicore_fifo_push_blocking(uint32_t data)
+{
+    pthread_mutex_lock(&test_core_mutex);
+
+    while(test_core_count == TEST_CORE_FIFO)
+    {
+        pthread_cond_wait(&test_core_cond, &test_core_mutex);
+    }
+
+    test_core_fifo[(test_core_head + test_core_count) % TEST_CORE_FIFO] = data;
+    test_core_count = test_core_count + 1;
+    pthread_cond_broadcast(&test_core_cond);
+    pthread_mutex_unlock(&test_core_mutex);
+}
+
+uint32_t multicore_fifo_pop_blocking(void)
+{
+    uint32_t    data = 0;
+
+    pthread_mutex_lock(&test_core_mutex);
+
+    while(test_core_count == 0)
+    {
+        pthread_cond_wait(&test_core_cond, &test_core_mutex);
+    }
+
+    data = test_core_fifo[test_core_head];
+    test_core_head = (test_core_head + 1) % TEST_CORE_FIFO;
+    test_core_count = test_core_count - 1;
+    pthread_cond_broadcast(&test_core_cond);
+    pthread_mutex_unlock(&test_core_mutex);
+
+    return(data);
+}
+
+// =================================================================================
+// Panel UART. Received bytes come from the pty, and each byte written to the data
+// register goes back to it when the UART is next asked whether it has room.
+
+bool uart_is_readable(uart_inst_t* uart)
+{
+    int length = 0;
+
+    (void) uart;
+
+    if(test_fifo_position == test_fifo_length)
+    {
+        length = read(test_slave, test_fifo, TEST_FIFO_SIZE);
+
+        test_fifo_position = 0;
+        test_fifo_length = (length > 0) ? length : 0;
+    }
+
+    return(test_fifo_position != test_fifo_length);
+}
+
+char uart_getc(uart_inst_t* uart)
+{
+    char    character = test_fifo[test_fifo_position];
+
+    (void) uart;
+
+    test_fifo_position = test_fifo_position + 1;
+
+    return(character);
+}
+
+bool uart_is_writable(uart_inst_t* uart)
+{
+    (void) uart;
+
+    test_panel_tx();
+
+    return(true);
+}
+
+void test_panel_tx(void)
+{
+    uart_hw_t*  hw = uart_get_hw(uart1);
+    uint8_t     character = 0;
+
+    if(hw->dr != TEST_DR_EMPTY)
+    {
+        character = hw->dr;
+        hw->dr = TEST_DR_EMPTY;
+        HOST_CHECK(write(test_slave, &character, 1) == 1);
+    }
+}
+
+// =================================================================================
+// Panel
+
+// The 1840A command loop, for SNON lines. The UART interrupt runs on the same
+// thread, whenever the pty has data.
+void* test_panel(void* unused)
+{
+    struct pollfd   waiting = {.fd = test_slave, .events = POLLIN};
+    const char*     command = NULL;
+    writer_t        writer;
+
+    (void) unused;
+
+    host_set_core(0);
+
+    while(test_running == true)
+    {
+        if(poll(&waiting, 1, 10) > 0)
+        {
+            host_irq(UART1_IRQ);
+        }
+
+        command = uart_command_get();
+
+        if(command[0] != 0)
+        {
+            writer_init_uart(&writer, WRITER_MODE_RAW);
+
+            if(command[0] == '[')
+            {
+                fragment_process_batch(&writer, command);
+            }
+            else
+            {
+                fragment_process(&writer, command);
+            }
+
+            writer_puts(&writer, "\r\n");
+            writer_flush(&writer);
+            uart_command_clear();
+            arena_reset(&scratch_arena);
+        }
+
+        test_panel_tx();
+    }
+
+    return(NULL);
+}
+
+// The HMI, redrawing whatever entity_wait_changes() hands it
+void* test_core1(void* unused)
+{
+    (void) unused;
+
+    host_set_core(1);
+
+    while(true)
+    {
+        entity_wait_changes();
+
+        if(test_running == false)
+        {
+            break;
+        }
+
+        test_redraws = test_redraws + 1;
+        entity_changes_drawn();
+    }
+
+    return(NULL);
+}
+
+// =================================================================================
+// Host
+
+// A raw pty, so carriage returns arrive as they were sent
+void test_open_pty(void)
+{
+    struct termios  settings;
+
+    test_master = posix_openpt(O_RDWR | O_NOCTTY);
+    HOST_CHECK(test_master >= 0);
+    HOST_CHECK(grantpt(test_master) == 0);
+    HOST_CHECK(unlockpt(test_master) == 0);
+
+    test_slave = open(ptsname(test_master), O_RDWR | O_NOCTTY | O_NONBLOCK);
+    HOST_CHECK(test_slave >= 0);
+
+    tcgetattr(test_slave, &settings);
+    cfmakeraw(&settings);
+    tcsetattr(test_slave, TCSANOW, &settings);
+}
+
+void test_send(const char* line)
+{
+    size_t  length = strlen(line);
+
+    usleep(TEST_TURNAROUND_US);
+
+    HOST_CHECK(write(test_master, line, length) == (ssize_t) length);
+}
+
+// Reads one reply line, without its line end
+bool test_receive(char* line)
+{
+    struct pollfd   waiting = {.fd = test_master, .events = POLLIN};
+    uint64_t        start_us = time_us_64();
+    uint16_t        length = 0;
+    char            character = 0;
+
+    while(time_us_64() - start_us < TEST_REPLY_US)
+    {
+        if((poll(&waiting, 1, 10) <= 0) || (read(test_master, &character, 1) != 1))
+        {
+            continue;
+        }
+
+        if(character == '\n')
+        {
+            line[length] = 0;
+            return(true);
+        }
+
+        if((character != '\r') && (length < TEST_LINE_MAX - 1))
+        {
+            line[length] = character;
+            length = length + 1;
+        }
+    }
+
+    line[length] = 0;
+
+    return(false);
+}
+
+// The JSON the panel answers with for an entity holding one value
+void test_entity_json(char* json, uint8_t entity, const char* value)
+{
+    sprintf(json, "{\"eID\":\"%s\",\"name\":\"%s\",\"v\":[\"%s\"]}", test_eids[entity], test_names[entity], value);
+}
+
+// Waits until core 1 has drawn everything sent so far
+void test_wait_drawn(void)
+{
+    uint32_t    redraws = 0;
+
+    do
+    {
+        redraws = test_redraws;
+        usleep(20000);
+    }
+    while((redraws != test_redraws) || (multicore_fifo_rvalid() == true));
+}
+
+// One line for each entity, waiting for each reply, as set-values.rb sends them
+test_result_t test_lines(uint32_t rounds)
+{
+    test_result_t   result = {"Lines", 0, 0};
+    char            line[TEST_LINE_MAX];
+    char            reply[TEST_LINE_MAX];
+    char            expected[TEST_LINE_MAX];
+    char            value[16];
+    uint32_t        redraws = test_redraws;
+    uint64_t        start_us = time_us_64();
+    uint32_t        round = 0;
+    uint8_t         entity = 0;
+
+    for(round = 0; round != rounds; round++)
+    {
+        for(entity = 0; entity != TEST_BATCH; entity++)
+        {
+            sprintf(value, "l%lu", (unsigned long) round);
+            snprintf(line, sizeof(line), "{\"eID\":\"%s\",\"v\":[\"%s\"]}\r\n", test_eids[entity], value);
+            test_send(line);
+
+            HOST_CHECK(test_receive(reply) == true);
+            test_entity_json(expected, entity, value);
+            HOST_CHECK(strcmp(reply, expected) == 0);
+        }
+    }
+
+    result.updates_per_s = (rounds * TEST_BATCH) / ((time_us_64() - start_us) / 1e6);
+    test_wait_drawn();
+    result.redraws_per_batch = (double) (test_redraws - redraws) / rounds;
+
+    return(result);
+}
+
+// All the entities in one batch line, with one reply
+test_result_t test_batch(uint32_t rounds)
+{
+    test_result_t   result = {"Batches", 0, 0};
+    char            line[TEST_LINE_MAX];
+    char            reply[TEST_LINE_MAX];
+    char            expected[TEST_LINE_MAX];
+    char            value[16];
+    uint32_t        redraws = test_redraws;
+    uint64_t        start_us = time_us_64();
+    uint32_t        round = 0;
+    uint16_t        length = 0;
+    uint8_t         entity = 0;
+
+    for(round = 0; round != rounds; round++)
+    {
+        sprintf(value, "b%lu", (unsigned long) round);
+        strcpy(line, "[");
+        strcpy(expected, "[");
+        length = 1;
+
+        for(entity = 0; entity != TEST_BATCH; entity++)
+        {
+            length = length + sprintf(&line[length], "%s{\"eID\":\"%s\",\"v\":[\"%s\"]}", (entity != 0) ? "," : "", test_eids[entity], value);
+            strcat(expected, (entity != 0) ? "," : "");
+            test_entity_json(&expected[strlen(expected)], entity, value);
+        }
+
+        strcpy(&line[length], "]\r\n");
+        strcat(expected, "]");
+        test_send(line);
+
+        HOST_CHECK(test_receive(reply) == true);
+        HOST_CHECK(strcmp(reply, expected) == 0);
+    }
+
+    result.updates_per_s = (rounds * TEST_BATCH) / ((time_us_64() - start_us) / 1e6);
+    test_wait_drawn();
+    result.redraws_per_batch = (double) (test_redraws - redraws) / rounds;
+
+    return(result);
+}
+
+int main(int argc, char** argv)
+{
+    pthread_t       panel;
+    pthread_t       core1;
+    test_result_t   lines;
+    test_result_t   batches;
+    uint32_t        rounds = TEST_ROUNDS;
+    uint8_t         entity = 0;
+
+    if(argc > 1)
+    {
+        rounds = strtoul(argv[1], NULL, 10);
+    }
+
+    arena_initialize();
+    snon_initialize("Batch Test");
+
+    for(entity = 0; entity != TEST_BATCH; entity++)
+    {
+        snon_register((char*) test_names[entity], SNON_CLASS_VALUE, "[\"off\"]");
+        snon_name_to_eid((char*) test_names[entity], test_eids[entity]);
+    }
+
+    store_initialize();
+
+    for(entity = 0; entity != TEST_BATCH; entity++)
+    {
+        HOST_CHECK(entity_register(test_names[entity], 1u << entity) == entity);
+    }
+
+    uart_get_hw(uart1)->dr = TEST_DR_EMPTY;
+    test_open_pty();
+    uart_setup();
+
+    pthread_create(&core1, NULL, test_core1, NULL);
+    pthread_create(&panel, NULL, test_panel, NULL);
+
+    lines = test_lines(rounds);
+    batches = test_batch(rounds);
+
+    // Wakes core 1 once more, so it sees it is done
+    test_running = false;
+    multicore_fifo_push_blocking(ENTITY_RECORD(0, true, 0xFFFF));
+    pthread_join(panel, NULL);
+    pthread_join(core1, NULL);
+
+    printf("Mode       Updates/s  Redraws/batch\n");
+    printf("%-9s  %9.0f  %13.2f\n", lines.name, lines.updates_per_s, lines.redraws_per_batch);
+    printf("%-9s  %9.0f  %13.2f\n", batches.name, batches.updates_per_s, batches.redraws_per_batch);
+    printf("%lu change records, %lu FIFO overflows\n", (unsigned long) entity_get_stats()->records, (unsigned long) entity_get_stats()->overflows);
+
+    // Every batch is drawn at most once, and nothing set was missed
+    HOST_CHECK(batches.redraws_per_batch > 0);
+    HOST_CHECK(batches.redraws_per_batch <= 1);
+    HOST_CHECK(lines.redraws_per_batch > batches.redraws_per_batch);
+    HOST_CHECK(entity_get_stats()->records == (rounds * TEST_BATCH * 2) + 1);
+
+    close(test_slave);
+    close(test_master);
+
+    return(host_result());
+}
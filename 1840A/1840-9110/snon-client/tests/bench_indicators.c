@@ -0,0 +1,206 @@
+// ---------------------------------------------------------------------------------
+// Host benchmark - LED timer frames
+// ---------------------------------------------------------------------------------
+// Times what the LED timer does each tick to draw a panel's front panel map, built
+// once for the 1840A (108 LEDs) and once for the 1870A (270 LEDs). The indicators
+// are given steady states, then a mix of steady and blinking ones, and then states
+// that change every few ticks. Each is drawn with ledmap_render(), and with the way
+// the panels used to work it out, comparing the state strings of every indicator on
+// every tick. Both must draw the same frames, and the tables must be faster.
+// Fades are left out, as bench_animation times them.
+//
+//   bench_indicators_<panel> [ticks]
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "pico/stdlib.h"
+
+#include "animation.h"
+#include "indicators.h"
+#include "ledmap.h"
+#include "ledstrip.h"
+#include "front_panel_leds.h"
+#include "snon/snon_utils.h"
+#include "host.h"
+
+// Constants
+#define BENCH_TICKS         20000
+#define BENCH_CHANGE_EVERY  10          // Ticks between state changes, when they change
+
+// Global variables
+const uint8_t       bench_steady[] = {INDICATOR_RED_STEADY, INDICATOR_GREEN_STEADY, INDICATOR_OFF, INDICATOR_AMBER_STEADY, INDICATOR_BLUE_STEADY};
+const uint8_t       bench_mixed[] = {INDICATOR_GREEN_STEADY, INDICATOR_WHITE_FAST, INDICATOR_AMBER_SLOW, INDICATOR_OFF, INDICATOR_GREEN_STANDBY,
+                                     INDICATOR_GREEN_SLOW, INDICATOR_GREEN_FEEDBACK};
+indicator_handle_t  bench_handles[FRONT_PANEL_LEDS_ENTRIES];
+uint32_t            bench_colours[FRONT_PANEL_LEDS_ENTRIES];
+ledmap_t            bench_map = {front_panel_leds, FRONT_PANEL_LEDS_ENTRIES, FRONT_PANEL_LEDS_PIXELS, bench_handles, bench_colours, NULL, 0, false, 0};
+const char*         bench_names[FRONT_PANEL_LEDS_ENTRIES];     // State of each entry, as the store held it
+uint32_t            bench_frame[FRONT_PANEL_LEDS_PIXELS];
+uint32_t            bench_reference[FRONT_PANEL_LEDS_PIXELS];
+uint32_t            bench_mismatches = 0;
+
+// Private prototypes
+uint32_t ledmap_scale(uint32_t colour, uint8_t brightness);     // Not in ledmap.h
+uint64_t bench_now_ns(void);
+void bench_set(const uint8_t* states, uint8_t state_count, uint32_t offset);
+uint32_t bench_string_colour(const char* name, uint8_t phase);
+void bench_string_render(uint8_t phase, uint32_t* frame);
+void bench_time(const char* name, const uint8_t* states, uint8_t state_count, bool changing, uint32_t ticks);
+
+// =================================================================================
+
+// The strip isn't sent to, so nothing is timed by it
+void ledstats_record(uint8_t histogram, uint32_t elapsed_us)
+{
+    (void) histogram;
+    (void) elapsed_us;
+}
+
+uint64_t bench_now_ns(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return((uint64_t) now.tv_sec * 1000000000ull + now.tv_nsec);
+}
+
+// Gives the indicators states from the list, each one along from the last
+void bench_set(const uint8_t* states, uint8_t state_count, uint32_t offset)
+{
+    uint16_t    counter = 0;
+    uint8_t     state = 0;
+
+    for(counter = 0; counter != FRONT_PANEL_LEDS_ENTRIES; counter++)
+    {
+        state = INDICATOR_OFF;
+
+        if(bench_handles[counter] != INDICATOR_NONE)
+        {
+            state = states[(counter + offset) % state_count];
+            indicator_set_state(bench_handles[counter], state);
+        }
+
+        bench_names[counter] = indicator_state_name(state);
+    }
+}
+
+// The colour of a state, found from its name as the panels used to
+uint32_t bench_string_colour(const char* name, uint8_t phase)
+{
+    uint8_t     state = 0;
+
+    while(state != INDICATOR_STATE_COUNT)
+    {
+        if(strcmp(name, indicator_state_name(state)) == 0)
+        {
+            return(indicator_state_colour(state, phase));
+        }
+
+        state = state + 1;
+    }
+
+    return(indicator_state_colour(INDICATOR_OFF, phase));
+}
+
+// Draws every LED of the frame from the state strings
+void bench_string_render(uint8_t phase, uint32_t* frame)
+{
+    const ledmap_entry_t*   entry = front_panel_leds;
+    uint32_t                colour = 0;
+    uint32_t*               pixel = frame;
+    uint16_t                counter = 0;
+    uint16_t                led = 0;
+
+    for(counter = 0; counter != FRONT_PANEL_LEDS_ENTRIES; counter++)
+    {
+        for(led = 0; led != entry[counter].count; led++)
+        {
+            colour = bench_string_colour(bench_names[counter], phase);
+
+            if(entry[counter].brightness != LEDMAP_FULL)
+            {
+                colour = ledmap_scale(colour, entry[counter].brightness);
+            }
+
+            *pixel = LEDSTRIP_WORD(colour);
+            pixel = pixel + 1;
+        }
+    }
+}
+
+// Draws the given number of ticks both ways, checking that the frames match
+void bench_time(const char* name, const uint8_t* states, uint8_t state_count, bool changing, uint32_t ticks)
+{
+    uint64_t    table_ns = 0;
+    uint64_t    string_ns = 0;
+    uint64_t    start = 0;
+    uint32_t    recomputed = 0;
+    uint32_t    tick = 0;
+    uint8_t     phase = 0;
+
+    bench_set(states, state_count, 0);
+    ledmap_invalidate(&bench_map);
+
+    for(tick = 0; tick != ticks; tick++)
+    {
+        if((changing == true) && (tick != 0) && ((tick % BENCH_CHANGE_EVERY) == 0))
+        {
+            bench_set(states, state_count, tick / BENCH_CHANGE_EVERY);
+        }
+
+        phase = indicator_phase(tick / ANIMATION_FRAMES_PER_PHASE);
+
+        start = bench_now_ns();
+        ledmap_render(&bench_map, phase, bench_frame);
+        table_ns = table_ns + (bench_now_ns() - start);
+        recomputed = recomputed + bench_map.recomputed;
+
+        start = bench_now_ns();
+        bench_string_render(phase, bench_reference);
+        string_ns = string_ns + (bench_now_ns() - start);
+
+        // An unchanged frame is left as it was drawn
+        if(memcmp(bench_frame, bench_reference, sizeof(bench_frame)) != 0)
+        {
+            bench_mismatches = bench_mismatches + 1;
+        }
+    }
+
+    printf("%-16s tables %7.2f us/tick %6.1f ns/LED %6.2f recomputed   strings %7.2f us/tick %6.1f ns/LED   %5.1fx\n", name,
+           table_ns / 1000.0 / ticks, (double) table_ns / ticks / FRONT_PANEL_LEDS_PIXELS, (double) recomputed / ticks,
+           string_ns / 1000.0 / ticks, (double) string_ns / ticks / FRONT_PANEL_LEDS_PIXELS, (double) string_ns / table_ns);
+
+    HOST_CHECK(table_ns < string_ns);
+}
+
+int main(int argc, char* argv[])
+{
+    uint32_t    ticks = BENCH_TICKS;
+
+    if(argc > 1)
+    {
+        ticks = strtoul(argv[1], NULL, 10);
+    }
+
+    snon_initialize("Indicator Bench");
+    indicators_initialize();
+    ledmap_initialize(&bench_map);
+
+    printf("%u entries, %u LEDs, %u ms ticks\n", FRONT_PANEL_LEDS_ENTRIES, FRONT_PANEL_LEDS_PIXELS, ANIMATION_FRAME_MS);
+
+    bench_time("steady", bench_steady, sizeof(bench_steady), false, ticks);
+    bench_time("blinking", bench_mixed, sizeof(bench_mixed), false, ticks);
+    bench_time("changing", bench_mixed, sizeof(bench_mixed), true, ticks);
+
+    HOST_CHECK(bench_mismatches == 0);
+
+    return(host_result());
+}
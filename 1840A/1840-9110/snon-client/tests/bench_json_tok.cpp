@@ -0,0 +1,182 @@
+// ---------------------------------------------------------------------------------
+// Host benchmark - JSON tokenizer
+// ---------------------------------------------------------------------------------
+// Messages per second for the fragments the scripts in 1840A/1840-9110 send:
+// json_tok finding the eID and values the way the command loop does, against
+// building a tree with the client JSON parser, and with cJSON when the snon
+// submodule is checked out.
+//
+// Usage: bench_json_tok [<messages>]
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "json.h"
+
+extern "C"
+{
+#include "json_tok.h"
+}
+
+#ifdef TEST_CJSON
+#include "cJSON.h"
+#endif
+
+// Constants
+#define BENCH_TOKENS    64
+
+// Types
+typedef struct
+{
+    const char* name;
+    uint8_t     fragments;
+    const char* json;
+} bench_message_t;
+
+// Global variables
+static const bench_message_t bench_messages[] =
+{
+    {"set-values.rb", 1, "{\"eID\":\"urn:uuid:254CB903-3406-5B2A-A6DD-9DEA8A0DB148\",\"v\":[\"vita40_amber_steady\"]}"},
+    {"snon-pipeline.rb", 1, "{\"eID\":\"urn:uuid:51529209-4838-51C5-A520-0044FDDF139C\",\"v\":[\"1234\"],\"rID\":42}"},
+    {"led-map.rb batch", 3, "[{\"eID\":\"urn:uuid:26FB922F-1B3D-526E-B9B4-A2BB0BA6F06F\",\"v\":[\"vita40_red_steady\"]},"
+                            "{\"eID\":\"urn:uuid:4C0A29C4-8DC2-5766-8E3C-406B8F02973C\",\"v\":[\"vita40_green_flash\"]},"
+                            "{\"eID\":\"urn:uuid:623B4CD2-B2C8-5F3A-BA7C-A53F0EF9299D\",\"v\":[\"vita40_off\"]}]"},
+    {NULL, 0, NULL}
+};
+
+// Private prototypes
+static double bench_seconds(std::chrono::steady_clock::time_point start);
+static uint32_t bench_json_tok(const char* json, uint32_t messages);
+static uint32_t bench_json_parse(const char* json, uint32_t messages);
+
+// =================================================================================
+
+static double bench_seconds(std::chrono::steady_clock::time_point start)
+{
+    return(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+}
+
+// Tokenizes, then finds the eID and values of every fragment, as the command loop
+// does. Returns the number of fragments found.
+static uint32_t bench_json_tok(const char* json, uint32_t messages)
+{
+    json_tok_t  tokens[BENCH_TOKENS];
+    uint16_t    length = strlen(json);
+    uint32_t    found = 0;
+
+    while(messages != 0)
+    {
+        int16_t count = json_tok_parse(json, length, tokens, BENCH_TOKENS);
+        int16_t fragment = 0;
+
+        // A batch is an array of fragments
+        if((count > 0) && (tokens[0].type == JSON_TOK_ARRAY))
+        {
+            fragment = 1;
+        }
+
+        while((count > 0) && (fragment < count))
+        {
+            if((json_tok_find_key(json, tokens, count, fragment, "eID") > 0) && (json_tok_find_key(json, tokens, count, fragment, "v") > 0))
+            {
+                found = found + 1;
+            }
+
+            fragment = json_tok_skip(tokens, count, fragment);
+        }
+
+        messages = messages - 1;
+    }
+
+    return(found);
+}
+
+static uint32_t bench_json_parse(const char* json, uint32_t messages)
+{
+    std::string         input = json;
+    snon::json_value    value;
+    uint32_t            found = 0;
+
+    while(messages != 0)
+    {
+        if(snon::json_parse(input, value) == true)
+        {
+            found = found + 1;
+        }
+
+        messages = messages - 1;
+    }
+
+    return(found);
+}
+
+#ifdef TEST_CJSON
+static uint32_t bench_cjson(const char* json, uint32_t messages)
+{
+    uint32_t    found = 0;
+
+    while(messages != 0)
+    {
+        cJSON*  parsed = cJSON_Parse(json);
+
+        if(parsed != NULL)
+        {
+            found = found + 1;
+            cJSON_Delete(parsed);
+        }
+
+        messages = messages - 1;
+    }
+
+    return(found);
+}
+#endif
+
+int main(int argc, char** argv)
+{
+    uint32_t    messages = (argc > 1) ? strtoul(argv[1], NULL, 10) : 1000000;
+    uint8_t     counter = 0;
+
+    printf("%-18s %14s %14s", "Messages", "json_tok/s", "json.cpp/s");
+#ifdef TEST_CJSON
+    printf(" %14s", "cJSON/s");
+#endif
+    printf("\n");
+
+    while(bench_messages[counter].name != NULL)
+    {
+        const char* json = bench_messages[counter].json;
+        auto        start = std::chrono::steady_clock::now();
+        uint32_t    found = bench_json_tok(json, messages);
+        double      tok_seconds = bench_seconds(start);
+
+        start = std::chrono::steady_clock::now();
+        bench_json_parse(json, messages);
+        printf("%-18s %14.0f %14.0f", bench_messages[counter].name, messages / tok_seconds, messages / bench_seconds(start));
+
+#ifdef TEST_CJSON
+        start = std::chrono::steady_clock::now();
+        bench_cjson(json, messages);
+        printf(" %14.0f", messages / bench_seconds(start));
+#endif
+        printf("\n");
+
+        // Every fragment must have been found, or the numbers mean nothing
+        if(found != messages * bench_messages[counter].fragments)
+        {
+            printf("Only %u fragments found in %s\n", found, json);
+            return(1);
+        }
+
+        counter = counter + 1;
+    }
+
+    return(0);
+}
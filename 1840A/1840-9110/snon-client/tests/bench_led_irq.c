@@ -0,0 +1,351 @@
+// ---------------------------------------------------------------------------------
+// Host benchmark - LED timer interrupt time and UART receive latency
+// ---------------------------------------------------------------------------------
+// Runs the 1840A front panel LED timer on a simulated clock, the way it used to
+// send frames and the way it does now, while the host sends a byte every character
+// time at 115200 baud. The old timer set the state machine up again, pushed every
+// pixel into the PIO FIFO as it drained, and then waited out the latch, all in the
+// interrupt. Now the timer hands the frame to DMA, and the DMA interrupt and the
+// latch alarm finish it. The UART interrupt can't run while one of these does, so
+// each byte that arrives meanwhile waits in the 32 byte RX FIFO, and is lost if it
+// fills. Only the time spent waiting on the PIO and the latch is on the clock, as
+// bench_indicators times drawing the frame.
+//
+//   bench_led_irq [ticks]
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/pio.h"
+#include "pico-utils/ws2812.h"
+
+#include "animation.h"
+#include "indicators.h"
+#include "ledmap.h"
+#include "ledstrip.h"
+#include "front_panel_leds.h"
+#include "snon/snon_utils.h"
+#include "host.h"
+
+// Constants
+#define BENCH_TICKS         2000
+#define BENCH_TICK_US       (ANIMATION_FRAME_MS * 1000)
+#define BENCH_PIXEL_US      30                      // 24 bits at 800 kHz
+#define BENCH_BYTE_US       87                      // 115200 baud, 8N1
+#define BENCH_RX_FIFO       32
+#define BENCH_OLD_LATCH_US  200                     // busy_wait_us() after the last pixel
+#define BENCH_NONE          UINT64_MAX
+
+// Types
+typedef struct
+{
+    const char* name;
+    uint32_t    irqs;
+    uint64_t    irq_us;                             // Total time in the interrupts
+    uint64_t    irq_max_us;
+    uint64_t    latency_us;                         // Total time bytes waited for the UART interrupt
+    uint64_t    latency_max_us;
+    uint32_t    overruns;                           // Bytes lost to a full RX FIFO
+    uint32_t    inits;                              // State machines set up
+} bench_result_t;
+
+// Global variables
+const uint8_t       bench_states[] = {INDICATOR_GREEN_STEADY, INDICATOR_WHITE_FAST, INDICATOR_AMBER_SLOW, INDICATOR_OFF, INDICATOR_GREEN_STANDBY};
+indicator_handle_t  bench_handles[FRONT_PANEL_LEDS_ENTRIES];
+uint32_t            bench_colours[FRONT_PANEL_LEDS_ENTRIES];
+ledmap_t            bench_map = {front_panel_leds, FRONT_PANEL_LEDS_ENTRIES, FRONT_PANEL_LEDS_PIXELS, bench_handles, bench_colours, NULL, 0, false, 0};
+ledstrip_t          bench_strip;
+uint32_t            bench_frames[2][FRONT_PANEL_LEDS_PIXELS];
+uint32_t            bench_tick = 0;
+uint32_t            bench_inits = 0;
+uint64_t            bench_fifo_empty_us = 0;        // When the PIO will have sent what it holds
+uint64_t            bench_dma_done_us = BENCH_NONE;
+uint64_t            bench_alarm_us = BENCH_NONE;
+alarm_callback_t    bench_alarm_callback = NULL;
+void*               bench_alarm_data = NULL;
+
+// Private prototypes
+void bench_irq_done(bench_result_t* result, uint64_t start_us);
+bool bench_old_tick(struct repeating_timer* timer);
+bool bench_dma_tick(struct repeating_timer* timer);
+void bench_run(bench_result_t* result, bool dma, uint32_t ticks);
+void bench_report(const bench_result_t* result, uint32_t ticks);
+
+// =================================================================================
+// PIO, DMA and alarms, on the simulated clock
+
+// The transmit times aren't under test
+void ledstats_record(uint8_t histogram, uint32_t elapsed_us)
+{
+    (void) histogram;
+    (void) elapsed_us;
+}
+
+void ws2812_program_init(PIO pio, uint sm, uint offset, uint pin, float freq, bool rgbw)
+{
+    (void) pio;
+    (void) sm;
+    (void) offset;
+    (void) pin;
+    (void) freq;
+    (void) rgbw;
+
+    bench_inits = bench_inits + 1;
+}
+
+// Waits for room in the FIFO, which drains a pixel at a time
+void put_pixel(uint32_t pixel_grb)
+{
+    uint64_t    now_us = time_us_64();
+
+    (void) pixel_grb;
+
+    if(bench_fifo_empty_us > now_us + (LEDSTRIP_FIFO_DEPTH - 1) * BENCH_PIXEL_US)
+    {
+        sleep_us(bench_fifo_empty_us - (LEDSTRIP_FIFO_DEPTH - 1) * BENCH_PIXEL_US - now_us);
+        now_us = time_us_64();
+    }
+
+    if(bench_fifo_empty_us < now_us)
+    {
+        bench_fifo_empty_us = now_us;
+    }
+
+    bench_fifo_empty_us = bench_fifo_empty_us + BENCH_PIXEL_US;
+}
+
+// DMA finishes once the last pixel is in the FIFO
+void dma_channel_set_read_addr(uint channel, const volatile void* read_addr, bool trigger)
+{
+    (void) read_addr;
+    (void) trigger;
+
+    bench_dma_done_us = time_us_64() + (dma_hw->ch[channel].transfer_count - LEDSTRIP_FIFO_DEPTH) * BENCH_PIXEL_US;
+}
+
+bool dma_channel_get_irq0_status(uint channel)
+{
+    (void) channel;
+
+    return(time_us_64() >= bench_dma_done_us);
+}
+
+void dma_channel_acknowledge_irq0(uint channel)
+{
+    (void) channel;
+
+    bench_dma_done_us = BENCH_NONE;
+}
+
+alarm_id_t add_alarm_in_us(uint64_t us, alarm_callback_t callback, void* user_data, bool fire_if_past)
+{
+    (void) fire_if_past;
+
+    bench_alarm_us = time_us_64() + us;
+    bench_alarm_callback = callback;
+    bench_alarm_data = user_data;
+
+    return(1);
+}
+
+// =================================================================================
+// LED timer
+
+// Counts the time since the interrupt started against the bytes that arrived
+// meanwhile. The first ones wait in the FIFO until the interrupt returns, and the
+// rest are lost.
+void bench_irq_done(bench_result_t* result, uint64_t start_us)
+{
+    uint64_t    end_us = time_us_64();
+    uint64_t    arrival_us = ((start_us + BENCH_BYTE_US - 1) / BENCH_BYTE_US) * BENCH_BYTE_US;
+    uint32_t    waiting = 0;
+
+    result->irqs = result->irqs + 1;
+    result->irq_us = result->irq_us + (end_us - start_us);
+
+    if(end_us - start_us > result->irq_max_us)
+    {
+        result->irq_max_us = end_us - start_us;
+    }
+
+    if((arrival_us < end_us) && (end_us - arrival_us > result->latency_max_us))
+    {
+        result->latency_max_us = end_us - arrival_us;
+    }
+
+    while(arrival_us < end_us)
+    {
+        if(waiting == BENCH_RX_FIFO)
+        {
+            result->overruns = result->overruns + 1;
+        }
+        else
+        {
+            result->latency_us = result->latency_us + (end_us - arrival_us);
+            waiting = waiting + 1;
+        }
+
+        arrival_us = arrival_us + BENCH_BYTE_US;
+    }
+}
+
+// As the 1840A used to draw its LEDs, the whole frame from the timer interrupt
+bool bench_old_tick(struct repeating_timer* timer)
+{
+    uint32_t    led_values[FRONT_PANEL_LEDS_PIXELS];
+    uint16_t    counter = 0;
+
+    (void) timer;
+
+    ledmap_render(&bench_map, indicator_phase(bench_tick / ANIMATION_FRAMES_PER_PHASE), led_values);
+    ws2812_program_init(pio1, 0, 0, 18, 800000, false);
+
+    while(counter < FRONT_PANEL_LEDS_PIXELS)
+    {
+        put_pixel(led_values[counter]);
+        counter = counter + 1;
+    }
+
+    busy_wait_us(BENCH_OLD_LATCH_US);
+
+    bench_tick = bench_tick + 1;
+
+    return(true);
+}
+
+// As the 1840A draws its LEDs now, handing the frame to DMA
+bool bench_dma_tick(struct repeating_timer* timer)
+{
+    bool    changed = false;
+
+    (void) timer;
+
+    changed = ledmap_render(&bench_map, indicator_phase(bench_tick / ANIMATION_FRAMES_PER_PHASE), ledstrip_back_buffer(&bench_strip));
+
+    if((changed == true) && (ledstrip_show(&bench_strip) == false))
+    {
+        ledmap_invalidate(&bench_map);
+    }
+
+    bench_tick = bench_tick + 1;
+
+    return(true);
+}
+
+// Runs the LED timer, and the DMA interrupt and latch alarm when they are due,
+// with a state change every phase
+void bench_run(bench_result_t* result, bool dma, uint32_t ticks)
+{
+    uint64_t    start_us = 0;
+    uint32_t    inits = bench_inits;
+    uint32_t    tick = 0;
+    uint16_t    counter = 0;
+
+    bench_tick = 0;
+    ledmap_invalidate(&bench_map);
+
+    for(tick = 0; tick != ticks; tick++)
+    {
+        host_clock_set((uint64_t) tick * BENCH_TICK_US);
+
+        if((tick % ANIMATION_FRAMES_PER_PHASE) == 0)
+        {
+            for(counter = 0; counter != FRONT_PANEL_LEDS_ENTRIES; counter++)
+            {
+                indicator_set_state(bench_handles[counter], bench_states[(counter + tick) % sizeof(bench_states)]);
+            }
+        }
+
+        start_us = time_us_64();
+
+        if(dma == true)
+        {
+            bench_dma_tick(NULL);
+        }
+        else
+        {
+            bench_old_tick(NULL);
+        }
+
+        bench_irq_done(result, start_us);
+
+        if(bench_dma_done_us != BENCH_NONE)
+        {
+            start_us = bench_dma_done_us;
+            host_clock_set(start_us);
+            host_irq(DMA_IRQ_0);
+            bench_irq_done(result, start_us);
+        }
+
+        if(bench_alarm_us != BENCH_NONE)
+        {
+            start_us = bench_alarm_us;
+            bench_alarm_us = BENCH_NONE;
+            host_clock_set(start_us);
+            bench_alarm_callback(1, bench_alarm_data);
+            bench_irq_done(result, start_us);
+        }
+    }
+
+    result->inits = bench_inits - inits;
+}
+
+void bench_report(const bench_result_t* result, uint32_t ticks)
+{
+    uint64_t    bytes = ((uint64_t) ticks * BENCH_TICK_US) / BENCH_BYTE_US;
+
+    printf("%-8s %6.2f interrupts/tick  %7.1f us max  %7.1f us/tick  RX latency %6.2f us mean %7.1f us max  %6.2f lost/tick  %lu set up\n",
+           result->name, (double) result->irqs / ticks, (double) result->irq_max_us, (double) result->irq_us / ticks,
+           (double) result->latency_us / bytes, (double) result->latency_max_us, (double) result->overruns / ticks, (unsigned long) result->inits);
+}
+
+int main(int argc, char* argv[])
+{
+    bench_result_t  old_result = {"before", 0, 0, 0, 0, 0, 0, 0};
+    bench_result_t  dma_result = {"after", 0, 0, 0, 0, 0, 0, 0};
+    uint32_t        ticks = BENCH_TICKS;
+
+    if(argc > 1)
+    {
+        ticks = strtoul(argv[1], NULL, 10);
+    }
+
+    snon_initialize("1840A");
+    indicators_initialize();
+    ledmap_initialize(&bench_map);
+
+    host_clock_set(0);
+    HOST_CHECK(ledstrip_init(&bench_strip, pio1, 18, 800000, bench_frames[0], bench_frames[1], FRONT_PANEL_LEDS_PIXELS) == true);
+    bench_inits = 0;
+
+    printf("%u LEDs, %u ms ticks, a byte every %u us\n", FRONT_PANEL_LEDS_PIXELS, ANIMATION_FRAME_MS, BENCH_BYTE_US);
+
+    bench_run(&old_result, false, ticks);
+    bench_report(&old_result, ticks);
+
+    bench_run(&dma_result, true, ticks);
+    bench_report(&dma_result, ticks);
+
+    // The old timer held the UART off for longer than its FIFO lasts
+    HOST_CHECK(old_result.irq_max_us >= (FRONT_PANEL_LEDS_PIXELS - LEDSTRIP_FIFO_DEPTH) * BENCH_PIXEL_US + BENCH_OLD_LATCH_US);
+    HOST_CHECK(old_result.overruns != 0);
+    HOST_CHECK(old_result.inits == ticks);
+
+    // Now no byte waits, and every changed frame goes out
+    HOST_CHECK(dma_result.irq_max_us < BENCH_BYTE_US);
+    HOST_CHECK(dma_result.latency_max_us < BENCH_BYTE_US);
+    HOST_CHECK(dma_result.overruns == 0);
+    HOST_CHECK(dma_result.inits == 0);
+    HOST_CHECK(bench_strip.skipped == 0);
+    HOST_CHECK(bench_strip.frames == ticks / ANIMATION_FRAMES_PER_PHASE);
+
+    return(host_result());
+}
@@ -0,0 +1,158 @@
+// ---------------------------------------------------------------------------------
+// Host benchmark - Bit plane transpose
+// ---------------------------------------------------------------------------------
+// Times ledstrip_transpose() against taking the bits one at a time, for the front
+// panels of the 1840A (108 pixels) and the 1870A (270 pixels) split across 2, 4 and
+// 8 chains. Both must give the same planes.
+//
+//   bench_ledstrip_transpose [iterations]
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "pico/stdlib.h"
+
+#include "ledstrip.h"
+#include "host.h"
+
+// Constants
+#define BENCH_ITERATIONS    20000
+#define BENCH_PIXELS_MAX    270
+
+// Global variables
+uint32_t    bench_frame[BENCH_PIXELS_MAX];
+uint32_t    bench_planes[LEDSTRIP_PLANE_WORDS(BENCH_PIXELS_MAX, 2)];
+uint32_t    bench_expected[LEDSTRIP_PLANE_WORDS(BENCH_PIXELS_MAX, 2)];
+
+// Private prototypes
+void bench_reference(const uint32_t* frame, uint16_t pixel_count, uint8_t lanes, uint32_t* planes);
+uint64_t bench_now_ns(void);
+double bench_time(uint16_t pixel_count, uint8_t lanes, uint32_t iterations, bool reference);
+
+// =================================================================================
+
+// The transmit times aren't under test
+void ledstats_record(uint8_t histogram, uint32_t elapsed_us)
+{
+    (void) histogram;
+    (void) elapsed_us;
+}
+
+// Bit b of pixel p of chain n, most significant bit first, goes in bit n of word
+// (p * 24) + b
+void bench_reference(const uint32_t* frame, uint16_t pixel_count, uint8_t lanes, uint32_t* planes)
+{
+    uint16_t    lane_pixels = LEDSTRIP_LANE_PIXELS(pixel_count, lanes);
+    uint16_t    pixel = 0;
+    uint16_t    index = 0;
+    uint8_t     lane = 0;
+    uint8_t     bit = 0;
+
+    memset(planes, 0, LEDSTRIP_PLANE_WORDS(pixel_count, lanes) * sizeof(uint32_t));
+
+    for(lane = 0; lane != lanes; lane++)
+    {
+        for(pixel = 0; pixel != lane_pixels; pixel++)
+        {
+            index = (lane * lane_pixels) + pixel;
+
+            for(bit = 0; (index < pixel_count) && (bit != LEDSTRIP_BITS); bit++)
+            {
+                planes[(pixel * LEDSTRIP_BITS) + bit] |= ((frame[index] >> (31 - bit)) & 1) << lane;
+            }
+        }
+    }
+}
+
+uint64_t bench_now_ns(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return((uint64_t) now.tv_sec * 1000000000ull + now.tv_nsec);
+}
+
+// Returns the time for one frame, in ns
+double bench_time(uint16_t pixel_count, uint8_t lanes, uint32_t iterations, bool reference)
+{
+    uint64_t    start = bench_now_ns();
+    uint32_t    counter = 0;
+
+    while(counter != iterations)
+    {
+        // A different frame every time, so the work can't be hoisted out of the loop
+        bench_frame[counter % pixel_count] = LEDSTRIP_WORD(counter & 0xFFFFFF);
+
+        if(reference == true)
+        {
+            bench_reference(bench_frame, pixel_count, lanes, bench_planes);
+        }
+        else
+        {
+            ledstrip_transpose(bench_frame, pixel_count, lanes, bench_planes);
+        }
+
+        counter = counter + 1;
+    }
+
+    return((double) (bench_now_ns() - start) / iterations);
+}
+
+int main(int argc, char* argv[])
+{
+    const uint16_t  pixel_counts[] = {108, 270, 0};
+    const uint8_t   lane_counts[] = {2, 4, 8, 0};
+    uint32_t        iterations = BENCH_ITERATIONS;
+    uint32_t        counter = 0;
+    uint8_t         pixels = 0;
+    uint8_t         lanes = 0;
+    uint16_t        pixel_count = 0;
+    double          transpose_ns = 0;
+    double          reference_ns = 0;
+
+    if(argc > 1)
+    {
+        iterations = strtoul(argv[1], NULL, 10);
+    }
+
+    srand(1);
+
+    while(counter != BENCH_PIXELS_MAX)
+    {
+        bench_frame[counter] = LEDSTRIP_WORD(rand() & 0xFFFFFF);
+        counter = counter + 1;
+    }
+
+    printf("%-8s %-6s %14s %12s %8s\n", "Pixels", "Chains", "transpose ns", "bit by bit", "faster");
+
+    while(pixel_counts[pixels] != 0)
+    {
+        pixel_count = pixel_counts[pixels];
+        lanes = 0;
+
+        while(lane_counts[lanes] != 0)
+        {
+            bench_reference(bench_frame, pixel_count, lane_counts[lanes], bench_expected);
+            ledstrip_transpose(bench_frame, pixel_count, lane_counts[lanes], bench_planes);
+            HOST_CHECK(memcmp(bench_planes, bench_expected, LEDSTRIP_PLANE_WORDS(pixel_count, lane_counts[lanes]) * sizeof(uint32_t)) == 0);
+
+            transpose_ns = bench_time(pixel_count, lane_counts[lanes], iterations, false);
+            reference_ns = bench_time(pixel_count, lane_counts[lanes], iterations, true);
+
+            printf("%-8u %-6u %14.0f %12.0f %7.1fx\n", pixel_count, lane_counts[lanes], transpose_ns, reference_ns, reference_ns / transpose_ns);
+
+            lanes = lanes + 1;
+        }
+
+        pixels = pixels + 1;
+    }
+
+    return(host_result());
+}
@@ -0,0 +1,403 @@
+// ---------------------------------------------------------------------------------
+// Host benchmark - Pipelined SNON requests
+// ---------------------------------------------------------------------------------
+// Runs the 1840A fragment handling behind the UART code on a pty, with the serial
+// link in between simulated in the panel's UART: bytes go at 115200 baud, 8N1,
+// and take a further 2 ms each way, about what a USB serial adapter adds. The
+// host sets values with a request ID on each fragment, keeping 1, 8 and then 32
+// requests outstanding, the way snon-pipeline.rb does. Every reply has to carry
+// the new value and come back in order with its request ID. Prints requests/s
+// for each, and what share of the wire's speed that is.
+//
+// The number of requests for each run can be given on the command line.
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "pico/stdlib.h"
+#include "hardware/irq.h"
+#include "hardware/uart.h"
+#include "snon/snon_utils.h"
+
+#include "arena.h"
+#include "fragment.h"
+#include "store.h"
+#include "uart.h"
+#include "writer.h"
+#include "host.h"
+
+// Constants
+#define TEST_REQUESTS       200
+#define TEST_ENTITIES       8
+#define TEST_LINE_MAX       512
+#define TEST_LINK_SIZE      8192                    // Bytes on their way, either way
+#define TEST_LINK_MASK      (TEST_LINK_SIZE - 1)
+#define TEST_FIFO_SIZE      32                      // Bytes the UART holds to send
+#define TEST_BYTE_US        (10.0 * 1e6 / 115200)   // 8N1
+#define TEST_LATENCY_US     2000                    // Each way
+#define TEST_REPLY_US       2000000
+#define TEST_DR_EMPTY       0x100                   // Nothing written to the UART data register
+
+// Types
+
+// Bytes on the link, each with the time it gets to the far end
+typedef struct
+{
+    uint8_t     data[TEST_LINK_SIZE];
+    uint64_t    due_us[TEST_LINK_SIZE];
+    uint32_t    head;
+    uint32_t    tail;
+    double      wire_us;                            // When the wire is next free
+} test_link_t;
+
+typedef struct
+{
+    uint8_t     outstanding;
+    double      requests_per_s;
+    double      wire_share;
+} test_result_t;
+
+// Global variables
+const uint8_t       test_depths[] = {1, 8, 32};
+char                test_names[TEST_ENTITIES][16];
+char                test_eids[TEST_ENTITIES][SNON_URN_LENGTH];
+int                 test_master = -1;
+int                 test_slave = -1;
+volatile bool       test_running = true;
+
+// Panel thread only
+test_link_t         test_rx;
+test_link_t         test_tx;
+
+// Private prototypes
+bool test_link_put(test_link_t* link, uint8_t data, uint64_t sent_us, bool wire_first);
+bool test_link_due(test_link_t* link);
+void test_panel_rx(void);
+void test_panel_tx(void);
+void* test_panel(void* unused);
+void test_open_pty(void);
+void test_request(char* line, uint32_t request);
+void test_reply(char* line, uint32_t request);
+bool test_receive(char* line, uint16_t* length);
+test_result_t test_pipeline(uint8_t outstanding, uint32_t requests);
+
+// =================================================================================
+// Serial link. A byte is on the wire for TEST_BYTE_US once the bytes ahead of it
+// have gone, and gets to the far end TEST_LATENCY_US later, or the other way round
+// for bytes the host sends, which wait in its USB adapter before the wire.
+
+bool test_link_put(test_link_t* link, uint8_t data, uint64_t sent_us, bool wire_first)
+{
+    double  start_us = sent_us;
+
+    if(link->tail - link->head == TEST_LINK_SIZE)
+    {
+        return(false);
+    }
+
+    if(wire_first == false)
+    {
+        start_us = start_us + TEST_LATENCY_US;
+    }
+
+    if(link->wire_us > start_us)
+    {
+        start_us = link->wire_us;
+    }
+
+    link->wire_us = start_us + TEST_BYTE_US;
+    link->data[link->tail & TEST_LINK_MASK] = data;
+    link->due_us[link->tail & TEST_LINK_MASK] = link->wire_us + ((wire_first == true) ? TEST_LATENCY_US : 0);
+    link->tail = link->tail + 1;
+
+    return(true);
+}
+
+bool test_link_due(test_link_t* link)
+{
+    return((link->head != link->tail) && (link->due_us[link->head & TEST_LINK_MASK] <= time_us_64()));
+}
+
+// =================================================================================
+// Panel UART. Received bytes come from the pty over the link, and each byte
+// written to the data register goes onto the link back to it.
+
+bool uart_is_readable(uart_inst_t* uart)
+{
+    (void) uart;
+
+    test_panel_rx();
+
+    return(test_link_due(&test_rx));
+}
+
+char uart_getc(uart_inst_t* uart)
+{
+    char    character = test_rx.data[test_rx.head & TEST_LINK_MASK];
+
+    (void) uart;
+
+    test_rx.head = test_rx.head + 1;
+
+    return(character);
+}
+
+// The UART has room while its FIFO isn't full of bytes still to go on the wire
+bool uart_is_writable(uart_inst_t* uart)
+{
+    (void) uart;
+
+    test_panel_tx();
+
+    return(test_tx.wire_us < time_us_64() + (TEST_FIFO_SIZE * TEST_BYTE_US));
+}
+
+void test_panel_rx(void)
+{
+    uint8_t     buffer[TEST_FIFO_SIZE];
+    int         length = read(test_slave, buffer, TEST_FIFO_SIZE);
+    int         counter = 0;
+
+    for(counter = 0; counter < length; counter++)
+    {
+        HOST_CHECK(test_link_put(&test_rx, buffer[counter], time_us_64(), false) == true);
+    }
+}
+
+void test_panel_tx(void)
+{
+    uart_hw_t*  hw = uart_get_hw(uart1);
+    uint8_t     character = 0;
+
+    if(hw->dr != TEST_DR_EMPTY)
+    {
+        HOST_CHECK(test_link_put(&test_tx, hw->dr, time_us_64(), true) == true);
+        hw->dr = TEST_DR_EMPTY;
+    }
+
+    while(test_link_due(&test_tx) == true)
+    {
+        character = test_tx.data[test_tx.head & TEST_LINK_MASK];
+        HOST_CHECK(write(test_slave, &character, 1) == 1);
+        test_tx.head = test_tx.head + 1;
+    }
+}
+
+// =================================================================================
+// Panel
+
+// The 1840A command loop, for SNON fragments. The UART interrupt runs on the same
+// thread, every pass, as there is nearly always something on the link.
+void* test_panel(void* unused)
+{
+    const char*     command = NULL;
+    writer_t        writer;
+
+    (void) unused;
+
+    host_set_core(0);
+
+    while(test_running == true)
+    {
+        host_irq(UART1_IRQ);
+        writer_resume();
+
+        command = uart_command_get();
+
+        if(command[0] != 0)
+        {
+            writer_init_uart(&writer, WRITER_MODE_RAW);
+            fragment_process(&writer, command);
+            writer_puts(&writer, "\r\n");
+            writer_flush(&writer);
+            uart_command_clear();
+
+            if(uart_response_pending() == false)
+            {
+                arena_reset(&scratch_arena);
+            }
+        }
+
+        test_panel_tx();
+        usleep(20);
+    }
+
+    return(NULL);
+}
+
+// =================================================================================
+// Host
+
+// A raw pty, so carriage returns arrive as they were sent
+void test_open_pty(void)
+{
+    struct termios  settings;
+
+    test_master = posix_openpt(O_RDWR | O_NOCTTY);
+    HOST_CHECK(test_master >= 0);
+    HOST_CHECK(grantpt(test_master) == 0);
+    HOST_CHECK(unlockpt(test_master) == 0);
+
+    test_slave = open(ptsname(test_master), O_RDWR | O_NOCTTY | O_NONBLOCK);
+    HOST_CHECK(test_slave >= 0);
+
+    tcgetattr(test_slave, &settings);
+    cfmakeraw(&settings);
+    tcsetattr(test_slave, TCSANOW, &settings);
+
+    // Replies are read as they arrive, between sending requests
+    fcntl(test_master, F_SETFL, fcntl(test_master, F_GETFL) | O_NONBLOCK);
+}
+
+// The fragment for a request, and the reply it has to get, without its line end
+void test_request(char* line, uint32_t request)
+{
+    sprintf(line, "{\"eID\":\"%s\",\"v\":[\"r%lu\"],\"rID\":%lu}\r\n", test_eids[request % TEST_ENTITIES], (unsigned long) request, (unsigned long) request);
+}
+
+void test_reply(char* line, uint32_t request)
+{
+    sprintf(line, "{\"eID\":\"%s\",\"name\":\"%s\",\"v\":[\"r%lu\"],\"rID\":%lu}", test_eids[request % TEST_ENTITIES], test_names[request % TEST_ENTITIES],
+            (unsigned long) request, (unsigned long) request);
+}
+
+// Reads what has arrived of a reply line. Returns true once it is whole, without
+// its line end.
+bool test_receive(char* line, uint16_t* length)
+{
+    char    character = 0;
+
+    while(read(test_master, &character, 1) == 1)
+    {
+        if(character == '\n')
+        {
+            line[*length] = 0;
+            *length = 0;
+            return(true);
+        }
+
+        if((character != '\r') && (*length < TEST_LINE_MAX - 1))
+        {
+            line[*length] = character;
+            *length = *length + 1;
+        }
+    }
+
+    return(false);
+}
+
+// Sends the requests, never with more than the given number outstanding
+test_result_t test_pipeline(uint8_t outstanding, uint32_t requests)
+{
+    struct pollfd   waiting = {.fd = test_master, .events = POLLIN};
+    test_result_t   result = {outstanding, 0, 0};
+    char            line[TEST_LINE_MAX];
+    char            reply[TEST_LINE_MAX];
+    char            expected[TEST_LINE_MAX];
+    uint64_t        start_us = time_us_64();
+    uint64_t        reply_us = time_us_64();
+    uint32_t        sent = 0;
+    uint32_t        answered = 0;
+    uint32_t        bytes = 0;
+    uint16_t        length = 0;
+
+    while((answered != requests) && (time_us_64() - reply_us < TEST_REPLY_US))
+    {
+        while((sent != requests) && (sent - answered < outstanding))
+        {
+            test_request(line, sent);
+            HOST_CHECK(write(test_master, line, strlen(line)) == (ssize_t) strlen(line));
+            sent = sent + 1;
+        }
+
+        poll(&waiting, 1, 10);
+
+        while(test_receive(reply, &length) == true)
+        {
+            // In order, each with its own request ID
+            test_reply(expected, answered);
+            HOST_CHECK(strcmp(reply, expected) == 0);
+            bytes = bytes + strlen(reply) + 2;
+            answered = answered + 1;
+            reply_us = time_us_64();
+        }
+    }
+
+    HOST_CHECK(answered == requests);
+
+    result.requests_per_s = answered / ((time_us_64() - start_us) / 1e6);
+    result.wire_share = result.requests_per_s / (1e6 / (((double) bytes / answered) * TEST_BYTE_US));
+
+    return(result);
+}
+
+int main(int argc, char** argv)
+{
+    pthread_t       panel;
+    test_result_t   results[sizeof(test_depths)];
+    uint32_t        requests = TEST_REQUESTS;
+    uint8_t         counter = 0;
+
+    if(argc > 1)
+    {
+        requests = strtoul(argv[1], NULL, 10);
+    }
+
+    arena_initialize();
+    snon_initialize("Pipeline Test");
+
+    for(counter = 0; counter != TEST_ENTITIES; counter++)
+    {
+        sprintf(test_names[counter], "=P01=E%03u", counter + 1);
+        snon_register(test_names[counter], SNON_CLASS_VALUE, "[\"off\"]");
+        snon_name_to_eid(test_names[counter], test_eids[counter]);
+    }
+
+    store_initialize();
+
+    uart_get_hw(uart1)->dr = TEST_DR_EMPTY;
+    test_open_pty();
+    uart_setup();
+
+    pthread_create(&panel, NULL, test_panel, NULL);
+
+    for(counter = 0; counter != sizeof(test_depths); counter++)
+    {
+        results[counter] = test_pipeline(test_depths[counter], requests);
+    }
+
+    test_running = false;
+    pthread_join(panel, NULL);
+
+    printf("Outstanding  Requests/s  Wire used\n");
+
+    for(counter = 0; counter != sizeof(test_depths); counter++)
+    {
+        printf("%11u  %10.0f  %8.0f%%\n", results[counter].outstanding, results[counter].requests_per_s, results[counter].wire_share * 100);
+    }
+
+    printf("%lu lines dropped\n", (unsigned long) (uart_get_stats()->rx_overflows + uart_get_stats()->line_overflows));
+
+    // Keeping requests outstanding hides the round trip, and nothing is dropped
+    // with as many outstanding as the line queue holds
+    HOST_CHECK(results[1].requests_per_s > results[0].requests_per_s * 1.5);
+    HOST_CHECK(results[2].requests_per_s >= results[1].requests_per_s * 0.9);
+    HOST_CHECK(results[2].wire_share > 0.8);
+    HOST_CHECK(uart_get_stats()->rx_overflows + uart_get_stats()->line_overflows == 0);
+
+    close(test_slave);
+    close(test_master);
+
+    return(host_result());
+}
@@ -0,0 +1,415 @@
+// ---------------------------------------------------------------------------------
+// Host benchmark - Entity JSON from the value store
+// ---------------------------------------------------------------------------------
+// Registers a panel's worth of SNON entities and takes them into the value store.
+// Every entity the store writes out must match what SNON gives for it, byte for
+// byte, and a value set through the store must show up in its JSON. Then times
+// writing every entity out as the "{}" fragment does, and setting values, against
+// fetching each entity's JSON from SNON as the panels used to. The heap is counted
+// throughout: the store may only use it while booting, and never after.
+//
+//   bench_store [rounds]
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "pico/stdlib.h"
+#include "snon/snon_utils.h"
+
+#include "arena.h"
+#include "json_tok.h"
+#include "store.h"
+#include "writer.h"
+#include "host.h"
+
+// Constants
+#define BENCH_ROUNDS        2000
+#define BENCH_ENTITIES      150
+#define BENCH_JSON_MAX      512
+#define BENCH_TOKENS        8
+
+// Types
+typedef struct
+{
+    uint32_t    allocations;
+    uint64_t    in_use;
+    uint64_t    peak;
+} bench_heap_t;
+
+// Global variables
+extern void*    __libc_malloc(size_t size);
+extern void*    __libc_calloc(size_t count, size_t size);
+extern void*    __libc_realloc(void* pointer, size_t size);
+extern void     __libc_free(void* pointer);
+
+bench_heap_t    bench_heap;
+bool            bench_counting = false;
+char            bench_names[BENCH_ENTITIES][16];
+
+// Private prototypes
+void bench_heap_start(void);
+void bench_heap_stop(const char* name);
+uint16_t bench_sink(writer_t* writer, const char* data, uint16_t length);
+void bench_init_sink(writer_t* writer);
+uint64_t bench_now_ns(void);
+void bench_register(void);
+void bench_compare(void);
+void bench_write_store(uint32_t rounds);
+void bench_write_snon(uint32_t rounds);
+void bench_set(uint32_t rounds);
+
+// =================================================================================
+// Heap
+
+// The heap is counted, while bench_counting is set, by standing in for malloc()
+void* malloc(size_t size)
+{
+    void*   pointer = __libc_malloc(size);
+
+    if((bench_counting == true) && (pointer != NULL))
+    {
+        bench_heap.allocations = bench_heap.allocations + 1;
+        bench_heap.in_use = bench_heap.in_use + malloc_usable_size(pointer);
+
+        if(bench_heap.in_use > bench_heap.peak)
+        {
+            bench_heap.peak = bench_heap.in_use;
+        }
+    }
+
+    return(pointer);
+}
+
+void* calloc(size_t count, size_t size)
+{
+    void*   pointer = malloc(count * size);
+
+    if(pointer != NULL)
+    {
+        memset(pointer, 0, count * size);
+    }
+
+    return(pointer);
+}
+
+void* realloc(void* pointer, size_t size)
+{
+    void*   moved = NULL;
+    size_t  length = 0;
+
+    if(pointer == NULL)
+    {
+        return(malloc(size));
+    }
+
+    moved = malloc(size);
+
+    if(moved != NULL)
+    {
+        length = malloc_usable_size(pointer);
+        memcpy(moved, pointer, (length < size) ? length : size);
+        free(pointer);
+    }
+
+    return(moved);
+}
+
+void free(void* pointer)
+{
+    if((bench_counting == true) && (pointer != NULL))
+    {
+        bench_heap.in_use = bench_heap.in_use - malloc_usable_size(pointer);
+    }
+
+    __libc_free(pointer);
+}
+
+void bench_heap_start(void)
+{
+    memset(&bench_heap, 0, sizeof(bench_heap));
+    bench_counting = true;
+}
+
+void bench_heap_stop(const char* name)
+{
+    bench_counting = false;
+    printf("%-22s heap: %6lu allocations, %7llu bytes peak\n", name, (unsigned long) bench_heap.allocations, (unsigned long long) bench_heap.peak);
+}
+
+// =================================================================================
+
+// Throws the output away, as a UART that keeps up would
+uint16_t bench_sink(writer_t* writer, const char* data, uint16_t length)
+{
+    (void) writer;
+    (void) data;
+
+    return(length);
+}
+
+void bench_init_sink(writer_t* writer)
+{
+    writer->sink = bench_sink;
+    writer->context = NULL;
+    writer->mode = WRITER_MODE_RAW;
+    writer->retry = false;
+    writer->failed = false;
+    writer->length = 0;
+    writer->total = 0;
+    writer->capacity = 0;
+}
+
+uint64_t bench_now_ns(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return((uint64_t) now.tv_sec * 1000000000ull + now.tv_nsec);
+}
+
+// Indicators, and readings with units, like the panels have
+void bench_register(void)
+{
+    char        values[64];
+    uint16_t    counter = 0;
+
+    arena_initialize();
+    snon_initialize("Store Bench");
+
+    for(counter = 0; counter != BENCH_ENTITIES; counter++)
+    {
+        snprintf(bench_names[counter], sizeof(bench_names[counter]), "=P01=PFA%03u", counter);
+
+        if((counter % 3) == 0)
+        {
+            snprintf(values, sizeof(values), "[\"%u.%02u\",\"A\"]", counter, counter % 100);
+        }
+        else
+        {
+            snprintf(values, sizeof(values), "[\"vita40_off\"]");
+        }
+
+        snon_register(bench_names[counter], SNON_CLASS_VALUE, values);
+    }
+
+    bench_heap_start();
+    store_initialize();
+    bench_heap_stop("Boot");
+
+    printf("%u entities stored, %lu of %lu boot arena bytes\n", store_get_count(), (unsigned long) boot_arena.used, (unsigned long) boot_arena.size);
+    HOST_CHECK(store_get_count() == BENCH_ENTITIES + 1);
+    HOST_CHECK(store_get_stats()->boot_failures == 0);
+
+    // Everything SNON allocated for the store is handed back
+    HOST_CHECK(bench_heap.in_use == 0);
+}
+
+// The store writes out what SNON would, and what is set through it
+void bench_compare(void)
+{
+    writer_t        writer;
+    json_tok_t      tokens[BENCH_TOKENS];
+    char            stored[BENCH_JSON_MAX];
+    char*           json = NULL;
+    const char*     command = "{\"eID\":\"\",\"v\":[\"vita40_red_steady\", 2]}";
+    store_handle_t  handle = 0;
+    int16_t         count = 0;
+    uint16_t        wrong = 0;
+
+    for(handle = 0; handle != store_get_count(); handle++)
+    {
+        writer_init_buffer(&writer, stored, sizeof(stored), WRITER_MODE_RAW);
+        store_write_json(&writer, handle, true);
+        writer_flush(&writer);
+
+        json = snon_get_json((char*) store_get_eid(handle));
+
+        if((json == NULL) || (strcmp(json, stored) != 0))
+        {
+            wrong = wrong + 1;
+        }
+
+        free(json);
+    }
+
+    HOST_CHECK(wrong == 0);
+
+    // Set from a fragment's tokens, as the 1840A does, and left open for a rID
+    handle = store_find(bench_names[1]);
+    count = json_tok_parse(command, strlen(command), tokens, BENCH_TOKENS);
+    HOST_CHECK(store_set_tokens(handle, command, tokens, count, json_tok_find_key(command, tokens, count, 0, "v")) == true);
+    HOST_CHECK(store_set_tokens(handle, command, tokens, count, 0) == false);
+
+    writer_init_buffer(&writer, stored, sizeof(stored), WRITER_MODE_RAW);
+    store_write_json(&writer, handle, false);
+    writer_flush(&writer);
+    HOST_CHECK(strstr(stored, ",\"v\":[\"vita40_red_steady\", 2]") != NULL);
+    HOST_CHECK(stored[strlen(stored) - 1] == ']');
+    HOST_CHECK(strcmp(store_get_value(handle), "vita40_red_steady") == 0);
+
+    // Values too long for any pool are refused, and leave the old ones
+    memset(stored, 'x', VALUE_MAX_LENGTH + 8);
+    stored[0] = '[';
+    stored[1] = '"';
+    strcpy(&stored[VALUE_MAX_LENGTH + 4], "\"]");
+    HOST_CHECK(store_set_values(handle, stored) == false);
+    HOST_CHECK(strcmp(store_get_value(handle), "vita40_red_steady") == 0);
+    HOST_CHECK(store_set_values(handle, "\"vita40_off\"") == false);
+    HOST_CHECK(store_set_values(STORE_INVALID, "[\"vita40_off\"]") == false);
+    HOST_CHECK(store_find("=P01=PFA999") == STORE_INVALID);
+}
+
+// Every entity, as the "{}" fragment writes them
+void bench_write_store(uint32_t rounds)
+{
+    writer_t        writer;
+    store_handle_t  handle = 0;
+    uint64_t        start = 0;
+    uint64_t        elapsed = 0;
+    uint64_t        bytes = 0;
+    uint32_t        round = 0;
+
+    bench_heap_start();
+    start = bench_now_ns();
+
+    for(round = 0; round != rounds; round++)
+    {
+        bench_init_sink(&writer);
+        writer_putc(&writer, '[');
+
+        for(handle = 0; handle != store_get_count(); handle++)
+        {
+            if(handle != 0)
+            {
+                writer_putc(&writer, ',');
+            }
+
+            store_write_json(&writer, handle, true);
+        }
+
+        writer_putc(&writer, ']');
+        writer_flush(&writer);
+        bytes = bytes + writer.total;
+    }
+
+    elapsed = bench_now_ns() - start;
+    bench_heap_stop("Store");
+
+    printf("Store: %lu bytes per dump, %.1f MB/s, %.1f us per dump\n", (unsigned long) (bytes / rounds), (double) bytes * 1000.0 / elapsed,
+           (double) elapsed / 1000.0 / rounds);
+
+    HOST_CHECK(bench_heap.allocations == 0);
+}
+
+// The same, with each entity's JSON fetched from SNON, which allocates it
+void bench_write_snon(uint32_t rounds)
+{
+    writer_t        writer;
+    store_handle_t  handle = 0;
+    char*           json = NULL;
+    uint64_t        start = 0;
+    uint64_t        elapsed = 0;
+    uint64_t        bytes = 0;
+    uint32_t        round = 0;
+
+    bench_heap_start();
+    start = bench_now_ns();
+
+    for(round = 0; round != rounds; round++)
+    {
+        bench_init_sink(&writer);
+        writer_putc(&writer, '[');
+
+        for(handle = 0; handle != store_get_count(); handle++)
+        {
+            if(handle != 0)
+            {
+                writer_putc(&writer, ',');
+            }
+
+            json = snon_get_json((char*) store_get_eid(handle));
+            writer_puts(&writer, json);
+            free(json);
+        }
+
+        writer_putc(&writer, ']');
+        writer_flush(&writer);
+        bytes = bytes + writer.total;
+    }
+
+    elapsed = bench_now_ns() - start;
+    bench_heap_stop("SNON");
+
+    printf("SNON: %lu bytes per dump, %.1f MB/s, %.1f us per dump\n", (unsigned long) (bytes / rounds), (double) bytes * 1000.0 / elapsed,
+           (double) elapsed / 1000.0 / rounds);
+}
+
+// Values growing and shrinking across the 16, 32 and 64 byte pools, set through
+// the store. Fewer than half are long enough for a 64 byte block, as the pools
+// are sized for.
+void bench_set(uint32_t rounds)
+{
+    char            values[VALUE_MAX_LENGTH];
+    store_handle_t  handle = 0;
+    uint64_t        start = 0;
+    uint64_t        elapsed = 0;
+    uint32_t        refused = store_get_stats()->refused;
+    uint32_t        sets = 0;
+    uint32_t        round = 0;
+    uint16_t        length = 0;
+
+    bench_heap_start();
+    start = bench_now_ns();
+
+    for(round = 0; round != rounds; round++)
+    {
+        for(handle = 0; handle != store_get_count(); handle++)
+        {
+            length = 4 + ((round + handle) % 40);
+            values[0] = '[';
+            values[1] = '"';
+            memset(&values[2], 'a' + (round % 26), length);
+            strcpy(&values[2 + length], "\"]");
+
+            if(store_set_values(handle, values) == true)
+            {
+                sets = sets + 1;
+            }
+        }
+    }
+
+    elapsed = bench_now_ns() - start;
+    bench_heap_stop("Sets");
+
+    printf("Sets: %.0f per second\n", (double) sets * 1000000000.0 / elapsed);
+
+    HOST_CHECK(bench_heap.allocations == 0);
+    HOST_CHECK(sets == rounds * store_get_count());
+    HOST_CHECK(store_get_stats()->refused == refused);
+}
+
+int main(int argc, char* argv[])
+{
+    uint32_t    rounds = BENCH_ROUNDS;
+
+    if(argc > 1)
+    {
+        rounds = strtoul(argv[1], NULL, 10);
+    }
+
+    bench_register();
+    bench_compare();
+    bench_write_store(rounds);
+    bench_write_snon(rounds);
+    bench_set(rounds);
+
+    return(host_result());
+}
@@ -0,0 +1,78 @@
+// ---------------------------------------------------------------------------------
+// Host test - JSON tokenizer fuzz target
+// ---------------------------------------------------------------------------------
+// Every input is tokenized by json_tok and parsed by the client JSON parser, and
+// the two must agree. Built with libFuzzer when SNON_CLIENT_FUZZ is on (clang
+// only); otherwise it replays the files and directories it is given, which is how
+// the committed corpus in corpus/json_tok runs as a test.
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "json_tok_compare.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    std::string input((const char*) data, size);
+    std::string detail;
+
+    if(json_compare(input, &detail) == JSON_COMPARE_DIFFERENT)
+    {
+        fprintf(stderr, "%s\n    %s\n", input.c_str(), detail.c_str());
+        abort();
+    }
+
+    return(0);
+}
+
+#ifndef JSON_TOK_LIBFUZZER
+
+int main(int argc, char** argv)
+{
+    std::vector<std::filesystem::path>  files;
+    int                                 counter = 0;
+
+    for(counter = 1; counter < argc; counter++)
+    {
+        if(std::filesystem::is_directory(argv[counter]))
+        {
+            for(const auto& entry : std::filesystem::directory_iterator(argv[counter]))
+            {
+                files.push_back(entry.path());
+            }
+        }
+        else
+        {
+            files.push_back(argv[counter]);
+        }
+    }
+
+    if(files.empty())
+    {
+        fprintf(stderr, "Usage: fuzz_json_tok <file or directory> [...]\n");
+        return(1);
+    }
+
+    for(const auto& file : files)
+    {
+        std::ifstream   stream(file, std::ios::binary);
+        std::string     input((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+
+        LLVMFuzzerTestOneInput((const uint8_t*) input.data(), input.size());
+    }
+
+    printf("Replayed %zu inputs\n", files.size());
+
+    return(0);
+}
+
+#endif
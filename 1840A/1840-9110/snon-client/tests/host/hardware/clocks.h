@@ -0,0 +1,21 @@
+// ---------------------------------------------------------------------------------
+// Host build of the Pico SDK - hardware/clocks.h
+// ---------------------------------------------------------------------------------
+// The system clock runs at the RP2040 default
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+
+#pragma once
+#ifndef HOST_HARDWARE_CLOCKS_H
+#define HOST_HARDWARE_CLOCKS_H
+
+#include "pico/stdlib.h"
+
+#define clk_sys     5
+
+uint32_t clock_get_hz(int clock);
+
+#endif // HOST_HARDWARE_CLOCKS_H
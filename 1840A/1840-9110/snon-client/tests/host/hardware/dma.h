@@ -0,0 +1,69 @@
+// ---------------------------------------------------------------------------------
+// Host build of the Pico SDK - hardware/dma.h
+// ---------------------------------------------------------------------------------
+// Channels are handed out and configured, but nothing is transferred. A test that
+// needs the transfers replaces dma_channel_set_read_addr().
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+
+#pragma once
+#ifndef HOST_HARDWARE_DMA_H
+#define HOST_HARDWARE_DMA_H
+
+#include "pico/stdlib.h"
+#include "hardware/irq.h"
+
+// Constants
+#define HOST_DMA_CHANNELS   12
+
+// Types
+typedef enum
+{
+    DMA_SIZE_8 = 0,
+    DMA_SIZE_16 = 1,
+    DMA_SIZE_32 = 2
+} dma_channel_transfer_size_t;
+
+typedef struct
+{
+    uint32_t    ctrl;
+} dma_channel_config;
+
+typedef struct
+{
+    volatile uint32_t   read_addr, write_addr, transfer_count, ctrl_trig;
+    volatile uint32_t   al1_ctrl, al1_read_addr, al1_write_addr, al1_transfer_count_trig;
+    volatile uint32_t   al2_ctrl, al2_transfer_count, al2_read_addr, al2_write_addr_trig;
+    volatile uint32_t   al3_ctrl, al3_write_addr, al3_transfer_count, al3_read_addr_trig;
+} dma_channel_hw_t;
+
+typedef struct
+{
+    dma_channel_hw_t    ch[HOST_DMA_CHANNELS];
+} dma_hw_t;
+
+extern dma_hw_t* dma_hw;
+
+int dma_claim_unused_channel(bool required);
+void dma_channel_unclaim(uint channel);
+dma_channel_config dma_channel_get_default_config(uint channel);
+void channel_config_set_transfer_data_size(dma_channel_config* config, dma_channel_transfer_size_t size);
+void channel_config_set_read_increment(dma_channel_config* config, bool increment);
+void channel_config_set_write_increment(dma_channel_config* config, bool increment);
+void channel_config_set_dreq(dma_channel_config* config, uint dreq);
+void channel_config_set_ring(dma_channel_config* config, bool write, uint size_bits);
+void channel_config_set_chain_to(dma_channel_config* config, uint chain_to);
+void channel_config_set_irq_quiet(dma_channel_config* config, bool irq_quiet);
+void dma_channel_configure(uint channel, const dma_channel_config* config, volatile void* write_addr, const volatile void* read_addr, uint transfer_count, bool trigger);
+void dma_channel_set_read_addr(uint channel, const volatile void* read_addr, bool trigger);
+void dma_channel_set_trans_count(uint channel, uint32_t trans_count, bool trigger);
+void dma_channel_set_irq0_enabled(uint channel, bool enabled);
+bool dma_channel_get_irq0_status(uint channel);
+void dma_channel_acknowledge_irq0(uint channel);
+bool dma_channel_is_busy(uint channel);
+void dma_channel_abort(uint channel);
+
+#endif // HOST_HARDWARE_DMA_H
@@ -0,0 +1,11 @@
+// ---------------------------------------------------------------------------------
+// Host build of the Pico SDK - hardware/gpio.h
+// ---------------------------------------------------------------------------------
+// Declared with the rest of the GPIO functions in pico/stdlib.h
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+
+#pragma once
@@ -0,0 +1,38 @@
+// ---------------------------------------------------------------------------------
+// Host build of the Pico SDK - hardware/irq.h
+// ---------------------------------------------------------------------------------
+// Handlers are remembered, so a test can raise an interrupt by calling host_irq()
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+
+#pragma once
+#ifndef HOST_HARDWARE_IRQ_H
+#define HOST_HARDWARE_IRQ_H
+
+#include "pico/stdlib.h"
+
+// Constants
+#define PICO_HIGHEST_IRQ_PRIORITY                       0x00
+#define PICO_DEFAULT_IRQ_PRIORITY                       0x80
+#define PICO_LOWEST_IRQ_PRIORITY                        0xff
+#define PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY  0x80
+#define PIO1_IRQ_0      9
+#define DMA_IRQ_0       11
+#define DMA_IRQ_1       12
+#define UART1_IRQ       21
+#define SPARE_IRQ_0     26
+#define HOST_IRQ_COUNT  32
+
+// Types
+typedef void (*irq_handler_t)(void);
+
+void irq_set_exclusive_handler(uint irq, irq_handler_t handler);
+void irq_add_shared_handler(uint irq, irq_handler_t handler, uint8_t order_priority);
+void irq_set_enabled(uint irq, bool enabled);
+void irq_set_priority(uint irq, uint8_t priority);
+void irq_set_pending(uint irq);
+
+#endif // HOST_HARDWARE_IRQ_H
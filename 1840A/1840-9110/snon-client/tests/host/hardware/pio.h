@@ -0,0 +1,64 @@
+// ---------------------------------------------------------------------------------
+// Host build of the Pico SDK - hardware/pio.h
+// ---------------------------------------------------------------------------------
+// The PIO blocks are plain memory. Nothing runs the state machines; a test that
+// needs their output simulates the program from what DMA would have sent.
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+
+#pragma once
+#ifndef HOST_HARDWARE_PIO_H
+#define HOST_HARDWARE_PIO_H
+
+#include "pico/stdlib.h"
+
+// Constants
+#define PIO_FIFO_JOIN_TX    1
+
+// Types
+typedef struct pio_hw
+{
+    volatile uint32_t   txf[4];
+} pio_hw_t;
+
+typedef pio_hw_t* PIO;
+
+typedef struct
+{
+    uint32_t    clkdiv;
+} pio_sm_config;
+
+typedef struct pio_program
+{
+    const uint16_t* instructions;
+    uint8_t         length;
+    int8_t          origin;
+} pio_program_t;
+
+extern pio_hw_t* pio0_hw_ptr;
+extern pio_hw_t* pio1_hw_ptr;
+#define pio0    pio0_hw_ptr
+#define pio1    pio1_hw_ptr
+
+uint pio_get_index(PIO pio);
+uint pio_get_dreq(PIO pio, uint sm, bool is_tx);
+bool pio_can_add_program(PIO pio, const pio_program_t* program);
+uint pio_add_program(PIO pio, const pio_program_t* program);
+int pio_claim_unused_sm(PIO pio, bool required);
+void pio_sm_claim(PIO pio, uint sm);
+void pio_sm_unclaim(PIO pio, uint sm);
+void pio_gpio_init(PIO pio, uint pin);
+void pio_sm_init(PIO pio, uint sm, uint initial_pc, const pio_sm_config* config);
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled);
+void pio_sm_set_consecutive_pindirs(PIO pio, uint sm, uint pin_base, uint pin_count, bool is_out);
+void pio_sm_put(PIO pio, uint sm, uint32_t data);
+void pio_sm_put_blocking(PIO pio, uint sm, uint32_t data);
+bool pio_sm_is_tx_fifo_full(PIO pio, uint sm);
+bool pio_sm_is_tx_fifo_empty(PIO pio, uint sm);
+void pio_sm_clear_fifos(PIO pio, uint sm);
+void pio_sm_restart(PIO pio, uint sm);
+
+#endif // HOST_HARDWARE_PIO_H
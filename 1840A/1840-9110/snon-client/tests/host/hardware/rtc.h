@@ -0,0 +1,17 @@
+// ---------------------------------------------------------------------------------
+// Host build of the Pico SDK - hardware/rtc.h
+// ---------------------------------------------------------------------------------
+// Nothing the panels call directly. The time commands go through snon_utils.
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+
+#pragma once
+#ifndef HOST_HARDWARE_RTC_H
+#define HOST_HARDWARE_RTC_H
+
+#include "pico/stdlib.h"
+
+#endif // HOST_HARDWARE_RTC_H
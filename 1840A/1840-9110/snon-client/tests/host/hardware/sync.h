@@ -0,0 +1,37 @@
+// ---------------------------------------------------------------------------------
+// Host build of the Pico SDK - hardware/sync.h
+// ---------------------------------------------------------------------------------
+// Barriers are real fences, and spin locks are real locks, so modules that are
+// shared between the cores can be exercised from several threads.
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+
+#pragma once
+#ifndef HOST_HARDWARE_SYNC_H
+#define HOST_HARDWARE_SYNC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Types
+typedef volatile uint32_t spin_lock_t;
+
+static inline void __dmb(void) { __atomic_thread_fence(__ATOMIC_SEQ_CST); }
+static inline void __compiler_memory_barrier(void) { __atomic_signal_fence(__ATOMIC_SEQ_CST); }
+static inline void __sev(void) {}
+static inline void __wfe(void) {}
+static inline void __wfi(void) {}
+
+uint32_t save_and_disable_interrupts(void);
+void restore_interrupts(uint32_t status);
+int spin_lock_claim_unused(bool required);
+spin_lock_t* spin_lock_init(unsigned int lock_num);
+spin_lock_t* spin_lock_instance(unsigned int lock_num);
+uint32_t spin_lock_blocking(spin_lock_t* lock);
+void spin_unlock(spin_lock_t* lock, uint32_t saved_irq);
+unsigned int get_core_num(void);
+
+#endif // HOST_HARDWARE_SYNC_H
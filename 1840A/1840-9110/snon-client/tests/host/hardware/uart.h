@@ -0,0 +1,53 @@
+// ---------------------------------------------------------------------------------
+// Host build of the Pico SDK - hardware/uart.h
+// ---------------------------------------------------------------------------------
+// The UART registers are plain memory. Tests feed the receive side by replacing
+// uart_is_readable() and uart_getc(), and collect the transmit side from uart_putc_raw().
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+
+#pragma once
+#ifndef HOST_HARDWARE_UART_H
+#define HOST_HARDWARE_UART_H
+
+#include "pico/stdlib.h"
+
+// Constants
+#define UART_UARTIMSC_RXIM_BITS     0x10
+#define UART_UARTIMSC_TXIM_BITS     0x20
+#define UART_UARTIMSC_RTIM_BITS     0x40
+#define UART_UARTFR_BUSY_BITS       0x08
+
+// Types
+typedef struct uart_inst uart_inst_t;
+
+typedef struct
+{
+    volatile uint32_t   dr, rsr, pad[4], fr, pad2, ilpr, ibrd, fbrd, lcr_h, cr, ifls, imsc, ris, mis, icr, dmacr;
+} uart_hw_t;
+
+extern uart_inst_t* uart0_inst;
+extern uart_inst_t* uart1_inst;
+#define uart0   uart0_inst
+#define uart1   uart1_inst
+
+uint uart_init(uart_inst_t* uart, uint baudrate);
+uint uart_get_index(uart_inst_t* uart);
+uart_hw_t* uart_get_hw(uart_inst_t* uart);
+uint uart_get_dreq(uart_inst_t* uart, bool is_tx);
+void uart_set_hw_flow(uart_inst_t* uart, bool cts, bool rts);
+void uart_set_fifo_enabled(uart_inst_t* uart, bool enabled);
+void uart_set_irq_enables(uart_inst_t* uart, bool rx_has_data, bool tx_needs_data);
+bool uart_is_readable(uart_inst_t* uart);
+bool uart_is_writable(uart_inst_t* uart);
+char uart_getc(uart_inst_t* uart);
+void uart_putc(uart_inst_t* uart, char c);
+void uart_putc_raw(uart_inst_t* uart, char c);
+void uart_puts(uart_inst_t* uart, const char* s);
+void uart_write_blocking(uart_inst_t* uart, const uint8_t* src, size_t len);
+void uart_tx_wait_blocking(uart_inst_t* uart);
+
+#endif // HOST_HARDWARE_UART_H
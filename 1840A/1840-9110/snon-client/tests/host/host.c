@@ -0,0 +1,567 @@
+// ---------------------------------------------------------------------------------
+// Host build of the Pico SDK
+// ---------------------------------------------------------------------------------
+// Stand-ins for the SDK calls the panel modules make. Every function is weak, so
+// a test can replace one with a version that simulates the hardware it needs.
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "hardware/sync.h"
+#include "hardware/irq.h"
+#include "hardware/uart.h"
+#include "hardware/pio.h"
+#include "hardware/dma.h"
+#include "hardware/clocks.h"
+#include "pico-utils/ws2812.h"
+#include "ws2812.pio.h"
+
+#include "host.h"
+
+#define HOST_WEAK   __attribute__((weak))
+
+// Constants
+#define HOST_SPIN_LOCKS         32
+#define HOST_SHARED_HANDLERS    4
+#define HOST_PIO_SMS            4
+
+// Global variables
+static bool             host_clock_manual = false;
+static uint64_t         host_clock_us = 0;
+static __thread uint    host_core = 0;
+static uint32_t         host_failures = 0;
+
+static spin_lock_t      host_spin_locks[HOST_SPIN_LOCKS];
+static uint8_t          host_spin_lock_count = 0;
+static irq_handler_t    host_irq_handlers[HOST_IRQ_COUNT][HOST_SHARED_HANDLERS];
+
+static struct uart_inst
+{
+    uint        index;
+} host_uarts[2] = {{0}, {1}};
+static uart_hw_t        host_uart_hw[2];
+uart_inst_t*            uart0_inst = &host_uarts[0];
+uart_inst_t*            uart1_inst = &host_uarts[1];
+
+static pio_hw_t         host_pio_hw[2];
+static uint8_t          host_pio_sms[2];
+static uint8_t          host_pio_offsets[2];
+pio_hw_t*               pio0_hw_ptr = &host_pio_hw[0];
+pio_hw_t*               pio1_hw_ptr = &host_pio_hw[1];
+
+static dma_hw_t         host_dma_hw;
+static uint8_t          host_dma_count = 0;
+dma_hw_t*               dma_hw = &host_dma_hw;
+
+static const uint16_t   host_program[1];
+const pio_program_t     ws2812_program = {host_program, 4, -1};
+const pio_program_t     ws2812_parallel_program = {host_program, 4, -1};
+
+// =================================================================================
+// Test controls
+
+void host_clock_set(uint64_t us)
+{
+    host_clock_manual = true;
+    host_clock_us = us;
+}
+
+void host_clock_advance(uint64_t us)
+{
+    host_clock_set(host_clock_now_us() + us);
+}
+
+uint64_t host_clock_now_us(void)
+{
+    struct timespec now;
+
+    if(host_clock_manual == true)
+    {
+        return(host_clock_us);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return(((uint64_t) now.tv_sec * 1000000u) + (now.tv_nsec / 1000));
+}
+
+void host_set_core(unsigned int core)
+{
+    host_core = core;
+}
+
+// Runs the handlers for an interrupt, as the NVIC would
+void host_irq(uint irq)
+{
+    uint8_t counter = 0;
+
+    while((counter != HOST_SHARED_HANDLERS) && (host_irq_handlers[irq][counter] != NULL))
+    {
+        host_irq_handlers[irq][counter]();
+        counter = counter + 1;
+    }
+}
+
+void host_check(bool condition, const char* text, const char* file, int line)
+{
+    if(condition == false)
+    {
+        printf("%s:%d: check failed: %s\n", file, line, text);
+        host_failures = host_failures + 1;
+    }
+}
+
+int host_result(void)
+{
+    if(host_failures != 0)
+    {
+        printf("%lu checks failed\n", (unsigned long) host_failures);
+        return(1);
+    }
+
+    printf("All checks passed\n");
+    return(0);
+}
+
+// =================================================================================
+// pico/stdlib.h
+
+HOST_WEAK uint64_t time_us_64(void)
+{
+    return(host_clock_now_us());
+}
+
+HOST_WEAK uint32_t time_us_32(void)
+{
+    return((uint32_t) time_us_64());
+}
+
+HOST_WEAK void sleep_us(uint64_t us)
+{
+    struct timespec delay = {us / 1000000u, (us % 1000000u) * 1000};
+
+    if(host_clock_manual == true)
+    {
+        host_clock_us = host_clock_us + us;
+    }
+    else
+    {
+        nanosleep(&delay, NULL);
+    }
+}
+
+HOST_WEAK void sleep_ms(uint32_t ms)
+{
+    sleep_us((uint64_t) ms * 1000);
+}
+
+HOST_WEAK void busy_wait_us(uint64_t us)
+{
+    sleep_us(us);
+}
+
+HOST_WEAK void busy_wait_us_32(uint32_t us)
+{
+    sleep_us(us);
+}
+
+// Timers never fire on their own. A test calls the callback itself, at the times
+// it wants to simulate.
+HOST_WEAK bool add_repeating_timer_us(int64_t delay_us, repeating_timer_callback_t callback, void* user_data, struct repeating_timer* out)
+{
+    out->user_data = user_data;
+    return(true);
+}
+
+HOST_WEAK bool add_repeating_timer_ms(int32_t delay_ms, repeating_timer_callback_t callback, void* user_data, struct repeating_timer* out)
+{
+    return(add_repeating_timer_us((int64_t) delay_ms * 1000, callback, user_data, out));
+}
+
+HOST_WEAK alarm_id_t add_alarm_in_us(uint64_t us, alarm_callback_t callback, void* user_data, bool fire_if_past)
+{
+    return(-1);
+}
+
+HOST_WEAK alarm_id_t add_alarm_in_ms(uint32_t ms, alarm_callback_t callback, void* user_data, bool fire_if_past)
+{
+    return(add_alarm_in_us((uint64_t) ms * 1000, callback, user_data, fire_if_past));
+}
+
+HOST_WEAK bool cancel_alarm(alarm_id_t alarm_id)
+{
+    return(false);
+}
+
+HOST_WEAK void stdio_init_all(void) {}
+HOST_WEAK void gpio_init(uint gpio) {}
+HOST_WEAK void gpio_set_dir(uint gpio, bool out) {}
+HOST_WEAK void gpio_put(uint gpio, bool value) {}
+HOST_WEAK void gpio_put_masked(uint32_t mask, uint32_t value) {}
+HOST_WEAK void gpio_pull_up(uint gpio) {}
+HOST_WEAK void gpio_set_function(uint gpio, int function) {}
+HOST_WEAK void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t events, bool enabled, gpio_irq_callback_t callback) {}
+
+HOST_WEAK bool gpio_get(uint gpio)
+{
+    return(true);
+}
+
+// =================================================================================
+// pico/multicore.h
+
+HOST_WEAK void multicore_launch_core1(void (*entry)(void)) {}
+HOST_WEAK void multicore_fifo_push_blocking(uint32_t data) {}
+HOST_WEAK void multicore_fifo_drain(void) {}
+HOST_WEAK void multicore_fifo_clear_irq(void) {}
+
+HOST_WEAK bool multicore_fifo_rvalid(void)
+{
+    return(false);
+}
+
+HOST_WEAK bool multicore_fifo_wready(void)
+{
+    return(false);
+}
+
+HOST_WEAK uint32_t multicore_fifo_pop_blocking(void)
+{
+    return(0);
+}
+
+HOST_WEAK bool multicore_fifo_push_timeout_us(uint32_t data, uint64_t timeout_us)
+{
+    return(false);
+}
+
+HOST_WEAK bool multicore_fifo_pop_timeout_us(uint64_t timeout_us, uint32_t* out)
+{
+    return(false);
+}
+
+// =================================================================================
+// hardware/sync.h
+
+HOST_WEAK uint32_t save_and_disable_interrupts(void)
+{
+    return(0);
+}
+
+HOST_WEAK void restore_interrupts(uint32_t status) {}
+
+HOST_WEAK int spin_lock_claim_unused(bool required)
+{
+    if(host_spin_lock_count == HOST_SPIN_LOCKS)
+    {
+        return(-1);
+    }
+
+    host_spin_lock_count = host_spin_lock_count + 1;
+
+    return(host_spin_lock_count - 1);
+}
+
+HOST_WEAK spin_lock_t* spin_lock_instance(unsigned int lock_num)
+{
+    return(&host_spin_locks[lock_num]);
+}
+
+HOST_WEAK spin_lock_t* spin_lock_init(unsigned int lock_num)
+{
+    __atomic_store_n(&host_spin_locks[lock_num], 0, __ATOMIC_RELEASE);
+
+    return(&host_spin_locks[lock_num]);
+}
+
+HOST_WEAK uint32_t spin_lock_blocking(spin_lock_t* lock)
+{
+    while(__atomic_exchange_n(lock, 1, __ATOMIC_ACQUIRE) != 0)
+    {
+        sched_yield();
+    }
+
+    return(0);
+}
+
+HOST_WEAK void spin_unlock(spin_lock_t* lock, uint32_t saved_irq)
+{
+    __atomic_store_n(lock, 0, __ATOMIC_RELEASE);
+}
+
+HOST_WEAK unsigned int get_core_num(void)
+{
+    return(host_core);
+}
+
+// =================================================================================
+// hardware/irq.h
+
+HOST_WEAK void irq_set_exclusive_handler(uint irq, irq_handler_t handler)
+{
+    host_irq_handlers[irq][0] = handler;
+}
+
+HOST_WEAK void irq_add_shared_handler(uint irq, irq_handler_t handler, uint8_t order_priority)
+{
+    uint8_t counter = 0;
+
+    while((counter != HOST_SHARED_HANDLERS) && (host_irq_handlers[irq][counter] != NULL))
+    {
+        counter = counter + 1;
+    }
+
+    if(counter != HOST_SHARED_HANDLERS)
+    {
+        host_irq_handlers[irq][counter] = handler;
+    }
+}
+
+HOST_WEAK void irq_set_enabled(uint irq, bool enabled) {}
+HOST_WEAK void irq_set_priority(uint irq, uint8_t priority) {}
+
+HOST_WEAK void irq_set_pending(uint irq)
+{
+    host_irq(irq);
+}
+
+// =================================================================================
+// hardware/uart.h
+
+HOST_WEAK uint uart_init(uart_inst_t* uart, uint baudrate)
+{
+    return(baudrate);
+}
+
+HOST_WEAK uint uart_get_index(uart_inst_t* uart)
+{
+    return(uart->index);
+}
+
+HOST_WEAK uart_hw_t* uart_get_hw(uart_inst_t* uart)
+{
+    return(&host_uart_hw[uart->index]);
+}
+
+HOST_WEAK uint uart_get_dreq(uart_inst_t* uart, bool is_tx)
+{
+    return(0);
+}
+
+HOST_WEAK void uart_set_hw_flow(uart_inst_t* uart, bool cts, bool rts) {}
+HOST_WEAK void uart_set_fifo_enabled(uart_inst_t* uart, bool enabled) {}
+HOST_WEAK void uart_set_irq_enables(uart_inst_t* uart, bool rx_has_data, bool tx_needs_data) {}
+HOST_WEAK void uart_tx_wait_blocking(uart_inst_t* uart) {}
+
+HOST_WEAK bool uart_is_readable(uart_inst_t* uart)
+{
+    return(false);
+}
+
+HOST_WEAK bool uart_is_writable(uart_inst_t* uart)
+{
+    return(true);
+}
+
+HOST_WEAK char uart_getc(uart_inst_t* uart)
+{
+    return(0);
+}
+
+HOST_WEAK void uart_putc_raw(uart_inst_t* uart, char c) {}
+
+HOST_WEAK void uart_putc(uart_inst_t* uart, char c)
+{
+    uart_putc_raw(uart, c);
+}
+
+HOST_WEAK void uart_puts(uart_inst_t* uart, const char* s)
+{
+    while(*s != 0)
+    {
+        uart_putc(uart, *s);
+        s = s + 1;
+    }
+}
+
+HOST_WEAK void uart_write_blocking(uart_inst_t* uart, const uint8_t* src, size_t len)
+{
+    while(len != 0)
+    {
+        uart_putc_raw(uart, *src);
+        src = src + 1;
+        len = len - 1;
+    }
+}
+
+// =================================================================================
+// hardware/clocks.h
+
+HOST_WEAK uint32_t clock_get_hz(int clock)
+{
+    return(125000000);
+}
+
+// =================================================================================
+// hardware/pio.h
+
+HOST_WEAK uint pio_get_index(PIO pio)
+{
+    return(pio == pio1 ? 1 : 0);
+}
+
+HOST_WEAK uint pio_get_dreq(PIO pio, uint sm, bool is_tx)
+{
+    return((pio_get_index(pio) * 8) + sm + (is_tx ? 0 : 4));
+}
+
+HOST_WEAK bool pio_can_add_program(PIO pio, const pio_program_t* program)
+{
+    return((host_pio_offsets[pio_get_index(pio)] + program->length) <= 32);
+}
+
+HOST_WEAK uint pio_add_program(PIO pio, const pio_program_t* program)
+{
+    uint    offset = host_pio_offsets[pio_get_index(pio)];
+
+    host_pio_offsets[pio_get_index(pio)] = offset + program->length;
+
+    return(offset);
+}
+
+HOST_WEAK int pio_claim_unused_sm(PIO pio, bool required)
+{
+    uint8_t*    used = &host_pio_sms[pio_get_index(pio)];
+    int         sm = 0;
+
+    while((sm != HOST_PIO_SMS) && ((*used & (1u << sm)) != 0))
+    {
+        sm = sm + 1;
+    }
+
+    if(sm == HOST_PIO_SMS)
+    {
+        return(-1);
+    }
+
+    *used = *used | (1u << sm);
+
+    return(sm);
+}
+
+HOST_WEAK void pio_sm_claim(PIO pio, uint sm)
+{
+    host_pio_sms[pio_get_index(pio)] = host_pio_sms[pio_get_index(pio)] | (1u << sm);
+}
+
+HOST_WEAK void pio_sm_unclaim(PIO pio, uint sm)
+{
+    host_pio_sms[pio_get_index(pio)] = host_pio_sms[pio_get_index(pio)] & ~(1u << sm);
+}
+
+HOST_WEAK void pio_gpio_init(PIO pio, uint pin) {}
+HOST_WEAK void pio_sm_init(PIO pio, uint sm, uint initial_pc, const pio_sm_config* config) {}
+HOST_WEAK void pio_sm_set_enabled(PIO pio, uint sm, bool enabled) {}
+HOST_WEAK void pio_sm_set_consecutive_pindirs(PIO pio, uint sm, uint pin_base, uint pin_count, bool is_out) {}
+HOST_WEAK void pio_sm_clear_fifos(PIO pio, uint sm) {}
+HOST_WEAK void pio_sm_restart(PIO pio, uint sm) {}
+
+HOST_WEAK void pio_sm_put(PIO pio, uint sm, uint32_t data)
+{
+    pio->txf[sm] = data;
+}
+
+HOST_WEAK void pio_sm_put_blocking(PIO pio, uint sm, uint32_t data)
+{
+    pio_sm_put(pio, sm, data);
+}
+
+HOST_WEAK bool pio_sm_is_tx_fifo_full(PIO pio, uint sm)
+{
+    return(false);
+}
+
+HOST_WEAK bool pio_sm_is_tx_fifo_empty(PIO pio, uint sm)
+{
+    return(true);
+}
+
+HOST_WEAK void ws2812_program_init(PIO pio, uint sm, uint offset, uint pin, float freq, bool rgbw) {}
+HOST_WEAK void ws2812_parallel_program_init(PIO pio, uint sm, uint offset, uint pin_base, uint pin_count, float freq) {}
+
+// =================================================================================
+// hardware/dma.h
+
+HOST_WEAK int dma_claim_unused_channel(bool required)
+{
+    if(host_dma_count == HOST_DMA_CHANNELS)
+    {
+        return(-1);
+    }
+
+    host_dma_count = host_dma_count + 1;
+
+    return(host_dma_count - 1);
+}
+
+HOST_WEAK void dma_channel_unclaim(uint channel) {}
+
+HOST_WEAK dma_channel_config dma_channel_get_default_config(uint channel)
+{
+    dma_channel_config config = {0};
+
+    return(config);
+}
+
+HOST_WEAK void channel_config_set_transfer_data_size(dma_channel_config* config, dma_channel_transfer_size_t size) {}
+HOST_WEAK void channel_config_set_read_increment(dma_channel_config* config, bool increment) {}
+HOST_WEAK void channel_config_set_write_increment(dma_channel_config* config, bool increment) {}
+HOST_WEAK void channel_config_set_dreq(dma_channel_config* config, uint dreq) {}
+HOST_WEAK void channel_config_set_ring(dma_channel_config* config, bool write, uint size_bits) {}
+HOST_WEAK void channel_config_set_chain_to(dma_channel_config* config, uint chain_to) {}
+HOST_WEAK void channel_config_set_irq_quiet(dma_channel_config* config, bool irq_quiet) {}
+
+HOST_WEAK void dma_channel_configure(uint channel, const dma_channel_config* config, volatile void* write_addr, const volatile void* read_addr, uint transfer_count, bool trigger)
+{
+    dma_hw->ch[channel].transfer_count = transfer_count;
+}
+
+HOST_WEAK void dma_channel_set_read_addr(uint channel, const volatile void* read_addr, bool trigger) {}
+
+HOST_WEAK void dma_channel_set_trans_count(uint channel, uint32_t trans_count, bool trigger)
+{
+    dma_hw->ch[channel].transfer_count = trans_count;
+}
+
+HOST_WEAK void dma_channel_set_irq0_enabled(uint channel, bool enabled) {}
+HOST_WEAK void dma_channel_acknowledge_irq0(uint channel) {}
+HOST_WEAK void dma_channel_abort(uint channel) {}
+
+HOST_WEAK bool dma_channel_get_irq0_status(uint channel)
+{
+    return(false);
+}
+
+HOST_WEAK bool dma_channel_is_busy(uint channel)
+{
+    return(false);
+}
+
+// =================================================================================
+// pico-utils/ws2812.h
+
+HOST_WEAK void put_pixel(uint32_t pixel_grb) {}
+
+HOST_WEAK uint32_t urgb_u32(uint8_t r, uint8_t g, uint8_t b)
+{
+    return(((uint32_t) r << 8) | ((uint32_t) g << 16) | (uint32_t) b);
+}
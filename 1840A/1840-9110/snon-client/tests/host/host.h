@@ -0,0 +1,35 @@
+// ---------------------------------------------------------------------------------
+// Host build of the Pico SDK - Test controls
+// ---------------------------------------------------------------------------------
+// Lets a test drive what the hardware would: the clock, which core a thread is,
+// and interrupts
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+
+#pragma once
+#ifndef HOST_H
+#define HOST_H
+
+#include "pico/stdlib.h"
+
+// Checks a condition, and fails the test with the location if it doesn't hold
+#define HOST_CHECK(condition)   host_check((condition), #condition, __FILE__, __LINE__)
+
+// Clock. The clock follows the host's monotonic clock until a test sets it, and
+// from then on only moves when the test (or sleep_ms()) moves it.
+void host_clock_set(uint64_t us);
+void host_clock_advance(uint64_t us);
+uint64_t host_clock_now_us(void);
+
+// Cores and interrupts
+void host_set_core(unsigned int core);
+void host_irq(uint irq);
+
+// Results
+void host_check(bool condition, const char* text, const char* file, int line);
+int host_result(void);
+
+#endif // HOST_H
@@ -0,0 +1,22 @@
+// ---------------------------------------------------------------------------------
+// Host build of the Pico SDK - pico-utils/ws2812.h
+// ---------------------------------------------------------------------------------
+// Colours are packed the way pico-utils packs them for the GRB strips
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+
+#pragma once
+#ifndef HOST_PICO_UTILS_WS2812_H
+#define HOST_PICO_UTILS_WS2812_H
+
+#include "pico/stdlib.h"
+#include "hardware/pio.h"
+#include "ws2812.pio.h"
+
+void put_pixel(uint32_t pixel_grb);
+uint32_t urgb_u32(uint8_t r, uint8_t g, uint8_t b);
+
+#endif // HOST_PICO_UTILS_WS2812_H
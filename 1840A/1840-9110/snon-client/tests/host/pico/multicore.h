@@ -0,0 +1,28 @@
+// ---------------------------------------------------------------------------------
+// Host build of the Pico SDK - pico/multicore.h
+// ---------------------------------------------------------------------------------
+// There is no core 1 on the host. The FIFO is always full, so senders take their
+// overflow paths, unless a test defines the functions itself.
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+
+#pragma once
+#ifndef HOST_PICO_MULTICORE_H
+#define HOST_PICO_MULTICORE_H
+
+#include "pico/stdlib.h"
+
+void multicore_launch_core1(void (*entry)(void));
+bool multicore_fifo_rvalid(void);
+bool multicore_fifo_wready(void);
+void multicore_fifo_push_blocking(uint32_t data);
+uint32_t multicore_fifo_pop_blocking(void);
+bool multicore_fifo_push_timeout_us(uint32_t data, uint64_t timeout_us);
+bool multicore_fifo_pop_timeout_us(uint64_t timeout_us, uint32_t* out);
+void multicore_fifo_drain(void);
+void multicore_fifo_clear_irq(void);
+
+#endif // HOST_PICO_MULTICORE_H
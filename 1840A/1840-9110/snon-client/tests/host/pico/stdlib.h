@@ -0,0 +1,74 @@
+// ---------------------------------------------------------------------------------
+// Host build of the Pico SDK - pico/stdlib.h
+// ---------------------------------------------------------------------------------
+// Just enough of the SDK for the panel modules under test to build on the host.
+// The functions are defined weakly in host.c, so a test can replace any of them.
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+
+#pragma once
+#ifndef HOST_PICO_STDLIB_H
+#define HOST_PICO_STDLIB_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef unsigned int uint;
+
+// Constants
+#define GPIO_OUT                0
+#define GPIO_IN                 1
+#define GPIO_FUNC_UART          2
+#define GPIO_FUNC_I2C           3
+#define GPIO_IRQ_EDGE_FALL      4
+#define PICO_ERROR_NONE         0
+#define PICO_ERROR_TIMEOUT      -1
+
+#define __not_in_flash_func(x)      x
+#define __time_critical_func(x)     x
+
+// Types
+typedef struct repeating_timer
+{
+    void*   user_data;
+} repeating_timer_t;
+
+typedef bool (*repeating_timer_callback_t)(struct repeating_timer* timer);
+typedef int32_t alarm_id_t;
+typedef int64_t (*alarm_callback_t)(alarm_id_t id, void* user_data);
+typedef void (*gpio_irq_callback_t)(uint gpio, uint32_t event_mask);
+
+// Time
+uint32_t time_us_32(void);
+uint64_t time_us_64(void);
+void sleep_ms(uint32_t ms);
+void sleep_us(uint64_t us);
+void busy_wait_us(uint64_t us);
+void busy_wait_us_32(uint32_t us);
+bool add_repeating_timer_ms(int32_t delay_ms, repeating_timer_callback_t callback, void* user_data, struct repeating_timer* out);
+bool add_repeating_timer_us(int64_t delay_us, repeating_timer_callback_t callback, void* user_data, struct repeating_timer* out);
+alarm_id_t add_alarm_in_us(uint64_t us, alarm_callback_t callback, void* user_data, bool fire_if_past);
+alarm_id_t add_alarm_in_ms(uint32_t ms, alarm_callback_t callback, void* user_data, bool fire_if_past);
+bool cancel_alarm(alarm_id_t alarm_id);
+static inline void tight_loop_contents(void) {}
+
+// Stdio and GPIO
+void stdio_init_all(void);
+void gpio_init(uint gpio);
+void gpio_set_dir(uint gpio, bool out);
+void gpio_put(uint gpio, bool value);
+void gpio_put_masked(uint32_t mask, uint32_t value);
+bool gpio_get(uint gpio);
+void gpio_pull_up(uint gpio);
+void gpio_set_function(uint gpio, int function);
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t events, bool enabled, gpio_irq_callback_t callback);
+
+#include "hardware/sync.h"
+#include "hardware/uart.h"
+#include "hardware/gpio.h"
+
+#endif // HOST_PICO_STDLIB_H
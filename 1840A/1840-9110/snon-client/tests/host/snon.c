@@ -0,0 +1,274 @@
+// ---------------------------------------------------------------------------------
+// Host build of snon_utils
+// ---------------------------------------------------------------------------------
+// A small in-memory SNON store with the same calls as snon_utils. Entities are
+// found by name or by eID, and values are kept as the JSON array text they were
+// set with. "Entities" lists the eID of every entity, in the order they were
+// registered. Every function is weak, so a test can replace one.
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "snon/snon_utils.h"
+
+#define HOST_WEAK   __attribute__((weak))
+
+// Constants
+#define SNON_HOST_ENTITIES      512
+#define SNON_HOST_NAME_LENGTH   64
+#define SNON_HOST_VALUES_LENGTH 512
+
+// Types
+typedef struct
+{
+    char    name[SNON_HOST_NAME_LENGTH];
+    char    eid[SNON_URN_LENGTH];
+    char    values[SNON_HOST_VALUES_LENGTH];
+    char    first[SNON_HOST_VALUES_LENGTH];     // First value, without quotes
+} snon_host_entity_t;
+
+// Global variables
+static snon_host_entity_t   snon_host_entities[SNON_HOST_ENTITIES];
+static uint16_t             snon_host_count = 0;
+
+// Private prototypes
+snon_host_entity_t* snon_host_find(const char* name);
+void snon_host_store(snon_host_entity_t* entity, const char* values);
+char* snon_host_list(void);
+
+// =================================================================================
+
+// Entities are found by name or eID, as the real store does
+snon_host_entity_t* snon_host_find(const char* name)
+{
+    uint16_t    counter = 0;
+
+    while(counter != snon_host_count)
+    {
+        if((strcmp(snon_host_entities[counter].name, name) == 0) || (strcmp(snon_host_entities[counter].eid, name) == 0))
+        {
+            return(&snon_host_entities[counter]);
+        }
+
+        counter = counter + 1;
+    }
+
+    return(NULL);
+}
+
+void snon_host_store(snon_host_entity_t* entity, const char* values)
+{
+    const char* start = NULL;
+    size_t      length = 0;
+
+    snprintf(entity->values, SNON_HOST_VALUES_LENGTH, "%s", values);
+
+    // First element of the array, as snon_get_value() returns it
+    start = strchr(values, '[');
+    start = (start == NULL) ? values : start + 1;
+
+    while((*start == ' ') || (*start == '"'))
+    {
+        start = start + 1;
+    }
+
+    length = strcspn(start, "\",]");
+
+    if(length >= SNON_HOST_VALUES_LENGTH)
+    {
+        length = SNON_HOST_VALUES_LENGTH - 1;
+    }
+
+    memcpy(entity->first, start, length);
+    entity->first[length] = 0;
+}
+
+// The "Entities" values, a JSON array of every eID
+char* snon_host_list(void)
+{
+    char*       list = malloc((snon_host_count * (SNON_URN_LENGTH + 3)) + 3);
+    size_t      length = 0;
+    uint16_t    counter = 0;
+
+    length = length + sprintf(&list[length], "[");
+
+    while(counter != snon_host_count)
+    {
+        length = length + sprintf(&list[length], "%s\"%s\"", (counter == 0) ? "" : ",", snon_host_entities[counter].eid);
+        counter = counter + 1;
+    }
+
+    sprintf(&list[length], "]");
+
+    return(list);
+}
+
+// =================================================================================
+
+HOST_WEAK void snon_initialize(char* device_name)
+{
+    snon_host_count = 0;
+    snon_register(device_name, SNON_CLASS_DEVICE, NULL);
+}
+
+// eIDs are derived from the name, so they are stable from run to run
+HOST_WEAK void snon_name_to_eid(char* name, char* eid)
+{
+    uint32_t    hash = 2166136261u;
+    const char* next = name;
+
+    while(*next != 0)
+    {
+        hash = (hash ^ (uint8_t) *next) * 16777619u;
+        next = next + 1;
+    }
+
+    snprintf(eid, SNON_URN_LENGTH, "urn:uuid:%08X-0000-5000-8000-%012X", hash, (unsigned int) strlen(name));
+}
+
+HOST_WEAK bool snon_register(char* name, uint8_t snon_class, char* values)
+{
+    snon_host_entity_t* entity = snon_host_find(name);
+
+    if(entity == NULL)
+    {
+        if(snon_host_count == SNON_HOST_ENTITIES)
+        {
+            return(false);
+        }
+
+        entity = &snon_host_entities[snon_host_count];
+        snprintf(entity->name, SNON_HOST_NAME_LENGTH, "%s", name);
+        snon_name_to_eid(name, entity->eid);
+        snon_host_count = snon_host_count + 1;
+    }
+
+    snon_host_store(entity, (values != NULL) ? values : "[]");
+
+    return(true);
+}
+
+HOST_WEAK bool snon_register_81346(char* name, uint8_t snon_class, char* values)
+{
+    return(snon_register(name, snon_class, values));
+}
+
+HOST_WEAK bool snon_add_relationship(char* name, uint8_t relationship, char* other)
+{
+    return(true);
+}
+
+HOST_WEAK bool snon_set_values(char* name, char* values)
+{
+    snon_host_entity_t* entity = snon_host_find(name);
+
+    if((entity == NULL) || (values == NULL) || (values[0] != '['))
+    {
+        return(false);
+    }
+
+    snon_host_store(entity, values);
+
+    return(true);
+}
+
+HOST_WEAK bool snon_set_value(char* name, char* value)
+{
+    char    values[SNON_HOST_VALUES_LENGTH];
+
+    snprintf(values, SNON_HOST_VALUES_LENGTH, "[\"%s\"]", value);
+
+    return(snon_set_values(name, values));
+}
+
+HOST_WEAK char* snon_get_value(char* name)
+{
+    snon_host_entity_t* entity = snon_host_find(name);
+
+    if(entity == NULL)
+    {
+        return(NULL);
+    }
+
+    return(entity->first);
+}
+
+HOST_WEAK double snon_get_value_as_double(char* name)
+{
+    char*   value = snon_get_value(name);
+
+    return((value != NULL) ? atof(value) : 0);
+}
+
+HOST_WEAK char* snon_get_values(char* name)
+{
+    snon_host_entity_t* entity = snon_host_find(name);
+
+    if(strcmp(name, "Entities") == 0)
+    {
+        return(snon_host_list());
+    }
+
+    if(entity == NULL)
+    {
+        return(NULL);
+    }
+
+    return(strdup(entity->values));
+}
+
+HOST_WEAK char* snon_get_name(char* eid)
+{
+    snon_host_entity_t* entity = snon_host_find(eid);
+
+    if(entity == NULL)
+    {
+        return(NULL);
+    }
+
+    return(entity->name);
+}
+
+HOST_WEAK char* snon_get_json(char* eid)
+{
+    snon_host_entity_t* entity = snon_host_find(eid);
+    char*               json = NULL;
+    size_t              length = 0;
+
+    if(entity == NULL)
+    {
+        return(NULL);
+    }
+
+    length = strlen(entity->eid) + strlen(entity->name) + strlen(entity->values) + 32;
+    json = malloc(length);
+    snprintf(json, length, "{\"eID\":\"%s\",\"name\":\"%s\",\"v\":%s}", entity->eid, entity->name, entity->values);
+
+    return(json);
+}
+
+HOST_WEAK char* snon_get_dump(void)
+{
+    return(strdup("[]"));
+}
+
+HOST_WEAK char* snon_get_time(char* eid)
+{
+    return(NULL);
+}
+
+HOST_WEAK bool rtc_counter_to_iso8601(char* buffer, uint64_t counter)
+{
+    strcpy(buffer, "1970-01-01T00:00:00Z");
+    return(true);
+}
+
+HOST_WEAK bool rtc_set_time(char* time)
+{
+    return(true);
+}
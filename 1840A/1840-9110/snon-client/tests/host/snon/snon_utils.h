@@ -0,0 +1,53 @@
+// ---------------------------------------------------------------------------------
+// Host build of snon_utils - Header
+// ---------------------------------------------------------------------------------
+// The calls the panel modules make into the SNON store. host/snon.c keeps a small
+// in-memory store behind them, which a test can replace function by function.
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+
+#pragma once
+#ifndef HOST_SNON_UTILS_H
+#define HOST_SNON_UTILS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Constants
+#define SNON_URN_LENGTH         46
+
+#define SNON_CLASS_MEASURAND    1
+#define SNON_CLASS_SENSOR       2
+#define SNON_CLASS_SERIES       3
+#define SNON_CLASS_VALUE        4
+#define SNON_CLASS_DEVICE       5
+
+#define SNON_REL_CHILD_OF       1
+#define SNON_REL_MEASURAND      2
+#define SNON_REL_VALUES         3
+#define SNON_REL_SETPOINT       4
+#define SNON_REL_ALARMS         5
+
+void snon_initialize(char* device_name);
+bool snon_register(char* name, uint8_t snon_class, char* values);
+bool snon_register_81346(char* name, uint8_t snon_class, char* values);
+bool snon_add_relationship(char* name, uint8_t relationship, char* other);
+bool snon_set_value(char* name, char* value);
+bool snon_set_values(char* name, char* values);
+char* snon_get_value(char* name);
+double snon_get_value_as_double(char* name);
+char* snon_get_values(char* name);
+char* snon_get_json(char* eid);
+char* snon_get_dump(void);
+char* snon_get_name(char* eid);
+char* snon_get_time(char* eid);
+void snon_name_to_eid(char* name, char* eid);
+bool json_has_eid(const char* json, char* eid);
+bool json_has_value(const char* json, char* values);
+bool rtc_counter_to_iso8601(char* buffer, uint64_t counter);
+bool rtc_set_time(char* time);
+
+#endif // HOST_SNON_UTILS_H
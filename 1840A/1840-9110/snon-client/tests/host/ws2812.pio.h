@@ -0,0 +1,23 @@
+// ---------------------------------------------------------------------------------
+// Host build of the Pico SDK - ws2812.pio.h
+// ---------------------------------------------------------------------------------
+// Stands in for the header pioasm generates from ws2812.pio
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+
+#pragma once
+#ifndef HOST_WS2812_PIO_H
+#define HOST_WS2812_PIO_H
+
+#include "hardware/pio.h"
+
+extern const pio_program_t ws2812_program;
+extern const pio_program_t ws2812_parallel_program;
+
+void ws2812_program_init(PIO pio, uint sm, uint offset, uint pin, float freq, bool rgbw);
+void ws2812_parallel_program_init(PIO pio, uint sm, uint offset, uint pin_base, uint pin_count, float freq);
+
+#endif // HOST_WS2812_PIO_H
@@ -0,0 +1,391 @@
+// ---------------------------------------------------------------------------------
+// Host test - json_tok against the client JSON parser
+// ---------------------------------------------------------------------------------
+// Both sides are written out in one canonical form: no whitespace, strings decoded
+// the way json.cpp decodes them, and primitives exactly as they were sent
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "json.h"
+#include "json_tok_compare.h"
+
+// Private prototypes
+static bool compare_domain(const std::string& input);
+static void canonical_string(const std::string& text, std::string& canonical);
+static std::string decode_slice(const std::string& input, const json_tok_t& token);
+static int16_t canonical_tokens(const std::string& input, const json_tok_t* tokens, int16_t token, int depth, std::string& canonical, int& depth_max, bool& primitives_valid);
+static void canonical_value(const snon::json_value& value, std::string& canonical);
+static bool primitive_valid(const std::string& text);
+
+// =================================================================================
+
+// Printable ASCII, and line breaks between values, with every \u followed by four
+// hex digits, and no escapes that JSON doesn't have
+static bool compare_domain(const std::string& input)
+{
+    size_t  position = 0;
+    bool    in_string = false;
+
+    if(input.length() > 60000)
+    {
+        return(false);
+    }
+
+    while(position < input.length())
+    {
+        unsigned char   character = (unsigned char) input[position];
+
+        if(((character < 0x20) && ((in_string == true) || ((character != '\r') && (character != '\n')))) || (character > 0x7E))
+        {
+            return(false);
+        }
+
+        if(character == '"')
+        {
+            in_string = !in_string;
+        }
+
+        if(character == '\\')
+        {
+            if((position + 1 >= input.length()) || (strchr("\"\\/bfnrtu", input[position + 1]) == NULL))
+            {
+                return(false);
+            }
+
+            if(input[position + 1] == 'u')
+            {
+                if((position + 6 > input.length()) || (input.find_first_not_of("0123456789abcdefABCDEF", position + 2) < position + 6))
+                {
+                    return(false);
+                }
+            }
+
+            position = position + 1;
+        }
+
+        position = position + 1;
+    }
+
+    return(true);
+}
+
+static void canonical_string(const std::string& text, std::string& canonical)
+{
+    canonical.push_back('"');
+
+    for(char character : text)
+    {
+        if((character == '"') || (character == '\\'))
+        {
+            canonical.push_back('\\');
+        }
+
+        canonical.push_back(character);
+    }
+
+    canonical.push_back('"');
+}
+
+// Decodes escapes as json.cpp does: \n, \r, \t and ASCII \u escapes, and the
+// escaped character itself for the rest
+static std::string decode_slice(const std::string& input, const json_tok_t& token)
+{
+    std::string text;
+    size_t      position = token.start;
+
+    while(position < token.end)
+    {
+        char    character = input[position];
+
+        position = position + 1;
+
+        if((character == '\\') && (position < token.end))
+        {
+            character = input[position];
+            position = position + 1;
+
+            if(character == 'n')
+            {
+                text.push_back('\n');
+            }
+            else if(character == 'r')
+            {
+                text.push_back('\r');
+            }
+            else if(character == 't')
+            {
+                text.push_back('\t');
+            }
+            else if(character == 'u')
+            {
+                unsigned int    code = 0;
+
+                if((sscanf(input.c_str() + position, "%4x", &code) == 1) && (code < 0x80))
+                {
+                    text.push_back((char) code);
+                }
+                else
+                {
+                    text.append(input, position - 2, 6);
+                }
+
+                position = position + 4;
+            }
+            else
+            {
+                text.push_back(character);
+            }
+        }
+        else
+        {
+            text.push_back(character);
+        }
+    }
+
+    return(text);
+}
+
+// Returns the token after the value written out
+static int16_t canonical_tokens(const std::string& input, const json_tok_t* tokens, int16_t token, int depth, std::string& canonical, int& depth_max, bool& primitives_valid)
+{
+    const json_tok_t&   value = tokens[token];
+    uint16_t            member = 0;
+
+    if(depth > depth_max)
+    {
+        depth_max = depth;
+    }
+
+    token = token + 1;
+
+    if(value.type == JSON_TOK_OBJECT)
+    {
+        canonical.push_back('{');
+
+        while(member != value.size)
+        {
+            if(member != 0)
+            {
+                canonical.push_back(',');
+            }
+
+            // Keys hold their value as their only child
+            canonical_string(decode_slice(input, tokens[token]), canonical);
+            canonical.push_back(':');
+            token = canonical_tokens(input, tokens, token + 1, depth + 1, canonical, depth_max, primitives_valid);
+            member = member + 1;
+        }
+
+        canonical.push_back('}');
+    }
+    else if(value.type == JSON_TOK_ARRAY)
+    {
+        canonical.push_back('[');
+
+        while(member != value.size)
+        {
+            if(member != 0)
+            {
+                canonical.push_back(',');
+            }
+
+            token = canonical_tokens(input, tokens, token, depth + 1, canonical, depth_max, primitives_valid);
+            member = member + 1;
+        }
+
+        canonical.push_back(']');
+    }
+    else if(value.type == JSON_TOK_STRING)
+    {
+        canonical_string(decode_slice(input, value), canonical);
+    }
+    else
+    {
+        std::string text = input.substr(value.start, value.end - value.start);
+
+        if(primitive_valid(text) == false)
+        {
+            primitives_valid = false;
+        }
+
+        canonical.append(text);
+    }
+
+    return(token);
+}
+
+static void canonical_value(const snon::json_value& value, std::string& canonical)
+{
+    size_t  counter = 0;
+
+    if(value.type == snon::json_value::JSON_OBJECT)
+    {
+        canonical.push_back('{');
+
+        for(counter = 0; counter != value.members.size(); counter++)
+        {
+            if(counter != 0)
+            {
+                canonical.push_back(',');
+            }
+
+            canonical_string(value.members[counter].first, canonical);
+            canonical.push_back(':');
+            canonical_value(value.members[counter].second, canonical);
+        }
+
+        canonical.push_back('}');
+    }
+    else if(value.type == snon::json_value::JSON_ARRAY)
+    {
+        canonical.push_back('[');
+
+        for(counter = 0; counter != value.items.size(); counter++)
+        {
+            if(counter != 0)
+            {
+                canonical.push_back(',');
+            }
+
+            canonical_value(value.items[counter], canonical);
+        }
+
+        canonical.push_back(']');
+    }
+    else if(value.type == snon::json_value::JSON_STRING)
+    {
+        canonical_string(value.text, canonical);
+    }
+    else
+    {
+        canonical.append(value.text);
+    }
+}
+
+// The primitives json.cpp accepts
+static bool primitive_valid(const std::string& text)
+{
+    if((text == "null") || (text == "true") || (text == "false"))
+    {
+        return(true);
+    }
+
+    return((text.length() != 0) && (text.find_first_not_of("0123456789+-.eE") == std::string::npos));
+}
+
+// =================================================================================
+
+bool json_compare_tokens(const std::string& input, std::string& canonical)
+{
+    std::vector<json_tok_t> tokens(JSON_COMPARE_TOKENS);
+    int16_t                 count = 0;
+    int                     depth_max = 0;
+    bool                    primitives_valid = true;
+
+    canonical.clear();
+
+    if(input.length() > 0xFFFF)
+    {
+        return(false);
+    }
+
+    count = json_tok_parse(input.c_str(), (uint16_t) input.length(), tokens.data(), JSON_COMPARE_TOKENS);
+    if(count <= 0)
+    {
+        return(false);
+    }
+
+    canonical_tokens(input, tokens.data(), 0, 0, canonical, depth_max, primitives_valid);
+
+    return(true);
+}
+
+json_compare_t json_compare(const std::string& input, std::string* detail)
+{
+    std::vector<json_tok_t> tokens(JSON_COMPARE_TOKENS);
+    snon::json_value        value;
+    std::string             from_tokens;
+    std::string             from_value;
+    int16_t                 count = 0;
+    int                     depth_max = 0;
+    bool                    primitives_valid = true;
+    bool                    parsed = false;
+
+    if(input.length() > 0xFFFF)
+    {
+        return(JSON_COMPARE_SKIPPED);
+    }
+
+    // Always tokenized, so the fuzzer reaches json_tok with anything
+    count = json_tok_parse(input.c_str(), (uint16_t) input.length(), tokens.data(), JSON_COMPARE_TOKENS);
+
+    if((compare_domain(input) == false) || (count == JSON_TOK_ERROR_NOMEM))
+    {
+        return(JSON_COMPARE_SKIPPED);
+    }
+
+    if(count > 0)
+    {
+        // The tokens must describe one value that covers the whole document
+        if(canonical_tokens(input, tokens.data(), 0, 0, from_tokens, depth_max, primitives_valid) != count)
+        {
+            if(detail != NULL)
+            {
+                *detail = "json_tok left tokens outside the first value";
+            }
+
+            return(JSON_COMPARE_DIFFERENT);
+        }
+    }
+
+    parsed = snon::json_parse(input, value);
+
+    if((count > 0) && (parsed == false))
+    {
+        // json_tok leaves checking primitives to the store, and goes deeper
+        if((primitives_valid == false) || (depth_max > JSON_COMPARE_DEPTH_MAX))
+        {
+            return(JSON_COMPARE_SKIPPED);
+        }
+
+        if(detail != NULL)
+        {
+            *detail = "json_tok accepted, json.cpp refused";
+        }
+
+        return(JSON_COMPARE_DIFFERENT);
+    }
+
+    if((count <= 0) && (parsed == true))
+    {
+        if(detail != NULL)
+        {
+            *detail = "json.cpp accepted, json_tok refused with " + std::to_string(count);
+        }
+
+        return(JSON_COMPARE_DIFFERENT);
+    }
+
+    if(parsed == true)
+    {
+        canonical_value(value, from_value);
+
+        if(from_tokens != from_value)
+        {
+            if(detail != NULL)
+            {
+                *detail = "json_tok " + from_tokens + ", json.cpp " + from_value;
+            }
+
+            return(JSON_COMPARE_DIFFERENT);
+        }
+    }
+
+    return(JSON_COMPARE_SAME);
+}
@@ -0,0 +1,45 @@
+// ---------------------------------------------------------------------------------
+// Host test - json_tok against the client JSON parser - Header
+// ---------------------------------------------------------------------------------
+// Tokenizes a document with the panel's json_tok and parses it with json.cpp,
+// then checks that both accept or refuse it, and that both see the same values.
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+
+#pragma once
+#ifndef JSON_TOK_COMPARE_H
+#define JSON_TOK_COMPARE_H
+
+#include <string>
+
+extern "C"
+{
+#include "json_tok.h"
+}
+
+// Constants
+#define JSON_COMPARE_TOKENS     4096
+#define JSON_COMPARE_DEPTH_MAX  16          // json.cpp refuses anything nested deeper
+
+// Types
+enum json_compare_t
+{
+    JSON_COMPARE_SAME,          // Both refused it, or both accepted the same values
+    JSON_COMPARE_SKIPPED,       // Outside what the two are meant to agree on
+    JSON_COMPARE_DIFFERENT
+};
+
+// Documents are only compared where the two are meant to agree. json_tok leaves
+// primitives and \u escapes for the store to check, json.cpp takes any escape and
+// control characters in strings, and stops at 16 levels. Neither is meant for
+// non-ASCII.
+json_compare_t json_compare(const std::string& input, std::string* detail);
+
+// The values json_tok found, written out the way json_compare() compares them.
+// Returns false if json_tok refused the document.
+bool json_compare_tokens(const std::string& input, std::string& canonical);
+
+#endif // JSON_TOK_COMPARE_H
@@ -0,0 +1,240 @@
+// ---------------------------------------------------------------------------------
+// Host test - SNON fragment generator
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+#include <cstdio>
+
+#include "json_tok_generate.h"
+
+// Constants
+static const char*  generate_characters = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789 _-=.:";
+static const char*  generate_escapes[] = {"\\\"", "\\\\", "\\/", "\\n", "\\t", "\\u0041"};
+static const char*  generate_mutations = "{}[]\":,1a \\tne.-";
+static const int    generate_depth_max = 6;
+
+// =================================================================================
+
+// xorshift32
+uint32_t json_generator::next(uint32_t limit)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+
+    return(state % limit);
+}
+
+std::string json_generator::eid(void)
+{
+    char    text[48];
+
+    snprintf(text, sizeof(text), "urn:uuid:%08X-%04X-5%03X-%04X-%08X%04X", next(0xFFFFFFFF), next(0x10000), next(0x1000),
+             0x8000 | next(0x4000), next(0xFFFFFFFF), next(0x10000));
+
+    return(text);
+}
+
+std::string json_generator::space(void)
+{
+    uint32_t    choice = next(16);
+
+    if(choice == 0)
+    {
+        return(" ");
+    }
+    else if(choice == 1)
+    {
+        return("\r\n  ");
+    }
+
+    return("");
+}
+
+std::string json_generator::string(void)
+{
+    std::string text = "\"";
+    uint32_t    length = next(24);
+
+    while(length != 0)
+    {
+        if(next(12) == 0)
+        {
+            text.append(generate_escapes[next(sizeof(generate_escapes) / sizeof(generate_escapes[0]))]);
+        }
+        else
+        {
+            text.push_back(generate_characters[next(68)]);
+        }
+
+        length = length - 1;
+    }
+
+    return(text + "\"");
+}
+
+std::string json_generator::number(void)
+{
+    char        text[32];
+    uint32_t    choice = next(4);
+
+    if(choice == 0)
+    {
+        snprintf(text, sizeof(text), "%u", next(100000));
+    }
+    else if(choice == 1)
+    {
+        snprintf(text, sizeof(text), "-%u.%02u", next(1000), next(100));
+    }
+    else if(choice == 2)
+    {
+        snprintf(text, sizeof(text), "%ue%d", next(10), (int) next(20) - 10);
+    }
+    else
+    {
+        snprintf(text, sizeof(text), "%u.%u", next(240), next(10));
+    }
+
+    return(text);
+}
+
+std::string json_generator::value(int depth)
+{
+    uint32_t    choice = next((depth < generate_depth_max) ? 7 : 5);
+    uint32_t    count = 0;
+    std::string text;
+
+    if(choice == 0)
+    {
+        return(string());
+    }
+    else if(choice == 1)
+    {
+        return(number());
+    }
+    else if(choice == 2)
+    {
+        return("true");
+    }
+    else if(choice == 3)
+    {
+        return(next(2) ? "false" : "null");
+    }
+    else if(choice == 4)
+    {
+        return("\"vita40_" + std::string(next(2) ? "amber" : "green") + "_steady\"");
+    }
+
+    count = next(5);
+    text = (choice == 5) ? "[" : "{";
+
+    for(uint32_t counter = 0; counter != count; counter++)
+    {
+        if(counter != 0)
+        {
+            text.append("," + space());
+        }
+
+        if(choice == 6)
+        {
+            text.append(string() + space() + ":" + space());
+        }
+
+        text.append(value(depth + 1));
+    }
+
+    return(text + space() + ((choice == 5) ? "]" : "}"));
+}
+
+std::string json_generator::fragment(const std::string& values)
+{
+    std::string text = "{" + space() + "\"eID\":" + space() + "\"" + eid() + "\"," + space() + "\"v\":" + values;
+
+    if(next(3) == 0)
+    {
+        text.append(",\"rID\":" + std::to_string(next(100000)));
+    }
+
+    if(next(8) == 0)
+    {
+        text.append("," + string() + ":" + value(1));
+    }
+
+    return(text + space() + "}");
+}
+
+std::string json_generator::document(void)
+{
+    uint32_t    choice = next(10);
+    uint32_t    count = 0;
+    std::string values;
+    std::string text;
+
+    if(choice == 0)
+    {
+        return(space() + value(0) + space());
+    }
+
+    if(choice < 8)
+    {
+        count = 1;
+    }
+    else
+    {
+        count = 1 + next(8);
+    }
+
+    for(uint32_t counter = 0; counter != count; counter++)
+    {
+        uint32_t    value_count = 1 + next(4);
+
+        values = "[";
+
+        for(uint32_t item = 0; item != value_count; item++)
+        {
+            values.append(((item != 0) ? "," : "") + value(2));
+        }
+
+        values.append("]");
+        text.append(((counter != 0) ? "," + space() : "") + fragment(values));
+    }
+
+    if(choice < 8)
+    {
+        return(text);
+    }
+
+    return("[" + text + "]");
+}
+
+std::string json_generator::mutate(const std::string& document)
+{
+    std::string text = document;
+    uint32_t    count = 1 + next(3);
+
+    while(count != 0)
+    {
+        uint32_t    position = next((uint32_t) text.length() + 1);
+        uint32_t    choice = next(3);
+        char        character = generate_mutations[next(16)];
+
+        if((choice == 0) || (position == text.length()))
+        {
+            text.insert(position, 1, character);
+        }
+        else if(choice == 1)
+        {
+            text.erase(position, 1);
+        }
+        else
+        {
+            text[position] = character;
+        }
+
+        count = count - 1;
+    }
+
+    return(text);
+}
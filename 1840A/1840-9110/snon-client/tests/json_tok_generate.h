@@ -0,0 +1,45 @@
+// ---------------------------------------------------------------------------------
+// Host test - SNON fragment generator - Header
+// ---------------------------------------------------------------------------------
+// Builds random SNON fragments and batches like the ones the scripts in
+// 1840A/1840-9110 send, from a fixed seed so every run sees the same documents
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+
+#pragma once
+#ifndef JSON_TOK_GENERATE_H
+#define JSON_TOK_GENERATE_H
+
+#include <cstdint>
+#include <string>
+
+class json_generator
+{
+public:
+    explicit json_generator(uint32_t seed) : state(seed) {}
+
+    // A fragment, a batch of fragments, or now and then any other JSON value
+    std::string document(void);
+
+    // A fragment setting one eID, with the values it is given
+    std::string fragment(const std::string& values);
+
+    // The document with one to three characters inserted, removed or replaced
+    std::string mutate(const std::string& document);
+
+    uint32_t next(uint32_t limit);
+
+private:
+    uint32_t    state;
+
+    std::string eid(void);
+    std::string space(void);
+    std::string string(void);
+    std::string number(void);
+    std::string value(int depth);
+};
+
+#endif // JSON_TOK_GENERATE_H
@@ -0,0 +1,543 @@
+// ---------------------------------------------------------------------------------
+// Host test - ISA-18.1 annunciator sequences
+// ---------------------------------------------------------------------------------
+// Checks the 1870A annunciator against a model written from the ISA-18.1 sequence
+// tables, for sequences A, M and R, with and without first-out. Every state the
+// model can reach is visited, and from each one every input, acknowledge and reset
+// is tried. Every sequence of a few events is also tried, and long random runs of
+// events, as the order windows are kept in depends on how they got there. After
+// each event, every window must be in the model's state, drawn with the model's
+// indicator and published over SNON.
+// Then an alarm flood checks that acknowledging and resetting only visit the
+// windows that change.
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+
+#include "annunciator.h"
+#include "indicators.h"
+#include "arena.h"
+#include "store.h"
+#include "snon/snon_utils.h"
+#include "host.h"
+
+// Constants
+#define TEST_WINDOWS        3                       // Windows in the exhaustive checks
+#define TEST_EVENTS         ((2 * TEST_WINDOWS) + 2)    // Normal and alarm for each window, acknowledge, reset
+#define TEST_ACKNOWLEDGE    (2 * TEST_WINDOWS)
+#define TEST_RESET          ((2 * TEST_WINDOWS) + 1)
+#define TEST_DEPTH          5                       // Length of the event sequences
+#define TEST_WALKS          2000                    // Random walks, for the order windows leave their lists in
+#define TEST_WALK_LENGTH    60
+#define TEST_PATH_MAX       32
+#define TEST_MODELS_MAX     (6 * 6 * 6 * (TEST_WINDOWS + 1))
+
+// Types
+
+// What ISA-18.1 says the windows should be doing
+typedef struct
+{
+    uint8_t     states[TEST_WINDOWS];
+    int8_t      first_out;                          // Window that alarmed first, or -1
+} test_model_t;
+
+// A state the model reached, and the events that got it there
+typedef struct
+{
+    test_model_t    model;
+    uint8_t         path[TEST_PATH_MAX];
+    uint8_t         length;
+} test_reached_t;
+
+// Global variables
+indicator_handle_t  test_handles[ANNUNCIATOR_MAX_COUNT];
+uint8_t             test_sequence = 0;
+bool                test_first_out = false;
+uint32_t            test_changes = 0;
+uint32_t            test_checks = 0;
+uint32_t            test_wrong = 0;
+uint8_t             test_events[TEST_DEPTH];
+test_reached_t      test_reached[TEST_MODELS_MAX];
+
+// Private prototypes
+void test_name(uint16_t window, char* name, bool input);
+void test_register(void);
+void test_start(uint16_t windows);
+void test_input(uint16_t window, bool alarm);
+void test_model_event(test_model_t* model, uint8_t event);
+uint8_t test_model_display(const test_model_t* model, uint8_t window);
+void test_event(test_model_t* model, uint8_t event);
+void test_compare(const test_model_t* model, const char* where);
+void test_states(void);
+void test_sequences(uint8_t depth);
+void test_walks(void);
+void test_flood(void);
+
+// =================================================================================
+// The console sees every window the annunciator publishes
+
+void subscribe_changed(const char* entity)
+{
+    (void) entity;
+
+    test_changes = test_changes + 1;
+}
+
+// =================================================================================
+// Windows
+
+void test_name(uint16_t window, char* name, bool input)
+{
+    sprintf(name, "=P01=PFA%02u%s", window + 1, (input == true) ? " Input" : "");
+}
+
+// Every window and input the tests use, registered once as the 1870A does
+void test_register(void)
+{
+    char        name[32];
+    uint16_t    window = 0;
+
+    snon_initialize("1870A");
+
+    while(window != ANNUNCIATOR_MAX_COUNT)
+    {
+        test_name(window, name, false);
+        snon_register(name, SNON_CLASS_VALUE, "[\"vita40_off\"]");
+
+        test_name(window, name, true);
+        snon_register(name, SNON_CLASS_VALUE, "[\"normal\"]");
+
+        window = window + 1;
+    }
+
+    // The annunciator publishes the windows to the store, as the panel does
+    arena_initialize();
+    store_initialize();
+    indicators_initialize();
+
+    for(window = 0; window != ANNUNCIATOR_MAX_COUNT; window++)
+    {
+        test_name(window, name, false);
+        test_handles[window] = indicator_register(name);
+    }
+}
+
+// Windows start normal, drawn off
+void test_start(uint16_t windows)
+{
+    char        name[32];
+    char        input[32];
+    uint16_t    window = 0;
+
+    annunciator_initialize();
+
+    while(window != windows)
+    {
+        test_name(window, name, false);
+        test_name(window, input, true);
+        indicator_set_state(test_handles[window], INDICATOR_OFF);
+        store_set_values(store_find(name), "[\"vita40_off\"]");
+        HOST_CHECK(annunciator_add_window(name, input) == true);
+        window = window + 1;
+    }
+
+    HOST_CHECK(annunciator_set_sequence(test_sequence, test_first_out) == true);
+}
+
+// Sets a process input the way the command loop does, by its eID
+void test_input(uint16_t window, bool alarm)
+{
+    char        name[32];
+    char        eid[SNON_URN_LENGTH];
+
+    test_name(window, name, true);
+    snon_name_to_eid(name, eid);
+    HOST_CHECK(annunciator_set_values(eid, (alarm == true) ? "[\"alarm\"]" : "[\"normal\"]") == true);
+}
+
+// =================================================================================
+// Model
+
+void test_model_event(test_model_t* model, uint8_t event)
+{
+    uint8_t     returned = ANNUNCIATOR_NORMAL;
+    uint8_t     window = event / 2;
+    uint8_t*    state = NULL;
+
+    // Where an acknowledged alarm goes when its process returns to normal
+    if(test_sequence == ANNUNCIATOR_SEQUENCE_M)
+    {
+        returned = ANNUNCIATOR_ACKED_CLEARED;
+    }
+    else if(test_sequence == ANNUNCIATOR_SEQUENCE_R)
+    {
+        returned = ANNUNCIATOR_RINGBACK;
+    }
+
+    if(event == TEST_ACKNOWLEDGE)
+    {
+        // Every alert is acknowledged, which ends the first-out group
+        model->first_out = -1;
+
+        for(window = 0; window != TEST_WINDOWS; window++)
+        {
+            state = &model->states[window];
+
+            if(*state == ANNUNCIATOR_ALERT)
+            {
+                *state = ANNUNCIATOR_ACKED;
+            }
+            else if(*state == ANNUNCIATOR_ALERT_CLEARED)
+            {
+                *state = returned;
+            }
+        }
+    }
+    else if(event == TEST_RESET)
+    {
+        // Only windows whose process is back to normal reset
+        for(window = 0; window != TEST_WINDOWS; window++)
+        {
+            state = &model->states[window];
+
+            if((*state == ANNUNCIATOR_ACKED_CLEARED) || (*state == ANNUNCIATOR_RINGBACK))
+            {
+                *state = ANNUNCIATOR_NORMAL;
+            }
+        }
+    }
+    else if((event % 2) == 1)
+    {
+        // Alarm. A return to alarm before acknowledging is the same alert.
+        state = &model->states[window];
+
+        if(*state == ANNUNCIATOR_ALERT_CLEARED)
+        {
+            *state = ANNUNCIATOR_ALERT;
+        }
+        else if((*state == ANNUNCIATOR_NORMAL) || (*state == ANNUNCIATOR_ACKED_CLEARED) || (*state == ANNUNCIATOR_RINGBACK))
+        {
+            if((test_first_out == true) && (model->first_out < 0))
+            {
+                model->first_out = window;
+            }
+
+            *state = ANNUNCIATOR_ALERT;
+        }
+    }
+    else
+    {
+        // Normal. An alert stays locked in until it is acknowledged.
+        state = &model->states[window];
+
+        if(*state == ANNUNCIATOR_ALERT)
+        {
+            *state = ANNUNCIATOR_ALERT_CLEARED;
+        }
+        else if(*state == ANNUNCIATOR_ACKED)
+        {
+            *state = returned;
+        }
+    }
+}
+
+// Alerts flash, acknowledged alarms are steady, and ringback flashes slowly. Under
+// first-out, only the first alert of the group flashes.
+uint8_t test_model_display(const test_model_t* model, uint8_t window)
+{
+    uint8_t     state = model->states[window];
+
+    if((state == ANNUNCIATOR_ALERT) || (state == ANNUNCIATOR_ALERT_CLEARED))
+    {
+        if((test_first_out == true) && (model->first_out != window))
+        {
+            return(INDICATOR_WHITE_STEADY);
+        }
+
+        return(INDICATOR_WHITE_FAST);
+    }
+
+    if((state == ANNUNCIATOR_ACKED) || (state == ANNUNCIATOR_ACKED_CLEARED))
+    {
+        return(INDICATOR_WHITE_STEADY);
+    }
+
+    if(state == ANNUNCIATOR_RINGBACK)
+    {
+        return(INDICATOR_AMBER_SLOW);
+    }
+
+    return(INDICATOR_OFF);
+}
+
+// =================================================================================
+
+// Applies one event to both the annunciator and the model
+void test_event(test_model_t* model, uint8_t event)
+{
+    if(event == TEST_ACKNOWLEDGE)
+    {
+        annunciator_acknowledge();
+    }
+    else if(event == TEST_RESET)
+    {
+        annunciator_reset();
+    }
+    else
+    {
+        test_input(event / 2, (event % 2) == 1);
+    }
+
+    test_model_event(model, event);
+}
+
+void test_compare(const test_model_t* model, const char* where)
+{
+    char        name[32];
+    const char* published = NULL;
+    uint16_t    unacknowledged = 0;
+    uint16_t    waiting = 0;
+    uint8_t     display = 0;
+    uint8_t     window = 0;
+    bool        wrong = false;
+
+    for(window = 0; window != TEST_WINDOWS; window++)
+    {
+        display = test_model_display(model, window);
+        test_name(window, name, false);
+        published = store_get_value(store_find(name));
+
+        if((annunciator_window_state(window) != model->states[window]) || (indicator_get_state(test_handles[window]) != display) ||
+           (published == NULL) || (strcmp(published, indicator_state_name(display)) != 0))
+        {
+            if(test_wrong < 10)
+            {
+                printf("%s, sequence %s%s: window %u is %s drawn %s, not %s drawn %s\n", where, annunciator_sequence_name(test_sequence),
+                       (test_first_out == true) ? " first-out" : "", window + 1, annunciator_state_name(annunciator_window_state(window)),
+                       indicator_state_name(indicator_get_state(test_handles[window])), annunciator_state_name(model->states[window]),
+                       indicator_state_name(display));
+            }
+
+            wrong = true;
+        }
+
+        if((model->states[window] == ANNUNCIATOR_ALERT) || (model->states[window] == ANNUNCIATOR_ALERT_CLEARED))
+        {
+            unacknowledged = unacknowledged + 1;
+        }
+
+        if((model->states[window] == ANNUNCIATOR_ACKED_CLEARED) || (model->states[window] == ANNUNCIATOR_RINGBACK))
+        {
+            waiting = waiting + 1;
+        }
+    }
+
+    if((annunciator_unacknowledged_count() != unacknowledged) || (annunciator_waiting_reset_count() != waiting))
+    {
+        wrong = true;
+    }
+
+    test_checks = test_checks + 1;
+    test_wrong = test_wrong + ((wrong == true) ? 1 : 0);
+}
+
+// Visits every state the model can reach, breadth first, and tries every event
+// from each. The annunciator is taken to each state by replaying the shortest
+// events that reach it.
+void test_states(void)
+{
+    test_model_t    model;
+    uint32_t        reached = 1;
+    uint32_t        visited = 0;
+    uint32_t        counter = 0;
+    uint8_t         event = 0;
+    uint8_t         step = 0;
+
+    memset(&test_reached[0], 0, sizeof(test_reached_t));
+    test_reached[0].model.first_out = -1;
+
+    while(visited != reached)
+    {
+        for(event = 0; event != TEST_EVENTS; event++)
+        {
+            memset(&model, 0, sizeof(model));
+            model.first_out = -1;
+            test_start(TEST_WINDOWS);
+
+            for(step = 0; step != test_reached[visited].length; step++)
+            {
+                test_event(&model, test_reached[visited].path[step]);
+            }
+
+            HOST_CHECK(memcmp(&model, &test_reached[visited].model, sizeof(test_model_t)) == 0);
+            test_event(&model, event);
+            test_compare(&model, "State");
+
+            // A new state is visited later, by way of this one
+            for(counter = 0; (counter != reached) && (memcmp(&test_reached[counter].model, &model, sizeof(test_model_t)) != 0); counter++)
+            {
+            }
+
+            if((counter == reached) && (reached != TEST_MODELS_MAX) && (test_reached[visited].length != TEST_PATH_MAX))
+            {
+                test_reached[reached] = test_reached[visited];
+                test_reached[reached].model = model;
+                test_reached[reached].path[test_reached[reached].length] = event;
+                test_reached[reached].length = test_reached[reached].length + 1;
+                reached = reached + 1;
+            }
+        }
+
+        visited = visited + 1;
+    }
+
+    printf("Sequence %s%s: %lu states reached\n", annunciator_sequence_name(test_sequence), (test_first_out == true) ? " with first-out" : "",
+           (unsigned long) reached);
+    HOST_CHECK(reached != TEST_MODELS_MAX);
+}
+
+// Every sequence of depth events, checked after each event
+void test_sequences(uint8_t depth)
+{
+    test_model_t    model;
+    uint8_t         step = 0;
+
+    if(depth != TEST_DEPTH)
+    {
+        for(test_events[depth] = 0; test_events[depth] != TEST_EVENTS; test_events[depth]++)
+        {
+            test_sequences(depth + 1);
+        }
+
+        return;
+    }
+
+    memset(&model, 0, sizeof(model));
+    model.first_out = -1;
+    test_start(TEST_WINDOWS);
+
+    for(step = 0; step != TEST_DEPTH; step++)
+    {
+        test_event(&model, test_events[step]);
+        test_compare(&model, "Sequence");
+    }
+}
+
+// Long runs of random events, which take windows out of the middle of the
+// acknowledge and reset lists in every order
+void test_walks(void)
+{
+    test_model_t    model;
+    uint32_t        walk = 0;
+    uint8_t         step = 0;
+
+    srand(test_sequence + 1);
+
+    while(walk != TEST_WALKS)
+    {
+        memset(&model, 0, sizeof(model));
+        model.first_out = -1;
+        test_start(TEST_WINDOWS);
+
+        for(step = 0; step != TEST_WALK_LENGTH; step++)
+        {
+            test_event(&model, rand() % TEST_EVENTS);
+            test_compare(&model, "Walk");
+        }
+
+        walk = walk + 1;
+    }
+}
+
+// Every window alarms at once, and is acknowledged and reset. Then a single window
+// alarms while the others are still acknowledged, and only that window is visited.
+void test_flood(void)
+{
+    const annunciator_stats_t*  stats = annunciator_get_stats();
+    uint32_t                    acknowledged = 0;
+    uint32_t                    reset = 0;
+    uint16_t                    window = 0;
+
+    test_sequence = ANNUNCIATOR_SEQUENCE_M;
+    test_first_out = true;
+    test_start(ANNUNCIATOR_MAX_COUNT);
+    test_changes = 0;
+
+    for(window = 0; window != ANNUNCIATOR_MAX_COUNT; window++)
+    {
+        test_input(window, true);
+    }
+
+    HOST_CHECK(test_changes == ANNUNCIATOR_MAX_COUNT);
+    HOST_CHECK(annunciator_unacknowledged_count() == ANNUNCIATOR_MAX_COUNT);
+    HOST_CHECK(indicator_get_state(test_handles[0]) == INDICATOR_WHITE_FAST);
+    HOST_CHECK(indicator_get_state(test_handles[1]) == INDICATOR_WHITE_STEADY);
+
+    // The first-out window stops flashing, and the others are already steady
+    test_changes = 0;
+    acknowledged = stats->acknowledged;
+    annunciator_acknowledge();
+    HOST_CHECK(stats->acknowledged - acknowledged == ANNUNCIATOR_MAX_COUNT);
+    HOST_CHECK(test_changes == 1);
+
+    // One window clears and alarms again while the rest stay acknowledged
+    test_input(7, false);
+    HOST_CHECK(annunciator_waiting_reset_count() == 1);
+    test_changes = 0;
+    reset = stats->reset;
+    annunciator_reset();
+    HOST_CHECK(stats->reset - reset == 1);
+    HOST_CHECK(test_changes == 1);
+
+    test_input(7, true);
+    HOST_CHECK(indicator_get_state(test_handles[7]) == INDICATOR_WHITE_FAST);
+    test_changes = 0;
+    acknowledged = stats->acknowledged;
+    annunciator_acknowledge();
+    HOST_CHECK(stats->acknowledged - acknowledged == 1);
+    HOST_CHECK(test_changes == 1);
+
+    // Inputs that are neither normal nor alarm are refused, and other entities
+    // are left to the indicators
+    {
+        char    eid[SNON_URN_LENGTH];
+
+        snon_name_to_eid("=P01=PFA01 Input", eid);
+        HOST_CHECK(annunciator_set_values(eid, "[\"maybe\"]") == false);
+        HOST_CHECK(stats->rejected == 1);
+        HOST_CHECK(annunciator_set_values("urn:uuid:00000000-0000-5000-8000-000000000000", "[\"alarm\"]") == true);
+        HOST_CHECK(annunciator_set_sequence(ANNUNCIATOR_SEQUENCE_COUNT, false) == false);
+    }
+}
+
+int main(void)
+{
+    uint8_t     first_out = 0;
+
+    test_register();
+
+    for(test_sequence = 0; test_sequence != ANNUNCIATOR_SEQUENCE_COUNT; test_sequence++)
+    {
+        for(first_out = 0; first_out != 2; first_out++)
+        {
+            test_first_out = (first_out == 1);
+            test_states();
+            test_sequences(0);
+            test_walks();
+        }
+    }
+
+    printf("%lu checks, %lu wrong\n", (unsigned long) test_checks, (unsigned long) test_wrong);
+    HOST_CHECK(test_wrong == 0);
+
+    test_flood();
+
+    return(host_result());
+}
@@ -0,0 +1,389 @@
+// ---------------------------------------------------------------------------------
+// Host test - Arena and value pool allocators
+// ---------------------------------------------------------------------------------
+// Runs a random workload of value_alloc() and value_free() calls against the
+// firmware's value pools, with up to twice as many values live as there are
+// blocks. An allocation may only fail when every size class that could hold it
+// is full, and must come from the smallest of those with a free block, so the
+// pools never run out while space is free and a value is never given a larger
+// block than it has to. Every free list is walked now and again and has to hold
+// exactly the blocks that aren't in use. The arenas get a random workload of
+// their own.
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+#include <stdio.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+
+#include "arena.h"
+#include "host.h"
+
+// Constants
+#define TEST_OPERATIONS     400000
+#define TEST_LIVE_MAX       1024                    // More than the pools hold between them
+#define TEST_CHECK_EVERY    1000
+#define TEST_ARENA_SIZE     1024
+#define TEST_ARENA_BLOCKS   4000
+
+// Types
+typedef struct
+{
+    char*       value;
+    uint16_t    length;
+    uint8_t     fill;
+} test_value_t;
+
+// Global variables
+test_value_t    test_live[TEST_LIVE_MAX];
+uint16_t        test_live_count = 0;
+uint32_t        test_random_state = 0x1840A;
+uint32_t        test_allocated = 0;
+uint32_t        test_refused = 0;
+uint32_t        test_moved_up = 0;              // Given a larger class, as the smallest was full
+uint64_t        test_wasted = 0;                // Bytes of the blocks handed out that the values didn't need
+uint64_t        test_handed_out = 0;
+
+// Private prototypes
+uint32_t test_random(void);
+uint16_t test_length(void);
+int8_t test_pool_of(const char* value);
+void test_alloc(void);
+void test_free(uint16_t index);
+void test_check_pools(void);
+void test_pools(void);
+void test_arena(void);
+
+// =================================================================================
+
+// xorshift32, so every run does the same work
+uint32_t test_random(void)
+{
+    test_random_state ^= test_random_state << 13;
+    test_random_state ^= test_random_state >> 17;
+    test_random_state ^= test_random_state << 5;
+
+    return(test_random_state);
+}
+
+// Mostly short values, like the indicator states and numbers the panels are set
+// to, with some up to the largest block
+uint16_t test_length(void)
+{
+    uint32_t    choice = test_random() % 8;
+
+    if(choice < 4)
+    {
+        return(1 + (test_random() % 16));
+    }
+    else if(choice < 7)
+    {
+        return(1 + (test_random() % 32));
+    }
+
+    return(1 + (test_random() % VALUE_MAX_LENGTH));
+}
+
+int8_t test_pool_of(const char* value)
+{
+    const pool_t*   pool = NULL;
+    int8_t          counter = 0;
+
+    while(counter != VALUE_POOL_COUNT)
+    {
+        pool = &value_pools[counter];
+
+        if(((uint8_t*) value >= pool->base) && ((uint8_t*) value < pool->base + (pool->block_size * pool->block_count)))
+        {
+            return(counter);
+        }
+
+        counter = counter + 1;
+    }
+
+    return(-1);
+}
+
+void test_alloc(void)
+{
+    test_value_t*   live = &test_live[test_live_count];
+    uint16_t        length = test_length();
+    int8_t          expected = -1;
+    int8_t          smallest = -1;
+    int8_t          pool = 0;
+    uint8_t         counter = 0;
+
+    // The pool it should come from, worked out before asking
+    while(counter != VALUE_POOL_COUNT)
+    {
+        if(value_pools[counter].block_size >= length)
+        {
+            if(smallest == -1)
+            {
+                smallest = counter;
+            }
+
+            if((expected == -1) && (value_pools[counter].in_use != value_pools[counter].block_count))
+            {
+                expected = counter;
+            }
+        }
+
+        counter = counter + 1;
+    }
+
+    live->value = value_alloc(length);
+
+    if(live->value == NULL)
+    {
+        // Only refused when there is no room in any pool that fits
+        HOST_CHECK(expected == -1);
+        test_refused = test_refused + 1;
+        return;
+    }
+
+    pool = test_pool_of(live->value);
+    HOST_CHECK(pool == expected);
+    HOST_CHECK(value_block_size(live->value) >= length);
+    HOST_CHECK(((uint8_t*) live->value - value_pools[pool].base) % value_pools[pool].block_size == 0);
+
+    if(pool != smallest)
+    {
+        test_moved_up = test_moved_up + 1;
+    }
+
+    test_wasted = test_wasted + (value_pools[pool].block_size - length);
+    test_handed_out = test_handed_out + value_pools[pool].block_size;
+
+    // Filled, so a block handed out twice shows up when either is freed
+    live->length = length;
+    live->fill = (uint8_t) test_random();
+    memset(live->value, live->fill, length);
+
+    test_allocated = test_allocated + 1;
+    test_live_count = test_live_count + 1;
+}
+
+void test_free(uint16_t index)
+{
+    test_value_t*   live = &test_live[index];
+    uint16_t        counter = 0;
+
+    while(counter != live->length)
+    {
+        if((uint8_t) live->value[counter] != live->fill)
+        {
+            HOST_CHECK((uint8_t) live->value[counter] == live->fill);
+            break;
+        }
+
+        counter = counter + 1;
+    }
+
+    value_free(live->value);
+
+    test_live_count = test_live_count - 1;
+    test_live[index] = test_live[test_live_count];
+}
+
+// Each free list holds every block not in use, once, and nothing else
+void test_check_pools(void)
+{
+    static uint8_t  seen[512];
+    const pool_t*   pool = NULL;
+    uint8_t*        block = NULL;
+    uint16_t        live[VALUE_POOL_COUNT];
+    uint16_t        free_count = 0;
+    uint32_t        offset = 0;
+    uint16_t        counter = 0;
+    int8_t          number = 0;
+
+    memset(live, 0, sizeof(live));
+
+    while(counter != test_live_count)
+    {
+        number = test_pool_of(test_live[counter].value);
+        live[number] = live[number] + 1;
+        counter = counter + 1;
+    }
+
+    for(number = 0; number != VALUE_POOL_COUNT; number++)
+    {
+        pool = &value_pools[number];
+        memset(seen, 0, sizeof(seen));
+        free_count = 0;
+        block = pool->free_list;
+
+        while((block != NULL) && (free_count <= pool->block_count))
+        {
+            offset = block - pool->base;
+
+            if((block < pool->base) || (offset >= (uint32_t) (pool->block_size * pool->block_count)) || ((offset % pool->block_size) != 0) || (seen[offset / pool->block_size] != 0))
+            {
+                HOST_CHECK(false);
+                break;
+            }
+
+            seen[offset / pool->block_size] = 1;
+            free_count = free_count + 1;
+            block = *(uint8_t**) block;
+        }
+
+        HOST_CHECK(pool->in_use == live[number]);
+        HOST_CHECK(free_count + pool->in_use == pool->block_count);
+        HOST_CHECK(pool->high_water >= pool->in_use);
+        HOST_CHECK(pool->high_water <= pool->block_count);
+    }
+}
+
+void test_pools(void)
+{
+    uint32_t    operation = 0;
+    uint32_t    failures = 0;
+    uint8_t     pool = 0;
+    uint16_t    counter = 0;
+    char*       blocks[512];
+
+    // Nothing that isn't from a pool is taken for one
+    HOST_CHECK(value_block_size(NULL) == 0);
+    HOST_CHECK(value_block_size((char*) &operation) == 0);
+    HOST_CHECK(value_alloc(VALUE_MAX_LENGTH + 1) == NULL);
+
+    for(operation = 0; operation != TEST_OPERATIONS; operation++)
+    {
+        // Slightly more allocations than frees, so the pools keep filling up
+        if((test_live_count == 0) || ((test_live_count != TEST_LIVE_MAX) && ((test_random() % 100) < 52)))
+        {
+            test_alloc();
+        }
+        else
+        {
+            test_free(test_random() % test_live_count);
+        }
+
+        if((operation % TEST_CHECK_EVERY) == 0)
+        {
+            test_check_pools();
+        }
+    }
+
+    test_check_pools();
+
+    printf("Pools: %lu values allocated, %lu refused, %lu given a larger class, %llu%% of the blocks unused\n", (unsigned long) test_allocated,
+           (unsigned long) test_refused, (unsigned long) test_moved_up, (unsigned long long) ((test_wasted * 100) / test_handed_out));
+
+    for(pool = 0; pool != VALUE_POOL_COUNT; pool++)
+    {
+        printf("%s: %u of %u peak, %lu failed\n", value_pools[pool].name, value_pools[pool].high_water, value_pools[pool].block_count, (unsigned long) value_pools[pool].failures);
+        HOST_CHECK(value_pools[pool].high_water == value_pools[pool].block_count);
+    }
+
+    // The workload has to have filled the pools, or the refusals weren't tested
+    HOST_CHECK(test_refused != 0);
+    HOST_CHECK(test_moved_up != 0);
+
+    // Once everything is back, every block can be handed out again
+    while(test_live_count != 0)
+    {
+        test_free(test_live_count - 1);
+    }
+
+    test_check_pools();
+
+    for(pool = 0; pool != VALUE_POOL_COUNT; pool++)
+    {
+        failures = value_pools[pool].failures;
+
+        for(counter = 0; counter != value_pools[pool].block_count; counter++)
+        {
+            blocks[counter] = pool_alloc(&value_pools[pool]);
+            HOST_CHECK(blocks[counter] != NULL);
+        }
+
+        HOST_CHECK(pool_alloc(&value_pools[pool]) == NULL);
+        HOST_CHECK(value_pools[pool].failures == failures + 1);
+
+        for(counter = 0; counter != value_pools[pool].block_count; counter++)
+        {
+            pool_free(&value_pools[pool], blocks[counter]);
+        }
+
+        HOST_CHECK(value_pools[pool].in_use == 0);
+    }
+
+    test_check_pools();
+}
+
+// Bump allocations are word aligned, never overlap, and are only refused when
+// the arena is full
+void test_arena(void)
+{
+    static uint32_t storage[TEST_ARENA_SIZE / 4];
+    arena_t         arena;
+    uint8_t*        block = NULL;
+    uint8_t*        last_end = NULL;
+    uint32_t        size = 0;
+    uint32_t        used = 0;
+    uint32_t        failures = 0;
+    uint32_t        resets = 0;
+    uint32_t        counter = 0;
+    char*           copy = NULL;
+
+    arena_init(&arena, "Test", storage, sizeof(storage));
+    last_end = arena.base;
+
+    for(counter = 0; counter != TEST_ARENA_BLOCKS; counter++)
+    {
+        size = 1 + (test_random() % 100);
+        used = arena.used;
+        block = arena_alloc(&arena, size);
+
+        if(used + ((size + 3) & ~3u) > arena.size)
+        {
+            HOST_CHECK(block == NULL);
+            HOST_CHECK(arena.used == used);
+            failures = failures + 1;
+
+            // Like the command loop, start again once it is full
+            arena_reset(&arena);
+            last_end = arena.base;
+            resets = resets + 1;
+        }
+        else
+        {
+            HOST_CHECK(block == last_end);
+            HOST_CHECK(((uintptr_t) block & 3) == 0);
+            HOST_CHECK(arena.used == used + ((size + 3) & ~3u));
+            last_end = arena.base + arena.used;
+        }
+
+        HOST_CHECK(arena.used <= arena.size);
+    }
+
+    HOST_CHECK(arena.failures == failures);
+    HOST_CHECK(resets != 0);
+    HOST_CHECK(arena.high_water <= arena.size);
+    HOST_CHECK(arena.high_water > arena.size - 100);
+
+    copy = arena_strdup(&arena, "=P01=PFA10");
+    HOST_CHECK((copy != NULL) && (strcmp(copy, "=P01=PFA10") == 0));
+
+    // The firmware arenas start out empty
+    HOST_CHECK(boot_arena.used == 0);
+    HOST_CHECK(boot_arena.size == BOOT_ARENA_SIZE);
+    HOST_CHECK(scratch_arena.used == 0);
+    HOST_CHECK(scratch_arena.size == SCRATCH_ARENA_SIZE);
+}
+
+int main(void)
+{
+    arena_initialize();
+
+    test_arena();
+    test_pools();
+
+    return(host_result());
+}
@@ -0,0 +1,788 @@
+// ---------------------------------------------------------------------------------
+// Host test - Binary SNON frames
+// ---------------------------------------------------------------------------------
+// Runs the 1840A command loop's SNON handling behind the UART code on a pty, and
+// talks to it the way a host would: "binary" switches it over, frames are COBS
+// encoded here with a CRC16, independently of binframe.c, and the exit frame
+// switches it back. Each value type has to be stored exactly as the same value
+// sent in a JSON fragment would be, a set with a bad item must change nothing,
+// and damaged frames must be refused with the right error.
+//
+// Then the same float values are streamed as JSON lines, JSON batches, and
+// binary frames of one and of eight values. The bytes each way are counted, and
+// values/s at 115200 baud is worked out from whichever direction is busier.
+//
+// The number of rounds for the stream can be given on the command line.
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "pico/stdlib.h"
+#include "hardware/irq.h"
+#include "hardware/uart.h"
+#include "snon/snon_utils.h"
+
+#include "arena.h"
+#include "binframe.h"
+#include "entities.h"
+#include "fragment.h"
+#include "store.h"
+#include "uart.h"
+#include "writer.h"
+#include "host.h"
+
+// Constants
+#define TEST_ROUNDS         200
+#define TEST_ENTITIES       8
+#define TEST_LINE_MAX       2048
+#define TEST_FRAME_MAX      512
+#define TEST_FIFO_SIZE      32                      // Bytes the UART holds between interrupts
+#define TEST_DR_EMPTY       0x100                   // Nothing written to the UART data register
+#define TEST_REPLY_US       2000000
+#define TEST_BYTES_PER_S    11520                   // 115200 baud, 8N1
+
+// Types
+typedef struct
+{
+    const char* name;
+    uint32_t    values;
+    uint32_t    sent;                               // Bytes from the host
+    uint32_t    received;                           // Bytes from the panel
+} test_stream_t;
+
+// Global variables
+char                test_names[TEST_ENTITIES][16];
+char                test_eids[TEST_ENTITIES][SNON_URN_LENGTH];
+int                 test_master = -1;
+int                 test_slave = -1;
+volatile bool       test_running = true;
+uint32_t            test_sent = 0;
+uint32_t            test_received = 0;
+uint8_t             test_sequence = 0;
+
+// Panel state, panel thread only
+uint8_t             test_fifo[TEST_FIFO_SIZE];
+int                 test_fifo_length = 0;
+int                 test_fifo_position = 0;
+
+// Private prototypes
+void test_panel_tx(void);
+void test_panel_line(const char* command);
+void* test_panel(void* unused);
+void test_open_pty(void);
+void test_send(const void* data, uint16_t length);
+bool test_receive(char* line);
+uint16_t test_cobs_encode(const uint8_t* data, uint16_t length, uint8_t* encoded);
+void test_send_frame(uint8_t type, const uint8_t* payload, uint16_t length, bool damage_crc);
+uint16_t test_receive_frame(uint8_t* frame);
+uint16_t test_item_string(uint8_t* item, uint16_t handle, const char* text);
+uint16_t test_item_word(uint8_t* item, uint16_t handle, uint8_t type, uint32_t word);
+uint16_t test_item_float(uint8_t* item, uint16_t handle, float value);
+uint16_t test_item_bool(uint8_t* item, uint16_t handle, bool value);
+void test_expect_ack(uint8_t count);
+void test_expect_nak(uint8_t error);
+void test_json_values(uint8_t entity, const char* text, char* values);
+void test_types(void);
+void test_refused(void);
+void test_list_get(void);
+void test_stream_json(test_stream_t* stream, uint32_t rounds, uint8_t batch);
+void test_stream_binary(test_stream_t* stream, uint32_t rounds, uint8_t batch);
+void test_report(const test_stream_t* stream);
+
+// =================================================================================
+// Panel UART. Received bytes come from the pty, and each byte written to the data
+// register goes back to it when the UART is next asked whether it has room.
+
+bool uart_is_readable(uart_inst_t* uart)
+{
+    int length = 0;
+
+    (void) uart;
+
+    if(test_fifo_position == test_fifo_length)
+    {
+        length = read(test_slave, test_fifo, TEST_FIFO_SIZE);
+
+        test_fifo_position = 0;
+        test_fifo_length = (length > 0) ? length : 0;
+    }
+
+    return(test_fifo_position != test_fifo_length);
+}
+
+char uart_getc(uart_inst_t* uart)
+{
+    char    character = test_fifo[test_fifo_position];
+
+    (void) uart;
+
+    test_fifo_position = test_fifo_position + 1;
+
+    return(character);
+}
+
+bool uart_is_writable(uart_inst_t* uart)
+{
+    (void) uart;
+
+    test_panel_tx();
+
+    return(true);
+}
+
+void test_panel_tx(void)
+{
+    uart_hw_t*  hw = uart_get_hw(uart1);
+    uint8_t     character = 0;
+
+    if(hw->dr != TEST_DR_EMPTY)
+    {
+        character = hw->dr;
+        hw->dr = TEST_DR_EMPTY;
+        HOST_CHECK(write(test_slave, &character, 1) == 1);
+    }
+}
+
+// =================================================================================
+// Panel
+
+// Text lines, as the 1840A command loop handles them
+void test_panel_line(const char* command)
+{
+    writer_t    writer;
+
+    writer_init_uart(&writer, WRITER_MODE_RAW);
+
+    if(strcmp(command, "binary") == 0)
+    {
+        uart_command_clear();
+        uart_set_binary_mode(true);
+        writer_puts(&writer, "\r\nBinary mode\r\n");
+        writer_flush(&writer);
+        return;
+    }
+
+    if(command[0] == '[')
+    {
+        fragment_process_batch(&writer, command);
+    }
+    else
+    {
+        fragment_process(&writer, command);
+    }
+
+    writer_puts(&writer, "\r\n");
+    writer_flush(&writer);
+    uart_command_clear();
+}
+
+// The 1840A command loop. The UART interrupt runs on the same thread, whenever
+// the pty has data.
+void* test_panel(void* unused)
+{
+    struct pollfd   waiting = {.fd = test_slave, .events = POLLIN};
+    const uint8_t*  frame = NULL;
+    const char*     command = NULL;
+    uint16_t        frame_length = 0;
+    writer_t        writer;
+
+    (void) unused;
+
+    host_set_core(0);
+
+    while(test_running == true)
+    {
+        if(poll(&waiting, 1, 10) > 0)
+        {
+            host_irq(UART1_IRQ);
+        }
+
+        if(uart_in_binary_mode() == true)
+        {
+            frame_length = uart_frame_get(&frame);
+
+            if(frame_length != 0)
+            {
+                writer_init_uart(&writer, WRITER_MODE_RAW);
+                binframe_process(frame, frame_length, &writer);
+                uart_command_clear();
+                arena_reset(&scratch_arena);
+            }
+        }
+
+        command = uart_command_get();
+
+        if((uart_in_binary_mode() == false) && (command[0] != 0))
+        {
+            test_panel_line(command);
+            arena_reset(&scratch_arena);
+        }
+
+        test_panel_tx();
+    }
+
+    return(NULL);
+}
+
+// =================================================================================
+// Host
+
+// A raw pty, so carriage returns and zeros arrive as they were sent
+void test_open_pty(void)
+{
+    struct termios  settings;
+
+    test_master = posix_openpt(O_RDWR | O_NOCTTY);
+    HOST_CHECK(test_master >= 0);
+    HOST_CHECK(grantpt(test_master) == 0);
+    HOST_CHECK(unlockpt(test_master) == 0);
+
+    test_slave = open(ptsname(test_master), O_RDWR | O_NOCTTY | O_NONBLOCK);
+    HOST_CHECK(test_slave >= 0);
+
+    tcgetattr(test_slave, &settings);
+    cfmakeraw(&settings);
+    tcsetattr(test_slave, TCSANOW, &settings);
+}
+
+void test_send(const void* data, uint16_t length)
+{
+    HOST_CHECK(write(test_master, data, length) == length);
+    test_sent = test_sent + length;
+}
+
+// Reads one text line, without its line end. Empty lines are skipped.
+bool test_receive(char* line)
+{
+    struct pollfd   waiting = {.fd = test_master, .events = POLLIN};
+    uint64_t        start_us = time_us_64();
+    uint16_t        length = 0;
+    char            character = 0;
+
+    while(time_us_64() - start_us < TEST_REPLY_US)
+    {
+        if((poll(&waiting, 1, 10) <= 0) || (read(test_master, &character, 1) != 1))
+        {
+            continue;
+        }
+
+        test_received = test_received + 1;
+
+        if((character == '\n') && (length != 0))
+        {
+            line[length] = 0;
+            return(true);
+        }
+
+        if((character != '\r') && (character != '\n') && (length < TEST_LINE_MAX - 1))
+        {
+            line[length] = character;
+            length = length + 1;
+        }
+    }
+
+    line[length] = 0;
+
+    return(false);
+}
+
+// The host's own COBS encoder, so binframe.c isn't checked against itself.
+// Returns the encoded length, including the zero delimiter.
+uint16_t test_cobs_encode(const uint8_t* data, uint16_t length, uint8_t* encoded)
+{
+    uint16_t    code_position = 0;
+    uint16_t    out = 1;
+    uint16_t    in = 0;
+    uint8_t     code = 1;
+
+    while(in != length)
+    {
+        if(data[in] == 0)
+        {
+            encoded[code_position] = code;
+            code_position = out;
+            out = out + 1;
+            code = 1;
+        }
+        else
+        {
+            encoded[out] = data[in];
+            out = out + 1;
+            code = code + 1;
+
+            if(code == 0xFF)
+            {
+                encoded[code_position] = code;
+                code_position = out;
+                out = out + 1;
+                code = 1;
+            }
+        }
+
+        in = in + 1;
+    }
+
+    encoded[code_position] = code;
+    encoded[out] = 0;
+
+    return(out + 1);
+}
+
+// Sends a frame with the next sequence number, optionally with its CRC spoiled
+void test_send_frame(uint8_t type, const uint8_t* payload, uint16_t length, bool damage_crc)
+{
+    uint8_t     frame[TEST_FRAME_MAX];
+    uint8_t     encoded[TEST_FRAME_MAX + (TEST_FRAME_MAX / 254) + 2];
+    uint16_t    crc = 0;
+    uint16_t    bit = 0;
+    uint16_t    counter = 0;
+
+    test_sequence = test_sequence + 1;
+    frame[0] = type;
+    frame[1] = test_sequence;
+    memcpy(&frame[2], payload, length);
+
+    // CRC16-CCITT, worked out bit by bit
+    crc = 0xFFFF;
+    for(counter = 0; counter != length + 2; counter++)
+    {
+        crc = crc ^ ((uint16_t) frame[counter] << 8);
+
+        for(bit = 0; bit != 8; bit++)
+        {
+            crc = ((crc & 0x8000) != 0) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+        }
+    }
+
+    if(damage_crc == true)
+    {
+        crc = crc ^ 0x0100;
+    }
+
+    frame[length + 2] = crc >> 8;
+    frame[length + 3] = crc & 0xFF;
+
+    test_send(encoded, test_cobs_encode(frame, length + 4, encoded));
+}
+
+// Reads and decodes one frame, checking its CRC and sequence number. Returns the
+// length without the CRC, or zero.
+uint16_t test_receive_frame(uint8_t* frame)
+{
+    struct pollfd   waiting = {.fd = test_master, .events = POLLIN};
+    uint64_t        start_us = time_us_64();
+    uint8_t         encoded[TEST_FRAME_MAX];
+    uint16_t        length = 0;
+    uint16_t        decoded = 0;
+    uint8_t         character = 0;
+
+    while(time_us_64() - start_us < TEST_REPLY_US)
+    {
+        if((poll(&waiting, 1, 10) <= 0) || (read(test_master, &character, 1) != 1))
+        {
+            continue;
+        }
+
+        test_received = test_received + 1;
+
+        if(character == 0)
+        {
+            decoded = binframe_cobs_decode(encoded, length, frame);
+
+            HOST_CHECK(decoded >= 4);
+            HOST_CHECK(frame[1] == test_sequence);
+            HOST_CHECK(binframe_crc16(frame, decoded - 2) == ((frame[decoded - 2] << 8) | frame[decoded - 1]));
+
+            return((decoded >= 4) ? decoded - 2 : 0);
+        }
+
+        if(length < TEST_FRAME_MAX)
+        {
+            encoded[length] = character;
+            length = length + 1;
+        }
+    }
+
+    HOST_CHECK(false);
+
+    return(0);
+}
+
+uint16_t test_item_string(uint8_t* item, uint16_t handle, const char* text)
+{
+    item[0] = handle >> 8;
+    item[1] = handle & 0xFF;
+    item[2] = BINFRAME_TYPE_STRING;
+    item[3] = strlen(text);
+    memcpy(&item[4], text, item[3]);
+
+    return(4 + item[3]);
+}
+
+uint16_t test_item_word(uint8_t* item, uint16_t handle, uint8_t type, uint32_t word)
+{
+    item[0] = handle >> 8;
+    item[1] = handle & 0xFF;
+    item[2] = type;
+    item[3] = word >> 24;
+    item[4] = (word >> 16) & 0xFF;
+    item[5] = (word >> 8) & 0xFF;
+    item[6] = word & 0xFF;
+
+    return(7);
+}
+
+uint16_t test_item_float(uint8_t* item, uint16_t handle, float value)
+{
+    uint32_t    word = 0;
+
+    memcpy(&word, &value, sizeof(word));
+
+    return(test_item_word(item, handle, BINFRAME_TYPE_FLOAT32, word));
+}
+
+uint16_t test_item_bool(uint8_t* item, uint16_t handle, bool value)
+{
+    item[0] = handle >> 8;
+    item[1] = handle & 0xFF;
+    item[2] = BINFRAME_TYPE_BOOL;
+    item[3] = (value == true) ? 1 : 0;
+
+    return(4);
+}
+
+void test_expect_ack(uint8_t count)
+{
+    uint8_t     frame[TEST_FRAME_MAX];
+
+    HOST_CHECK(test_receive_frame(frame) == 3);
+    HOST_CHECK(frame[0] == BINFRAME_ACK);
+    HOST_CHECK(frame[2] == count);
+}
+
+void test_expect_nak(uint8_t error)
+{
+    uint8_t     frame[TEST_FRAME_MAX];
+
+    HOST_CHECK(test_receive_frame(frame) == 3);
+    HOST_CHECK(frame[0] == BINFRAME_NAK);
+    HOST_CHECK(frame[2] == error);
+}
+
+// Sets an entity through a JSON fragment, and returns what the store then holds
+void test_json_values(uint8_t entity, const char* text, char* values)
+{
+    char    line[TEST_LINE_MAX];
+    char    reply[TEST_LINE_MAX];
+
+    snprintf(line, sizeof(line), "{\"eID\":\"%s\",\"v\":[\"%s\"]}\r\n", test_eids[entity], text);
+    test_send(line, strlen(line));
+    HOST_CHECK(test_receive(reply) == true);
+
+    strcpy(values, store_get_values(store_find(test_eids[entity])));
+}
+
+// Every value type is stored as the same value in a JSON fragment would be. Ends
+// in binary mode.
+void test_types(void)
+{
+    uint8_t     payload[TEST_FRAME_MAX];
+    uint16_t    length = 0;
+    char        expected[TEST_ENTITIES][TEST_LINE_MAX];
+    char        cleared[TEST_LINE_MAX];
+    uint8_t     entity = 0;
+
+    // The JSON path first, with the text the binary values stand for. The
+    // string has a quote and a backslash, which both paths escape.
+    test_json_values(0, "status \\\"ok\\\" \\\\ 1", expected[0]);
+    test_json_values(1, "-42", expected[1]);
+    test_json_values(2, "1.5", expected[2]);
+    test_json_values(3, "true", expected[3]);
+    test_json_values(4, "false", expected[4]);
+
+    // Cleared, so each value has to come from the frame
+    for(entity = 0; entity != 5; entity++)
+    {
+        test_json_values(entity, "", cleared);
+        HOST_CHECK(strcmp(cleared, "[\"\"]") == 0);
+    }
+
+    test_send("binary\r\n", 8);
+    HOST_CHECK(test_receive(cleared) == true);
+    HOST_CHECK(strcmp(cleared, "Binary mode") == 0);
+
+    length = test_item_string(payload, 0, "status \"ok\" \\ 1");
+    length = length + test_item_word(&payload[length], 1, BINFRAME_TYPE_INT32, (uint32_t) -42);
+    length = length + test_item_float(&payload[length], 2, 1.5f);
+    length = length + test_item_bool(&payload[length], 3, true);
+    length = length + test_item_bool(&payload[length], 4, false);
+
+    test_send_frame(BINFRAME_SET, payload, length, false);
+    test_expect_ack(5);
+
+    for(entity = 0; entity != 5; entity++)
+    {
+        if(strcmp(store_get_values(store_find(test_eids[entity])), expected[entity]) != 0)
+        {
+            printf("Entity %u: JSON gave %s, binary gave %s\n", entity, expected[entity], store_get_values(store_find(test_eids[entity])));
+        }
+
+        HOST_CHECK(strcmp(store_get_values(store_find(test_eids[entity])), expected[entity]) == 0);
+    }
+
+    // The same escaping as a control character in a JSON string
+    length = test_item_string(payload, 5, "a\001b");
+    test_send_frame(BINFRAME_SET, payload, length, false);
+    test_expect_ack(1);
+    HOST_CHECK(strcmp(store_get_values(store_find(test_eids[5])), "[\"a\\u0001b\"]") == 0);
+}
+
+// Frames that are damaged, or have a bad item anywhere, change nothing
+void test_refused(void)
+{
+    uint8_t     payload[TEST_FRAME_MAX];
+    uint8_t     damaged[] = {0x03, BINFRAME_GET, 0x00};
+    uint16_t    length = 0;
+
+    length = test_item_string(payload, 6, "before");
+    test_send_frame(BINFRAME_SET, payload, length, false);
+    test_expect_ack(1);
+
+    // A good item, then a handle past the last entity
+    length = test_item_string(payload, 6, "after");
+    length = length + test_item_string(&payload[length], TEST_ENTITIES, "after");
+    test_send_frame(BINFRAME_SET, payload, length, false);
+    test_expect_nak(BINFRAME_ERROR_HANDLE);
+
+    // A good item, then one cut short
+    length = test_item_string(payload, 6, "after");
+    length = length + test_item_float(&payload[length], 7, 2.0f) - 2;
+    test_send_frame(BINFRAME_SET, payload, length, false);
+    test_expect_nak(BINFRAME_ERROR_LENGTH);
+
+    // An unknown value type
+    length = test_item_string(payload, 6, "after");
+    payload[2] = 0x09;
+    test_send_frame(BINFRAME_SET, payload, length, false);
+    test_expect_nak(BINFRAME_ERROR_TYPE);
+
+    length = test_item_string(payload, 6, "after");
+    test_send_frame(BINFRAME_SET, payload, length, true);
+    test_expect_nak(BINFRAME_ERROR_CRC);
+
+    HOST_CHECK(strcmp(store_get_values(store_find(test_eids[6])), "[\"before\"]") == 0);
+
+    // A COBS block longer than the frame. The sequence number can't be read, so
+    // the NAK carries zero.
+    test_send(damaged, sizeof(damaged));
+    test_sequence = 0;
+    test_expect_nak(BINFRAME_ERROR_FRAMING);
+
+    // An unknown frame type
+    test_send_frame(0x42, payload, 0, false);
+    test_expect_nak(BINFRAME_ERROR_TYPE);
+}
+
+// Handles map to the eIDs a host would otherwise have to send, and values can be
+// read back by handle
+void test_list_get(void)
+{
+    uint8_t     payload[4] = {0, 0, 0, 6};
+    uint8_t     frame[TEST_FRAME_MAX];
+    uint16_t    length = 0;
+    uint16_t    position = 4;
+    uint16_t    handle = 0;
+    uint8_t     counter = 0;
+
+    test_send_frame(BINFRAME_LIST, payload, 2, false);
+    length = test_receive_frame(frame);
+    HOST_CHECK(frame[0] == BINFRAME_ENTITIES);
+    HOST_CHECK(((frame[2] << 8) | frame[3]) == TEST_ENTITIES);
+
+    while(position < length)
+    {
+        handle = (frame[position] << 8) | frame[position + 1];
+        HOST_CHECK(handle == counter);
+        HOST_CHECK((frame[position + 2] == strlen(test_eids[handle])) && (memcmp(&frame[position + 3], test_eids[handle], frame[position + 2]) == 0));
+
+        position = position + 3 + frame[position + 2];
+        counter = counter + 1;
+    }
+
+    HOST_CHECK(counter != 0);
+
+    // Entity 6 still holds the value from before the refused frames
+    test_send_frame(BINFRAME_GET, &payload[2], 2, false);
+    length = test_receive_frame(frame);
+    HOST_CHECK(frame[0] == BINFRAME_VALUES);
+    HOST_CHECK(length == 2 + 4 + strlen("before"));
+    HOST_CHECK((frame[2] == 0) && (frame[3] == 6) && (frame[4] == BINFRAME_TYPE_STRING));
+    HOST_CHECK(memcmp(&frame[6], "before", frame[5]) == 0);
+}
+
+// Float values as JSON lines, or as batches of them, waiting for each reply
+void test_stream_json(test_stream_t* stream, uint32_t rounds, uint8_t batch)
+{
+    char        line[TEST_LINE_MAX];
+    char        reply[TEST_LINE_MAX];
+    uint32_t    sent = test_sent;
+    uint32_t    received = test_received;
+    uint32_t    round = 0;
+    uint16_t    length = 0;
+    uint8_t     counter = 0;
+
+    for(round = 0; round != rounds; round++)
+    {
+        length = 0;
+
+        if(batch > 1)
+        {
+            line[0] = '[';
+            length = 1;
+        }
+
+        for(counter = 0; counter != batch; counter++)
+        {
+            length = length + sprintf(&line[length], "%s{\"eID\":\"%s\",\"v\":[\"%g\"]}", (counter != 0) ? "," : "", test_eids[counter],
+                                      (round * 0.25) + counter);
+        }
+
+        strcpy(&line[length], (batch > 1) ? "]\r\n" : "\r\n");
+        test_send(line, strlen(line));
+        HOST_CHECK(test_receive(reply) == true);
+        HOST_CHECK(strstr(reply, "\"error\"") == NULL);
+    }
+
+    stream->values = rounds * batch;
+    stream->sent = test_sent - sent;
+    stream->received = test_received - received;
+}
+
+// The same values as binary frames of one item or more
+void test_stream_binary(test_stream_t* stream, uint32_t rounds, uint8_t batch)
+{
+    uint8_t     payload[TEST_FRAME_MAX];
+    char        expected[32];
+    uint32_t    sent = test_sent;
+    uint32_t    received = test_received;
+    uint32_t    round = 0;
+    uint16_t    length = 0;
+    uint8_t     counter = 0;
+
+    for(round = 0; round != rounds; round++)
+    {
+        length = 0;
+
+        for(counter = 0; counter != batch; counter++)
+        {
+            length = length + test_item_float(&payload[length], counter, (round * 0.25f) + counter);
+        }
+
+        test_send_frame(BINFRAME_SET, payload, length, false);
+        test_expect_ack(batch);
+    }
+
+    // The last values are all there
+    for(counter = 0; counter != batch; counter++)
+    {
+        snprintf(expected, sizeof(expected), "[\"%g\"]", ((rounds - 1) * 0.25f) + counter);
+        HOST_CHECK(strcmp(store_get_values(store_find(test_eids[counter])), expected) == 0);
+    }
+
+    stream->values = rounds * batch;
+    stream->sent = test_sent - sent;
+    stream->received = test_received - received;
+}
+
+// Values/s at 115200 baud, limited by whichever direction carries more
+void test_report(const test_stream_t* stream)
+{
+    uint32_t    busiest = (stream->sent > stream->received) ? stream->sent : stream->received;
+
+    printf("%-18s  %8.1f  %8.1f  %8.0f\n", stream->name, (double) stream->sent / stream->values, (double) stream->received / stream->values,
+           (double) TEST_BYTES_PER_S * stream->values / busiest);
+}
+
+int main(int argc, char** argv)
+{
+    pthread_t       panel;
+    test_stream_t   streams[4] = {{"JSON lines", 0, 0, 0}, {"JSON batches of 8", 0, 0, 0}, {"Binary, 1 a frame", 0, 0, 0}, {"Binary, 8 a frame", 0, 0, 0}};
+    char            reply[TEST_LINE_MAX];
+    uint8_t         payload[1] = {0};
+    uint8_t         counter = 0;
+    uint32_t        rounds = TEST_ROUNDS;
+
+    if(argc > 1)
+    {
+        rounds = strtoul(argv[1], NULL, 10);
+    }
+
+    arena_initialize();
+    snon_initialize("Binary Test");
+
+    for(counter = 0; counter != TEST_ENTITIES; counter++)
+    {
+        sprintf(test_names[counter], "=P01=PFA%02u", counter + 1);
+        snon_register(test_names[counter], SNON_CLASS_VALUE, "[\"off\"]");
+        snon_name_to_eid(test_names[counter], test_eids[counter]);
+    }
+
+    store_initialize();
+
+    for(counter = 0; counter != TEST_ENTITIES; counter++)
+    {
+        HOST_CHECK(entity_register(test_names[counter], 1u << counter) == counter);
+    }
+
+    uart_get_hw(uart1)->dr = TEST_DR_EMPTY;
+    test_open_pty();
+    uart_setup();
+    pthread_create(&panel, NULL, test_panel, NULL);
+
+    test_stream_json(&streams[0], rounds, 1);
+    test_stream_json(&streams[1], rounds, TEST_ENTITIES);
+
+    test_types();
+    test_refused();
+    test_list_get();
+
+    test_stream_binary(&streams[2], rounds, 1);
+    test_stream_binary(&streams[3], rounds, TEST_ENTITIES);
+
+    // Back to text, which is answered as before
+    test_send_frame(BINFRAME_EXIT, payload, 0, false);
+    test_expect_ack(0);
+    test_json_values(7, "text", reply);
+    HOST_CHECK(strcmp(reply, "[\"text\"]") == 0);
+
+    test_running = false;
+    pthread_join(panel, NULL);
+
+    printf("Stream              Bytes/value out   in  Values/s at 115200\n");
+
+    for(counter = 0; counter != 4; counter++)
+    {
+        test_report(&streams[counter]);
+    }
+
+    // Handles and binary floats take fewer bytes than eIDs and JSON text
+    HOST_CHECK(streams[2].sent < streams[0].sent);
+    HOST_CHECK(streams[3].sent < streams[1].sent);
+    HOST_CHECK(streams[3].received < streams[1].received);
+
+    close(test_slave);
+    close(test_master);
+
+    return(host_result());
+}
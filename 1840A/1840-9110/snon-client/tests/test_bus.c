@@ -0,0 +1,686 @@
+// ---------------------------------------------------------------------------------
+// Host test - Multi-drop bus
+// ---------------------------------------------------------------------------------
+// Simulates 32 panels sharing one RS-485 bus. Each panel is a separate process
+// running the UART, writer and reply code in multi-drop mode. A hub thread plays
+// the part of the wires: every byte the host sends on the pty reaches every panel,
+// and every byte a panel sends goes back to the host. Once the host has sent a
+// line, the bus belongs to the panel it was addressed to until that panel has
+// sent one line back, and after a broadcast it belongs to no one. A collision is
+// counted for every byte a panel sends while the bus isn't its own.
+//
+// The host sends each panel addressed SNON fragments with a request ID, and then
+// a broadcast. Each addressed fragment must be answered by its own panel only, and
+// nothing may answer the broadcast. Every panel then reports how many lines it
+// dropped for other panels. Round trip and turnaround times are printed per panel.
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "pico/stdlib.h"
+#include "hardware/irq.h"
+#include "hardware/uart.h"
+#include "snon/snon_utils.h"
+
+#include "arena.h"
+#include "json_tok.h"
+#include "reply.h"
+#include "store.h"
+#include "uart.h"
+#include "writer.h"
+#include "host.h"
+
+// Constants
+#define TEST_PANELS         32
+#define TEST_ROUNDS         20
+#define TEST_TOKENS         32
+#define TEST_LINE_MAX       512
+#define TEST_FIFO_SIZE      32              // Bytes the UART holds between interrupts
+#define TEST_DR_EMPTY       0x100           // Nothing written to the UART data register
+#define TEST_REPLY_US       2000000         // Longest wait for a reply
+#define TEST_QUIET_US       200000          // How long the bus must stay quiet after a broadcast
+#define TEST_BROADCAST      5               // Panel whose entity the broadcast sets
+
+// Types
+typedef struct
+{
+    int         socket;                     // Hub end
+    pid_t       pid;
+    uint16_t    address;
+    char        eid[SNON_URN_LENGTH];       // Entity the host sets
+    uint32_t    sent;                       // Lines addressed to this panel
+    uint32_t    replies;
+    uint32_t    bytes;                      // Bytes the panel put on the bus
+    uint64_t    round_trip_us;
+    uint64_t    turnaround_max_us;
+    uint64_t    turnaround_total_us;
+} test_panel_t;
+
+// Global variables
+test_panel_t        test_panels[TEST_PANELS];
+int                 test_master = -1;
+int                 test_slave = -1;
+volatile bool       test_running = true;
+uint32_t            test_sent_total = 0;    // Addressed lines sent to any panel
+uint32_t            test_broadcasts = 0;
+
+// Bus state, hub thread only, apart from the counters
+bool                test_host_sending = false;
+char                test_host_line[8];      // Start of the line the host is sending
+uint8_t             test_host_length = 0;
+int                 test_owner = -1;        // Panel allowed to answer
+volatile uint32_t   test_collisions = 0;
+volatile uint32_t   test_panel_bytes = 0;
+
+// Panel process state
+int                 test_panel_socket = -1;
+uint8_t             test_fifo[TEST_FIFO_SIZE];
+int                 test_fifo_length = 0;
+int                 test_fifo_position = 0;
+bool                test_panel_closed = false;
+
+// Private prototypes
+void test_panel_name(uint8_t panel, char* device, char* entity);
+void test_panel_tx(void);
+void test_panel_command(const char* command);
+void test_panel_run(uint8_t panel);
+void test_start_panels(void);
+void test_open_pty(void);
+void test_hub_host(uint8_t character);
+void* test_hub(void* unused);
+void test_send(int panel, const char* line);
+bool test_receive(char* line, uint64_t timeout_us, uint64_t* first_byte_us);
+void test_request(uint8_t panel, uint32_t round);
+void test_broadcast(void);
+void test_panel_stats(uint8_t panel);
+
+// =================================================================================
+// Panel UART. Received bytes come from the hub, and each byte written to the data
+// register goes to the hub when the UART is next asked whether it has room.
+
+bool uart_is_readable(uart_inst_t* uart)
+{
+    int length = 0;
+
+    (void) uart;
+
+    if(test_fifo_position == test_fifo_length)
+    {
+        length = read(test_panel_socket, test_fifo, TEST_FIFO_SIZE);
+
+        if(length == 0)
+        {
+            test_panel_closed = true;
+        }
+
+        test_fifo_position = 0;
+        test_fifo_length = (length > 0) ? length : 0;
+    }
+
+    return(test_fifo_position != test_fifo_length);
+}
+
+char uart_getc(uart_inst_t* uart)
+{
+    char    character = test_fifo[test_fifo_position];
+
+    (void) uart;
+
+    test_fifo_position = test_fifo_position + 1;
+
+    return(character);
+}
+
+bool uart_is_writable(uart_inst_t* uart)
+{
+    (void) uart;
+
+    test_panel_tx();
+
+    return(true);
+}
+
+void test_panel_tx(void)
+{
+    uart_hw_t*  hw = uart_get_hw(uart1);
+    uint8_t     character = 0;
+
+    if(hw->dr != TEST_DR_EMPTY)
+    {
+        character = hw->dr;
+        hw->dr = TEST_DR_EMPTY;
+
+        if(write(test_panel_socket, &character, 1) != 1)
+        {
+            test_panel_closed = true;
+        }
+    }
+}
+
+// =================================================================================
+// Panel
+
+void test_panel_name(uint8_t panel, char* device, char* entity)
+{
+    if(device != NULL)
+    {
+        sprintf(device, "1840A-%02u", panel);
+    }
+
+    if(entity != NULL)
+    {
+        sprintf(entity, "=P%02u=PFA01", panel);
+    }
+}
+
+// Handles a line the way the command loop does: SNON fragments are stored and
+// answered with the entity, and "get uart" with the line counts
+void test_panel_command(const char* command)
+{
+    json_tok_t      tokens[TEST_TOKENS];
+    writer_t        writer;
+    reply_rid_t     rid;
+    char            eid[SNON_URN_LENGTH];
+    int16_t         count = 0;
+    int16_t         eid_token = 0;
+    int16_t         value_token = 0;
+    const uart_stats_t* stats = uart_get_stats();
+
+    writer_init_uart(&writer, WRITER_MODE_RAW);
+
+    if(strcmp(command, "get uart") == 0)
+    {
+        writer_puts(&writer, "{\"lines\":");
+        writer_uint(&writer, stats->lines);
+        writer_puts(&writer, ",\"other\":");
+        writer_uint(&writer, stats->lines_other);
+        writer_puts(&writer, "}");
+    }
+    else
+    {
+        count = json_tok_parse(command, strlen(command), tokens, TEST_TOKENS);
+
+        if((count < 1) || (tokens[0].type != JSON_TOK_OBJECT))
+        {
+            reply_error(&writer, REPLY_ERROR_INVALID, NULL);
+        }
+        else
+        {
+            reply_get_rid(command, tokens, count, 0, &rid);
+            eid_token = json_tok_find_key(command, tokens, count, 0, "eID");
+            value_token = json_tok_find_key(command, tokens, count, 0, "v");
+
+            if((eid_token == -1) || (tokens[eid_token].type != JSON_TOK_STRING))
+            {
+                reply_error(&writer, REPLY_ERROR_NO_EID, &rid);
+            }
+            else
+            {
+                json_tok_copy(command, &tokens[eid_token], eid, SNON_URN_LENGTH);
+
+                if(value_token != -1)
+                {
+                    store_set_tokens(store_find(eid), command, tokens, count, value_token);
+                }
+
+                if(reply_entity(&writer, eid, &rid) == false)
+                {
+                    reply_error(&writer, REPLY_ERROR_NOT_FOUND, &rid);
+                }
+            }
+        }
+    }
+
+    writer_puts(&writer, "\r\n");
+    writer_flush(&writer);
+}
+
+// Runs a panel until the hub closes its end
+void test_panel_run(uint8_t panel)
+{
+    struct pollfd   waiting = {.fd = test_panel_socket, .events = POLLIN};
+    char            device[16];
+    char            entity[16];
+    char            eid[SNON_URN_LENGTH];
+    const char*     command = NULL;
+
+    test_panel_name(panel, device, entity);
+    snon_initialize(device);
+    snon_register(entity, SNON_CLASS_VALUE, "[\"off\"]");
+    arena_initialize();
+    store_initialize();
+
+    uart_get_hw(uart1)->dr = TEST_DR_EMPTY;
+    uart_setup();
+    snon_name_to_eid(device, eid);
+    uart_set_address(uart_address_from_eid(eid));
+    uart_set_multidrop_mode(true);
+
+    while((test_panel_closed == false) && (poll(&waiting, 1, -1) > 0))
+    {
+        host_irq(UART1_IRQ);
+        command = uart_command_get();
+
+        while(command[0] != 0)
+        {
+            test_panel_command(command);
+            uart_command_clear();
+            command = uart_command_get();
+        }
+
+        test_panel_tx();
+    }
+
+    _exit(0);
+}
+
+void test_start_panels(void)
+{
+    char    device[16];
+    char    entity[16];
+    char    eid[SNON_URN_LENGTH];
+    int     sockets[2];
+    uint8_t panel = 0;
+    uint8_t other = 0;
+
+    while(panel != TEST_PANELS)
+    {
+        test_panel_name(panel, device, entity);
+        snon_name_to_eid(device, eid);
+        test_panels[panel].address = uart_address_from_eid(eid);
+        snon_name_to_eid(entity, test_panels[panel].eid);
+
+        // Every panel needs an address of its own
+        for(other = 0; other != panel; other++)
+        {
+            HOST_CHECK(test_panels[other].address != test_panels[panel].address);
+        }
+
+        socketpair(AF_UNIX, SOCK_STREAM, 0, sockets);
+        test_panels[panel].pid = fork();
+
+        if(test_panels[panel].pid == 0)
+        {
+            // Only this panel's own end stays open
+            close(sockets[0]);
+
+            for(other = 0; other != panel; other++)
+            {
+                close(test_panels[other].socket);
+            }
+
+            close(test_master);
+            close(test_slave);
+            test_panel_socket = sockets[1];
+            fcntl(test_panel_socket, F_SETFL, O_NONBLOCK);
+            test_panel_run(panel);
+        }
+
+        close(sockets[1]);
+        test_panels[panel].socket = sockets[0];
+        panel = panel + 1;
+    }
+}
+
+// =================================================================================
+// Bus
+
+// A raw pty, so carriage returns arrive as they were sent
+void test_open_pty(void)
+{
+    struct termios  settings;
+
+    test_master = posix_openpt(O_RDWR | O_NOCTTY);
+    HOST_CHECK(test_master >= 0);
+    HOST_CHECK(grantpt(test_master) == 0);
+    HOST_CHECK(unlockpt(test_master) == 0);
+
+    test_slave = open(ptsname(test_master), O_RDWR | O_NOCTTY);
+    HOST_CHECK(test_slave >= 0);
+
+    tcgetattr(test_slave, &settings);
+    cfmakeraw(&settings);
+    tcsetattr(test_slave, TCSANOW, &settings);
+}
+
+// Follows the host's lines, giving the bus to the panel each one is addressed to
+void test_hub_host(uint8_t character)
+{
+    unsigned int    address = 0;
+    int             panel = 0;
+
+    if(character == '\n')
+    {
+        return;
+    }
+
+    if(character != '\r')
+    {
+        test_host_sending = true;
+        test_owner = -1;
+
+        if(test_host_length < sizeof(test_host_line) - 1)
+        {
+            test_host_line[test_host_length] = character;
+            test_host_length = test_host_length + 1;
+        }
+
+        return;
+    }
+
+    test_host_line[test_host_length] = 0;
+    test_host_sending = false;
+    test_host_length = 0;
+
+    if(sscanf(test_host_line, "@%4x ", &address) != 1)
+    {
+        return;
+    }
+
+    for(panel = 0; panel != TEST_PANELS; panel++)
+    {
+        if(test_panels[panel].address == address)
+        {
+            test_owner = panel;
+        }
+    }
+}
+
+// Passes what the host sends to every panel, and what the panels send to the host,
+// counting every byte a panel sends while someone else has the bus
+void* test_hub(void* unused)
+{
+    struct pollfd   waiting[TEST_PANELS + 1];
+    uint8_t         buffer[TEST_LINE_MAX];
+    ssize_t         length = 0;
+    ssize_t         counter = 0;
+    int             panel = 0;
+
+    (void) unused;
+
+    waiting[0].fd = test_slave;
+    waiting[0].events = POLLIN;
+
+    for(panel = 0; panel != TEST_PANELS; panel++)
+    {
+        waiting[panel + 1].fd = test_panels[panel].socket;
+        waiting[panel + 1].events = POLLIN;
+    }
+
+    while(test_running == true)
+    {
+        if(poll(waiting, TEST_PANELS + 1, 10) <= 0)
+        {
+            continue;
+        }
+
+        if((waiting[0].revents & POLLIN) != 0)
+        {
+            length = read(test_slave, buffer, sizeof(buffer));
+
+            for(counter = 0; counter < length; counter++)
+            {
+                test_hub_host(buffer[counter]);
+            }
+
+            for(panel = 0; (length > 0) && (panel != TEST_PANELS); panel++)
+            {
+                HOST_CHECK(write(test_panels[panel].socket, buffer, length) == length);
+            }
+        }
+
+        for(panel = 0; panel != TEST_PANELS; panel++)
+        {
+            if((waiting[panel + 1].revents & POLLIN) == 0)
+            {
+                continue;
+            }
+
+            length = read(test_panels[panel].socket, buffer, sizeof(buffer));
+
+            for(counter = 0; counter < length; counter++)
+            {
+                if((test_host_sending == true) || (test_owner != panel))
+                {
+                    test_collisions = test_collisions + 1;
+                }
+                else if(buffer[counter] == '\n')
+                {
+                    test_owner = -1;
+                }
+            }
+
+            if(length > 0)
+            {
+                test_panels[panel].bytes = test_panels[panel].bytes + length;
+                test_panel_bytes = test_panel_bytes + length;
+                HOST_CHECK(write(test_slave, buffer, length) == length);
+            }
+        }
+    }
+
+    return(NULL);
+}
+
+// =================================================================================
+// Host
+
+// Sends a line, counting it against the panel it is addressed to (-1 for every panel)
+void test_send(int panel, const char* line)
+{
+    size_t  length = strlen(line);
+
+    HOST_CHECK(write(test_master, line, length) == (ssize_t) length);
+
+    if(panel == -1)
+    {
+        test_broadcasts = test_broadcasts + 1;
+    }
+    else
+    {
+        test_panels[panel].sent = test_panels[panel].sent + 1;
+        test_sent_total = test_sent_total + 1;
+    }
+}
+
+// Reads one reply line, without its line end
+bool test_receive(char* line, uint64_t timeout_us, uint64_t* first_byte_us)
+{
+    struct pollfd   waiting = {.fd = test_master, .events = POLLIN};
+    uint64_t        start_us = time_us_64();
+    uint16_t        length = 0;
+    char            character = 0;
+
+    while(time_us_64() - start_us < timeout_us)
+    {
+        if((poll(&waiting, 1, 10) <= 0) || (read(test_master, &character, 1) != 1))
+        {
+            continue;
+        }
+
+        if((length == 0) && (first_byte_us != NULL))
+        {
+            *first_byte_us = time_us_64();
+        }
+
+        if(character == '\n')
+        {
+            line[length] = 0;
+            return(true);
+        }
+
+        if((character != '\r') && (length < TEST_LINE_MAX - 1))
+        {
+            line[length] = character;
+            length = length + 1;
+        }
+    }
+
+    line[length] = 0;
+
+    return(false);
+}
+
+// Sets a panel's entity, and checks that the panel answers with the new value and
+// the request ID
+void test_request(uint8_t panel, uint32_t round)
+{
+    test_panel_t*   target = &test_panels[panel];
+    char            line[TEST_LINE_MAX];
+    char            reply[TEST_LINE_MAX];
+    char            expected[TEST_LINE_MAX];
+    uint32_t        rid = (round * TEST_PANELS) + panel;
+    uint64_t        sent_us = 0;
+    uint64_t        first_byte_us = 0;
+    uint64_t        turnaround_us = 0;
+
+    // Lower case addresses are accepted too
+    snprintf(line, sizeof(line), (round & 1) ? "@%04x {\"eID\":\"%s\",\"v\":[\"r%lu\"],\"rID\":%lu}\r\n" : "@%04X {\"eID\":\"%s\",\"v\":[\"r%lu\"],\"rID\":%lu}\r\n",
+             target->address, target->eid, (unsigned long) round, (unsigned long) rid);
+    test_send(panel, line);
+    sent_us = time_us_64();
+
+    HOST_CHECK(test_receive(reply, TEST_REPLY_US, &first_byte_us) == true);
+
+    snprintf(expected, sizeof(expected), "{\"eID\":\"%s\",\"name\":\"=P%02u=PFA01\",\"v\":[\"r%lu\"],\"rID\":%lu}", target->eid, panel, (unsigned long) round, (unsigned long) rid);
+    if(strcmp(reply, expected) != 0)
+    {
+        printf("Panel %u: expected %s\n          received %s\n", panel, expected, reply);
+    }
+
+    HOST_CHECK(strcmp(reply, expected) == 0);
+
+    turnaround_us = first_byte_us - sent_us;
+    target->replies = target->replies + 1;
+    target->round_trip_us = target->round_trip_us + (time_us_64() - sent_us);
+    target->turnaround_total_us = target->turnaround_total_us + turnaround_us;
+
+    if(turnaround_us > target->turnaround_max_us)
+    {
+        target->turnaround_max_us = turnaround_us;
+    }
+}
+
+// Sets one panel's entity through a broadcast. Nothing answers it, and only that
+// panel takes the value.
+void test_broadcast(void)
+{
+    test_panel_t*   target = &test_panels[TEST_BROADCAST];
+    char            line[TEST_LINE_MAX];
+    char            reply[TEST_LINE_MAX];
+    char            expected[TEST_LINE_MAX];
+    uint32_t        bytes = test_panel_bytes;
+
+    snprintf(line, sizeof(line), "@* {\"eID\":\"%s\",\"v\":[\"broadcast\"],\"rID\":7}\r\n", target->eid);
+    test_send(-1, line);
+
+    HOST_CHECK(test_receive(reply, TEST_QUIET_US, NULL) == false);
+    HOST_CHECK(reply[0] == 0);
+    HOST_CHECK(test_panel_bytes == bytes);
+
+    // The value was set, and reading it back is an ordinary request
+    snprintf(line, sizeof(line), "@%04X {\"eID\":\"%s\"}\r\n", target->address, target->eid);
+    test_send(TEST_BROADCAST, line);
+    HOST_CHECK(test_receive(reply, TEST_REPLY_US, NULL) == true);
+
+    snprintf(expected, sizeof(expected), "{\"eID\":\"%s\",\"name\":\"=P%02u=PFA01\",\"v\":[\"broadcast\"]}", target->eid, TEST_BROADCAST);
+    HOST_CHECK(strcmp(reply, expected) == 0);
+}
+
+// Every line reached the panel it was meant for, and every other line was
+// dropped before it reached the line queue
+void test_panel_stats(uint8_t panel)
+{
+    test_panel_t*   target = &test_panels[panel];
+    char            line[TEST_LINE_MAX];
+    char            reply[TEST_LINE_MAX];
+    unsigned long   lines = 0;
+    unsigned long   other = 0;
+
+    snprintf(line, sizeof(line), "@%04X get uart\r\n", target->address);
+    test_send(panel, line);
+    HOST_CHECK(test_receive(reply, TEST_REPLY_US, NULL) == true);
+    HOST_CHECK(sscanf(reply, "{\"lines\":%lu,\"other\":%lu}", &lines, &other) == 2);
+    HOST_CHECK(lines == target->sent + test_broadcasts);
+    HOST_CHECK(other == test_sent_total - target->sent);
+}
+
+int main(void)
+{
+    pthread_t   hub;
+    uint64_t    start_us = 0;
+    uint64_t    elapsed_us = 0;
+    uint32_t    round = 0;
+    uint32_t    replies = 0;
+    uint8_t     panel = 0;
+
+    signal(SIGPIPE, SIG_IGN);
+    test_open_pty();
+    test_start_panels();
+    pthread_create(&hub, NULL, test_hub, NULL);
+
+    // Each panel in turn, as a host polling a rack does
+    start_us = time_us_64();
+
+    for(round = 0; round != TEST_ROUNDS; round++)
+    {
+        for(panel = 0; panel != TEST_PANELS; panel++)
+        {
+            test_request(panel, round);
+        }
+    }
+
+    elapsed_us = time_us_64() - start_us;
+
+    test_broadcast();
+
+    for(panel = 0; panel != TEST_PANELS; panel++)
+    {
+        test_panel_stats(panel);
+    }
+
+    test_running = false;
+    pthread_join(hub, NULL);
+
+    printf("Panel Address  Requests  Bytes  Round trip (us)  Turnaround (us)  Max (us)\n");
+
+    for(panel = 0; panel != TEST_PANELS; panel++)
+    {
+        test_panel_t*   target = &test_panels[panel];
+
+        printf("%5u  %04X  %8lu  %5lu  %15.0f  %15.0f  %8lu\n", panel, target->address, (unsigned long) target->replies, (unsigned long) target->bytes,
+               (double) target->round_trip_us / (target->replies ? target->replies : 1),
+               (double) target->turnaround_total_us / (target->replies ? target->replies : 1), (unsigned long) target->turnaround_max_us);
+        HOST_CHECK(target->replies == TEST_ROUNDS);
+        replies = replies + target->replies;
+        close(target->socket);
+    }
+
+    printf("%lu requests in %.2f s, %.0f requests/s on the bus, %lu collisions\n", (unsigned long) replies, elapsed_us / 1e6,
+           replies / (elapsed_us / 1e6), (unsigned long) test_collisions);
+    HOST_CHECK(test_collisions == 0);
+
+    for(panel = 0; panel != TEST_PANELS; panel++)
+    {
+        waitpid(test_panels[panel].pid, NULL, 0);
+    }
+
+    close(test_slave);
+    close(test_master);
+
+    return(host_result());
+}
@@ -0,0 +1,435 @@
+// ---------------------------------------------------------------------------------
+// Host test - Command sessions
+// ---------------------------------------------------------------------------------
+// Runs scripted sessions on the serial terminal of a panel, built from that
+// panel's source tree. Each line of a script is typed into the UART, handled by
+// the command loop as main.c handles it, and what comes back between the echo and
+// the next prompt is checked against the script. The shared commands are run on
+// every panel. The panel's own commands are in main.c, which doesn't build here,
+// so they are registered with a stand-in that writes back its arguments, to check
+// the panel's command set is dispatched and listed as main.c registers it.
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "hardware/irq.h"
+#include "hardware/uart.h"
+#include "snon/snon_utils.h"
+
+#include "arena.h"
+#include "commands.h"
+#include "logger.h"
+#include "store.h"
+#include "uart.h"
+#include "writer.h"
+#include "host.h"
+
+// Constants
+#define TEST_PASSES_MAX     100000
+#define TEST_OUTPUT_SIZE    16384
+#define TEST_INPUT_SIZE     256
+#define TEST_DR_EMPTY       0x100                   // Nothing written to the UART data register
+#define TEST_PROMPT         "\r\n1840A > "
+
+// Types
+
+// A line typed at the prompt, and text that has to be in the response to it
+typedef struct
+{
+    const char*     line;
+    const char*     expected;
+} test_step_t;
+
+// Global variables
+char            test_input[TEST_INPUT_SIZE];
+uint16_t        test_input_length = 0;
+uint16_t        test_input_position = 0;
+char            test_output[TEST_OUTPUT_SIZE];
+uint32_t        test_output_length = 0;
+char            test_time[32] = "";
+const char*     test_line = NULL;                   // The line being dispatched
+
+// The shared commands, from commands_initialize()
+const test_step_t   test_shared[] =
+{
+    { "help",                           "\"cat <entity>\"" },
+    { "help",                           "\"set time <iso8601>\"" },
+    { "helpx",                          "Unknown command" },
+    { "help me",                        "\"exit\"" },
+    { "ls",                             "=P01=E003" },
+    { "cat =P01=E002",                  "\"value 2\"" },
+    { "cat =P01=E009",                  "Entity not found" },
+    { "cat",                            "Entity not found" },
+    { "dump",                           "\"value 3\"" },
+    { "dumpx",                          "Unknown command" },
+    { "clear",                          "\033[2J\033[H" },
+    { "log level 3",                    "Log level set to 3" },
+    { "log level 4",                    "Invalid log level" },
+    { "log level x",                    "Invalid log level" },
+    { "get log",                        "Log level: 3" },
+    { "log level 1",                    "Log level set to 1" },
+    { "get",                            "Unknown command" },
+    { "get mem",                        "Free memory: " },
+    { "get uart",                       "Received: " },
+    { "get leds",                       "Frames: " },
+    { "get ledstats",                   "samples" },
+    { "get subs",                       "Subscriptions: " },
+    { "get time",                       "RTC not running" },
+    { "set time 2021-06-01T12:30:00Z",  "Invalid year 2021" },
+    { "set time 2024-13-01T12:30:00Z",  "Invalid month 13" },
+    { "set time 2024-06-01T24:30:00Z",  "Invalid hour 24" },
+    { "set time 2024-06-01T12:30:00Z",  "Time set to 2024-06-01T12:30:00Z" },
+    { "get time",                       "The time is: 2024-06-01T12:30:00Z" },
+    { "set address 1f",                 "Address: 001F, multi-drop off" },
+    { "set address 12345",              "Invalid address" },
+    { "get address",                    "Address: 001F" },
+    { "multidrop maybe",                "Usage: multidrop <on|off>" },
+    { NULL,                             NULL }
+};
+
+// The panel's own commands, as its main.c registers them
+#if defined(TEST_PANEL_1840A)
+const char*     test_panel = "1840A";
+const char*     test_panel_commands[] = { "get hmi", "binary", NULL };
+const test_step_t   test_panel_steps[] =
+{
+    { "get hmi",                        "\r\n[get hmi] \r\n" },
+    { "get hmi now",                    "\r\n[get hmi] now\r\n" },
+    { "binary",                         "\r\n[binary] \r\n" },
+    { "binaryx",                        "Unknown command" },
+    { NULL,                             NULL }
+};
+#elif defined(TEST_PANEL_1841A)
+const char*     test_panel = "1841A";
+const char*     test_panel_commands[] = { "get hmi", NULL };
+const test_step_t   test_panel_steps[] =
+{
+    { "get hmi",                        "\r\n[get hmi] \r\n" },
+    { "get hmix",                       "Unknown command" },
+    { NULL,                             NULL }
+};
+#elif defined(TEST_PANEL_1870A)
+const char*     test_panel = "1870A";
+const char*     test_panel_commands[] = { "ack", "reset", "get alarms", "set sequence", NULL };
+const test_step_t   test_panel_steps[] =
+{
+    { "ack",                            "\r\n[ack] \r\n" },
+    { "reset",                          "\r\n[reset] \r\n" },
+    { "get alarms",                     "\r\n[get alarms] \r\n" },
+    { "get alarms now",                 "\r\n[get alarms] now\r\n" },
+    { "set sequence m fo",              "\r\n[set sequence] m fo\r\n" },
+    { "set sequence   r",               "\r\n[set sequence] r\r\n" },
+    { "set",                            "Unknown command" },
+    { NULL,                             NULL }
+};
+#endif
+
+// Private prototypes
+void test_capture(void);
+void test_panel_command(writer_t* writer, const char* arguments);
+void test_pass(void);
+void test_run(void);
+bool test_step(const test_step_t* step);
+void test_script(const test_step_t* steps);
+void test_help(void);
+void test_exit(void);
+
+// =================================================================================
+// UART. Input comes from what the test has typed, and output is captured as the
+// data register is written.
+
+bool uart_is_readable(uart_inst_t* uart)
+{
+    (void) uart;
+
+    return(test_input_position != test_input_length);
+}
+
+char uart_getc(uart_inst_t* uart)
+{
+    char    character = test_input[test_input_position];
+
+    (void) uart;
+
+    test_input_position = test_input_position + 1;
+
+    return(character);
+}
+
+bool uart_is_writable(uart_inst_t* uart)
+{
+    (void) uart;
+
+    test_capture();
+
+    return(true);
+}
+
+void test_capture(void)
+{
+    uart_hw_t*  hw = uart_get_hw(uart1);
+
+    if(hw->dr != TEST_DR_EMPTY)
+    {
+        HOST_CHECK(test_output_length != TEST_OUTPUT_SIZE - 1);
+
+        if(test_output_length != TEST_OUTPUT_SIZE - 1)
+        {
+            test_output[test_output_length] = hw->dr;
+            test_output_length = test_output_length + 1;
+            test_output[test_output_length] = 0;
+        }
+
+        hw->dr = TEST_DR_EMPTY;
+    }
+}
+
+// mem_utils.c needs the firmware's linker symbols, so "get mem" is given a stand-in
+size_t get_free_ram_2(void)
+{
+    return(0);
+}
+
+// The RTC keeps the time it was last set to, and isn't running until it is set
+bool rtc_set_time(char* time)
+{
+    strcpy(test_time, time);
+    return(true);
+}
+
+bool rtc_counter_to_iso8601(char* buffer, uint64_t counter)
+{
+    (void) counter;
+
+    strcpy(buffer, test_time);
+    return(test_time[0] != 0);
+}
+
+// Stands in for a handler in the panel's main.c
+void test_panel_command(writer_t* writer, const char* arguments)
+{
+    uint16_t    length = strlen(test_line) - strlen(arguments);
+
+    // The name the line was dispatched to, as typed, without the spaces after it
+    while((length != 0) && (test_line[length - 1] == ' '))
+    {
+        length = length - 1;
+    }
+
+    writer_puts(writer, "\r\n[");
+    writer_putn(writer, test_line, length);
+    writer_puts(writer, "] ");
+    writer_puts(writer, arguments);
+    writer_puts(writer, "\r\n");
+}
+
+// =================================================================================
+// Command loop
+
+// One pass of the command loop, in command mode, as the panels' main.c has it
+void test_pass(void)
+{
+    const char* command = NULL;
+    writer_t    writer;
+
+    host_irq(UART1_IRQ);
+    writer_resume();
+
+    command = uart_command_get();
+
+    if(command[0] != 0)
+    {
+        writer_init_uart(&writer, WRITER_MODE_RAW);
+        test_line = command;
+
+        if(command_dispatch(&writer, command) == false)
+        {
+            writer_puts(&writer, "\r\nUnknown command\r\n");
+        }
+
+        writer_flush(&writer);
+        uart_command_clear();
+
+        if(uart_response_pending() == false)
+        {
+            arena_reset(&scratch_arena);
+        }
+    }
+
+    // The last byte written is still in the data register
+    test_capture();
+}
+
+// Runs the loop until everything typed has been answered and sent
+void test_run(void)
+{
+    uint32_t    passes = 0;
+    uint32_t    quiet = 0;
+    uint32_t    output_length = 0;
+
+    while((quiet != 10) && (passes != TEST_PASSES_MAX))
+    {
+        output_length = test_output_length;
+        test_pass();
+        passes = passes + 1;
+
+        if((output_length == test_output_length) && (uart_response_pending() == false) && (test_input_position == test_input_length))
+        {
+            quiet = quiet + 1;
+        }
+        else
+        {
+            quiet = 0;
+        }
+    }
+
+    HOST_CHECK(passes != TEST_PASSES_MAX);
+}
+
+// Types a line at the prompt. The line is echoed, the response has to have the
+// expected text in it, and the prompt has to come back once, at the end.
+bool test_step(const test_step_t* step)
+{
+    char*   response = NULL;
+    char*   prompt = NULL;
+    bool    passed = true;
+
+    test_input_length = 0;
+    test_input_position = 0;
+    test_output_length = 0;
+    test_output[0] = 0;
+
+    memcpy(test_input, step->line, strlen(step->line));
+    test_input_length = strlen(step->line);
+    test_input[test_input_length] = '\r';
+    test_input_length = test_input_length + 1;
+    test_run();
+
+    response = &test_output[strlen(step->line)];
+    prompt = strstr(response, TEST_PROMPT);
+
+    if(strncmp(test_output, step->line, strlen(step->line)) != 0)
+    {
+        passed = false;
+    }
+    else if((prompt == NULL) || (strcmp(prompt, TEST_PROMPT) != 0))
+    {
+        passed = false;
+    }
+    else
+    {
+        *prompt = 0;
+        passed = (strstr(response, step->expected) != NULL);
+        *prompt = '\r';
+    }
+
+    if(passed == false)
+    {
+        printf("%s: \"%s\" expected \"%s\", got \"%s\"\n", test_panel, step->line, step->expected, test_output);
+    }
+
+    return(passed);
+}
+
+void test_script(const test_step_t* steps)
+{
+    while(steps->line != NULL)
+    {
+        HOST_CHECK(test_step(steps) == true);
+        steps = steps + 1;
+    }
+}
+
+// "help" lists every command, shared or the panel's, once and sorted by name
+void test_help(void)
+{
+    test_step_t step = { "help", "" };
+    char*       line = NULL;
+    char*       previous = NULL;
+    uint16_t    listed = 0;
+    uint16_t    counter = 0;
+    char        name[COMMAND_BUFFER_SIZE];
+
+    HOST_CHECK(test_step(&step) == true);
+
+    line = strstr(test_output, "\r\n\"");
+    while(line != NULL)
+    {
+        if(previous != NULL)
+        {
+            HOST_CHECK(strcmp(previous, line) < 0);
+        }
+
+        previous = line;
+        listed = listed + 1;
+        line = strstr(line + 1, "\r\n\"");
+    }
+
+    while(test_panel_commands[counter] != NULL)
+    {
+        snprintf(name, COMMAND_BUFFER_SIZE, "\r\n\"%s\"", test_panel_commands[counter]);
+        HOST_CHECK(strstr(test_output, name) != NULL);
+        counter = counter + 1;
+    }
+
+    HOST_CHECK(listed == 18 + counter);
+}
+
+// "exit" leaves command mode, without a prompt after it
+void test_exit(void)
+{
+    test_input_length = 0;
+    test_input_position = 0;
+    test_output_length = 0;
+
+    strcpy(test_input, "exit\r");
+    test_input_length = strlen(test_input);
+    test_run();
+
+    HOST_CHECK(uart_in_command_mode() == false);
+    HOST_CHECK(strstr(test_output, TEST_PROMPT) == NULL);
+}
+
+int main(void)
+{
+    uint16_t    counter = 0;
+
+    arena_initialize();
+    snon_initialize("Command Test");
+    snon_register("=P01=E001", SNON_CLASS_VALUE, "[\"value 1\"]");
+    snon_register("=P01=E002", SNON_CLASS_VALUE, "[\"value 2\"]");
+    snon_register("=P01=E003", SNON_CLASS_VALUE, "[\"value 3\"]");
+
+    store_initialize();
+    commands_initialize();
+
+    while(test_panel_commands[counter] != NULL)
+    {
+        HOST_CHECK(command_register(test_panel_commands[counter], NULL, "Panel command", test_panel_command) == true);
+        counter = counter + 1;
+    }
+
+    uart_get_hw(uart1)->dr = TEST_DR_EMPTY;
+    uart_setup();
+
+    // Into command mode
+    strcpy(test_input, "\033");
+    test_input_length = 1;
+    test_run();
+    HOST_CHECK(uart_in_command_mode() == true);
+
+    test_script(test_shared);
+    test_script(test_panel_steps);
+    test_help();
+    test_exit();
+
+    printf("%s: %u shared and %u panel commands\n", test_panel, 18, counter);
+
+    return(host_result());
+}
@@ -0,0 +1,265 @@
+// ---------------------------------------------------------------------------------
+// Host test - Entity values
+// ---------------------------------------------------------------------------------
+// Hammers entity_set_values() from one thread, standing in for the core 0 command
+// loop, while two more threads read the same values back, standing in for core 1
+// and the LED timer interrupt. Every value is a run of one letter whose length
+// depends on the letter, so a read that mixes two values is always caught, and
+// the copies keep moving between the 16 and 32 byte value pools. An indicator
+// must only change once the store has taken its new value.
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "snon/snon_utils.h"
+
+#include "entities.h"
+#include "arena.h"
+#include "store.h"
+#include "indicators.h"
+#include "host.h"
+
+// Constants
+#define TEST_ENTITIES       4
+#define TEST_SETS           1000000
+#define TEST_READERS        2
+#define TEST_INDICATOR      "=P01=PFA10"
+
+// Global variables
+const char*         test_names[TEST_ENTITIES] = {"=P01=PFA01", "=P01=PFA02", "=P01=PFA03", "=P01=PFA04"};
+entity_handle_t     test_handles[TEST_ENTITIES];
+volatile bool       test_writing = true;
+uint32_t            test_reads[TEST_READERS];
+uint32_t            test_changes[TEST_READERS];
+uint32_t            test_torn[TEST_READERS];
+
+// Private prototypes
+void test_value(uint32_t counter, char* value);
+bool test_value_valid(const char* value);
+void* test_writer(void* unused);
+void* test_reader(void* reader);
+void test_indicator(void);
+
+// =================================================================================
+
+void subscribe_changed(const char* entity)
+{
+    (void) entity;
+}
+
+// =================================================================================
+
+// Letters A to Z, with lengths 4 to 29
+void test_value(uint32_t counter, char* value)
+{
+    uint8_t letter = counter % 26;
+
+    memset(value, 'A' + letter, 4 + letter);
+    value[4 + letter] = 0;
+}
+
+bool test_value_valid(const char* value)
+{
+    size_t  length = strlen(value);
+    uint8_t counter = 0;
+
+    if((value[0] < 'A') || (value[0] > 'Z') || (length != (size_t) (4 + value[0] - 'A')))
+    {
+        return(false);
+    }
+
+    while(counter != length)
+    {
+        if(value[counter] != value[0])
+        {
+            return(false);
+        }
+
+        counter = counter + 1;
+    }
+
+    return(true);
+}
+
+void* test_writer(void* unused)
+{
+    char        value[ENTITY_VALUE_LENGTH];
+    char        values[ENTITY_VALUE_LENGTH + 8];
+    uint32_t    counter = 0;
+
+    (void) unused;
+
+    host_set_core(0);
+
+    while(counter != TEST_SETS)
+    {
+        test_value(counter, value);
+        snprintf(values, sizeof(values), "[\"%s\"]", value);
+        entity_set_values(entity_get_eid(test_handles[counter % TEST_ENTITIES]), values);
+
+        counter = counter + 1;
+    }
+
+    test_writing = false;
+
+    return(NULL);
+}
+
+void* test_reader(void* reader)
+{
+    uint8_t     index = (uint8_t) (uintptr_t) reader;
+    char        value[ENTITY_VALUE_LENGTH];
+    char        last[TEST_ENTITIES][ENTITY_VALUE_LENGTH] = {{0}};
+    uint8_t     entity = 0;
+
+    host_set_core(1);
+
+    while(test_writing == true)
+    {
+        entity_get_value(test_handles[entity], value, ENTITY_VALUE_LENGTH);
+        test_reads[index] = test_reads[index] + 1;
+
+        if(test_value_valid(value) == false)
+        {
+            test_torn[index] = test_torn[index] + 1;
+        }
+
+        if(strcmp(value, last[entity]) != 0)
+        {
+            strcpy(last[entity], value);
+            test_changes[index] = test_changes[index] + 1;
+        }
+
+        entity = (entity + 1) % TEST_ENTITIES;
+    }
+
+    return(NULL);
+}
+
+// Values that aren't indicator states are refused before they reach the store,
+// and values the store refuses leave the indicator as it was
+void test_indicator(void)
+{
+    char                eid[SNON_URN_LENGTH];
+    indicator_handle_t  handle = INDICATOR_NONE;
+    uint32_t            rejected = 0;
+
+    indicators_initialize();
+    handle = indicator_register(TEST_INDICATOR);
+    snon_name_to_eid(TEST_INDICATOR, eid);
+    rejected = indicator_get_stats()->rejected;
+
+    HOST_CHECK(entity_set_values(eid, "[\"vita40_red_steady\"]") == true);
+    HOST_CHECK(indicator_get_state(handle) == indicator_parse("vita40_red_steady"));
+    HOST_CHECK(strcmp(store_get_value(store_find(TEST_INDICATOR)), "vita40_red_steady") == 0);
+
+    HOST_CHECK(entity_set_values(eid, "[\"vita40_purple\"]") == false);
+    HOST_CHECK(indicator_get_state(handle) == indicator_parse("vita40_red_steady"));
+    HOST_CHECK(strcmp(store_get_value(store_find(TEST_INDICATOR)), "vita40_red_steady") == 0);
+    HOST_CHECK(indicator_get_stats()->rejected == rejected + 1);
+
+    // A known state, but not an array, so the store won't take it
+    HOST_CHECK(entity_set_values(eid, "\"vita40_blue_steady\"") == false);
+    HOST_CHECK(indicator_get_state(handle) == indicator_parse("vita40_red_steady"));
+    HOST_CHECK(strcmp(store_get_value(store_find(TEST_INDICATOR)), "vita40_red_steady") == 0);
+
+    // The store keeps the array as it was sent
+    HOST_CHECK(entity_set_values(eid, "[\"vita40_green_steady\", 1]") == true);
+    HOST_CHECK(strcmp(store_get_values(store_find(TEST_INDICATOR)), "[\"vita40_green_steady\", 1]") == 0);
+    HOST_CHECK(indicator_get_state(handle) == indicator_parse("vita40_green_steady"));
+}
+
+int main(void)
+{
+    pthread_t   writer;
+    pthread_t   readers[TEST_READERS];
+    char        value[ENTITY_VALUE_LENGTH];
+    char        long_value[64];
+    uint8_t     counter = 0;
+
+    arena_initialize();
+    snon_initialize("Entity Test");
+
+    while(counter != TEST_ENTITIES)
+    {
+        test_value(0, value);
+        snprintf(long_value, sizeof(long_value), "[\"%s\"]", value);
+        snon_register((char*) test_names[counter], SNON_CLASS_VALUE, long_value);
+        counter = counter + 1;
+    }
+
+    snon_register(TEST_INDICATOR, SNON_CLASS_VALUE, "[\"vita40_off\"]");
+    store_initialize();
+    HOST_CHECK(store_get_count() == TEST_ENTITIES + 2);
+    counter = 0;
+
+    while(counter != TEST_ENTITIES)
+    {
+        test_handles[counter] = entity_register(test_names[counter], 1u << counter);
+        HOST_CHECK(test_handles[counter] == counter);
+
+        counter = counter + 1;
+    }
+
+    // Lookups by name and eID find the same entity
+    HOST_CHECK(entity_find_name("=P01=PFA03") == test_handles[2]);
+    HOST_CHECK(entity_find_eid(entity_get_eid(test_handles[2])) == test_handles[2]);
+    HOST_CHECK(entity_find_name("=P01=PFA99") == ENTITY_INVALID);
+
+    // Values too long for the copies are cut short, and counted
+    HOST_CHECK(entity_set_values(entity_get_eid(test_handles[0]), "[\"0123456789012345678901234567890123456789\"]") == true);
+    HOST_CHECK(entity_get_value(test_handles[0], value, ENTITY_VALUE_LENGTH) == true);
+    HOST_CHECK(strlen(value) == ENTITY_VALUE_LENGTH - 1);
+    HOST_CHECK(entity_get_stats()->truncated == 1);
+    HOST_CHECK(entity_get_value(ENTITY_INVALID, value, ENTITY_VALUE_LENGTH) == false);
+    test_value(0, value);
+    snprintf(long_value, sizeof(long_value), "[\"%s\"]", value);
+    entity_set_values(entity_get_eid(test_handles[0]), long_value);
+
+    // Readers never see a value part way through being written
+    counter = 0;
+
+    while(counter != TEST_READERS)
+    {
+        pthread_create(&readers[counter], NULL, test_reader, (void*) (uintptr_t) counter);
+        counter = counter + 1;
+    }
+
+    pthread_create(&writer, NULL, test_writer, NULL);
+    pthread_join(writer, NULL);
+    counter = 0;
+
+    while(counter != TEST_READERS)
+    {
+        pthread_join(readers[counter], NULL);
+        printf("Reader %u: %lu reads, %lu changes seen, %lu torn\n", counter, (unsigned long) test_reads[counter], (unsigned long) test_changes[counter], (unsigned long) test_torn[counter]);
+        HOST_CHECK(test_torn[counter] == 0);
+        HOST_CHECK(test_changes[counter] != 0);
+
+        counter = counter + 1;
+    }
+
+    // Once the writer is done, every entity holds the last value set for it
+    counter = 0;
+
+    while(counter != TEST_ENTITIES)
+    {
+        char    expected[ENTITY_VALUE_LENGTH];
+
+        test_value(TEST_SETS - TEST_ENTITIES + counter, expected);
+        entity_get_value(test_handles[counter], value, ENTITY_VALUE_LENGTH);
+        HOST_CHECK(strcmp(value, expected) == 0);
+
+        counter = counter + 1;
+    }
+
+    test_indicator();
+
+    return(host_result());
+}
@@ -0,0 +1,202 @@
+// ---------------------------------------------------------------------------------
+// Host test - JSON tokenizer
+// ---------------------------------------------------------------------------------
+// Checks json_tok against the client JSON parser (and against cJSON, when the snon
+// submodule is checked out): known documents, generated SNON fragments and
+// batches, and the same documents with a few characters broken
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+extern "C"
+{
+#include "host.h"
+}
+
+#include "json_tok_compare.h"
+#include "json_tok_generate.h"
+
+#ifdef TEST_CJSON
+#include "cJSON.h"
+#endif
+
+// Constants
+#define TEST_DOCUMENTS      20000
+#define TEST_MUTATIONS      200000
+#define TEST_TOKENS         256
+
+// Types
+typedef struct
+{
+    const char* json;
+    bool        valid;
+} test_case_t;
+
+// Global variables
+static const test_case_t test_cases[] =
+{
+    {"{\"eID\":\"urn:uuid:254CB903-3406-5B2A-A6DD-9DEA8A0DB148\",\"v\":[\"vita40_amber_steady\"]}", true},
+    {"[{\"eID\":\"x\",\"v\":[\"1\",\"2\"]},{\"eID\":\"y\",\"v\":[3]}]", true},
+    {"{\"a\":{\"b\":[1,{\"c\":2}]},\"v\":[\"q\\\"x\"]}", true},
+    {"  {\"a\" : 1 }\r\n", true},
+    {"{}", true},
+    {"[]", true},
+    {"[[]]", true},
+    {"{\"\":\"\"}", true},
+    {"\"x\"", true},
+    {"1", true},
+    {"{\"a\",:1}", false},
+    {"{\"a\",\"b\":1}", false},
+    {"{\"a\":1,\"b\"}", false},
+    {"{\"a\"}", false},
+    {"{\"a\":}", false},
+    {"{\"a\":1,}", false},
+    {"{\"a\" \"b\"}", false},
+    {"{\"a\":1:2}", false},
+    {"{\"a\"::1}", false},
+    {"{1:2}", false},
+    {"[1,]", false},
+    {"[,1]", false},
+    {"[1 2]", false},
+    {"[\"a\"1]", false},
+    {"{\"a\"", false},
+    {"{} {}", false},
+    {"{]", false},
+    {"[}", false},
+    {"]", false},
+    {"", false},
+    {"   ", false},
+    {"[\"\\x\"]", false},
+    {"[\"a\nb\"]", false},
+    {NULL, false}
+};
+
+// Private prototypes
+static void test_known(void);
+static void test_generated(void);
+static void test_mutated(void);
+
+// =================================================================================
+
+static void test_known(void)
+{
+    json_tok_t  tokens[TEST_TOKENS];
+    std::string detail;
+    int         counter = 0;
+
+    while(test_cases[counter].json != NULL)
+    {
+        const char* json = test_cases[counter].json;
+        int16_t     count = json_tok_parse(json, strlen(json), tokens, TEST_TOKENS);
+
+        if((count > 0) != test_cases[counter].valid)
+        {
+            printf("%s: json_tok returned %d\n", json, count);
+        }
+
+        HOST_CHECK((count > 0) == test_cases[counter].valid);
+        HOST_CHECK(json_compare(json, &detail) != JSON_COMPARE_DIFFERENT);
+
+        counter = counter + 1;
+    }
+
+    // Keys and values are found in place
+    {
+        const char* json = test_cases[0].json;
+        int16_t     count = json_tok_parse(json, strlen(json), tokens, TEST_TOKENS);
+        int16_t     value = json_tok_find_key(json, tokens, count, 0, "v");
+        char        buffer[32];
+
+        HOST_CHECK(value > 0);
+        HOST_CHECK(tokens[value].type == JSON_TOK_ARRAY);
+        HOST_CHECK(tokens[value].size == 1);
+        HOST_CHECK(json_tok_copy(json, &tokens[value + 1], buffer, sizeof(buffer)) == 19);
+        HOST_CHECK(strcmp(buffer, "vita40_amber_steady") == 0);
+        HOST_CHECK(json_tok_equals(json, &tokens[json_tok_find_key(json, tokens, count, 0, "eID")], "urn:uuid:254CB903-3406-5B2A-A6DD-9DEA8A0DB148") == true);
+        HOST_CHECK(json_tok_find_key(json, tokens, count, 0, "rID") == -1);
+        HOST_CHECK(json_tok_skip(tokens, count, 0) == count);
+    }
+
+    // Running out of tokens is reported as such
+    HOST_CHECK(json_tok_parse(test_cases[1].json, strlen(test_cases[1].json), tokens, 4) == JSON_TOK_ERROR_NOMEM);
+}
+
+// Every generated document is valid JSON, so both must accept it and agree on it
+static void test_generated(void)
+{
+    json_generator  generator(1);
+    std::string     detail;
+    uint32_t        different = 0;
+    uint32_t        counter = 0;
+
+    while(counter != TEST_DOCUMENTS)
+    {
+        std::string document = generator.document();
+        std::string canonical;
+
+        HOST_CHECK(json_compare_tokens(document, canonical) == true);
+
+        if(json_compare(document, &detail) == JSON_COMPARE_DIFFERENT)
+        {
+            if(different < 10)
+            {
+                printf("%s\n    %s\n", document.c_str(), detail.c_str());
+            }
+
+            different = different + 1;
+        }
+
+#ifdef TEST_CJSON
+        cJSON*  parsed = cJSON_ParseWithOpts(document.c_str(), NULL, 1);
+
+        HOST_CHECK(parsed != NULL);
+        cJSON_Delete(parsed);
+#endif
+
+        counter = counter + 1;
+    }
+
+    printf("Generated documents: %u, %u different\n", TEST_DOCUMENTS, different);
+    HOST_CHECK(different == 0);
+}
+
+// Broken documents must be refused by both, or accepted by both with the same values
+static void test_mutated(void)
+{
+    json_generator  generator(2);
+    std::string     detail;
+    uint32_t        results[3] = {0, 0, 0};
+    uint32_t        counter = 0;
+
+    while(counter != TEST_MUTATIONS)
+    {
+        std::string     document = generator.mutate(generator.document());
+        json_compare_t  result = json_compare(document, &detail);
+
+        if((result == JSON_COMPARE_DIFFERENT) && (results[JSON_COMPARE_DIFFERENT] < 10))
+        {
+            printf("%s\n    %s\n", document.c_str(), detail.c_str());
+        }
+
+        results[result] = results[result] + 1;
+        counter = counter + 1;
+    }
+
+    printf("Mutated documents: %u same, %u skipped, %u different\n", results[JSON_COMPARE_SAME], results[JSON_COMPARE_SKIPPED], results[JSON_COMPARE_DIFFERENT]);
+    HOST_CHECK(results[JSON_COMPARE_DIFFERENT] == 0);
+    HOST_CHECK(results[JSON_COMPARE_SAME] > (TEST_MUTATIONS / 2));
+}
+
+int main(void)
+{
+    test_known();
+    test_generated();
+    test_mutated();
+
+    return(host_result());
+}
@@ -0,0 +1,304 @@
+// ---------------------------------------------------------------------------------
+// Host test - Run-length annunciator frames
+// ---------------------------------------------------------------------------------
+// The 1870A sends its annunciator windows as runs of one colour, which a pair of
+// DMA channels expand as they send them. The channel pair is modelled from the way
+// ledstrip_init_runs() sets it up, and every frame it would send must match, bit
+// for bit, the full frame ledmap_render() draws from the same map. The windows are
+// given random states over a few thousand LED timer ticks, so that flashing and
+// fading colours are covered.
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "pico/stdlib.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+
+#include "indicators.h"
+#include "ledmap.h"
+#include "ledstrip.h"
+#include "front_panel_leds.h"
+#include "snon/snon_utils.h"
+#include "host.h"
+
+// Constants
+#define TEST_TICKS              5000
+#define TEST_CHANGE_EVERY       5           // One tick in five changes a window, on average
+#define TEST_STATES             6
+
+// DMA settings kept in dma_channel_config.ctrl by the overrides below
+#define TEST_DMA_READ_INCREMENT     0x0001
+#define TEST_DMA_WRITE_INCREMENT    0x0002
+#define TEST_DMA_RING_WRITE         0x0004
+#define TEST_DMA_IRQ_QUIET          0x0008
+#define TEST_DMA_RING_SHIFT         4       // Ring size bits
+#define TEST_DMA_CHAIN_SHIFT        8       // Chain to, or the channel itself for none
+#define TEST_DMA_CHAINED            0x1000
+
+// Types
+typedef struct
+{
+    uint32_t            ctrl;
+    volatile void*      write_addr;
+    const volatile void* read_addr;
+    uint32_t            transfer_count;
+} test_channel_t;
+
+typedef struct
+{
+    bool        changed;
+    uint32_t    pixels[FRONT_PANEL_LEDS_PIXELS];
+} test_frame_t;
+
+// Global variables
+const char*         test_states[TEST_STATES] = {"vita40_red_steady", "vita40_amber_slow", "vita40_white_fast", "vita40_off", "vita40_green_standby",
+                                               "vita40_green_slow"};
+test_channel_t      test_channels[HOST_DMA_CHANNELS];
+int                 test_dma_done = -1;
+indicator_handle_t  test_full_handles[FRONT_PANEL_LEDS_ENTRIES];
+uint32_t            test_full_colours[FRONT_PANEL_LEDS_ENTRIES];
+indicator_handle_t  test_run_handles[FRONT_PANEL_LEDS_ENTRIES];
+uint32_t            test_run_colours[FRONT_PANEL_LEDS_ENTRIES];
+ledmap_t            test_full_map = {front_panel_leds, FRONT_PANEL_LEDS_ENTRIES, FRONT_PANEL_LEDS_PIXELS, test_full_handles, test_full_colours, NULL, 0, false, 0};
+ledmap_t            test_run_map = {front_panel_leds, FRONT_PANEL_LEDS_ENTRIES, FRONT_PANEL_LEDS_PIXELS, test_run_handles, test_run_colours, NULL, 0, false, 0};
+ledstrip_t          test_strip;
+ledstrip_run_t      test_runs[FRONT_PANEL_LEDS_ENTRIES + 1];
+uint32_t            test_strip_colours[FRONT_PANEL_LEDS_ENTRIES];
+uint32_t            test_sent[FRONT_PANEL_LEDS_PIXELS * 2];
+uint32_t            test_sent_count = 0;
+
+// Private prototypes
+void test_expand(const ledstrip_run_t* block);
+void test_check_channels(void);
+void test_change(void);
+void test_full_frames(test_frame_t* frames);
+
+// =================================================================================
+// DMA. The settings are kept so that the channel pair can be checked, and
+// triggering the control channel sends the whole frame.
+
+void channel_config_set_read_increment(dma_channel_config* config, bool increment)
+{
+    config->ctrl = (config->ctrl & ~TEST_DMA_READ_INCREMENT) | (increment ? TEST_DMA_READ_INCREMENT : 0);
+}
+
+void channel_config_set_write_increment(dma_channel_config* config, bool increment)
+{
+    config->ctrl = (config->ctrl & ~TEST_DMA_WRITE_INCREMENT) | (increment ? TEST_DMA_WRITE_INCREMENT : 0);
+}
+
+void channel_config_set_ring(dma_channel_config* config, bool write, uint size_bits)
+{
+    config->ctrl = config->ctrl | (write ? TEST_DMA_RING_WRITE : 0) | (size_bits << TEST_DMA_RING_SHIFT);
+}
+
+void channel_config_set_chain_to(dma_channel_config* config, uint chain_to)
+{
+    config->ctrl = config->ctrl | TEST_DMA_CHAINED | (chain_to << TEST_DMA_CHAIN_SHIFT);
+}
+
+void channel_config_set_irq_quiet(dma_channel_config* config, bool irq_quiet)
+{
+    config->ctrl = config->ctrl | (irq_quiet ? TEST_DMA_IRQ_QUIET : 0);
+}
+
+void dma_channel_configure(uint channel, const dma_channel_config* config, volatile void* write_addr, const volatile void* read_addr, uint transfer_count, bool trigger)
+{
+    (void) trigger;
+
+    test_channels[channel].ctrl = config->ctrl;
+    test_channels[channel].write_addr = write_addr;
+    test_channels[channel].read_addr = read_addr;
+    test_channels[channel].transfer_count = transfer_count;
+}
+
+void dma_channel_set_read_addr(uint channel, const volatile void* read_addr, bool trigger)
+{
+    HOST_CHECK((int) channel == test_strip.control_channel);
+    HOST_CHECK(trigger == true);
+
+    test_expand((const ledstrip_run_t*) read_addr);
+}
+
+bool dma_channel_get_irq0_status(uint channel)
+{
+    return((int) channel == test_dma_done);
+}
+
+// The transmit times aren't under test
+void ledstats_record(uint8_t histogram, uint32_t elapsed_us)
+{
+    (void) histogram;
+    (void) elapsed_us;
+}
+
+// =================================================================================
+
+// The control channel loads one block into the data channel's count and read
+// address trigger, and the data channel sends the colour that many times before
+// chaining back. The block with no colour is a null trigger, which stops the chain
+// and raises the interrupt.
+void test_expand(const ledstrip_run_t* block)
+{
+    uint32_t    counter = 0;
+
+    test_sent_count = 0;
+
+    while(block->colour != NULL)
+    {
+        counter = 0;
+
+        while((counter != block->count) && (test_sent_count != FRONT_PANEL_LEDS_PIXELS * 2))
+        {
+            test_sent[test_sent_count] = *block->colour;
+            test_sent_count = test_sent_count + 1;
+            counter = counter + 1;
+        }
+
+        block = block + 1;
+    }
+
+    HOST_CHECK(block->count == 0);
+
+    test_dma_done = test_strip.dma_channel;
+    host_irq(DMA_IRQ_0);
+    test_dma_done = -1;
+}
+
+// The channel pair works the way test_expand() assumes
+void test_check_channels(void)
+{
+    const test_channel_t*   data = &test_channels[test_strip.dma_channel];
+    const test_channel_t*   control = &test_channels[test_strip.control_channel];
+
+    // Each run is one colour word sent again and again to the FIFO, and the end of
+    // a run goes back to the control channel without an interrupt
+    HOST_CHECK((data->ctrl & (TEST_DMA_READ_INCREMENT | TEST_DMA_WRITE_INCREMENT)) == 0);
+    HOST_CHECK((data->ctrl & TEST_DMA_CHAINED) != 0);
+    HOST_CHECK(((data->ctrl >> TEST_DMA_CHAIN_SHIFT) & 0x0F) == (uint32_t) test_strip.control_channel);
+    HOST_CHECK((data->ctrl & TEST_DMA_IRQ_QUIET) != 0);
+    HOST_CHECK(data->write_addr == &test_strip.pio->txf[test_strip.sm]);
+
+    // Each block is written to the count and then the read address trigger, with
+    // the write address going back to the count every two words
+    HOST_CHECK((control->ctrl & (TEST_DMA_READ_INCREMENT | TEST_DMA_WRITE_INCREMENT)) == (TEST_DMA_READ_INCREMENT | TEST_DMA_WRITE_INCREMENT));
+    HOST_CHECK((control->ctrl & TEST_DMA_RING_WRITE) != 0);
+    HOST_CHECK(((control->ctrl >> TEST_DMA_RING_SHIFT) & 0x0F) == 3);
+    HOST_CHECK(control->write_addr == &dma_hw->ch[test_strip.dma_channel].al3_transfer_count);
+    HOST_CHECK(&dma_hw->ch[test_strip.dma_channel].al3_read_addr_trig == &dma_hw->ch[test_strip.dma_channel].al3_transfer_count + 1);
+    HOST_CHECK(control->transfer_count == 2);
+    HOST_CHECK(control->read_addr == test_runs);
+}
+
+// Gives a random window a random state now and then, the same way on every run
+void test_change(void)
+{
+    char        name[32];
+    char        eid[SNON_URN_LENGTH];
+    char        values[64];
+
+    if((rand() % TEST_CHANGE_EVERY) == 0)
+    {
+        sprintf(name, "=P01=PFA%02u", 1 + (rand() % FRONT_PANEL_LEDS_ENTRIES));
+        sprintf(values, "[\"%s\"]", test_states[rand() % TEST_STATES]);
+        snon_name_to_eid(name, eid);
+        HOST_CHECK(indicator_set_values(eid, values) == true);
+    }
+}
+
+// Draws a full frame on every tick that changes anything, as the 1870A did
+// before it sent runs
+void test_full_frames(test_frame_t* frames)
+{
+    uint32_t    tick = 0;
+
+    HOST_CHECK(ledmap_initialize(&test_full_map) == true);
+    srand(1);
+
+    while(tick != TEST_TICKS)
+    {
+        test_change();
+        frames[tick].changed = ledmap_render(&test_full_map, indicator_phase(tick), frames[tick].pixels);
+        tick = tick + 1;
+    }
+}
+
+int main(void)
+{
+    test_frame_t*   full_frames = NULL;
+    uint32_t        tick = 0;
+    uint32_t        frames = 0;
+    uint32_t        wrong = 0;
+    bool            changed = false;
+    pid_t           child = 0;
+    int             status = 0;
+
+    snon_initialize("1870A");
+    indicators_initialize();
+
+    // The maps take changes from the indicators as they draw, so the full frames
+    // are drawn in a process of their own from the same changes
+    full_frames = mmap(NULL, TEST_TICKS * sizeof(test_frame_t), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    HOST_CHECK(full_frames != MAP_FAILED);
+
+    fflush(stdout);
+    child = fork();
+
+    if(child == 0)
+    {
+        test_full_frames(full_frames);
+        _exit(0);
+    }
+
+    waitpid(child, &status, 0);
+    HOST_CHECK((WIFEXITED(status) != 0) && (WEXITSTATUS(status) == 0));
+
+    HOST_CHECK(ledmap_initialize(&test_run_map) == true);
+    HOST_CHECK(ledstrip_init_runs(&test_strip, pio1, 2, 800000, test_runs, test_strip_colours, FRONT_PANEL_LEDS_ENTRIES) == true);
+    HOST_CHECK(ledmap_runs(&test_run_map, &test_strip) == true);
+    HOST_CHECK(test_strip.pixel_count == FRONT_PANEL_LEDS_PIXELS);
+    test_check_channels();
+
+    srand(1);
+
+    while(tick != TEST_TICKS)
+    {
+        test_change();
+        changed = ledmap_update(&test_run_map, indicator_phase(tick));
+
+        if(changed == true)
+        {
+            HOST_CHECK(ledstrip_show_runs(&test_strip, test_run_map.colours) == true);
+            frames = frames + 1;
+        }
+
+        // Runs are sent on the same ticks as full frames, with the same pixels
+        if((changed != full_frames[tick].changed) ||
+           ((changed == true) && ((test_sent_count != FRONT_PANEL_LEDS_PIXELS) || (memcmp(test_sent, full_frames[tick].pixels, sizeof(full_frames[tick].pixels)) != 0))))
+        {
+            wrong = wrong + 1;
+        }
+
+        tick = tick + 1;
+    }
+
+    printf("%lu frames of %u pixels sent as %u runs, %lu different\n", (unsigned long) frames, FRONT_PANEL_LEDS_PIXELS, FRONT_PANEL_LEDS_ENTRIES,
+           (unsigned long) wrong);
+    HOST_CHECK(frames > TEST_TICKS / 10);
+    HOST_CHECK(wrong == 0);
+    HOST_CHECK(test_strip.busy == false);
+    HOST_CHECK(test_strip.frames == frames);
+
+    munmap(full_frames, TEST_TICKS * sizeof(test_frame_t));
+
+    return(host_result());
+}
@@ -0,0 +1,351 @@
+// ---------------------------------------------------------------------------------
+// Host test - LED timing statistics
+// ---------------------------------------------------------------------------------
+// Drives the LED timing histograms from a simulated LED timer, with ticks that
+// start a little late, now and then very late, and now and then not at all, across
+// the 32 bit microsecond counter wrapping. Every bucket, count and maximum must
+// match what the simulated timer did, and the histograms must be copied to the
+// value store no more often than LEDSTATS_PUBLISH_MS, and only when they have
+// changed.
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+
+#include "ledstats.h"
+#include "animation.h"
+#include "arena.h"
+#include "store.h"
+#include "snon/snon_utils.h"
+#include "host.h"
+
+// Constants
+#define TEST_PERIOD_US      (ANIMATION_FRAME_MS * 1000)
+#define TEST_TICKS          50000
+#define TEST_WRAP_TICKS     100                     // Ticks before the microsecond counter wraps
+#define TEST_WRAP_US        0x100000000ull
+#define TEST_VALUES_LENGTH  256
+
+// Types
+
+// What the histograms should hold
+typedef struct
+{
+    uint32_t    buckets[LEDSTATS_BUCKETS];
+    uint32_t    count;
+    uint32_t    last_us;
+    uint32_t    max_us;
+    uint64_t    total_us;
+} test_histogram_t;
+
+// Global variables
+test_histogram_t    test_expected[LEDSTATS_COUNT];
+uint32_t            test_published[LEDSTATS_COUNT];
+uint64_t            test_published_at[LEDSTATS_COUNT];
+uint32_t            test_early = 0;                 // Histograms copied to the store too soon
+uint32_t            test_wrong = 0;                 // Histograms copied to the store with the wrong buckets
+
+// Private prototypes
+uint8_t test_bucket(uint32_t elapsed_us);
+void test_record(uint8_t histogram, uint32_t elapsed_us);
+void test_values(uint8_t histogram, char* values);
+void test_compare(void);
+void test_buckets(void);
+void test_timer(void);
+void test_publish(void);
+
+// =================================================================================
+
+// Called by ledstats_publish() after each histogram is copied to the store
+void subscribe_changed(const char* entity)
+{
+    char        expected[TEST_VALUES_LENGTH];
+    const char* values = NULL;
+    uint8_t     histogram = 0;
+
+    while(histogram != LEDSTATS_COUNT)
+    {
+        if(strcmp(entity, ledstats_get(histogram)->name) == 0)
+        {
+            if((test_published[histogram] != 0) && ((host_clock_now_us() - test_published_at[histogram]) < (LEDSTATS_PUBLISH_MS * 1000)))
+            {
+                test_early = test_early + 1;
+            }
+
+            test_values(histogram, expected);
+            values = store_get_values(store_find(entity));
+
+            if((values == NULL) || (strcmp(values, expected) != 0))
+            {
+                test_wrong = test_wrong + 1;
+            }
+
+            test_published[histogram] = test_published[histogram] + 1;
+            test_published_at[histogram] = host_clock_now_us();
+        }
+
+        histogram = histogram + 1;
+    }
+}
+
+// The largest power of two no more than the time, counted from 1 us
+uint8_t test_bucket(uint32_t elapsed_us)
+{
+    uint8_t     bucket = LEDSTATS_BUCKETS - 1;
+
+    while((bucket != 0) && (elapsed_us < (1UL << bucket)))
+    {
+        bucket = bucket - 1;
+    }
+
+    return(bucket);
+}
+
+void test_record(uint8_t histogram, uint32_t elapsed_us)
+{
+    test_histogram_t*   expected = &test_expected[histogram];
+    uint8_t             bucket = test_bucket(elapsed_us);
+
+    expected->buckets[bucket] = expected->buckets[bucket] + 1;
+    expected->count = expected->count + 1;
+    expected->last_us = elapsed_us;
+    expected->total_us = expected->total_us + elapsed_us;
+
+    if(elapsed_us > expected->max_us)
+    {
+        expected->max_us = elapsed_us;
+    }
+}
+
+// The SNON value a histogram should be copied to SNON as
+void test_values(uint8_t histogram, char* values)
+{
+    uint16_t    length = 0;
+    uint8_t     bucket = 0;
+
+    for(bucket = 0; bucket != LEDSTATS_BUCKETS; bucket++)
+    {
+        length = length + snprintf(&values[length], TEST_VALUES_LENGTH - length, "%s\"%lu\"", (bucket == 0) ? "[" : ",",
+                                   (unsigned long) test_expected[histogram].buckets[bucket]);
+    }
+
+    snprintf(&values[length], TEST_VALUES_LENGTH - length, "]");
+}
+
+void test_compare(void)
+{
+    const ledstats_histogram_t* stats = NULL;
+    test_histogram_t*           expected = NULL;
+    uint8_t                     histogram = 0;
+
+    for(histogram = 0; histogram != LEDSTATS_COUNT; histogram++)
+    {
+        stats = ledstats_get(histogram);
+        expected = &test_expected[histogram];
+
+        printf("%-24s %6lu samples, %5lu us max\n", stats->name, (unsigned long) stats->count, (unsigned long) stats->max_us);
+        HOST_CHECK(memcmp(stats->buckets, expected->buckets, sizeof(expected->buckets)) == 0);
+        HOST_CHECK(stats->count == expected->count);
+        HOST_CHECK(stats->last_us == expected->last_us);
+        HOST_CHECK(stats->max_us == expected->max_us);
+        HOST_CHECK(stats->total_us == expected->total_us);
+    }
+}
+
+// Each bucket starts at a power of two
+void test_buckets(void)
+{
+    const uint32_t  times[] = {0, 1, 2, 3, 4, 1023, 1024, 20000, 32767, 32768, 65536, 0xFFFFFFFF};
+    const uint8_t   buckets[] = {0, 0, 1, 1, 2, 9, 10, 14, 14, 15, 15, 15};
+    uint32_t        elapsed_us = 0;
+    uint8_t         counter = 0;
+
+    for(counter = 0; counter != sizeof(buckets); counter++)
+    {
+        HOST_CHECK(ledstats_bucket(times[counter]) == buckets[counter]);
+    }
+
+    for(elapsed_us = 0; elapsed_us != 0x20000; elapsed_us++)
+    {
+        HOST_CHECK(ledstats_bucket(elapsed_us) == test_bucket(elapsed_us));
+    }
+}
+
+// Runs the LED timer callback the way hmi.c does, and compares the histograms with
+// what the simulated timer did. The first tick is where counting starts, so isn't
+// recorded. After that, each tick is measured from the tick counting started at,
+// a whole number of periods on, until a tick is a whole period out, which lost a
+// tick and starts the counting again.
+void test_timer(void)
+{
+    uint64_t    scheduled_us = TEST_WRAP_US - (TEST_WRAP_TICKS * TEST_PERIOD_US) - 10;
+    uint64_t    origin_us = 0;
+    uint64_t    started_us = 0;
+    uint64_t    due_us = 0;
+    uint32_t    ticks = 0;                          // Since counting started
+    uint32_t    tick = 0;
+    uint32_t    late_us = 0;
+    uint32_t    start_us = 0;
+    uint32_t    elapsed_us = 0;
+    uint32_t    lost = 0;
+    uint32_t    wrapped = 0;                        // Ticks due before the counter wrapped that started after
+    int64_t     jitter_us = 0;
+
+    host_clock_set(scheduled_us);
+    ledstats_initialize();
+    arena_initialize();
+    store_initialize();
+
+    for(tick = 0; tick != TEST_TICKS; tick++)
+    {
+        // Mostly a few us late, sometimes by up to a period and a half, and
+        // sometimes the tick doesn't happen
+        late_us = rand() % 40;
+
+        if((rand() % 20) == 0)
+        {
+            late_us = rand() % (TEST_PERIOD_US + (TEST_PERIOD_US / 2));
+        }
+
+        if((tick != 0) && ((rand() % 200) == 0))
+        {
+            scheduled_us = scheduled_us + TEST_PERIOD_US;
+            lost = lost + 1;
+        }
+
+        // The tick due last before the counter wraps starts just after it
+        due_us = origin_us + ((uint64_t) (ticks + 1) * TEST_PERIOD_US);
+
+        if((tick != 0) && (due_us < TEST_WRAP_US) && (scheduled_us < TEST_WRAP_US) && ((due_us + TEST_PERIOD_US) > TEST_WRAP_US))
+        {
+            late_us = (TEST_WRAP_US - scheduled_us) + (rand() % 40);
+        }
+
+        // A tick can't start until the one before has finished
+        if(scheduled_us + late_us > host_clock_now_us())
+        {
+            host_clock_set(scheduled_us + late_us);
+        }
+
+        started_us = host_clock_now_us();
+        wrapped = wrapped + (((tick != 0) && (due_us < TEST_WRAP_US) && (started_us >= TEST_WRAP_US)) ? 1 : 0);
+        start_us = time_us_32();
+        ledstats_tick(start_us, TEST_PERIOD_US);
+
+        if(tick == 0)
+        {
+            origin_us = started_us;
+            ticks = 0;
+        }
+        else
+        {
+            ticks = ticks + 1;
+            jitter_us = (int64_t) started_us - (int64_t) (origin_us + ((uint64_t) ticks * TEST_PERIOD_US));
+
+            if(jitter_us < 0)
+            {
+                jitter_us = -jitter_us;
+            }
+
+            test_record(LEDSTATS_JITTER, (uint32_t) jitter_us);
+
+            if(jitter_us >= TEST_PERIOD_US)
+            {
+                origin_us = started_us;
+                ticks = 0;
+            }
+        }
+
+        // Working out the frame, mostly quick, sometimes over the period, which
+        // makes the next tick late
+        host_clock_advance((rand() % 8) == 0 ? rand() % 40000 : rand() % 2000);
+        elapsed_us = time_us_32() - start_us;
+        ledstats_record(LEDSTATS_COMPUTE, elapsed_us);
+        test_record(LEDSTATS_COMPUTE, elapsed_us);
+
+        // Sending it, from the DMA interrupt
+        elapsed_us = 3000 + (rand() % 5000);
+        ledstats_record(LEDSTATS_TRANSMIT, elapsed_us);
+        test_record(LEDSTATS_TRANSMIT, elapsed_us);
+
+        ledstats_publish();
+
+        scheduled_us = scheduled_us + TEST_PERIOD_US;
+    }
+
+    printf("%u ticks, %lu lost, clock wrapped after %u\n", TEST_TICKS, (unsigned long) lost, TEST_WRAP_TICKS);
+    HOST_CHECK(wrapped == 1);
+    HOST_CHECK(test_expected[LEDSTATS_JITTER].count == TEST_TICKS - 1);
+    HOST_CHECK(test_expected[LEDSTATS_JITTER].max_us >= TEST_PERIOD_US);
+
+    test_compare();
+}
+
+// Copied to SNON every LEDSTATS_PUBLISH_MS while the histograms keep changing, and
+// not at all once they stop
+void test_publish(void)
+{
+    uint32_t    periods = (TEST_TICKS * (uint64_t) TEST_PERIOD_US) / (LEDSTATS_PUBLISH_MS * 1000);
+    uint32_t    published[LEDSTATS_COUNT];
+    uint8_t     histogram = 0;
+
+    printf("Published %lu, %lu and %lu times in %lu publish periods\n", (unsigned long) test_published[0], (unsigned long) test_published[1],
+           (unsigned long) test_published[2], (unsigned long) periods);
+
+    HOST_CHECK(test_early == 0);
+    HOST_CHECK(test_wrong == 0);
+
+    for(histogram = 0; histogram != LEDSTATS_COUNT; histogram++)
+    {
+        // The 20 ms ticks land up to a tick after each publish period
+        HOST_CHECK(test_published[histogram] >= ((periods * ANIMATION_FRAME_MS) / (ANIMATION_FRAME_MS + 1)));
+        HOST_CHECK(test_published[histogram] <= periods);
+    }
+
+    // What changed since the last copy goes at the end of the period
+    host_clock_advance(LEDSTATS_PUBLISH_MS * 1000);
+    ledstats_publish();
+
+    for(histogram = 0; histogram != LEDSTATS_COUNT; histogram++)
+    {
+        published[histogram] = test_published[histogram];
+    }
+
+    // Nothing changed
+    host_clock_advance(LEDSTATS_PUBLISH_MS * 1000);
+    ledstats_publish();
+    HOST_CHECK(memcmp(published, test_published, sizeof(published)) == 0);
+
+    // One changed, but too soon
+    ledstats_record(LEDSTATS_TRANSMIT, 5000);
+    test_record(LEDSTATS_TRANSMIT, 5000);
+    host_clock_advance(1000);
+    ledstats_publish();
+    HOST_CHECK(test_published[LEDSTATS_TRANSMIT] == published[LEDSTATS_TRANSMIT]);
+
+    // Then only that one
+    host_clock_advance(LEDSTATS_PUBLISH_MS * 1000);
+    ledstats_publish();
+    HOST_CHECK(test_published[LEDSTATS_JITTER] == published[LEDSTATS_JITTER]);
+    HOST_CHECK(test_published[LEDSTATS_COMPUTE] == published[LEDSTATS_COMPUTE]);
+    HOST_CHECK(test_published[LEDSTATS_TRANSMIT] == published[LEDSTATS_TRANSMIT] + 1);
+    HOST_CHECK(test_early == 0);
+    HOST_CHECK(test_wrong == 0);
+}
+
+int main(void)
+{
+    srand(1);
+
+    test_buckets();
+    test_timer();
+    test_publish();
+
+    return(host_result());
+}
@@ -0,0 +1,566 @@
+// ---------------------------------------------------------------------------------
+// Host test - LED strips at the PIO level
+// ---------------------------------------------------------------------------------
+// Runs the ws2812 and ws2812_parallel programs, as assembled by pioasm for the
+// 1841A, on a cycle by cycle model of a PIO state machine fed by DMA. Frames are
+// sent through ledstrip_show() to a serial strip and to a strip split across 1 to
+// 8 chains. The pin waveforms are decoded the way a WS2812 reads them, and every
+// chain must receive its share of the frame, with every bit 10 cycles long and no
+// gaps. A split frame must take 1/n of the time of the serial one.
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "pico/stdlib.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/pio.h"
+
+#include "ledstrip.h"
+#include "host.h"
+
+// Only the instructions and defines are wanted from the pioasm output
+#define PICO_NO_HARDWARE    1
+#include WS2812_PIO_HEADER
+
+// Constants
+#define TEST_FRAMES         3
+#define TEST_PIN_SERIAL     2
+#define TEST_PIN_PARALLEL   8
+#define TEST_CYCLES_PER_BIT 10              // T1 + T2 + T3 of both programs
+#define TEST_FIFO_DEPTH     8               // Joined TX FIFO
+#define TEST_CYCLES_MAX     (300 * 24 * TEST_CYCLES_PER_BIT + 1000)
+#define TEST_IDLE_CYCLES    64              // Stalled this long with nothing left to send ends the frame
+
+// Types
+
+// A state machine, with the settings ws2812_program_init() and
+// ws2812_parallel_program_init() give it
+typedef struct
+{
+    const uint16_t* program;
+    uint8_t         wrap_target;
+    uint8_t         wrap;
+    uint8_t         sideset_bits;
+    uint8_t         sideset_pin;
+    uint8_t         out_base;
+    uint8_t         out_count;
+    bool            shift_right;
+    uint8_t         pull_threshold;
+    uint8_t         pc;
+    uint8_t         delay;
+    uint32_t        x;
+    uint32_t        y;
+    uint32_t        osr;
+    uint8_t         osr_count;              // Bits shifted out of the OSR
+    uint32_t        fifo[TEST_FIFO_DEPTH];
+    uint8_t         fifo_count;
+    uint32_t        pins;
+} test_sm_t;
+
+// Global variables
+const volatile void*    test_dma_read[HOST_DMA_CHANNELS];
+int                     test_dma_done = -1;
+uint8_t                 test_parallel_base = 0;
+uint8_t                 test_parallel_count = 0;
+uint8_t                 test_serial_pin = 0;
+uint32_t                test_pins[TEST_CYCLES_MAX];
+
+// Private prototypes
+void test_sm_init(test_sm_t* sm, const uint16_t* program, uint8_t wrap_target, uint8_t wrap);
+void test_sm_write_pins(test_sm_t* sm, uint8_t base, uint8_t count, uint32_t value);
+bool test_sm_step(test_sm_t* sm);
+uint32_t test_run(test_sm_t* sm, int channel);
+uint32_t test_decode(uint32_t cycles, uint8_t pin, uint32_t* pixels, uint16_t pixel_count);
+uint32_t test_random(void);
+void test_configuration(uint16_t pixel_count, uint8_t lanes);
+
+// =================================================================================
+// The SDK calls the strips make
+
+void dma_channel_set_read_addr(uint channel, const volatile void* read_addr, bool trigger)
+{
+    (void) trigger;
+
+    test_dma_read[channel] = read_addr;
+}
+
+// Raised for one channel at a time, by test_run() when it has taken every word
+bool dma_channel_get_irq0_status(uint channel)
+{
+    return((int) channel == test_dma_done);
+}
+
+void ws2812_program_init(PIO pio, uint sm, uint offset, uint pin, float freq, bool rgbw)
+{
+    (void) pio;
+    (void) sm;
+    (void) offset;
+    (void) freq;
+    (void) rgbw;
+
+    test_serial_pin = pin;
+}
+
+void ws2812_parallel_program_init(PIO pio, uint sm, uint offset, uint pin_base, uint pin_count, float freq)
+{
+    (void) pio;
+    (void) sm;
+    (void) offset;
+    (void) freq;
+
+    test_parallel_base = pin_base;
+    test_parallel_count = pin_count;
+}
+
+// The transmit times aren't under test
+void ledstats_record(uint8_t histogram, uint32_t elapsed_us)
+{
+    (void) histogram;
+    (void) elapsed_us;
+}
+
+// =================================================================================
+// PIO model. Only what the two programs use: JMP, OUT, MOV and SET to pins and the
+// scratch registers, side-set, delays, and autopull from the TX FIFO.
+
+void test_sm_init(test_sm_t* sm, const uint16_t* program, uint8_t wrap_target, uint8_t wrap)
+{
+    memset(sm, 0, sizeof(test_sm_t));
+    sm->program = program;
+    sm->wrap_target = wrap_target;
+    sm->wrap = wrap;
+    sm->pc = wrap_target;
+    sm->osr_count = 32;
+}
+
+void test_sm_write_pins(test_sm_t* sm, uint8_t base, uint8_t count, uint32_t value)
+{
+    uint32_t    mask = (count == 32) ? 0xFFFFFFFF : ((1u << count) - 1);
+
+    sm->pins = (sm->pins & ~(mask << base)) | ((value & mask) << base);
+}
+
+// Runs one cycle. Returns false if the state machine is stalled on an empty FIFO.
+bool test_sm_step(test_sm_t* sm)
+{
+    uint16_t    instruction = 0;
+    uint8_t     field = 0;
+    uint8_t     opcode = 0;
+    uint8_t     destination = 0;
+    uint8_t     source_select = 0;
+    uint8_t     bits = 0;
+    uint32_t    value = 0;
+    uint32_t    mask = 0;
+    bool        jump = false;
+
+    if(sm->delay != 0)
+    {
+        sm->delay = sm->delay - 1;
+        return(true);
+    }
+
+    instruction = sm->program[sm->pc];
+    opcode = instruction >> 13;
+    field = (instruction >> 8) & 0x1F;
+    destination = (instruction >> 5) & 0x07;
+
+    // Side-set takes effect even when the instruction stalls
+    if(sm->sideset_bits != 0)
+    {
+        test_sm_write_pins(sm, sm->sideset_pin, sm->sideset_bits, field >> (5 - sm->sideset_bits));
+    }
+
+    if(opcode == 0)
+    {
+        // JMP, with the conditions the programs use
+        if(destination == 0)
+        {
+            jump = true;
+        }
+        else if(destination == 1)
+        {
+            jump = (sm->x == 0);
+        }
+        else if(destination == 3)
+        {
+            jump = (sm->y == 0);
+        }
+    }
+    else if(opcode == 3)
+    {
+        // OUT, with autopull
+        bits = ((instruction & 0x1F) == 0) ? 32 : (instruction & 0x1F);
+
+        if(sm->osr_count >= sm->pull_threshold)
+        {
+            if(sm->fifo_count == 0)
+            {
+                return(false);
+            }
+
+            sm->osr = sm->fifo[0];
+            memmove(&sm->fifo[0], &sm->fifo[1], (TEST_FIFO_DEPTH - 1) * sizeof(uint32_t));
+            sm->fifo_count = sm->fifo_count - 1;
+            sm->osr_count = 0;
+        }
+
+        mask = (bits == 32) ? 0xFFFFFFFF : ((1u << bits) - 1);
+
+        if(sm->shift_right == true)
+        {
+            value = sm->osr & mask;
+            sm->osr = (bits == 32) ? 0 : (sm->osr >> bits);
+        }
+        else
+        {
+            value = (sm->osr >> (32 - bits)) & mask;
+            sm->osr = (bits == 32) ? 0 : (sm->osr << bits);
+        }
+
+        sm->osr_count = sm->osr_count + bits;
+
+        if(destination == 0)
+        {
+            test_sm_write_pins(sm, sm->out_base, sm->out_count, value);
+        }
+        else if(destination == 1)
+        {
+            sm->x = value;
+        }
+        else if(destination == 2)
+        {
+            sm->y = value;
+        }
+    }
+    else if(opcode == 5)
+    {
+        // MOV, with no operation or invert
+        source_select = instruction & 0x07;
+
+        if(source_select == 0)
+        {
+            value = sm->pins >> sm->out_base;
+        }
+        else if(source_select == 1)
+        {
+            value = sm->x;
+        }
+        else if(source_select == 2)
+        {
+            value = sm->y;
+        }
+        else if(source_select == 7)
+        {
+            value = sm->osr;
+        }
+
+        if(((instruction >> 3) & 0x03) == 1)
+        {
+            value = ~value;
+        }
+
+        if(destination == 0)
+        {
+            test_sm_write_pins(sm, sm->out_base, sm->out_count, value);
+        }
+        else if(destination == 1)
+        {
+            sm->x = value;
+        }
+        else if(destination == 2)
+        {
+            sm->y = value;
+        }
+    }
+    else if(opcode == 7)
+    {
+        // SET
+        if(destination == 0)
+        {
+            test_sm_write_pins(sm, sm->out_base, sm->out_count, instruction & 0x1F);
+        }
+        else if(destination == 1)
+        {
+            sm->x = instruction & 0x1F;
+        }
+        else if(destination == 2)
+        {
+            sm->y = instruction & 0x1F;
+        }
+    }
+
+    if(jump == true)
+    {
+        sm->pc = instruction & 0x1F;
+    }
+    else if(sm->pc == sm->wrap)
+    {
+        sm->pc = sm->wrap_target;
+    }
+    else
+    {
+        sm->pc = sm->pc + 1;
+    }
+
+    sm->delay = field & ((1u << (5 - sm->sideset_bits)) - 1);
+
+    return(true);
+}
+
+// Feeds the words the channel was started on to the state machine as DMA does,
+// keeping the FIFO full, and records the pins every cycle. The channel's interrupt
+// is raised when the last word is in the FIFO. Returns the number of cycles
+// recorded.
+uint32_t test_run(test_sm_t* sm, int channel)
+{
+    const uint32_t* words = (const uint32_t*) test_dma_read[channel];
+    uint32_t        word_count = dma_hw->ch[channel].transfer_count;
+    uint32_t        cycle = 0;
+    uint32_t        sent = 0;
+    uint32_t        idle = 0;
+
+    while((cycle != TEST_CYCLES_MAX) && (idle != TEST_IDLE_CYCLES))
+    {
+        while((sent != word_count) && (sm->fifo_count != TEST_FIFO_DEPTH))
+        {
+            sm->fifo[sm->fifo_count] = words[sent];
+            sm->fifo_count = sm->fifo_count + 1;
+            sent = sent + 1;
+
+            if(sent == word_count)
+            {
+                test_dma_done = channel;
+                host_irq(DMA_IRQ_0);
+                test_dma_done = -1;
+            }
+        }
+
+        if((test_sm_step(sm) == false) && (sent == word_count))
+        {
+            idle = idle + 1;
+        }
+
+        test_pins[cycle] = sm->pins;
+        cycle = cycle + 1;
+    }
+
+    HOST_CHECK(cycle != TEST_CYCLES_MAX);
+
+    return(cycle);
+}
+
+// Reads the pixels on one pin the way a WS2812 does: a bit is a high pulse, long
+// for a one and short for a zero. Every bit must take 10 cycles, from the first to
+// the last, and the line must end low. Returns the cycles from the first bit to
+// the end of the last.
+uint32_t test_decode(uint32_t cycles, uint8_t pin, uint32_t* pixels, uint16_t pixel_count)
+{
+    uint32_t    cycle = 0;
+    uint32_t    bits = 0;
+    uint32_t    high = 0;
+    uint32_t    first = 0;
+    uint32_t    last = 0;
+    uint32_t    wrong = 0;
+    bool        level = false;
+    bool        previous = false;
+
+    memset(pixels, 0, pixel_count * sizeof(uint32_t));
+
+    while(cycle != cycles)
+    {
+        level = ((test_pins[cycle] >> pin) & 1) != 0;
+
+        if((level == true) && (previous == false))
+        {
+            // A bit starts exactly one bit time after the last one
+            if(bits == 0)
+            {
+                first = cycle;
+            }
+            else if(cycle - last != TEST_CYCLES_PER_BIT)
+            {
+                wrong = wrong + 1;
+            }
+
+            last = cycle;
+            high = 0;
+        }
+
+        if(level == true)
+        {
+            high = high + 1;
+        }
+
+        if((level == false) && (previous == true))
+        {
+            if((high != ws2812_T1) && (high != ws2812_T1 + ws2812_T2))
+            {
+                wrong = wrong + 1;
+            }
+
+            if((bits / LEDSTRIP_BITS) < pixel_count)
+            {
+                pixels[bits / LEDSTRIP_BITS] = (pixels[bits / LEDSTRIP_BITS] << 1) | (high > ws2812_T1 ? 1 : 0);
+            }
+
+            bits = bits + 1;
+        }
+
+        previous = level;
+        cycle = cycle + 1;
+    }
+
+    HOST_CHECK(wrong == 0);
+    HOST_CHECK(previous == false);
+    HOST_CHECK(bits == (uint32_t) pixel_count * LEDSTRIP_BITS);
+
+    return(last + TEST_CYCLES_PER_BIT - first);
+}
+
+uint32_t test_random(void)
+{
+    static uint32_t state = 2463534242u;
+
+    state = state ^ (state << 13);
+    state = state ^ (state >> 17);
+    state = state ^ (state << 5);
+
+    return(state);
+}
+
+// One serial and one split strip of the same pixels, each sent a few frames
+void test_configuration(uint16_t pixel_count, uint8_t lanes)
+{
+    static uint32_t serial_buffers[2][300];
+    static uint32_t frame[300];
+    static uint32_t planes[LEDSTRIP_PLANE_WORDS(300, 1)];
+    static uint32_t decoded[300];
+    ledstrip_t      serial;
+    ledstrip_t      parallel;
+    test_sm_t       sm;
+    uint16_t        lane_pixels = LEDSTRIP_LANE_PIXELS(pixel_count, lanes);
+    uint32_t        serial_cycles = 0;
+    uint32_t        parallel_cycles = 0;
+    uint32_t        cycles = 0;
+    uint32_t        colour = 0;
+    uint32_t        wrong = 0;
+    uint16_t        pixel = 0;
+    uint8_t         lane = 0;
+    uint8_t         counter = 0;
+
+    HOST_CHECK(ledstrip_init(&serial, pio0, TEST_PIN_SERIAL, 800000, serial_buffers[0], serial_buffers[1], pixel_count) == true);
+    HOST_CHECK(ledstrip_init_parallel(&parallel, pio1, TEST_PIN_PARALLEL, lanes, 800000, frame, planes, pixel_count) == true);
+    HOST_CHECK(test_parallel_base == TEST_PIN_PARALLEL);
+    HOST_CHECK(test_parallel_count == lanes);
+
+    while(counter != TEST_FRAMES)
+    {
+        uint32_t*   serial_frame = ledstrip_back_buffer(&serial);
+        uint32_t*   parallel_frame = ledstrip_back_buffer(&parallel);
+
+        for(pixel = 0; pixel != pixel_count; pixel++)
+        {
+            colour = test_random() & 0xFFFFFF;
+            serial_frame[pixel] = LEDSTRIP_WORD(colour);
+            parallel_frame[pixel] = LEDSTRIP_WORD(colour);
+        }
+
+        // Serial: 24 bits from the top of each word, shifted left
+        HOST_CHECK(ledstrip_show(&serial) == true);
+        test_sm_init(&sm, ws2812_program_instructions, ws2812_wrap_target, ws2812_wrap);
+        sm.sideset_bits = 1;
+        sm.sideset_pin = test_serial_pin;
+        sm.pull_threshold = 24;
+        cycles = test_run(&sm, serial.dma_channel);
+        HOST_CHECK(serial.busy == false);
+        serial_cycles = test_decode(cycles, TEST_PIN_SERIAL, decoded, pixel_count);
+
+        for(pixel = 0; pixel != pixel_count; pixel++)
+        {
+            wrong = wrong + ((decoded[pixel] != (serial_frame[pixel] >> 8)) ? 1 : 0);
+        }
+
+        // Parallel: one bit plane word per bit time, shifted right onto the pins
+        HOST_CHECK(ledstrip_show(&parallel) == true);
+        test_sm_init(&sm, ws2812_parallel_program_instructions, ws2812_parallel_wrap_target, ws2812_parallel_wrap);
+        sm.out_base = test_parallel_base;
+        sm.out_count = test_parallel_count;
+        sm.shift_right = true;
+        sm.pull_threshold = 32;
+        cycles = test_run(&sm, parallel.dma_channel);
+        HOST_CHECK(parallel.busy == false);
+
+        for(lane = 0; lane != lanes; lane++)
+        {
+            parallel_cycles = test_decode(cycles, TEST_PIN_PARALLEL + lane, decoded, lane_pixels);
+
+            // Each chain takes the next lane_pixels pixels, and is padded with off
+            for(pixel = 0; pixel != lane_pixels; pixel++)
+            {
+                colour = ((lane * lane_pixels) + pixel < pixel_count) ? (parallel_frame[(lane * lane_pixels) + pixel] >> 8) : 0;
+                wrong = wrong + ((decoded[pixel] != colour) ? 1 : 0);
+            }
+        }
+
+        // Nothing else moves
+        HOST_CHECK((test_pins[cycles - 1] & ~(((1u << lanes) - 1) << TEST_PIN_PARALLEL)) == 0);
+
+        counter = counter + 1;
+    }
+
+    printf("%5u pixels  %u chains  serial %7.1f us  parallel %7.1f us  %.2f times faster\n", pixel_count, lanes, serial_cycles / 8.0, parallel_cycles / 8.0,
+           (double) serial_cycles / parallel_cycles);
+
+    HOST_CHECK(wrong == 0);
+    HOST_CHECK(serial_cycles == (uint32_t) pixel_count * LEDSTRIP_BITS * TEST_CYCLES_PER_BIT);
+    HOST_CHECK(parallel_cycles == (uint32_t) lane_pixels * LEDSTRIP_BITS * TEST_CYCLES_PER_BIT);
+}
+
+int main(void)
+{
+    const uint16_t  pixel_counts[] = {1, 108, 270, 0};
+    uint8_t         counter = 0;
+    uint8_t         lanes = 0;
+    pid_t           child = 0;
+    int             status = 0;
+    uint8_t         failed = 0;
+
+    // Strips can't be released, so each configuration runs in a process of its own.
+    // Failures are only counted here once they are all done, so that each process
+    // starts with none.
+    while(pixel_counts[counter] != 0)
+    {
+        for(lanes = 1; lanes <= LEDSTRIP_MAX_LANES; lanes++)
+        {
+            fflush(stdout);
+            child = fork();
+
+            if(child == 0)
+            {
+                test_configuration(pixel_counts[counter], lanes);
+                fflush(stdout);
+                _exit(host_result());
+            }
+
+            waitpid(child, &status, 0);
+            if((WIFEXITED(status) == false) || (WEXITSTATUS(status) != 0))
+            {
+                failed = failed + 1;
+            }
+        }
+
+        counter = counter + 1;
+    }
+
+    HOST_CHECK(failed == 0);
+
+    return(host_result());
+}
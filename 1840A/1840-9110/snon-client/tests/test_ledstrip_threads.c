@@ -0,0 +1,307 @@
+// ---------------------------------------------------------------------------------
+// Host test - LED strips shared between contexts
+// ---------------------------------------------------------------------------------
+// Sets up the 1840A front panel, the debug LED and a run-length strip on the one
+// PIO, then has three threads submit frames at once, the way the LED timer, the
+// main loop and the other core do. The panel and the debug LED each belong to one
+// thread, and every thread submits to the run-length strip. DMA is simulated a
+// word at a time, letting the other threads run. No strip may be sent two frames
+// at once, every frame must go out whole and in the order its thread submitted
+// it, and no state machine may be set up again after setup.
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/pio.h"
+
+#include "ledstrip.h"
+#include "host.h"
+
+// Constants
+#define TEST_THREADS        3
+#define TEST_FRAMES         20000                   // Submitted by each thread to each of its strips
+#define TEST_PANEL_PIXELS   8
+#define TEST_RUNS           3
+#define TEST_CHANNELS       16
+
+// Types
+
+// What the simulated DMA saw on a strip
+typedef struct
+{
+    uint32_t    sending;                            // Frames being sent, which must never be more than one
+    uint32_t    overlapped;
+    uint32_t    torn;                               // Frames with words from more than one submission
+    uint32_t    reordered;
+    uint32_t    sent;
+    uint32_t    last[TEST_THREADS];                 // Last frame sent from each thread
+    uint32_t    submitted;
+    uint32_t    refused;
+} test_strip_t;
+
+// Global variables
+ledstrip_t          test_panel;
+ledstrip_t          test_debug;
+ledstrip_t          test_shared;
+uint32_t            test_panel_buffers[2][TEST_PANEL_PIXELS];
+uint32_t            test_debug_buffers[2][1];
+ledstrip_run_t      test_runs[TEST_RUNS + 1];
+uint32_t            test_run_colours[TEST_RUNS];
+ledstrip_t*         test_channels[TEST_CHANNELS];
+test_strip_t        test_strips[TEST_CHANNELS];     // By data channel
+bool                test_done[TEST_CHANNELS];       // DMA finished, for the interrupt
+uint32_t            test_inits = 0;                 // State machines set up
+pthread_mutex_t     test_irq_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Private prototypes
+test_strip_t* test_strip(ledstrip_t* strip);
+void test_send(uint32_t word, uint32_t* first, bool* whole);
+void test_dma_done(ledstrip_t* strip);
+void* test_submitter(void* thread_number);
+void test_report(const char* name, ledstrip_t* strip, uint32_t submitted);
+
+// =================================================================================
+
+// The transmit times aren't under test
+void ledstats_record(uint8_t histogram, uint32_t elapsed_us)
+{
+    (void) histogram;
+    (void) elapsed_us;
+}
+
+void ws2812_program_init(PIO pio, uint sm, uint offset, uint pin, float freq, bool rgbw)
+{
+    (void) pio;
+    (void) sm;
+    (void) offset;
+    (void) pin;
+    (void) freq;
+    (void) rgbw;
+
+    test_inits = test_inits + 1;
+}
+
+bool dma_channel_get_irq0_status(uint channel)
+{
+    return(__atomic_load_n(&test_done[channel], __ATOMIC_ACQUIRE));
+}
+
+void dma_channel_acknowledge_irq0(uint channel)
+{
+    __atomic_store_n(&test_done[channel], false, __ATOMIC_RELEASE);
+}
+
+// Sends the frame a word at a time, as DMA would, letting the other threads run
+// between words. A run-length strip is started on its control channel.
+void dma_channel_set_read_addr(uint channel, const volatile void* read_addr, bool trigger)
+{
+    ledstrip_t*             strip = test_channels[channel];
+    test_strip_t*           test = test_strip(strip);
+    const ledstrip_run_t*   runs = (const ledstrip_run_t*) read_addr;
+    const uint32_t*         words = (const uint32_t*) read_addr;
+    uint32_t                first = 0;
+    bool                    whole = true;
+    uint16_t                run = 0;
+    uint16_t                counter = 0;
+    uint8_t                 thread = 0;
+
+    (void) trigger;
+
+    if(__atomic_fetch_add(&test->sending, 1, __ATOMIC_ACQ_REL) != 0)
+    {
+        __atomic_fetch_add(&test->overlapped, 1, __ATOMIC_RELAXED);
+    }
+
+    if((int) channel == strip->control_channel)
+    {
+        first = *runs[0].colour;
+
+        for(run = 0; runs[run].count != 0; run++)
+        {
+            for(counter = 0; counter != runs[run].count; counter++)
+            {
+                test_send(*runs[run].colour, &first, &whole);
+            }
+        }
+    }
+    else
+    {
+        first = words[0];
+
+        for(counter = 0; counter != strip->pixel_count; counter++)
+        {
+            test_send(words[counter], &first, &whole);
+        }
+    }
+
+    // Every word of a frame is the thread number and the frame number
+    if(whole == false)
+    {
+        test->torn = test->torn + 1;
+    }
+    else
+    {
+        thread = first >> 24;
+
+        if((first & 0xFFFFFF) <= test->last[thread])
+        {
+            test->reordered = test->reordered + 1;
+        }
+
+        test->last[thread] = first & 0xFFFFFF;
+    }
+
+    test->sent = test->sent + 1;
+    __atomic_fetch_sub(&test->sending, 1, __ATOMIC_ACQ_REL);
+
+    test_dma_done(strip);
+}
+
+test_strip_t* test_strip(ledstrip_t* strip)
+{
+    return(&test_strips[strip->dma_channel]);
+}
+
+void test_send(uint32_t word, uint32_t* first, bool* whole)
+{
+    if(word != *first)
+    {
+        *whole = false;
+    }
+
+    sched_yield();
+}
+
+// DMA_IRQ_0 is only enabled on one core, so its handler never runs twice at once.
+// No alarm is free on the host, so the strip is marked sent from the interrupt.
+void test_dma_done(ledstrip_t* strip)
+{
+    pthread_mutex_lock(&test_irq_mutex);
+    __atomic_store_n(&test_done[strip->dma_channel], true, __ATOMIC_RELEASE);
+    host_irq(DMA_IRQ_0);
+    pthread_mutex_unlock(&test_irq_mutex);
+}
+
+// Thread 0 is the LED timer, with the panel, thread 1 is the main loop, with the
+// debug LED, and thread 2 is the other core. All of them send to the run-length
+// strip.
+void* test_submitter(void* thread_number)
+{
+    uint32_t    thread = (uint32_t) (uintptr_t) thread_number;
+    ledstrip_t* own = (thread == 0) ? &test_panel : &test_debug;
+    uint32_t    colours[TEST_RUNS];
+    uint32_t*   frame = NULL;
+    uint32_t    word = 0;
+    uint32_t    number = 0;
+    uint16_t    counter = 0;
+
+    host_set_core((thread == 2) ? 1 : 0);
+
+    for(number = 1; number <= TEST_FRAMES; number++)
+    {
+        word = (thread << 24) | number;
+
+        if(thread != 2)
+        {
+            frame = ledstrip_back_buffer(own);
+
+            for(counter = 0; counter != own->pixel_count; counter++)
+            {
+                frame[counter] = word;
+            }
+
+            __atomic_fetch_add(&test_strip(own)->submitted, 1, __ATOMIC_RELAXED);
+
+            if(ledstrip_show(own) == false)
+            {
+                __atomic_fetch_add(&test_strip(own)->refused, 1, __ATOMIC_RELAXED);
+            }
+        }
+
+        for(counter = 0; counter != TEST_RUNS; counter++)
+        {
+            colours[counter] = word;
+        }
+
+        __atomic_fetch_add(&test_strip(&test_shared)->submitted, 1, __ATOMIC_RELAXED);
+
+        if(ledstrip_show_runs(&test_shared, colours) == false)
+        {
+            __atomic_fetch_add(&test_strip(&test_shared)->refused, 1, __ATOMIC_RELAXED);
+        }
+    }
+
+    return(NULL);
+}
+
+// Every frame the strip took was sent once, whole and in order, and every one it
+// refused was counted as skipped
+void test_report(const char* name, ledstrip_t* strip, uint32_t submitted)
+{
+    test_strip_t*   test = test_strip(strip);
+
+    printf("%-12s sm %u  %6lu sent  %6lu skipped  %lu overlapped  %lu torn  %lu reordered\n", name, strip->sm, (unsigned long) test->sent,
+           (unsigned long) strip->skipped, (unsigned long) test->overlapped, (unsigned long) test->torn, (unsigned long) test->reordered);
+
+    HOST_CHECK(test->overlapped == 0);
+    HOST_CHECK(test->torn == 0);
+    HOST_CHECK(test->reordered == 0);
+    HOST_CHECK(test->submitted == submitted);
+    HOST_CHECK(test->sent == strip->frames);
+    HOST_CHECK(test->refused == strip->skipped);
+    HOST_CHECK(strip->frames + strip->skipped == submitted);
+    HOST_CHECK(strip->frames != 0);
+    HOST_CHECK(strip->busy == false);
+}
+
+int main(void)
+{
+    pthread_t   threads[TEST_THREADS];
+    uintptr_t   thread = 0;
+
+    HOST_CHECK(ledstrip_init(&test_panel, pio1, 18, 800000, test_panel_buffers[0], test_panel_buffers[1], TEST_PANEL_PIXELS) == true);
+    HOST_CHECK(ledstrip_init(&test_debug, pio1, 11, 1200000, test_debug_buffers[0], test_debug_buffers[1], 1) == true);
+    HOST_CHECK(ledstrip_init_runs(&test_shared, pio1, 3, 800000, test_runs, test_run_colours, TEST_RUNS) == true);
+
+    ledstrip_set_run(&test_shared, 0, 2);
+    ledstrip_set_run(&test_shared, 1, 1);
+    ledstrip_set_run(&test_shared, 2, 3);
+
+    test_channels[test_panel.dma_channel] = &test_panel;
+    test_channels[test_debug.dma_channel] = &test_debug;
+    test_channels[test_shared.dma_channel] = &test_shared;
+    test_channels[test_shared.control_channel] = &test_shared;
+
+    // A state machine of its own for each strip, each set up once
+    HOST_CHECK(test_panel.sm != test_debug.sm);
+    HOST_CHECK(test_panel.sm != test_shared.sm);
+    HOST_CHECK(test_debug.sm != test_shared.sm);
+    HOST_CHECK(test_inits == 3);
+
+    for(thread = 0; thread != TEST_THREADS; thread++)
+    {
+        pthread_create(&threads[thread], NULL, test_submitter, (void*) thread);
+    }
+
+    for(thread = 0; thread != TEST_THREADS; thread++)
+    {
+        pthread_join(threads[thread], NULL);
+    }
+
+    test_report("Panel", &test_panel, TEST_FRAMES);
+    test_report("Debug LED", &test_debug, TEST_FRAMES);
+    test_report("Runs", &test_shared, TEST_THREADS * TEST_FRAMES);
+    HOST_CHECK(test_inits == 3);
+
+    return(host_result());
+}
@@ -0,0 +1,298 @@
+// ---------------------------------------------------------------------------------
+// Host test - Deferred logging
+// ---------------------------------------------------------------------------------
+// Logging from an interrupt handler must only copy a record: nothing is formatted
+// or written until logger_drain(), and the time taken doesn't grow with the text.
+// Checks what is printed, the counters, records from core 1 while core 0 drains,
+// and the time each kind of call takes.
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "pico/stdlib.h"
+
+#include "logger.h"
+#include "host.h"
+
+// Constants
+#define TEST_CALLS          200000
+#define TEST_CORE1_RECORDS  100000
+#define TEST_LONG_TEXT      4000
+#define TEST_P99_NS_MAX     10000       // A character time at 115200 baud is about 87000 ns
+
+// Types
+typedef struct
+{
+    const char* name;
+    uint32_t    median;
+    uint32_t    p99;
+    uint32_t    max;
+} test_cost_t;
+
+// Global variables
+FILE*               test_stdout = NULL;
+char*               test_output = NULL;
+size_t              test_output_length = 0;
+char                test_long_text[TEST_LONG_TEXT];
+uint32_t            test_times[TEST_CALLS];
+volatile bool       test_core1_done = false;
+
+// Private prototypes
+void test_capture_start(void);
+void test_capture_end(void);
+void test_discard(void);
+uint64_t test_now_ns(void);
+int test_compare(const void* first, const void* second);
+test_cost_t test_cost(const char* name, uint8_t kind, bool drain);
+void test_output_checks(void);
+void* test_core1(void* unused);
+void test_cores(void);
+
+// =================================================================================
+
+// stdout goes to memory until test_capture_end()
+void test_capture_start(void)
+{
+    fflush(stdout);
+    test_stdout = stdout;
+    stdout = open_memstream(&test_output, &test_output_length);
+}
+
+void test_capture_end(void)
+{
+    fclose(stdout);
+    stdout = test_stdout;
+}
+
+// Empties both rings without keeping what they print
+void test_discard(void)
+{
+    FILE*   saved = stdout;
+
+    stdout = fopen("/dev/null", "w");
+    logger_drain(LOGGER_RING_SIZE);
+    fclose(stdout);
+    stdout = saved;
+}
+
+uint64_t test_now_ns(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return((uint64_t) now.tv_sec * 1000000000ull + now.tv_nsec);
+}
+
+int test_compare(const void* first, const void* second)
+{
+    uint32_t    a = *(const uint32_t*) first;
+    uint32_t    b = *(const uint32_t*) second;
+
+    return((a > b) - (a < b));
+}
+
+// Times one kind of call, emptying the ring whenever it fills unless the calls
+// are meant to find it full
+test_cost_t test_cost(const char* name, uint8_t kind, bool drain)
+{
+    test_cost_t result = {name, 0, 0, 0};
+    uint64_t    start = 0;
+    uint32_t    counter = 0;
+
+    test_discard();
+
+    while(counter != TEST_CALLS)
+    {
+        if((drain == true) && ((counter % (LOGGER_RING_SIZE - 1)) == 0))
+        {
+            test_discard();
+        }
+
+        start = test_now_ns();
+
+        if(kind == 0)
+        {
+            logger_log(LOGGER_WARNING, "Values %lu %lu %lu %lu %lu %lu", 6, counter, 1, 2, 3, 4, 5);
+        }
+        else if(kind == 1)
+        {
+            logger_log_text(LOGGER_INFO, "New value for eID %s (%lu characters)", "=P01=PFA01", 1, counter);
+        }
+        else if(kind == 2)
+        {
+            logger_log_text(LOGGER_INFO, "Received SNON fragment \"%s\" (%lu characters)", test_long_text, 1, counter);
+        }
+        else
+        {
+            logger_log(LOGGER_DEBUG, "Filtered %lu", 1, counter);
+        }
+
+        test_times[counter] = test_now_ns() - start;
+        counter = counter + 1;
+    }
+
+    qsort(test_times, TEST_CALLS, sizeof(uint32_t), test_compare);
+    result.median = test_times[TEST_CALLS / 2];
+    result.p99 = test_times[(TEST_CALLS * 99) / 100];
+    result.max = test_times[TEST_CALLS - 1];
+
+    printf("%-24s %8lu %8lu %8lu\n", name, (unsigned long) result.median, (unsigned long) result.p99, (unsigned long) result.max);
+    HOST_CHECK(result.p99 < TEST_P99_NS_MAX);
+
+    return(result);
+}
+
+// Records come out formatted in order, only when drained
+void test_output_checks(void)
+{
+    const logger_stats_t*   stats = logger_get_stats(0);
+    uint32_t                counter = 0;
+
+    host_clock_set(1000005);
+    logger_set_level(LOGGER_INFO);
+
+    // Arguments are 32 bits, as long is on the panel but not on the host, so only
+    // unsigned values print the same on both
+    test_capture_start();
+    logger_log(LOGGER_WARNING, "Invalid SNON fragment (%lu)", 1, 3);
+    logger_log_text(LOGGER_INFO, "New value for eID %s (%lu characters)", "urn:uuid:254CB903", 1, 12);
+    logger_log(LOGGER_DEBUG, "Not shown", 0);
+    logger_log_text(LOGGER_INFO, "Received SNON fragment \"%s\" (%lu characters)", test_long_text, 1, TEST_LONG_TEXT - 1);
+    fflush(stdout);
+    HOST_CHECK(test_output_length == 0);
+
+    logger_drain(LOGGER_DRAIN_COUNT);
+    test_capture_end();
+
+    printf("%s", test_output);
+    HOST_CHECK(strstr(test_output, "[1.000005 0] Invalid SNON fragment (3)\n") != NULL);
+    HOST_CHECK(strstr(test_output, "[1.000005 0] New value for eID urn:uuid:254CB903 (12 characters)\n") != NULL);
+    HOST_CHECK(strstr(test_output, "Not shown") == NULL);
+    HOST_CHECK(strstr(test_output, "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa...\" (3999 characters)\n") != NULL);
+    HOST_CHECK(stats->queued == 3);
+    HOST_CHECK(stats->filtered == 1);
+    HOST_CHECK(stats->printed == 3);
+    free(test_output);
+
+    // A full ring drops records, and counts them
+    while(counter != LOGGER_RING_SIZE + 9)
+    {
+        logger_log(LOGGER_ERROR, "Record %lu", 1, counter);
+        counter = counter + 1;
+    }
+
+    HOST_CHECK(stats->queued == 3 + LOGGER_RING_SIZE - 1);
+    HOST_CHECK(stats->dropped == 10);
+    test_discard();
+    HOST_CHECK(stats->printed == stats->queued);
+}
+
+// Stands in for core 1 logging as fast as it can
+void* test_core1(void* unused)
+{
+    uint32_t    counter = 0;
+
+    (void) unused;
+
+    host_set_core(1);
+
+    while(counter != TEST_CORE1_RECORDS)
+    {
+        logger_log(LOGGER_INFO, "Core 1 record %lu", 1, counter);
+        counter = counter + 1;
+
+        // Lets core 0 in, when the host has only one processor
+        if((counter % 8) == 0)
+        {
+            sched_yield();
+        }
+    }
+
+    test_core1_done = true;
+
+    return(NULL);
+}
+
+// Core 0 drains while core 1 queues. Every record printed is whole and in order,
+// and every other one was counted as dropped.
+void test_cores(void)
+{
+    const logger_stats_t*   stats = logger_get_stats(1);
+    pthread_t               core1;
+    const char*             position = NULL;
+    unsigned long           number = 0;
+    long                    previous = -1;
+    uint32_t                printed = 0;
+    uint32_t                wrong = 0;
+
+    test_capture_start();
+    pthread_create(&core1, NULL, test_core1, NULL);
+
+    while(test_core1_done == false)
+    {
+        logger_drain(LOGGER_DRAIN_COUNT);
+        sched_yield();
+    }
+
+    pthread_join(core1, NULL);
+    logger_drain(LOGGER_RING_SIZE);
+    test_capture_end();
+
+    position = test_output;
+
+    while((position = strstr(position, "] Core 1 record ")) != NULL)
+    {
+        if((sscanf(position, "] Core 1 record %lu", &number) != 1) || ((long) number <= previous) || (position[-1] != '1'))
+        {
+            wrong = wrong + 1;
+        }
+
+        previous = number;
+        printed = printed + 1;
+        position = position + 1;
+    }
+
+    printf("Core 1: %lu records printed, %lu dropped, %lu wrong\n", (unsigned long) printed, (unsigned long) stats->dropped, (unsigned long) wrong);
+    HOST_CHECK(wrong == 0);
+    HOST_CHECK(printed == stats->printed);
+    HOST_CHECK(printed > LOGGER_RING_SIZE);
+    HOST_CHECK(printed + stats->dropped == TEST_CORE1_RECORDS);
+    free(test_output);
+}
+
+int main(void)
+{
+    test_cost_t accepted;
+    test_cost_t short_text;
+    test_cost_t long_text;
+
+    memset(test_long_text, 'a', TEST_LONG_TEXT - 1);
+    test_long_text[TEST_LONG_TEXT - 1] = 0;
+
+    test_output_checks();
+    test_cores();
+
+    // The time a call takes is bounded, and the same for any length of text
+    host_set_core(0);
+    printf("%-24s %8s %8s %8s\n", "Call (ns)", "median", "99%", "max");
+    accepted = test_cost("Six integers", 0, true);
+    short_text = test_cost("Short text", 1, true);
+    long_text = test_cost("4000 character text", 2, true);
+    test_cost("Below the level", 3, true);
+    test_cost("Ring full", 0, false);
+
+    HOST_CHECK(long_text.median < (2 * short_text.median) + 100);
+    HOST_CHECK(accepted.median < 2000);
+
+    return(host_result());
+}
@@ -0,0 +1,353 @@
+// ---------------------------------------------------------------------------------
+// Host test - Long responses
+// ---------------------------------------------------------------------------------
+// Runs the 1840A command loop against a UART that sends 12 bytes each pass, about
+// what 115200 baud carries in a millisecond. "dump" answers with a few times what
+// the TX ring holds, and the loop must keep going while it does, so the test only
+// gets to the end if nothing waits for room in the ring. The output has to come
+// out whole and in order, with the prompt after it, and a command typed in the
+// meantime has to be answered only once the output has all gone. Then "{}" is
+// sent with a batch of SNON fragments straight after it, so the acknowledgement
+// of the batch has to wait for the dump and is then finished from the loop too.
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "hardware/irq.h"
+#include "hardware/uart.h"
+#include "snon/snon_utils.h"
+
+#include "arena.h"
+#include "commands.h"
+#include "fragment.h"
+#include "store.h"
+#include "uart.h"
+#include "writer.h"
+#include "host.h"
+
+// Constants
+#define TEST_ENTITIES       200
+#define TEST_VALUE_LENGTH   24
+#define TEST_BATCH          48
+#define TEST_BYTES_PER_PASS 12                      // 115200 baud, 8N1, for a millisecond
+#define TEST_PASSES_MAX     100000
+#define TEST_PASS_MAX_US    5000                    // Longest a pass of the loop may take
+#define TEST_OUTPUT_SIZE    131072
+#define TEST_INPUT_SIZE     2048
+#define TEST_DR_EMPTY       0x100                   // Nothing written to the UART data register
+
+// Global variables
+char            test_names[TEST_ENTITIES][16];
+char            test_input[TEST_INPUT_SIZE];
+uint16_t        test_input_length = 0;
+uint16_t        test_input_position = 0;
+char            test_output[TEST_OUTPUT_SIZE];
+uint32_t        test_output_length = 0;
+uint16_t        test_budget = 0;
+uint32_t        test_deferred_passes = 0;
+uint64_t        test_pass_max_us = 0;
+
+// Private prototypes
+void test_capture(void);
+void test_type(const char* text);
+void test_pass(void);
+uint32_t test_run(void);
+char* test_expect(char* from, const char* expected);
+void test_dump(void);
+void test_batch(void);
+
+// =================================================================================
+// UART. Input comes from what the test has typed, and output is captured as the
+// data register is written, a pass's worth at a time.
+
+bool uart_is_readable(uart_inst_t* uart)
+{
+    (void) uart;
+
+    return(test_input_position != test_input_length);
+}
+
+char uart_getc(uart_inst_t* uart)
+{
+    char    character = test_input[test_input_position];
+
+    (void) uart;
+
+    test_input_position = test_input_position + 1;
+
+    return(character);
+}
+
+bool uart_is_writable(uart_inst_t* uart)
+{
+    (void) uart;
+
+    test_capture();
+
+    if(test_budget == 0)
+    {
+        return(false);
+    }
+
+    test_budget = test_budget - 1;
+
+    return(true);
+}
+
+void test_capture(void)
+{
+    uart_hw_t*  hw = uart_get_hw(uart1);
+
+    if(hw->dr != TEST_DR_EMPTY)
+    {
+        HOST_CHECK(test_output_length != TEST_OUTPUT_SIZE - 1);
+
+        if(test_output_length != TEST_OUTPUT_SIZE - 1)
+        {
+            test_output[test_output_length] = hw->dr;
+            test_output_length = test_output_length + 1;
+            test_output[test_output_length] = 0;
+        }
+
+        hw->dr = TEST_DR_EMPTY;
+    }
+}
+
+// mem_utils.c needs the firmware's linker symbols, so "get mem" is given a stand-in
+size_t get_free_ram_2(void)
+{
+    return(0);
+}
+
+// =================================================================================
+// Command loop
+
+void test_type(const char* text)
+{
+    memcpy(&test_input[test_input_length], text, strlen(text));
+    test_input_length = test_input_length + strlen(text);
+}
+
+// One pass of the 1840A command loop, after the UART interrupt
+void test_pass(void)
+{
+    uint64_t    start_us = time_us_64();
+    const char* command = NULL;
+    writer_t    writer;
+
+    test_budget = TEST_BYTES_PER_PASS;
+    host_irq(UART1_IRQ);
+
+    if(writer_resume() == true)
+    {
+        test_deferred_passes = test_deferred_passes + 1;
+    }
+
+    command = uart_command_get();
+
+    if(command[0] != 0)
+    {
+        writer_init_uart(&writer, WRITER_MODE_RAW);
+
+        if(strcmp(command, "{}") == 0)
+        {
+            write_entities_json(&writer, ",");
+            writer_puts(&writer, "\r\n");
+        }
+        else if(command[0] == '[')
+        {
+            fragment_process_batch(&writer, command);
+            writer_puts(&writer, "\r\n");
+        }
+        else if(command_dispatch(&writer, command) == false)
+        {
+            writer_puts(&writer, "\r\nUnknown command\r\n");
+        }
+
+        writer_flush(&writer);
+        uart_command_clear();
+
+        if(uart_response_pending() == false)
+        {
+            arena_reset(&scratch_arena);
+        }
+    }
+
+    // The last byte written is still in the data register
+    test_capture();
+
+    if(time_us_64() - start_us > test_pass_max_us)
+    {
+        test_pass_max_us = time_us_64() - start_us;
+    }
+}
+
+// Runs the loop until everything typed has been answered and sent. Returns the
+// number of passes, one a millisecond on the wire.
+uint32_t test_run(void)
+{
+    uint32_t    passes = 0;
+    uint32_t    quiet = 0;
+    uint32_t    output_length = 0;
+
+    while((quiet != 10) && (passes != TEST_PASSES_MAX))
+    {
+        output_length = test_output_length;
+        test_pass();
+        passes = passes + 1;
+
+        if((output_length == test_output_length) && (uart_response_pending() == false) && (test_input_position == test_input_length))
+        {
+            quiet = quiet + 1;
+        }
+        else
+        {
+            quiet = 0;
+        }
+    }
+
+    HOST_CHECK(passes != TEST_PASSES_MAX);
+
+    return(passes);
+}
+
+// Checks that the expected text comes next in the output, and returns what
+// follows it
+char* test_expect(char* from, const char* expected)
+{
+    if(strncmp(from, expected, strlen(expected)) != 0)
+    {
+        printf("Expected \"%.40s\", got \"%.40s\"\n", expected, from);
+        HOST_CHECK(false);
+        return(from);
+    }
+
+    return(from + strlen(expected));
+}
+
+// =================================================================================
+
+// A dump several times the size of the TX ring, with a command typed while it goes
+void test_dump(void)
+{
+    static char expected[TEST_OUTPUT_SIZE];
+    writer_t    writer;
+    char*       output = NULL;
+    uint32_t    passes = 0;
+
+    writer_init_buffer(&writer, expected, sizeof(expected), WRITER_MODE_RAW);
+    write_entities_json(&writer, ",\r\n");
+    writer_flush(&writer);
+    HOST_CHECK(strlen(expected) > 2 * 8192);
+
+    test_type("\033");
+    test_run();
+    test_output_length = 0;
+
+    test_type("dump\r");
+    test_pass();
+    test_pass();
+    test_type("get uart\r");
+    passes = test_run();
+
+    // The UART sends "\r\n" for the lone "\n" before and after the array
+    output = test_expect(test_output, "dump");
+    output = test_expect(output, "\r\n");
+    output = test_expect(output, expected);
+    output = test_expect(output, "\r\n");
+    output = test_expect(output, "\r\n1840A > ");
+    output = test_expect(output, "get uart");
+    output = test_expect(output, "\r\nReceived: ");
+    HOST_CHECK(strstr(output, " 1 deferred") != NULL);
+
+    // The dump goes at the speed of the wire, with the loop going round meanwhile
+    HOST_CHECK(test_deferred_passes > (strlen(expected) / TEST_BYTES_PER_PASS) / 2);
+
+    printf("Dump: %lu bytes in %lu passes, %lu of them finishing it from the loop\n", (unsigned long) strlen(expected), (unsigned long) passes,
+           (unsigned long) test_deferred_passes);
+}
+
+// A batch sent straight after "{}", as a host script might
+void test_batch(void)
+{
+    static char expected[TEST_OUTPUT_SIZE];
+    char        batch[TEST_INPUT_SIZE];
+    writer_t    writer;
+    char*       output = NULL;
+    uint16_t    length = 0;
+    uint8_t     counter = 0;
+
+    writer_init_buffer(&writer, expected, sizeof(expected), WRITER_MODE_RAW);
+    write_entities_json(&writer, ",");
+    writer_puts(&writer, "\r\n[");
+    batch[0] = '[';
+    length = 1;
+
+    for(counter = 0; counter != TEST_BATCH; counter++)
+    {
+        if(counter != 0)
+        {
+            writer_putc(&writer, ',');
+            batch[length] = ',';
+            length = length + 1;
+        }
+
+        store_write_json(&writer, store_find(test_names[counter]), true);
+        length = length + sprintf(&batch[length], "{\"eID\":\"%s\"}", test_names[counter]);
+    }
+
+    writer_puts(&writer, "]\r\n");
+    writer_flush(&writer);
+    strcpy(&batch[length], "]\r");
+
+    // Outside command mode
+    test_type("exit\r");
+    test_run();
+    HOST_CHECK(uart_in_command_mode() == false);
+    test_output_length = 0;
+
+    test_type("{}\r");
+    test_type(batch);
+    test_run();
+
+    output = test_expect(test_output, expected);
+    HOST_CHECK(*output == 0);
+    HOST_CHECK(uart_get_stats()->tx_deferred == 3);
+}
+
+int main(void)
+{
+    char    value[TEST_VALUE_LENGTH + 8];
+    uint8_t counter = 0;
+
+    arena_initialize();
+    snon_initialize("Response Test");
+
+    for(counter = 0; counter != TEST_ENTITIES; counter++)
+    {
+        sprintf(test_names[counter], "=P01=E%03u", counter + 1);
+        sprintf(value, "[\"%0*u\"]", TEST_VALUE_LENGTH, counter);
+        snon_register(test_names[counter], SNON_CLASS_VALUE, value);
+    }
+
+    store_initialize();
+    commands_initialize();
+
+    uart_get_hw(uart1)->dr = TEST_DR_EMPTY;
+    uart_setup();
+
+    test_dump();
+    test_batch();
+
+    // Nothing waited for the ring, so no pass took long
+    printf("Longest pass: %lu us\n", (unsigned long) test_pass_max_us);
+    HOST_CHECK(test_pass_max_us < TEST_PASS_MAX_US);
+
+    return(host_result());
+}
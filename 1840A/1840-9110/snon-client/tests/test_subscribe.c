@@ -0,0 +1,465 @@
+// ---------------------------------------------------------------------------------
+// Host test - Change subscriptions
+// ---------------------------------------------------------------------------------
+// Runs the 1840A fragment handling and subscriptions behind the UART code on a
+// pty, and subscribes to the entities under "=P01" with a 50 ms interval. Each of
+// them has to be pushed straight away with the value it has, and after that a
+// value that is set has to be pushed once, after the reply to the fragment that
+// set it.
+// A burst of sets to one entity has to be pushed at most once an interval, with
+// the last value coming last. Setting a value it already has, or one outside the
+// subscription, pushes nothing, and nor does anything once unsubscribed. Pushes
+// have to be numbered one after another.
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "pico/stdlib.h"
+#include "hardware/irq.h"
+#include "hardware/uart.h"
+#include "snon/snon_utils.h"
+
+#include "arena.h"
+#include "fragment.h"
+#include "store.h"
+#include "subscribe.h"
+#include "uart.h"
+#include "writer.h"
+#include "host.h"
+
+// Constants
+#define TEST_ENTITIES       4
+#define TEST_BURST          10                      // Sets sent back to back
+#define TEST_INTERVAL_MS    50
+#define TEST_PUSHES_MAX     64
+#define TEST_LINE_MAX       512
+#define TEST_FIFO_SIZE      32                      // Bytes the UART holds between interrupts
+#define TEST_DR_EMPTY       0x100                   // Nothing written to the UART data register
+#define TEST_REPLY_US       2000000
+#define TEST_SETTLE_US      300000                  // Long enough for anything held back to be pushed
+
+// Types
+typedef struct
+{
+    uint32_t    sequence;
+    uint8_t     entity;
+    char        value[16];
+    uint64_t    received_us;
+} test_push_t;
+
+// Global variables
+const char*         test_names[TEST_ENTITIES] = {"=P01=E001", "=P01=E002", "=P01=E003", "=P02=E001"};
+char                test_eids[TEST_ENTITIES][SNON_URN_LENGTH];
+int                 test_master = -1;
+int                 test_slave = -1;
+volatile bool       test_running = true;
+
+// Host thread only
+test_push_t         test_pushes[TEST_PUSHES_MAX];
+uint8_t             test_push_count = 0;
+
+// Panel state, panel thread only
+uint8_t             test_fifo[TEST_FIFO_SIZE];
+int                 test_fifo_length = 0;
+int                 test_fifo_position = 0;
+
+// Private prototypes
+void test_panel_tx(void);
+void* test_panel(void* unused);
+void test_open_pty(void);
+void test_send(const char* line);
+bool test_receive(char* line, uint64_t timeout_us);
+bool test_push(const char* line);
+void test_reply(char* reply);
+void test_settle(void);
+void test_set(uint8_t entity, const char* value);
+uint8_t test_pushes_of(uint8_t entity, uint8_t from);
+
+// =================================================================================
+// Panel UART. Received bytes come from the pty, and each byte written to the data
+// register goes back to it when the UART is next asked whether it has room.
+
+bool uart_is_readable(uart_inst_t* uart)
+{
+    int length = 0;
+
+    (void) uart;
+
+    if(test_fifo_position == test_fifo_length)
+    {
+        length = read(test_slave, test_fifo, TEST_FIFO_SIZE);
+
+        test_fifo_position = 0;
+        test_fifo_length = (length > 0) ? length : 0;
+    }
+
+    return(test_fifo_position != test_fifo_length);
+}
+
+char uart_getc(uart_inst_t* uart)
+{
+    char    character = test_fifo[test_fifo_position];
+
+    (void) uart;
+
+    test_fifo_position = test_fifo_position + 1;
+
+    return(character);
+}
+
+bool uart_is_writable(uart_inst_t* uart)
+{
+    (void) uart;
+
+    test_panel_tx();
+
+    return(true);
+}
+
+void test_panel_tx(void)
+{
+    uart_hw_t*  hw = uart_get_hw(uart1);
+    uint8_t     character = 0;
+
+    if(hw->dr != TEST_DR_EMPTY)
+    {
+        character = hw->dr;
+        hw->dr = TEST_DR_EMPTY;
+        HOST_CHECK(write(test_slave, &character, 1) == 1);
+    }
+}
+
+// =================================================================================
+// Panel
+
+// The 1840A command loop, for SNON fragments, with the subscriptions serviced
+// each time round. The UART interrupt runs on the same thread, whenever the pty
+// has data.
+void* test_panel(void* unused)
+{
+    struct pollfd   waiting = {.fd = test_slave, .events = POLLIN};
+    const char*     command = NULL;
+    writer_t        writer;
+
+    (void) unused;
+
+    host_set_core(0);
+
+    while(test_running == true)
+    {
+        if(poll(&waiting, 1, 1) > 0)
+        {
+            host_irq(UART1_IRQ);
+        }
+
+        writer_resume();
+        command = uart_command_get();
+
+        if(command[0] != 0)
+        {
+            writer_init_uart(&writer, WRITER_MODE_RAW);
+            fragment_process(&writer, command);
+            writer_puts(&writer, "\r\n");
+            writer_flush(&writer);
+            uart_command_clear();
+
+            if(uart_response_pending() == false)
+            {
+                arena_reset(&scratch_arena);
+            }
+        }
+
+        subscribe_service();
+        test_panel_tx();
+    }
+
+    return(NULL);
+}
+
+// =================================================================================
+// Host
+
+// A raw pty, so carriage returns arrive as they were sent
+void test_open_pty(void)
+{
+    struct termios  settings;
+
+    test_master = posix_openpt(O_RDWR | O_NOCTTY);
+    HOST_CHECK(test_master >= 0);
+    HOST_CHECK(grantpt(test_master) == 0);
+    HOST_CHECK(unlockpt(test_master) == 0);
+
+    test_slave = open(ptsname(test_master), O_RDWR | O_NOCTTY | O_NONBLOCK);
+    HOST_CHECK(test_slave >= 0);
+
+    tcgetattr(test_slave, &settings);
+    cfmakeraw(&settings);
+    tcsetattr(test_slave, TCSANOW, &settings);
+}
+
+void test_send(const char* line)
+{
+    size_t  length = strlen(line);
+
+    HOST_CHECK(write(test_master, line, length) == (ssize_t) length);
+}
+
+// Reads one line, without its line end
+bool test_receive(char* line, uint64_t timeout_us)
+{
+    struct pollfd   waiting = {.fd = test_master, .events = POLLIN};
+    uint64_t        start_us = time_us_64();
+    uint16_t        length = 0;
+    char            character = 0;
+
+    while(time_us_64() - start_us < timeout_us)
+    {
+        if((poll(&waiting, 1, 1) <= 0) || (read(test_master, &character, 1) != 1))
+        {
+            continue;
+        }
+
+        if(character == '\n')
+        {
+            line[length] = 0;
+            return(true);
+        }
+
+        if((character != '\r') && (length < TEST_LINE_MAX - 1))
+        {
+            line[length] = character;
+            length = length + 1;
+        }
+    }
+
+    line[length] = 0;
+
+    return(false);
+}
+
+// Notes a line if it is a push. Returns false if it is anything else.
+bool test_push(const char* line)
+{
+    unsigned long   sequence = 0;
+    char            eid[SNON_URN_LENGTH];
+    char            value[16];
+    uint8_t         entity = 0;
+
+    if(sscanf(line, "{\"seq\":%lu,\"eID\":\"%63[^\"]\",\"v\":[\"%15[^\"]\"]}", &sequence, eid, value) != 3)
+    {
+        return(false);
+    }
+
+    while((entity != TEST_ENTITIES) && (strcmp(eid, test_eids[entity]) != 0))
+    {
+        entity = entity + 1;
+    }
+
+    HOST_CHECK(entity != TEST_ENTITIES);
+    HOST_CHECK(test_push_count != TEST_PUSHES_MAX);
+
+    if(test_push_count != TEST_PUSHES_MAX)
+    {
+        test_pushes[test_push_count].sequence = sequence;
+        test_pushes[test_push_count].entity = entity;
+        strcpy(test_pushes[test_push_count].value, value);
+        test_pushes[test_push_count].received_us = time_us_64();
+        test_push_count = test_push_count + 1;
+    }
+
+    return(true);
+}
+
+// Reads up to the next reply, noting any pushes on the way
+void test_reply(char* reply)
+{
+    do
+    {
+        HOST_CHECK(test_receive(reply, TEST_REPLY_US) == true);
+    }
+    while(test_push(reply) == true);
+}
+
+// Notes the pushes sent until everything held back has had time to go
+void test_settle(void)
+{
+    char        line[TEST_LINE_MAX];
+    uint64_t    start_us = time_us_64();
+
+    while(time_us_64() - start_us < TEST_SETTLE_US)
+    {
+        if(test_receive(line, TEST_SETTLE_US - (time_us_64() - start_us)) == true)
+        {
+            HOST_CHECK(test_push(line) == true);
+        }
+    }
+}
+
+// Sets a value and checks the reply to it
+void test_set(uint8_t entity, const char* value)
+{
+    char    line[TEST_LINE_MAX];
+    char    expected[TEST_LINE_MAX];
+
+    snprintf(line, sizeof(line), "{\"eID\":\"%s\",\"v\":[\"%s\"]}\r\n", test_eids[entity], value);
+    test_send(line);
+
+    test_reply(line);
+    snprintf(expected, sizeof(expected), "{\"eID\":\"%s\",\"name\":\"%s\",\"v\":[\"%s\"]}", test_eids[entity], test_names[entity], value);
+    HOST_CHECK(strcmp(line, expected) == 0);
+}
+
+// Number of pushes of an entity, from the given push on
+uint8_t test_pushes_of(uint8_t entity, uint8_t from)
+{
+    uint8_t     count = 0;
+
+    while(from != test_push_count)
+    {
+        if(test_pushes[from].entity == entity)
+        {
+            count = count + 1;
+        }
+
+        from = from + 1;
+    }
+
+    return(count);
+}
+
+int main(void)
+{
+    pthread_t   panel;
+    char        line[TEST_LINE_MAX];
+    char        value[16];
+    uint8_t     from = 0;
+    uint8_t     last = 0;
+    uint8_t     counter = 0;
+
+    arena_initialize();
+    snon_initialize("Subscribe Test");
+
+    for(counter = 0; counter != TEST_ENTITIES; counter++)
+    {
+        snon_register((char*) test_names[counter], SNON_CLASS_VALUE, "[\"off\"]");
+        snon_name_to_eid((char*) test_names[counter], test_eids[counter]);
+    }
+
+    store_initialize();
+
+    uart_get_hw(uart1)->dr = TEST_DR_EMPTY;
+    test_open_pty();
+    uart_setup();
+
+    pthread_create(&panel, NULL, test_panel, NULL);
+
+    // Everything under =P01, but not =P02, and nothing for a prefix with no entities
+    snprintf(line, sizeof(line), "{\"subscribe\":[\"=P01\"],\"interval\":%u,\"rID\":1}\r\n", TEST_INTERVAL_MS);
+    test_send(line);
+    test_reply(line);
+    HOST_CHECK(strcmp(line, "{\"rID\":1,\"subscribed\":3}") == 0);
+
+    test_send("{\"subscribe\":\"=P09\",\"rID\":2}\r\n");
+    test_reply(line);
+    HOST_CHECK(strstr(line, "\"rID\":2") != NULL);
+    HOST_CHECK(strstr(line, "\"error\":3") != NULL);
+
+    // The values they have to start with
+    test_settle();
+    HOST_CHECK(test_push_count == 3);
+
+    for(counter = 0; counter != 3; counter++)
+    {
+        HOST_CHECK(test_pushes_of(counter, 0) == 1);
+        HOST_CHECK(strcmp(test_pushes[counter].value, "off") == 0);
+    }
+
+    // One set, one push, after the reply
+    from = test_push_count;
+    test_set(0, "a");
+    HOST_CHECK(test_push_count == from);
+    test_settle();
+    HOST_CHECK(test_push_count == from + 1);
+    HOST_CHECK(test_pushes_of(0, from) == 1);
+    HOST_CHECK(strcmp(test_pushes[from].value, "a") == 0);
+
+    // A burst, sent back to back, is pushed at most once an interval, ending
+    // with the last value
+    from = test_push_count;
+
+    for(counter = 0; counter != TEST_BURST; counter++)
+    {
+        snprintf(line, sizeof(line), "{\"eID\":\"%s\",\"v\":[\"b%u\"]}\r\n", test_eids[1], counter);
+        test_send(line);
+    }
+
+    for(counter = 0; counter != TEST_BURST; counter++)
+    {
+        test_reply(line);
+        HOST_CHECK(strstr(line, test_eids[1]) != NULL);
+    }
+
+    test_settle();
+    HOST_CHECK(test_pushes_of(1, from) >= 1);
+    HOST_CHECK(test_pushes_of(1, from) < TEST_BURST / 2);
+    HOST_CHECK(subscribe_get_stats()->deferred >= 1);
+
+    last = from;
+    for(counter = from; counter != test_push_count; counter++)
+    {
+        if(counter != from)
+        {
+            HOST_CHECK(test_pushes[counter].received_us - test_pushes[last].received_us >= (TEST_INTERVAL_MS - 10) * 1000);
+        }
+
+        last = counter;
+    }
+
+    sprintf(value, "b%u", TEST_BURST - 1);
+    HOST_CHECK(strcmp(test_pushes[test_push_count - 1].value, value) == 0);
+
+    // The same value again, and a value outside the subscription, push nothing
+    from = test_push_count;
+    test_set(1, value);
+    test_set(3, "c");
+    test_settle();
+    HOST_CHECK(test_push_count == from);
+
+    // Nothing once unsubscribed
+    test_send("{\"unsubscribe\":[],\"rID\":3}\r\n");
+    test_reply(line);
+    HOST_CHECK(strcmp(line, "{\"rID\":3,\"unsubscribed\":3}") == 0);
+
+    test_set(2, "d");
+    test_settle();
+    HOST_CHECK(test_push_count == from);
+
+    test_running = false;
+    pthread_join(panel, NULL);
+
+    // Numbered one after another, and every push was seen
+    for(counter = 0; counter != test_push_count; counter++)
+    {
+        HOST_CHECK(test_pushes[counter].sequence == counter + 1u);
+    }
+
+    HOST_CHECK(subscribe_get_stats()->pushes == test_push_count);
+
+    printf("%u pushes, %lu held back by the interval\n", test_push_count, (unsigned long) subscribe_get_stats()->deferred);
+
+    close(test_slave);
+    close(test_master);
+
+    return(host_result());
+}
@@ -0,0 +1,366 @@
+// ---------------------------------------------------------------------------------
+// Host test - UART receive queue
+// ---------------------------------------------------------------------------------
+// Blasts SNON lines into a pty, the way the scripts in 1840A/1840-9110 do. One
+// thread stands in for the UART interrupt and reads the pty whenever it has data,
+// and another stands in for the command loop. Every line has to come out of
+// uart_command_get() whole and in order. Then the command loop stops while a burst
+// of long lines fills the ring and a burst of short lines fills the line queue,
+// and every line that doesn't fit has to be counted as dropped.
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "pico/stdlib.h"
+#include "hardware/irq.h"
+#include "hardware/uart.h"
+
+#include "uart.h"
+#include "host.h"
+
+// Constants
+#define TEST_LINES          2000
+#define TEST_BURST_LINES    200
+#define TEST_LONG_EVERY     100         // Every 100th line is longer than the old 254 limit
+#define TEST_SHORT_FIRST    100000      // Lines from here on are short enough to fill the line queue first
+#define TEST_LINE_MAX       1100
+#define TEST_BYTES_PER_MS   200         // About 17 times what the panel's 115200 baud carries
+#define TEST_FIFO_SIZE      32          // Bytes the UART holds between interrupts
+#define TEST_IDLE_US        5000000     // How long the command loop waits for more lines
+
+// Global variables
+int                 test_master = -1;
+int                 test_slave = -1;
+uint8_t             test_fifo[TEST_FIFO_SIZE];
+int                 test_fifo_length = 0;
+int                 test_fifo_position = 0;
+volatile bool       test_running = true;
+uint32_t            test_received = 0;
+uint32_t            test_wrong = 0;
+uint32_t            test_sent_bytes = 0;
+
+// Private prototypes
+uint16_t test_line(uint32_t number, char* line, uint16_t length);
+void test_write_line(uint32_t number);
+void test_open_pty(void);
+void* test_writer(void* unused);
+void* test_interrupt(void* unused);
+void* test_command_loop(void* unused);
+bool test_check_line(const char* command, uint32_t* number);
+void test_wait_received(uint32_t bytes);
+void test_burst(uint32_t first);
+
+// =================================================================================
+// The UART receive FIFO is filled from the pty, and only ever read from the
+// interrupt thread
+
+bool uart_is_readable(uart_inst_t* uart)
+{
+    int length = 0;
+
+    (void) uart;
+
+    if(test_fifo_position == test_fifo_length)
+    {
+        length = read(test_slave, test_fifo, TEST_FIFO_SIZE);
+
+        test_fifo_position = 0;
+        test_fifo_length = (length > 0) ? length : 0;
+    }
+
+    return(test_fifo_position != test_fifo_length);
+}
+
+char uart_getc(uart_inst_t* uart)
+{
+    char    character = test_fifo[test_fifo_position];
+
+    (void) uart;
+
+    test_fifo_position = test_fifo_position + 1;
+
+    return(character);
+}
+
+// =================================================================================
+
+// An entity update with the line number in its value, and a different length for
+// every line. Returns the length of the line, without the end of line.
+uint16_t test_line(uint32_t number, char* line, uint16_t length)
+{
+    uint16_t    padding = (number * 37) % 300;
+    int         used = 0;
+
+    if(number >= TEST_SHORT_FIRST)
+    {
+        padding = number % 8;
+    }
+    else if((number % TEST_LONG_EVERY) == TEST_LONG_EVERY - 1)
+    {
+        padding = 900;
+    }
+
+    used = snprintf(line, length, "{\"eID\":\"urn:uuid:254CB903-3406-5B2A-A6DD-9DEA8A0DB148\",\"v\":[\"%06lu:", (unsigned long) number);
+    memset(line + used, 'a' + (number % 26), padding);
+    used = used + padding;
+    used = used + snprintf(line + used, length - used, "\"]}");
+
+    return(used);
+}
+
+void test_write_line(uint32_t number)
+{
+    char        line[TEST_LINE_MAX + 2];
+    uint16_t    length = test_line(number, line, TEST_LINE_MAX);
+    uint16_t    written = 0;
+    ssize_t     result = 0;
+
+    line[length] = '\r';
+    line[length + 1] = '\n';
+    length = length + 2;
+
+    while(written != length)
+    {
+        result = write(test_master, line + written, length - written);
+
+        if(result > 0)
+        {
+            written = written + result;
+        }
+    }
+
+    test_sent_bytes = test_sent_bytes + length;
+}
+
+// A raw pty, so carriage returns arrive as they were sent
+void test_open_pty(void)
+{
+    struct termios  settings;
+
+    test_master = posix_openpt(O_RDWR | O_NOCTTY);
+    HOST_CHECK(test_master >= 0);
+    HOST_CHECK(grantpt(test_master) == 0);
+    HOST_CHECK(unlockpt(test_master) == 0);
+
+    test_slave = open(ptsname(test_master), O_RDWR | O_NOCTTY | O_NONBLOCK);
+    HOST_CHECK(test_slave >= 0);
+
+    tcgetattr(test_slave, &settings);
+    cfmakeraw(&settings);
+    tcsetattr(test_slave, TCSANOW, &settings);
+}
+
+// Sends the lines back to back, at a steady byte rate
+void* test_writer(void* unused)
+{
+    uint64_t    start_us = time_us_64();
+    uint64_t    due_us = 0;
+    uint32_t    number = 0;
+
+    (void) unused;
+
+    while(number != TEST_LINES)
+    {
+        test_write_line(number);
+
+        due_us = start_us + (test_sent_bytes * 1000ull) / TEST_BYTES_PER_MS;
+        if(due_us > time_us_64())
+        {
+            usleep(due_us - time_us_64());
+        }
+
+        number = number + 1;
+    }
+
+    return(NULL);
+}
+
+// Runs the UART interrupt handler whenever the pty has data
+void* test_interrupt(void* unused)
+{
+    struct pollfd   waiting = {.fd = test_slave, .events = POLLIN};
+
+    (void) unused;
+
+    host_set_core(0);
+
+    while(test_running == true)
+    {
+        if(poll(&waiting, 1, 10) > 0)
+        {
+            host_irq(UART1_IRQ);
+        }
+    }
+
+    return(NULL);
+}
+
+// Takes lines until none have arrived for a while
+void* test_command_loop(void* unused)
+{
+    uint64_t    last_us = time_us_64();
+    uint32_t    expected = 0;
+    uint32_t    number = 0;
+    const char* command = NULL;
+
+    (void) unused;
+
+    host_set_core(0);
+
+    while((test_received != TEST_LINES) && (time_us_64() - last_us < TEST_IDLE_US))
+    {
+        command = uart_command_get();
+
+        if(command[0] == 0)
+        {
+            sched_yield();
+            continue;
+        }
+
+        if((test_check_line(command, &number) == false) || (number != expected))
+        {
+            test_wrong = test_wrong + 1;
+        }
+
+        expected = number + 1;
+        test_received = test_received + 1;
+        last_us = time_us_64();
+
+        uart_command_clear();
+    }
+
+    return(NULL);
+}
+
+// True if the command is one of the test lines, exactly as it was sent
+bool test_check_line(const char* command, uint32_t* number)
+{
+    char            line[TEST_LINE_MAX];
+    unsigned long   found = 0;
+    const char*     value = strstr(command, "\"v\":[\"");
+
+    if((value == NULL) || (sscanf(value + 6, "%06lu:", &found) != 1))
+    {
+        return(false);
+    }
+
+    *number = found;
+    test_line(found, line, TEST_LINE_MAX);
+
+    return(strcmp(command, line) == 0);
+}
+
+// Waits for the interrupt thread to have taken the bytes out of the pty
+void test_wait_received(uint32_t bytes)
+{
+    uint64_t    start_us = time_us_64();
+
+    while((uart_get_stats()->rx_bytes != bytes) && (time_us_64() - start_us < TEST_IDLE_US))
+    {
+        usleep(1000);
+    }
+}
+
+// Sends a burst of lines while the command loop is stopped, then takes what was
+// queued
+void test_burst(uint32_t first)
+{
+    const uart_stats_t* stats = uart_get_stats();
+    const char*         command = NULL;
+    uint32_t            dropped = stats->rx_overflows + stats->line_overflows;
+    uint32_t            lines = stats->lines;
+    uint32_t            number = first;
+    uint32_t            previous = 0;
+
+    while(number != first + TEST_BURST_LINES)
+    {
+        test_write_line(number);
+        number = number + 1;
+    }
+
+    test_wait_received(test_sent_bytes);
+    HOST_CHECK(stats->rx_bytes == test_sent_bytes);
+
+    test_received = 0;
+    test_wrong = 0;
+    command = uart_command_get();
+
+    while(command[0] != 0)
+    {
+        if((test_check_line(command, &number) == false) || ((test_received != 0) && (number <= previous)))
+        {
+            test_wrong = test_wrong + 1;
+        }
+
+        previous = number;
+        test_received = test_received + 1;
+        uart_command_clear();
+        command = uart_command_get();
+    }
+
+    dropped = stats->rx_overflows + stats->line_overflows - dropped;
+    printf("Burst: %lu of %u lines queued, %lu dropped (%lu ring, %lu queue in total), %lu wrong\n", (unsigned long) test_received, TEST_BURST_LINES,
+           (unsigned long) dropped, (unsigned long) stats->rx_overflows, (unsigned long) stats->line_overflows, (unsigned long) test_wrong);
+    HOST_CHECK(test_received != 0);
+    HOST_CHECK(dropped != 0);
+    HOST_CHECK(test_received + dropped == TEST_BURST_LINES);
+    HOST_CHECK(stats->lines - lines == test_received);
+    HOST_CHECK(test_wrong == 0);
+}
+
+int main(void)
+{
+    pthread_t           writer;
+    pthread_t           interrupt;
+    pthread_t           command_loop;
+    const uart_stats_t* stats = uart_get_stats();
+    uint64_t            start_us = 0;
+
+    test_open_pty();
+    uart_setup();
+
+    // Every line arrives, whole and in order
+    start_us = time_us_64();
+    pthread_create(&interrupt, NULL, test_interrupt, NULL);
+    pthread_create(&command_loop, NULL, test_command_loop, NULL);
+    pthread_create(&writer, NULL, test_writer, NULL);
+    pthread_join(writer, NULL);
+    pthread_join(command_loop, NULL);
+
+    printf("Stream: %lu of %u lines in %.2f s, %lu wrong, %lu bytes, ring high water %lu\n", (unsigned long) test_received, TEST_LINES,
+           (time_us_64() - start_us) / 1e6, (unsigned long) test_wrong, (unsigned long) stats->rx_bytes, (unsigned long) stats->rx_high_water);
+    HOST_CHECK(test_received == TEST_LINES);
+    HOST_CHECK(test_wrong == 0);
+    HOST_CHECK(stats->rx_bytes == test_sent_bytes);
+    HOST_CHECK(stats->rx_overflows == 0);
+    HOST_CHECK(stats->line_overflows == 0);
+    HOST_CHECK(stats->lines_truncated == 0);
+
+    // With the command loop stopped, a burst of long lines fills the ring and a
+    // burst of short lines fills the line queue. The lines that don't fit are
+    // dropped whole and counted, and the rest come out intact.
+    test_burst(0);
+    HOST_CHECK(stats->rx_overflows != 0);
+
+    test_burst(TEST_SHORT_FIRST);
+    HOST_CHECK(stats->line_overflows != 0);
+
+    test_running = false;
+    pthread_join(interrupt, NULL);
+    close(test_slave);
+    close(test_master);
+
+    return(host_result());
+}
@@ -0,0 +1,385 @@
+// ---------------------------------------------------------------------------------
+// SNON transports
+// ---------------------------------------------------------------------------------
+// Line-oriented links to a panel: a serial device, a TCP serial bridge, or an
+// in-process mock panel
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "transport.h"
+#include "mock_panel.h"
+
+namespace snon
+{
+
+// Constants
+static const size_t     read_chunk_size = 4096;
+
+// =================================================================================
+// File descriptors
+
+fd_transport::~fd_transport()
+{
+    fd_transport::close();
+}
+
+void fd_transport::close()
+{
+    if(fd != -1)
+    {
+        ::close(fd);
+        fd = -1;
+    }
+
+    received.clear();
+}
+
+bool fd_transport::write(const std::string& data)
+{
+    size_t  sent = 0;
+    ssize_t result = 0;
+
+    if(fd == -1)
+    {
+        return(false);
+    }
+
+    while(sent != data.length())
+    {
+        result = ::write(fd, data.data() + sent, data.length() - sent);
+
+        if(result < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+
+            return(false);
+        }
+
+        sent = sent + result;
+    }
+
+    return(true);
+}
+
+// Lines end with "\r", "\n" or both. Empty lines are skipped.
+transport::read_t fd_transport::read_line(std::string& line, int timeout_ms)
+{
+    struct pollfd   poll_fd;
+    char            chunk[read_chunk_size];
+    size_t          end = 0;
+    ssize_t         result = 0;
+
+    while(true)
+    {
+        end = received.find_first_of("\r\n");
+        while(end == 0)
+        {
+            received.erase(0, 1);
+            end = received.find_first_of("\r\n");
+        }
+
+        if(end != std::string::npos)
+        {
+            line = received.substr(0, end);
+            received.erase(0, end + 1);
+            return(READ_LINE);
+        }
+
+        if(fd == -1)
+        {
+            return(READ_CLOSED);
+        }
+
+        poll_fd.fd = fd;
+        poll_fd.events = POLLIN;
+        poll_fd.revents = 0;
+
+        result = poll(&poll_fd, 1, timeout_ms);
+        if(result == 0)
+        {
+            return(READ_TIMEOUT);
+        }
+        else if(result < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+
+            return(READ_CLOSED);
+        }
+
+        result = ::read(fd, chunk, sizeof(chunk));
+        if(result <= 0)
+        {
+            if((result < 0) && ((errno == EINTR) || (errno == EAGAIN)))
+            {
+                continue;
+            }
+
+            return(READ_CLOSED);
+        }
+
+        received.append(chunk, result);
+    }
+}
+
+// =================================================================================
+// TCP serial bridges
+
+tcp_transport::tcp_transport(const std::string& host, const std::string& port) : host(host), port(port)
+{
+}
+
+bool tcp_transport::open()
+{
+    struct addrinfo     hints = {};
+    struct addrinfo*    addresses = NULL;
+    struct addrinfo*    address = NULL;
+    int                 flag = 1;
+
+    close();
+    signal(SIGPIPE, SIG_IGN);
+
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    if(getaddrinfo(host.c_str(), port.c_str(), &hints, &addresses) != 0)
+    {
+        return(false);
+    }
+
+    for(address = addresses; address != NULL; address = address->ai_next)
+    {
+        fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+        if(fd == -1)
+        {
+            continue;
+        }
+
+        if(connect(fd, address->ai_addr, address->ai_addrlen) == 0)
+        {
+            break;
+        }
+
+        ::close(fd);
+        fd = -1;
+    }
+
+    freeaddrinfo(addresses);
+
+    if(fd == -1)
+    {
+        return(false);
+    }
+
+    // Requests are small and latency matters more than packet count
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+
+    return(true);
+}
+
+std::string tcp_transport::describe() const
+{
+    return("tcp:" + host + ":" + port);
+}
+
+// =================================================================================
+// Serial devices
+
+static speed_t baud_to_speed(uint32_t baud)
+{
+    static const struct { uint32_t baud; speed_t speed; } speeds[] =
+    {
+        { 9600, B9600 }, { 19200, B19200 }, { 38400, B38400 }, { 57600, B57600 },
+        { 115200, B115200 }, { 230400, B230400 }, { 460800, B460800 }, { 921600, B921600 }
+    };
+
+    for(const auto& entry : speeds)
+    {
+        if(entry.baud == baud)
+        {
+            return(entry.speed);
+        }
+    }
+
+    return(B0);
+}
+
+serial_transport::serial_transport(const std::string& device, uint32_t baud) : device(device), baud(baud)
+{
+}
+
+bool serial_transport::open()
+{
+    struct termios  settings;
+    speed_t         speed = baud_to_speed(baud);
+
+    close();
+
+    if(speed == B0)
+    {
+        return(false);
+    }
+
+    fd = ::open(device.c_str(), O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if(fd == -1)
+    {
+        return(false);
+    }
+
+    if(tcgetattr(fd, &settings) != 0)
+    {
+        close();
+        return(false);
+    }
+
+    cfmakeraw(&settings);
+    cfsetispeed(&settings, speed);
+    cfsetospeed(&settings, speed);
+    settings.c_cflag = settings.c_cflag | CLOCAL | CREAD;
+    settings.c_cc[VMIN] = 1;
+    settings.c_cc[VTIME] = 0;
+
+    if(tcsetattr(fd, TCSANOW, &settings) != 0)
+    {
+        close();
+        return(false);
+    }
+
+    tcflush(fd, TCIOFLUSH);
+
+    return(true);
+}
+
+std::string serial_transport::describe() const
+{
+    return("serial:" + device + "@" + std::to_string(baud));
+}
+
+// =================================================================================
+// Mock panels
+
+mock_transport::mock_transport(mock_panel& panel) : panel(panel)
+{
+}
+
+mock_transport::~mock_transport()
+{
+    mock_transport::close();
+}
+
+bool mock_transport::open()
+{
+    int     fds[2];
+
+    close();
+    signal(SIGPIPE, SIG_IGN);
+
+    if(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+    {
+        return(false);
+    }
+
+    fd = fds[0];
+    panel_fd = fds[1];
+    panel_thread = std::thread([this]() { panel.serve(panel_fd); });
+
+    return(true);
+}
+
+void mock_transport::close()
+{
+    if(fd != -1)
+    {
+        shutdown(fd, SHUT_RDWR);
+    }
+
+    if(panel_thread.joinable() == true)
+    {
+        panel_thread.join();
+    }
+
+    if(panel_fd != -1)
+    {
+        ::close(panel_fd);
+        panel_fd = -1;
+    }
+
+    fd_transport::close();
+}
+
+std::string mock_transport::describe() const
+{
+    return("mock");
+}
+
+// =================================================================================
+// Transport specifications
+
+std::unique_ptr<transport> transport_from_spec(const std::string& spec, mock_panel* panel)
+{
+    std::string body = spec;
+    size_t      separator = 0;
+    uint32_t    baud = 115200;
+
+    if(spec == "mock")
+    {
+        if(panel == NULL)
+        {
+            return(NULL);
+        }
+
+        return(std::unique_ptr<transport>(new mock_transport(*panel)));
+    }
+
+    if((spec.compare(0, 7, "serial:") == 0) || (spec.compare(0, 5, "/dev/") == 0))
+    {
+        if(spec.compare(0, 7, "serial:") == 0)
+        {
+            body = spec.substr(7);
+        }
+
+        separator = body.rfind('@');
+        if(separator != std::string::npos)
+        {
+            baud = strtoul(body.c_str() + separator + 1, NULL, 10);
+            body = body.substr(0, separator);
+        }
+
+        return(std::unique_ptr<transport>(new serial_transport(body, baud)));
+    }
+
+    if(spec.compare(0, 4, "tcp:") == 0)
+    {
+        body = spec.substr(4);
+    }
+
+    separator = body.rfind(':');
+    if((separator == std::string::npos) || (separator == 0) || (separator + 1 == body.length()))
+    {
+        return(NULL);
+    }
+
+    return(std::unique_ptr<transport>(new tcp_transport(body.substr(0, separator), body.substr(separator + 1))));
+}
+
+} // namespace snon
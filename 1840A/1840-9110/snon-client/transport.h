@@ -0,0 +1,109 @@
+// ---------------------------------------------------------------------------------
+// SNON transports - Header
+// ---------------------------------------------------------------------------------
+// Line-oriented links to a panel: a serial device, a TCP serial bridge, or an
+// in-process mock panel
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+
+#pragma once
+#ifndef SNON_TRANSPORT_H
+#define SNON_TRANSPORT_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace snon
+{
+
+class mock_panel;
+
+class transport
+{
+public:
+    enum read_t { READ_LINE, READ_TIMEOUT, READ_CLOSED };
+
+    virtual ~transport() {}
+
+    // May be called again after a close() to reconnect
+    virtual bool open() = 0;
+    virtual void close() = 0;
+
+    virtual bool write(const std::string& data) = 0;
+
+    // Returns one line without its line ending. Only one thread may read.
+    virtual read_t read_line(std::string& line, int timeout_ms) = 0;
+
+    virtual std::string describe() const = 0;
+};
+
+// Shared by everything that ends up as a file descriptor
+class fd_transport : public transport
+{
+public:
+    ~fd_transport() override;
+
+    void close() override;
+    bool write(const std::string& data) override;
+    read_t read_line(std::string& line, int timeout_ms) override;
+
+protected:
+    int         fd = -1;
+    std::string received;
+};
+
+class tcp_transport : public fd_transport
+{
+public:
+    tcp_transport(const std::string& host, const std::string& port);
+
+    bool open() override;
+    std::string describe() const override;
+
+private:
+    std::string host;
+    std::string port;
+};
+
+class serial_transport : public fd_transport
+{
+public:
+    serial_transport(const std::string& device, uint32_t baud);
+
+    bool open() override;
+    std::string describe() const override;
+
+private:
+    std::string device;
+    uint32_t    baud;
+};
+
+// Serves a mock_panel on the far end of a socket pair, from its own thread
+class mock_transport : public fd_transport
+{
+public:
+    explicit mock_transport(mock_panel& panel);
+    ~mock_transport() override;
+
+    bool open() override;
+    void close() override;
+    std::string describe() const override;
+
+private:
+    mock_panel& panel;
+    int         panel_fd = -1;
+    std::thread panel_thread;
+};
+
+// "tcp:<host>:<port>", "<host>:<port>", "serial:<device>[@<baud>]", "/dev/..." or "mock".
+// Mock transports are served by the given panel. Returns NULL if the spec isn't valid.
+std::unique_ptr<transport> transport_from_spec(const std::string& spec, mock_panel* panel);
+
+} // namespace snon
+
+#endif // SNON_TRANSPORT_H
@@ -0,0 +1,98 @@
+# sets 1840A SNON values with several requests in flight
+#
+# Usage: ruby snon-pipeline.rb <eID> [<requests>] [<window> ...] [--address <XXXX>]
+#
+# Each fragment carries a request ID ("rID"), which the panel echoes in its reply.
+# Replies come back in the order the requests were sent. Failures are returned as
+# {"rID":<id>,"error":<code>,"message":"<text>"}. The panel queues up to 32
+# received lines, so no more than 32 requests should be outstanding.
+#
+# Sets the entity <requests> times for each window size (default 1, 8 and 32),
+# and prints the request rate for each.
+#
+# On a multi-drop bus, --address prefixes each request with "@<XXXX> " so that only
+# the panel with that address (the first four hex digits of its device eID) answers.
+require "json"
+require "socket"
+
+module SnonPipeline
+  MAX_WINDOW = 32
+
+  class Connection
+    def initialize(socket, address = nil)
+      @socket = socket
+      @prefix = address ? "@#{address.upcase} " : ""
+      @next_rid = 1
+      @outstanding = []
+    end
+
+    def send_set(eid, value)
+      rid = @next_rid
+      @next_rid += 1
+      @socket.print(@prefix + { "eID" => eid, "v" => [value], "rID" => rid }.to_json + "\r")
+      @outstanding << rid
+      rid
+    end
+
+    # Waits for the reply to the oldest outstanding request
+    def receive
+      loop do
+        line = @socket.gets
+        raise "Connection closed" if line.nil?
+        next unless line.start_with?("{")
+
+        reply = JSON.parse(line)
+        next unless reply.key?("rID")
+
+        expected = @outstanding.shift
+        raise "Reply #{reply["rID"]} arrived while waiting for #{expected}" if reply["rID"] != expected
+        raise "Request #{expected} failed: #{reply["message"]} (#{reply["error"]})" if reply.key?("error")
+        return reply
+      end
+    end
+
+    def outstanding
+      @outstanding.length
+    end
+
+    # Sends count requests, keeping up to window of them in flight
+    def run(eid, count, window)
+      window = [window, MAX_WINDOW].min
+      sent = 0
+      start = Process.clock_gettime(Process::CLOCK_MONOTONIC)
+
+      while sent < count || outstanding > 0
+        while sent < count && outstanding < window
+          send_set(eid, sent.to_s)
+          sent += 1
+        end
+        receive
+      end
+
+      count / (Process.clock_gettime(Process::CLOCK_MONOTONIC) - start)
+    end
+  end
+end
+
+if __FILE__ == $0
+  address = nil
+  if (index = ARGV.index("--address"))
+    address = ARGV[index + 1]
+    ARGV.slice!(index, 2)
+  end
+
+  eid = ARGV[0]
+  count = (ARGV[1] || 200).to_i
+  windows = ARGV.length > 2 ? ARGV[2..].map(&:to_i) : [1, 8, 32]
+
+  print "Connecting to SNON device\n";
+  socket = TCPSocket.open("192.168.88.101", "200");
+  connection = SnonPipeline::Connection.new(socket, address)
+
+  windows.each do |window|
+    rate = connection.run(eid, count, window)
+    printf("%2d in flight: %7.1f requests/s\n", window, rate)
+  end
+
+  socket.close;
+end
@@ -0,0 +1,44 @@
+# prints SNON value changes pushed by a panel
+#
+# Usage: ruby snon-watch.rb <eID or name prefix> [...] [--interval <ms>]
+#
+# Subscribes to each eID, or to every entity whose name starts with the prefix
+# (such as "=P01"), then prints the changes as the panel pushes them:
+#   {"seq":<n>,"eID":"<eID>","v":[...]}
+# The sequence number counts every push, so a gap means a push was missed.
+require "json"
+require "socket"
+
+interval = 100
+if (index = ARGV.index("--interval"))
+  interval = ARGV[index + 1].to_i
+  ARGV.slice!(index, 2)
+end
+
+print "Connecting to SNON device\n";
+socket = TCPSocket.open("192.168.88.101", "200");
+socket.print({ "subscribe" => ARGV, "interval" => interval, "rID" => 1 }.to_json + "\r")
+
+last_seq = nil
+begin
+  while (line = socket.gets)
+    next unless line.start_with?("{")
+    message = JSON.parse(line)
+
+    if message.key?("seq")
+      if last_seq && message["seq"] != last_seq + 1
+        print "Missed #{message["seq"] - last_seq - 1} changes\n"
+      end
+      last_seq = message["seq"]
+      print "#{message["seq"]}: #{message["eID"]} = #{message["v"].join(", ")}\n"
+    elsif message.key?("error")
+      abort "Subscribe failed: #{message["message"]}"
+    else
+      print "Subscribed to #{message["subscribed"]} entities\n"
+    end
+  end
+rescue Interrupt
+  socket.print({ "unsubscribe" => [] }.to_json + "\r")
+end
+
+socket.close;
@@ -0,0 +1,165 @@
+// ---------------------------------------------------------------------------------
+// LED animations
+// ---------------------------------------------------------------------------------
+// Fades each LED run from its last colour to a new one in fixed point, with the
+// fade curve shaped by a gamma table
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "pico/stdlib.h"
+
+#include "animation.h"
+
+// Global variables
+uint8_t             animation_gamma[256];      // Fade curve, from progress to mix
+animation_stats_t   animation_stats;
+
+// Private prototypes
+uint32_t animation_mix(uint32_t from, uint32_t to, uint16_t mix);
+
+// =================================================================================
+// Setup
+
+// Works out the fade curve once, so the LED timer only looks it up
+void animation_initialize(void)
+{
+    uint16_t    counter = 0;
+
+    while(counter != 256)
+    {
+        animation_gamma[counter] = (uint8_t) ((powf(counter / 255.0f, ANIMATION_GAMMA) * 255.0f) + 0.5f);
+        counter = counter + 1;
+    }
+}
+
+// Shows the colour with no fade running
+void animation_hold(animation_t* animation, uint32_t colour)
+{
+    animation->from = colour;
+    animation->to = colour;
+    animation->progress = ANIMATION_DONE;
+    animation->rate = 0;
+    animation->waveform = ANIMATION_STEP;
+}
+
+// =================================================================================
+// LED timer
+
+// Starts a fade from the colour now shown. Asking for the colour already being
+// faded to leaves the fade running.
+void animation_start(animation_t* animation, uint32_t from, uint32_t to, uint16_t fade_ms)
+{
+    if(to == animation->to)
+    {
+        return;
+    }
+
+    animation->from = from;
+    animation->to = to;
+    animation->progress = 0;
+
+    if(fade_ms <= ANIMATION_FRAME_MS)
+    {
+        animation->rate = ANIMATION_DONE;
+        animation->waveform = ANIMATION_STEP;
+    }
+    else
+    {
+        // Rounded up, so the fade takes no more frames than fade_ms allows
+        animation->rate = (((uint32_t) ANIMATION_DONE * ANIMATION_FRAME_MS) + fade_ms - 1) / fade_ms;
+        animation->waveform = ANIMATION_FADE;
+    }
+}
+
+// Mixes each byte of the two colours, with mix out of 255
+uint32_t animation_mix(uint32_t from, uint32_t to, uint16_t mix)
+{
+    uint32_t    mixed = 0;
+    int32_t     start = 0;
+    int32_t     end = 0;
+    uint8_t     shift = 0;
+
+    // Out of 256, so a shift can stand in for the division
+    mix = mix + (mix >> 7);
+
+    while(shift != 32)
+    {
+        start = (from >> shift) & 0xFF;
+        end = (to >> shift) & 0xFF;
+        mixed = mixed | ((uint32_t) (start + (((end - start) * mix) >> 8)) << shift);
+        shift = shift + 8;
+    }
+
+    return(mixed);
+}
+
+// Advances every running fade by one frame. Returns false if no colour changed.
+bool animation_step(animation_t* animations, uint32_t* colours, uint16_t count)
+{
+    uint32_t        start_us = time_us_32();
+    animation_t*    animation = animations;
+    animation_t*    end = animations + count;
+    uint32_t*       colour = colours;
+    uint32_t        progress = 0;
+    uint32_t        next = 0;
+    uint16_t        running = 0;
+    bool            changed = false;
+
+    while(animation != end)
+    {
+        if(animation->progress != ANIMATION_DONE)
+        {
+            progress = animation->progress + animation->rate;
+
+            if((progress >= ANIMATION_DONE) || (animation->waveform == ANIMATION_STEP))
+            {
+                animation->progress = ANIMATION_DONE;
+                next = animation->to;
+            }
+            else
+            {
+                animation->progress = progress;
+                next = animation_mix(animation->from, animation->to, animation_gamma[progress >> 8]);
+            }
+
+            if(next != *colour)
+            {
+                *colour = next;
+                changed = true;
+            }
+
+            running = running + 1;
+        }
+
+        animation = animation + 1;
+        colour = colour + 1;
+    }
+
+    animation_stats.frames = animation_stats.frames + 1;
+    animation_stats.running = animation_stats.running + running;
+    animation_stats.last_us = time_us_32() - start_us;
+
+    if(animation_stats.last_us > animation_stats.max_us)
+    {
+        animation_stats.max_us = animation_stats.last_us;
+    }
+
+    if(animation_stats.last_us > ANIMATION_BUDGET_US)
+    {
+        animation_stats.over_budget = animation_stats.over_budget + 1;
+    }
+
+    return(changed);
+}
+
+const animation_stats_t* animation_get_stats(void)
+{
+    return(&animation_stats);
+}
@@ -0,0 +1,535 @@
+// ---------------------------------------------------------------------------------
+// SNON entity handles
+// ---------------------------------------------------------------------------------
+// Table of the SNON entities rendered by the panel, with change notification
+// from the command loop (core 0) to the HMI (core 1), and copies of their
+// values that can be read from either core or from interrupt handlers
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "hardware/sync.h"
+
+#include "entities.h"
+#include "arena.h"
+#include "logger.h"
+#include "indicators.h"
+#include "subscribe.h"
+#include "store.h"
+#include "json_tok.h"
+#include "snon/snon_utils.h"
+
+// Types
+
+// Values are kept in two copies. The writer (the core 0 command loop) only ever
+// modifies the copy readers are not directed to by the sequence count, so a
+// reader never waits on the writer, even when it is an interrupt handler that
+// has pre-empted it. Readers on core 1 retry if the sequence count moved while
+// they were copying.
+// Each copy is a block from the value pools, and moves to a different size
+// class when the value grows or shrinks. Pool memory is never handed back, so
+// a reader that raced a move only copies stale bytes and then retries.
+typedef struct
+{
+    volatile uint32_t   sequence;
+    char* volatile      value[2];
+} entity_value_t;
+
+typedef struct
+{
+    char*               name;
+    uint32_t            name_hash;
+    char                eid[SNON_URN_LENGTH];
+    uint32_t            eid_hash;
+    uint32_t            widgets;
+    entity_value_t      value;
+    volatile uint16_t   generation;         // Written by core 0
+    uint16_t            drawn_generation;   // Written by core 1
+    volatile uint32_t   changed_us;         // Written by core 0
+} entity_t;
+
+// Global variables
+entity_t*           entities[ENTITY_MAX_COUNT];     // Allocated from the boot arena
+uint16_t            entity_count = 0;
+uint16_t            entity_generation = 0;
+volatile bool       entity_overflow = false;
+uint32_t            entity_all_widgets = 0;
+uint32_t            entity_round_start_us = 0;
+entity_stats_t      entity_stats;
+bool                entity_batch_active = false;
+entity_handle_t     entity_batch_handles[ENTITY_MAX_COUNT];
+uint16_t            entity_batch_count = 0;
+json_tok_t          entity_tokens[STORE_TOKEN_MAX];
+
+// Private prototypes
+uint32_t entity_hash(const char* eid);
+void entity_store_value(entity_t* entity, const char* value);
+uint32_t entity_process_record(uint32_t record);
+void entity_notify(entity_handle_t handle, bool last);
+
+// =================================================================================
+
+// FNV-1a hash of a name or eID, used to skip most string compares during lookups
+uint32_t entity_hash(const char* eid)
+{
+    uint32_t hash = 2166136261u;
+
+    while(*eid != 0)
+    {
+        hash = (hash ^ (uint8_t) *eid) * 16777619u;
+        eid = eid + 1;
+    }
+
+    return(hash);
+}
+
+// Adds an entity to the table. The widget mask is returned from
+// entity_wait_changes() when the entity changes.
+entity_handle_t entity_register(const char* name, uint32_t widgets)
+{
+    entity_handle_t handle = entity_find_name(name);
+    entity_t*       entity = NULL;
+
+    if(handle != ENTITY_INVALID)
+    {
+        // Already registered for another widget
+        entities[handle]->widgets = entities[handle]->widgets | widgets;
+        entity_all_widgets = entity_all_widgets | widgets;
+
+        return(handle);
+    }
+
+    if(entity_count == ENTITY_MAX_COUNT)
+    {
+        printf("Entity table full, unable to add \"%s\"\n", name);
+        return(ENTITY_INVALID);
+    }
+
+    entity = arena_alloc(&boot_arena, sizeof(entity_t));
+
+    if(entity == NULL)
+    {
+        printf("Out of boot memory, unable to add \"%s\"\n", name);
+        return(ENTITY_INVALID);
+    }
+
+    entities[entity_count] = entity;
+    entity->name = (char*) name;
+    entity->name_hash = entity_hash(name);
+    snon_name_to_eid(entity->name, entity->eid);
+    entity->eid_hash = entity_hash(entity->eid);
+    entity->widgets = widgets;
+    entity->generation = 0;
+    entity->drawn_generation = 0;
+    entity->changed_us = 0;
+    entity->value.sequence = 0;
+    entity->value.value[0] = NULL;
+    entity->value.value[1] = NULL;
+    entity_store_value(entity, store_get_value(store_find(entity->name)));
+
+    entity_all_widgets = entity_all_widgets | widgets;
+    entity_count = entity_count + 1;
+
+    return(entity_count - 1);
+}
+
+entity_handle_t entity_find_eid(const char* eid)
+{
+    uint32_t        hash = entity_hash(eid);
+    entity_handle_t handle = 0;
+
+    while(handle != entity_count)
+    {
+        if((entities[handle]->eid_hash == hash) && (strcmp(entities[handle]->eid, eid) == 0))
+        {
+            return(handle);
+        }
+
+        handle = handle + 1;
+    }
+
+    return(ENTITY_INVALID);
+}
+
+entity_handle_t entity_find_name(const char* name)
+{
+    uint32_t        hash = entity_hash(name);
+    entity_handle_t handle = 0;
+
+    while(handle != entity_count)
+    {
+        if((entities[handle]->name_hash == hash) && (strcmp(entities[handle]->name, name) == 0))
+        {
+            return(handle);
+        }
+
+        handle = handle + 1;
+    }
+
+    return(ENTITY_INVALID);
+}
+
+// Returns the eID of an entity, or NULL if the handle is not valid
+const char* entity_get_eid(entity_handle_t handle)
+{
+    if(handle >= entity_count)
+    {
+        return(NULL);
+    }
+
+    return(entities[handle]->eid);
+}
+
+uint16_t entity_get_count(void)
+{
+    return(entity_count);
+}
+
+// Updates both copies of an entity value. Only called from the core 0 command loop.
+// Values longer than the copies are cut short, and counted.
+void entity_store_value(entity_t* entity, const char* value)
+{
+    uint8_t     copy = 0;
+    uint16_t    length = 0;
+    uint16_t    block_size = 0;
+    char*       block = NULL;
+
+    if(value == NULL)
+    {
+        value = "";
+    }
+
+    length = strlen(value) + 1;
+
+    if(length > ENTITY_VALUE_LENGTH)
+    {
+        length = ENTITY_VALUE_LENGTH;
+        entity_stats.truncated = entity_stats.truncated + 1;
+        logger_log_text(LOGGER_WARNING, "Value of %s cut to %u characters", entity->name, 1, ENTITY_VALUE_LENGTH - 1);
+    }
+
+    while(copy != 2)
+    {
+        // Direct readers to the other copy, then update this one
+        entity->value.sequence = entity->value.sequence + 1;
+        __dmb();
+
+        block = entity->value.value[copy];
+        block_size = value_block_size(block);
+
+        // Move to the smallest size class that fits
+        if((block == NULL) || (block_size < length) || ((block_size > value_pools[0].block_size) && (block_size >= length * 2)))
+        {
+            block = value_alloc(length);
+
+            if(block != NULL)
+            {
+                if(entity->value.value[copy] != NULL)
+                {
+                    value_free(entity->value.value[copy]);
+                }
+
+                entity->value.value[copy] = block;
+                block_size = value_block_size(block);
+            }
+            else
+            {
+                // Pools exhausted, keep the old block and truncate
+                block = entity->value.value[copy];
+            }
+        }
+
+        if(block != NULL)
+        {
+            strncpy(block, value, block_size - 1);
+            block[block_size - 1] = 0;
+        }
+        __dmb();
+
+        copy = copy + 1;
+    }
+}
+
+// Pushes a change record to core 1
+void entity_notify(entity_handle_t handle, bool last)
+{
+    if(multicore_fifo_wready())
+    {
+        multicore_fifo_push_blocking(ENTITY_RECORD(handle, last, entities[handle]->generation));
+    }
+    else
+    {
+        // Core 1 still has records to read, so it will see the flag
+        entity_overflow = true;
+        __sev();
+    }
+}
+
+// Sets the values of an SNON entity from a JSON array, and notifies core 1 if
+// it is on the panel
+bool entity_set_values(const char* eid, const char* values)
+{
+    int16_t     count = json_tok_parse(values, strlen(values), entity_tokens, STORE_TOKEN_MAX);
+
+    if((count < 1) || (entity_tokens[0].type != JSON_TOK_ARRAY))
+    {
+        return(false);
+    }
+
+    return(entity_set_tokens(eid, values, entity_tokens, count, 0));
+}
+
+// As above, for the values array at a token of JSON that has already been
+// tokenized. The values are copied into the store as they were received.
+bool entity_set_tokens(const char* eid, const char* json, const json_tok_t* tokens, int16_t count, int16_t values)
+{
+    store_handle_t  stored = store_find(eid);
+    entity_handle_t handle = ENTITY_INVALID;
+    entity_t*       entity = NULL;
+    bool            set_valid = false;
+
+    // Indicators only take known states, and only show them once the store has them
+    if(indicator_check_tokens(eid, json, tokens, count, values) == false)
+    {
+        return(false);
+    }
+
+    set_valid = store_set_tokens(stored, json, tokens, count, values);
+    handle = entity_find_eid(eid);
+
+    if(set_valid == true)
+    {
+        indicator_set_values(eid, store_get_values(stored));
+        subscribe_changed(eid);
+    }
+
+    if(handle != ENTITY_INVALID)
+    {
+        entity = entities[handle];
+        entity_store_value(entity, store_get_value(stored));
+
+        if(entity_batch_active == false)
+        {
+            entity_generation = entity_generation + 1;
+        }
+
+        entity->generation = entity_generation;
+        entity->changed_us = time_us_32();
+
+        if(entity->widgets == 0)
+        {
+            // Not drawn by core 1
+        }
+        else if(entity_batch_active == true)
+        {
+            // Held back until the whole batch has been applied
+            if(entity_batch_count != ENTITY_MAX_COUNT)
+            {
+                entity_batch_handles[entity_batch_count] = handle;
+                entity_batch_count = entity_batch_count + 1;
+            }
+        }
+        else
+        {
+            entity_notify(handle, true);
+        }
+    }
+
+    return(set_valid);
+}
+
+// Starts a batch of updates that share one generation, and are drawn together
+void entity_batch_begin(void)
+{
+    entity_generation = entity_generation + 1;
+    entity_batch_count = 0;
+    entity_batch_active = true;
+}
+
+// Notifies core 1 of everything set since entity_batch_begin(). The final
+// record is flagged as the last, so core 1 redraws once for the whole batch.
+void entity_batch_end(void)
+{
+    uint16_t    counter = 0;
+
+    entity_batch_active = false;
+
+    while(counter != entity_batch_count)
+    {
+        entity_notify(entity_batch_handles[counter], (counter + 1) == entity_batch_count);
+
+        counter = counter + 1;
+    }
+
+    entity_batch_count = 0;
+}
+
+// Copies out the current value of an entity
+bool entity_get_value(entity_handle_t handle, char* buffer, uint16_t length)
+{
+    entity_value_t* value = NULL;
+    uint32_t        sequence = 0;
+    char*           block = NULL;
+    uint16_t        block_size = 0;
+
+    if((handle >= entity_count) || (length == 0))
+    {
+        return(false);
+    }
+
+    value = &entities[handle]->value;
+
+    do
+    {
+        sequence = value->sequence;
+        __dmb();
+
+        block = value->value[sequence & 1];
+        block_size = value_block_size(block);
+
+        if(block_size > length)
+        {
+            block_size = length;
+        }
+
+        if(block_size == 0)
+        {
+            buffer[0] = 0;
+        }
+        else
+        {
+            strncpy(buffer, block, block_size - 1);
+            buffer[block_size - 1] = 0;
+        }
+        __dmb();
+    }
+    while(sequence != value->sequence);
+
+    return(true);
+}
+
+double entity_get_value_as_double(entity_handle_t handle)
+{
+    char    buffer[ENTITY_VALUE_LENGTH];
+
+    if(entity_get_value(handle, buffer, ENTITY_VALUE_LENGTH) == false)
+    {
+        return(0);
+    }
+
+    return(atof(buffer));
+}
+
+// =================================================================================
+
+// Returns the widgets to redraw for a change record
+uint32_t entity_process_record(uint32_t record)
+{
+    entity_handle_t handle = ENTITY_RECORD_HANDLE(record);
+    uint16_t        generation = ENTITY_RECORD_GENERATION(record);
+    entity_t*       entity = NULL;
+
+    entity_stats.records = entity_stats.records + 1;
+
+    if(handle >= entity_count)
+    {
+        return(0);
+    }
+
+    entity = entities[handle];
+
+    if(entity->drawn_generation == generation)
+    {
+        entity_stats.duplicates = entity_stats.duplicates + 1;
+        return(0);
+    }
+
+    entity->drawn_generation = generation;
+
+    if((entity_round_start_us == 0) || ((int32_t) (entity->changed_us - entity_round_start_us) < 0))
+    {
+        entity_round_start_us = entity->changed_us;
+    }
+
+    return(entity->widgets);
+}
+
+// Sleeps until one or more entities change, and returns the widgets to redraw
+uint32_t entity_wait_changes(void)
+{
+    uint32_t    widgets = 0;
+    uint32_t    record = 0;
+    uint64_t    wait_start_us = time_us_64();
+    bool        done = false;
+
+    if(entity_stats.start_us == 0)
+    {
+        entity_stats.start_us = wait_start_us;
+    }
+
+    entity_round_start_us = 0;
+
+    while(done == false)
+    {
+        // Waits with WFE until core 0 pushes a record
+        record = multicore_fifo_pop_blocking();
+        widgets = widgets | entity_process_record(record);
+
+        if(ENTITY_RECORD_LAST(record))
+        {
+            done = true;
+        }
+
+        // Coalesce anything else that has arrived
+        while(multicore_fifo_rvalid())
+        {
+            widgets = widgets | entity_process_record(multicore_fifo_pop_blocking());
+        }
+
+        if(entity_overflow == true)
+        {
+            // Clear before drawing, so a later overflow forces another redraw
+            entity_overflow = false;
+            entity_stats.overflows = entity_stats.overflows + 1;
+            widgets = entity_all_widgets;
+            done = true;
+        }
+
+        if(widgets == 0)
+        {
+            // Nothing new to draw
+            done = false;
+        }
+    }
+
+    entity_stats.idle_us = entity_stats.idle_us + (time_us_64() - wait_start_us);
+    entity_stats.updates = entity_stats.updates + 1;
+
+    return(widgets);
+}
+
+// Called by core 1 once the widgets from entity_wait_changes() are on the glass
+void entity_changes_drawn(void)
+{
+    if(entity_round_start_us != 0)
+    {
+        entity_stats.latency_last_us = time_us_32() - entity_round_start_us;
+
+        if(entity_stats.latency_last_us > entity_stats.latency_max_us)
+        {
+            entity_stats.latency_max_us = entity_stats.latency_last_us;
+        }
+    }
+}
+
+const entity_stats_t* entity_get_stats(void)
+{
+    return(&entity_stats);
+}
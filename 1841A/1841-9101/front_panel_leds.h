@@ -0,0 +1,124 @@
+// ---------------------------------------------------------------------------------
+// LED map - Generated by 1840-9110/led-map.rb from front_panel_leds.csv. Do not edit.
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+
+#pragma once
+#ifndef FRONT_PANEL_LEDS_H
+#define FRONT_PANEL_LEDS_H
+
+#include "ledmap.h"
+
+#define FRONT_PANEL_LEDS_PIXELS      108
+#define FRONT_PANEL_LEDS_ENTRIES     102
+
+static const ledmap_entry_t front_panel_leds[FRONT_PANEL_LEDS_ENTRIES] =
+{
+    { "=W01=WBA03=PFA01",              0,    1,   LEDMAP_FULL },
+    { "=W01=WBA02=PFA01",              1,    1,   LEDMAP_FULL },
+    { "=W01=WBA01=PFA01",              2,    1,   LEDMAP_FULL },
+    { "=W01=WBA01=PFA02",              3,    1,   LEDMAP_FULL },
+    { "=W01=WBA02=PFA02",              4,    1,   LEDMAP_FULL },
+    { "=W01=WBA03=PFA02",              5,    1,   LEDMAP_FULL },
+    { "=W01=WBA01=PFA03",              6,    1,   LEDMAP_FULL },
+    { "=W01=WBA02=PFA03",              7,    1,   LEDMAP_FULL },
+    { "=W01=WBA03=PFA03",              8,    1,   LEDMAP_FULL },
+    { "=Q21=PFA01",                    9,    1,   LEDMAP_FULL },
+    { "=Q21=QBA01=PFA01",              10,   1,   LEDMAP_FULL },
+    { "=Q21=QBA02=PFA01",              11,   1,   LEDMAP_FULL },
+    { "=Q21=QBA03=PFA01",              12,   1,   LEDMAP_FULL },
+    { "=W02=WBA01=PGC01=PFA01",        13,   1,   LEDMAP_FULL },
+    { "=W02=WBA02=PGC01=PFA01",        14,   1,   LEDMAP_FULL },
+    { "=W02=WBA03=PGC01=PFA01",        15,   1,   LEDMAP_FULL },
+    { "=W02=WBA01=PGA01=PFA01",        16,   1,   LEDMAP_FULL },
+    { "=W02=WBA02=PGA01=PFA01",        17,   1,   LEDMAP_FULL },
+    { "=W02=WBA03=PGA01=PFA01",        18,   1,   LEDMAP_FULL },
+    { "=W02=WBA01=PFA01",              19,   1,   LEDMAP_FULL },
+    { "=W02=WBA02=PFA01",              20,   1,   LEDMAP_FULL },
+    { "=W02=WBA03=PFA01",              21,   1,   LEDMAP_FULL },
+    { "=Q20=PFA01",                    22,   1,   LEDMAP_FULL },
+    { "=Q20=QBA01=PFA01",              23,   1,   LEDMAP_FULL },
+    { "=Q20=QBA02=PFA01",              24,   1,   LEDMAP_FULL },
+    { "=Q20=QBA03=PFA01",              25,   1,   LEDMAP_FULL },
+    { "=W03=WBA01=PFA01",              26,   1,   LEDMAP_FULL },
+    { "=W03=WBA02=PFA01",              27,   1,   LEDMAP_FULL },
+    { "=W03=WBA03=PFA01",              28,   1,   LEDMAP_FULL },
+    { "=W03=WBA01=PGA01=PFA01",        29,   1,   LEDMAP_FULL },
+    { "=W03=WBA02=PGA01=PFA01",        30,   1,   LEDMAP_FULL },
+    { "=W03=WBA03=PGA01=PFA01",        31,   1,   LEDMAP_FULL },
+    { "=W03=WBA01=PGC01=PFA01",        32,   1,   LEDMAP_FULL },
+    { "=W03=WBA02=PGC01=PFA01",        33,   1,   LEDMAP_FULL },
+    { "=W03=WBA03=PGC01=PFA01",        34,   1,   LEDMAP_FULL },
+    { "=Q22=PFA01",                    35,   1,   LEDMAP_FULL },
+    { "=Q22=QBA01=PFA01",              36,   1,   LEDMAP_FULL },
+    { "=Q22=QBA02=PFA01",              37,   1,   LEDMAP_FULL },
+    { "=Q22=QBA03=PFA01",              38,   1,   LEDMAP_FULL },
+    { "=W04=WBA01=PFA01",              39,   1,   LEDMAP_FULL },
+    { "=W04=WBA02=PFA01",              40,   1,   LEDMAP_FULL },
+    { "=W04=WBA03=PFA01",              41,   1,   LEDMAP_FULL },
+    { NULL,                            42,   1,   LEDMAP_FULL },
+    { "=T01=TAA01=PFA01",              43,   1,   LEDMAP_FULL },
+    { "=T01=TAA01=PFA02",              44,   1,   LEDMAP_FULL },
+    { "=T01=TAA01=PFA03",              45,   1,   LEDMAP_FULL },
+    { NULL,                            46,   6,   LEDMAP_FULL },
+    { "=W05=WBA01=PFA01",              52,   1,   LEDMAP_FULL },
+    { "=W05=WBA02=PFA01",              53,   1,   LEDMAP_FULL },
+    { "=W05=WBA03=PFA01",              54,   1,   LEDMAP_FULL },
+    { "=Q12=PFA01",                    55,   1,   LEDMAP_FULL },
+    { "=Q12=QBA01=PFA01",              56,   1,   LEDMAP_FULL },
+    { "=Q12=QBA02=PFA01",              57,   1,   LEDMAP_FULL },
+    { "=Q12=QBA03=PFA01",              58,   1,   LEDMAP_FULL },
+    { "=W06=WBA01=PFA01",              59,   1,   LEDMAP_FULL },
+    { "=W06=WBA02=PFA01",              60,   1,   LEDMAP_FULL },
+    { "=W06=WBA03=PFA01",              61,   1,   LEDMAP_FULL },
+    { "=W06=WBA01=PGA01=PFA01",        62,   1,   LEDMAP_FULL },
+    { "=W06=WBA02=PGA01=PFA01",        63,   1,   LEDMAP_FULL },
+    { "=W06=WBA03=PGA01=PFA01",        64,   1,   LEDMAP_FULL },
+    { "=W06=WBA01=PGC01=PFA01",        65,   1,   LEDMAP_FULL },
+    { "=W06=WBA02=PGC01=PFA01",        66,   1,   LEDMAP_FULL },
+    { "=W06=WBA03=PGC01=PFA01",        67,   1,   LEDMAP_FULL },
+    { "=Q10=PFA01",                    68,   1,   LEDMAP_FULL },
+    { "=Q10=QBA01=PFA01",              69,   1,   LEDMAP_FULL },
+    { "=Q10=QBA02=PFA01",              70,   1,   LEDMAP_FULL },
+    { "=Q10=QBA03=PFA01",              71,   1,   LEDMAP_FULL },
+    { "=W07=WBA01=PFA01",              72,   1,   LEDMAP_FULL },
+    { "=W07=WBA02=PFA01",              73,   1,   LEDMAP_FULL },
+    { "=W07=WBA03=PFA01",              74,   1,   LEDMAP_FULL },
+    { "=Q11=PFA01",                    75,   1,   LEDMAP_FULL },
+    { "=Q11=QBA01=PFA01",              76,   1,   LEDMAP_FULL },
+    { "=Q11=QBA02=PFA01",              77,   1,   LEDMAP_FULL },
+    { "=Q11=QBA03=PFA01",              78,   1,   LEDMAP_FULL },
+    { "=W08=WBA01=PGC01=PFA01",        79,   1,   LEDMAP_FULL },
+    { "=W08=WBA02=PGC01=PFA01",        80,   1,   LEDMAP_FULL },
+    { "=W08=WBA03=PGC01=PFA01",        81,   1,   LEDMAP_FULL },
+    { "=W08=WBA01=PGA01=PFA01",        82,   1,   LEDMAP_FULL },
+    { "=W08=WBA02=PGA01=PFA01",        83,   1,   LEDMAP_FULL },
+    { "=W08=WBA03=PGA01=PFA01",        84,   1,   LEDMAP_FULL },
+    { "=W08=WBA01=PFA01",              85,   1,   LEDMAP_FULL },
+    { "=W08=WBA02=PFA01",              86,   1,   LEDMAP_FULL },
+    { "=W08=WBA03=PFA01",              87,   1,   LEDMAP_FULL },
+    { "=G01=GAA01=RBA01=PFA01",        88,   1,   LEDMAP_FULL },
+    { "=G01=GAA01=PFA01",              89,   1,   LEDMAP_FULL },
+    { "=G01=GAA01=PFA02",              90,   1,   LEDMAP_FULL },
+    { "=G01=GAA01=PFA03",              91,   1,   LEDMAP_FULL },
+    { "=W09=WBA01=PFA01",              92,   1,   LEDMAP_FULL },
+    { "=W09=WBA02=PFA01",              93,   1,   LEDMAP_FULL },
+    { "=W09=WBA03=PFA01",              94,   1,   LEDMAP_FULL },
+    { "=W09=WBA01=PGA01=PFA01",        95,   1,   LEDMAP_FULL },
+    { "=W09=WBA02=PGA01=PFA01",        96,   1,   LEDMAP_FULL },
+    { "=W09=WBA03=PGA01=PFA01",        97,   1,   LEDMAP_FULL },
+    { "=W09=WBA01=PGC01=PFA01",        98,   1,   LEDMAP_FULL },
+    { "=W09=WBA02=PGC01=PFA01",        99,   1,   LEDMAP_FULL },
+    { "=W09=WBA03=PGC01=PFA01",        100,  1,   LEDMAP_FULL },
+    { NULL,                            101,  2,   LEDMAP_FULL },
+    { "=G01=T02=TAA01=PFA01",          103,  1,   LEDMAP_FULL },
+    { "=G01=T02=TAA01=RAC01=PFA01",    104,  1,   LEDMAP_FULL },
+    { NULL,                            105,  1,   LEDMAP_FULL },
+    { "=W10=WEA01=PFA01",              106,  1,   LEDMAP_FULL },
+    { "=G01=T02=TAA01=PGC01=PFA01",    107,  1,   LEDMAP_FULL }
+};
+
+#endif // FRONT_PANEL_LEDS_H
@@ -20,39 +20,127 @@
 #include "st7789_lcd.h"
 #include "mcp23017.h"
 #include "snon/snon_utils.h"
-#include "vita40/vita40.h"
+#include "indicators.h"
+#include "ledmap.h"
+#include "front_panel_leds.h"
+#include "ledstrip.h"
+#include "ledstats.h"
 #include "pico-utils/ws2812.h"
+#include "entities.h"
 
 // Defines
-#define FRONT_PANEL_LED_COUNT   108
+#define FRONT_PANEL_LED_PIN     18
 #define DRAW_TITLE              0b00000001
 #define DRAW_PHASE_1            0b00000010
 #define DRAW_PHASE_2            0b00000100
 #define DRAW_PHASE_3            0b00001000
+#define DRAW_TOP(region)        (region)
+#define DRAW_BOTTOM(region)     ((region) << 4)
 
 // Private prototypes
 void draw_gen_top_init(void);
 void draw_gen_top(uint8_t update_region);
 void draw_gen_bottom_init(void);
 void draw_gen_bottom(uint8_t update_region);
+float gen_value(const char* name);
 
 // Global variables
 uint32_t        led_update_counter = 0;
-extern uint     pio_sm;
-extern uint     pio_sm_offset;
-char*           prev_title_time = NULL;
-char*           prev_phase1v_time = NULL;
-char*           prev_phase2v_time = NULL;
-char*           prev_phase3v_time = NULL;
-char*           prev_phase1c_time = NULL;
-char*           prev_phase2c_time = NULL;
-char*           prev_phase3c_time = NULL;
+indicator_handle_t gen_led_handles[FRONT_PANEL_LEDS_ENTRIES];
+uint32_t        gen_led_colours[FRONT_PANEL_LEDS_ENTRIES];
+ledmap_t        gen_led_map = { front_panel_leds, FRONT_PANEL_LEDS_ENTRIES, FRONT_PANEL_LEDS_PIXELS, gen_led_handles, gen_led_colours };
+ledstrip_t      gen_led_strip;
+#if LEDSTRIP_LANES > 1
+uint32_t        gen_led_frame[FRONT_PANEL_LEDS_PIXELS];
+uint32_t        gen_led_planes[LEDSTRIP_PLANE_WORDS(FRONT_PANEL_LEDS_PIXELS, LEDSTRIP_LANES)];
+#else
+uint32_t        gen_led_frames[2][FRONT_PANEL_LEDS_PIXELS];
+#endif
+
+// Entities that cause the LCDs to be redrawn when they change
+const struct
+{
+    const char* name;
+    uint32_t    widgets;
+} gen_screen_entities[] =
+{
+    { "=W01=PHA01",         DRAW_TOP(DRAW_TITLE) | DRAW_BOTTOM(DRAW_TITLE) },
+
+    { "L1 Voltage",         DRAW_TOP(DRAW_PHASE_1) },
+    { "L1 Voltage LoLo",    DRAW_TOP(DRAW_PHASE_1) },
+    { "L1 Voltage Lo",      DRAW_TOP(DRAW_PHASE_1) },
+    { "L1 Voltage Hi",      DRAW_TOP(DRAW_PHASE_1) },
+    { "L1 Voltage HiHi",    DRAW_TOP(DRAW_PHASE_1) },
+    { "L1 Voltage SP",      DRAW_TOP(DRAW_PHASE_1) },
+
+    // The L3 indicators are drawn against the L2 limits
+    { "L2 Voltage",         DRAW_TOP(DRAW_PHASE_2) | DRAW_TOP(DRAW_PHASE_3) },
+    { "L2 Voltage LoLo",    DRAW_TOP(DRAW_PHASE_2) | DRAW_TOP(DRAW_PHASE_3) },
+    { "L2 Voltage Lo",      DRAW_TOP(DRAW_PHASE_2) | DRAW_TOP(DRAW_PHASE_3) },
+    { "L2 Voltage Hi",      DRAW_TOP(DRAW_PHASE_2) | DRAW_TOP(DRAW_PHASE_3) },
+    { "L2 Voltage HiHi",    DRAW_TOP(DRAW_PHASE_2) | DRAW_TOP(DRAW_PHASE_3) },
+    { "L2 Voltage SP",      DRAW_TOP(DRAW_PHASE_2) | DRAW_TOP(DRAW_PHASE_3) },
+
+    { "L3 Voltage",         DRAW_TOP(DRAW_PHASE_3) },
+
+    { "L1 Current",         DRAW_BOTTOM(DRAW_PHASE_1) },
+    { "L1 Current LoLo",    DRAW_BOTTOM(DRAW_PHASE_1) },
+    { "L1 Current Lo",      DRAW_BOTTOM(DRAW_PHASE_1) },
+    { "L1 Current Hi",      DRAW_BOTTOM(DRAW_PHASE_1) },
+    { "L1 Current HiHi",    DRAW_BOTTOM(DRAW_PHASE_1) },
+    { "L1 Current SP",      DRAW_BOTTOM(DRAW_PHASE_1) },
+
+    { "L2 Current",         DRAW_BOTTOM(DRAW_PHASE_2) | DRAW_BOTTOM(DRAW_PHASE_3) },
+    { "L2 Current LoLo",    DRAW_BOTTOM(DRAW_PHASE_2) | DRAW_BOTTOM(DRAW_PHASE_3) },
+    { "L2 Current Lo",      DRAW_BOTTOM(DRAW_PHASE_2) | DRAW_BOTTOM(DRAW_PHASE_3) },
+    { "L2 Current Hi",      DRAW_BOTTOM(DRAW_PHASE_2) | DRAW_BOTTOM(DRAW_PHASE_3) },
+    { "L2 Current HiHi",    DRAW_BOTTOM(DRAW_PHASE_2) | DRAW_BOTTOM(DRAW_PHASE_3) },
+    { "L2 Current SP",      DRAW_BOTTOM(DRAW_PHASE_2) | DRAW_BOTTOM(DRAW_PHASE_3) },
+
+    { "L3 Current",         DRAW_BOTTOM(DRAW_PHASE_3) },
+};
 
 // Functions
+
+// Registers the entities drawn on the LCDs. Must be called on core 0 before
+// core 1 is launched.
+void init_gen_entities(void)
+{
+    uint16_t    counter = 0;
+
+    while(counter < sizeof(gen_screen_entities) / sizeof(gen_screen_entities[0]))
+    {
+        entity_register(gen_screen_entities[counter].name, gen_screen_entities[counter].widgets);
+        counter = counter + 1;
+    }
+}
+
+// Registers the front panel LEDs as indicators. Must be called before the LED
+// timer is started.
+void init_gen_leds(void)
+{
+    ledmap_initialize(&gen_led_map);
+#if LEDSTRIP_LANES > 1
+    ledstrip_init_parallel(&gen_led_strip, pio1, FRONT_PANEL_LED_PIN, LEDSTRIP_LANES, 800000, gen_led_frame, gen_led_planes, FRONT_PANEL_LEDS_PIXELS);
+#else
+    ledstrip_init(&gen_led_strip, pio1, FRONT_PANEL_LED_PIN, 800000, gen_led_frames[0], gen_led_frames[1], FRONT_PANEL_LEDS_PIXELS);
+#endif
+}
+
+// Reads a value drawn on the LCDs without touching the SNON heap
+float gen_value(const char* name)
+{
+    return(entity_get_value_as_double(entity_find_name(name)));
+}
+
 void init_gen_screens(void)
 {
     draw_gen_top_init();
     draw_gen_bottom_init();
+
+    // Voltages and currents aren't displayed until values are received
+    draw_gen_top(DRAW_TITLE);
+    draw_gen_bottom(DRAW_TITLE);
 }
 
 void draw_gen_top_init(void)
@@ -71,11 +159,6 @@ void draw_gen_top_init(void)
     asm_draw_flow_arrow(3, asm_flow_none);
 
     st7789_end_pixels();
-
-    // Don't display voltages until values received
-    prev_phase1v_time = snon_get_time("L1 Voltage");
-    prev_phase2v_time = snon_get_time("L2 Voltage");
-    prev_phase3v_time = snon_get_time("L3 Voltage");
 }
 
 void draw_gen_bottom_init(void)
@@ -89,126 +172,77 @@ void draw_gen_bottom_init(void)
     st7789_draw_string_centred("L3", B612_BMA_24, (SCREEN_WIDTH / 3) * 2, (SCREEN_WIDTH / 3) * 3, 160);
 
     st7789_end_pixels();
-
-    // Don't display currents until values received
-    prev_phase1c_time = snon_get_time("L1 Current");
-    prev_phase2c_time = snon_get_time("L2 Current");
-    prev_phase3c_time = snon_get_time("L3 Current");
 }
 
+// Sleeps until core 0 reports a change, then redraws the affected regions
 void update_gen_screens(void)
 {
-    char* value_time = NULL;
-
-    value_time = snon_get_time("=W01=PHA01");
+    uint32_t    widgets = entity_wait_changes();
+    uint8_t     top_region = widgets & 0x0F;
+    uint8_t     bottom_region = (widgets >> 4) & 0x0F;
 
-    if(value_time != prev_title_time)
+    if(top_region != 0)
     {
-        draw_gen_top(DRAW_TITLE);
-        draw_gen_bottom(DRAW_TITLE);
-        prev_title_time = value_time;
+        draw_gen_top(top_region);
     }
 
-    value_time = snon_get_time("L1 Voltage");
-
-    if(value_time != prev_phase1v_time)
-    {
-        draw_gen_top(DRAW_PHASE_1);
-        prev_phase1v_time = value_time;
-    }
-
-    value_time = snon_get_time("L2 Voltage");
-
-    if(value_time != prev_phase2v_time)
-    {
-        draw_gen_top(DRAW_PHASE_2);
-        prev_phase2v_time = value_time;
-    }
-
-    value_time = snon_get_time("L3 Voltage");
-
-    if(value_time != prev_phase3v_time)
-    {
-        draw_gen_top(DRAW_PHASE_3);
-        prev_phase3v_time = value_time;
-    }
-
-    value_time = snon_get_time("L1 Current");
-
-    if(value_time != prev_phase1c_time)
-    {
-        draw_gen_bottom(DRAW_PHASE_1);
-        prev_phase1c_time = value_time;
-    }
-
-    value_time = snon_get_time("L2 Current");
-
-    if(value_time != prev_phase2c_time)
+    if(bottom_region != 0)
     {
-        draw_gen_bottom(DRAW_PHASE_2);
-        prev_phase2c_time = value_time;
+        draw_gen_bottom(bottom_region);
     }
 
-    value_time = snon_get_time("L3 Current");
-
-    if(value_time != prev_phase3c_time)
-    {
-        draw_gen_bottom(DRAW_PHASE_3);
-        prev_phase3c_time = value_time;
-    }
-
-//    draw_gen_top();
-//    draw_gen_bottom();
-
-
+    entity_changes_drawn();
 }
 
 void draw_gen_top(uint8_t update_region)
 {
+    char    title[ENTITY_VALUE_LENGTH];
+
     st7789_start_pixels(PIN_CS_1);
 
     // Title area
     if(update_region & DRAW_TITLE)
     {
+        entity_get_value(entity_find_name("=W01=PHA01"), title, ENTITY_VALUE_LENGTH);
         st7789_set_fgcolor(st7789_rgb_to_colour(asm_text));
-        st7789_draw_string_centred(snon_get_value("=W01=PHA01"), B612_BMA_32, 0, SCREEN_WIDTH, 190);
+        st7789_draw_string_centred(title, B612_BMA_32, 0, SCREEN_WIDTH, 190);
     }
 
     // Value indicators
     if(update_region & DRAW_PHASE_1)
     {
-        asm_draw_value_indicator(1, snon_get_value_as_double("L1 Voltage LoLo"),
-                                    snon_get_value_as_double("L1 Voltage Lo"),
-                                    snon_get_value_as_double("L1 Voltage"),
-                                    snon_get_value_as_double("L1 Voltage Hi"),
-                                    snon_get_value_as_double("L1 Voltage HiHi"),
-                                    snon_get_value_as_double("L1 Voltage SP"));
-
-        asm_draw_flow_value(1, snon_get_value_as_double("L1 Voltage"), "V");
+        asm_draw_value_indicator(1, gen_value("L1 Voltage LoLo"),
+                                    gen_value("L1 Voltage Lo"),
+                                    gen_value("L1 Voltage"),
+                                    gen_value("L1 Voltage Hi"),
+                                    gen_value("L1 Voltage HiHi"),
+                                    gen_value("L1 Voltage SP"));
+
+        asm_draw_flow_value(1, gen_value("L1 Voltage"), "V");
     }
 
     if(update_region & DRAW_PHASE_2)
     {
-        asm_draw_value_indicator(2, snon_get_value_as_double("L2 Voltage LoLo"),
-                                    snon_get_value_as_double("L2 Voltage Lo"),
-                                    snon_get_value_as_double("L2 Voltage"),
-                                    snon_get_value_as_double("L2 Voltage Hi"),
-                                    snon_get_value_as_double("L2 Voltage HiHi"),
-                                    snon_get_value_as_double("L2 Voltage SP"));
-
-        asm_draw_flow_value(2, snon_get_value_as_double("L2 Voltage"), "V");
+        asm_draw_value_indicator(2, gen_value("L2 Voltage LoLo"),
+                                    gen_value("L2 Voltage Lo"),
+                                    gen_value("L2 Voltage"),
+                                    gen_value("L2 Voltage Hi"),
+                                    gen_value("L2 Voltage HiHi"),
+                                    gen_value("L2 Voltage SP"));
+
+        asm_draw_flow_value(2, gen_value("L2 Voltage"), "V");
     }
 
     if(update_region & DRAW_PHASE_3)
     {
-        asm_draw_value_indicator(3, snon_get_value_as_double("L2 Voltage LoLo"),
-                                    snon_get_value_as_double("L2 Voltage Lo"),
-                                    snon_get_value_as_double("L2 Voltage"),
-                                    snon_get_value_as_double("L2 Voltage Hi"),
-                                    snon_get_value_as_double("L2 Voltage HiHi"),
-                                    snon_get_value_as_double("L2 Voltage SP"));
-
-        asm_draw_flow_value(3, snon_get_value_as_double("L3 Voltage"), "V");
+        asm_draw_value_indicator(3, gen_value("L2 Voltage LoLo"),
+                                    gen_value("L2 Voltage Lo"),
+                                    gen_value("L2 Voltage"),
+                                    gen_value("L2 Voltage Hi"),
+                                    gen_value("L2 Voltage HiHi"),
+                                    gen_value("L2 Voltage SP"));
+
+        asm_draw_flow_value(3, gen_value("L3 Voltage"), "V");
     }
 
     //asm_draw_value_alarm(2, asm_alarm_one);
@@ -219,29 +253,32 @@ void draw_gen_top(uint8_t update_region)
 
 void draw_gen_bottom(uint8_t update_region)
 {
+    char    title[ENTITY_VALUE_LENGTH];
+
     st7789_start_pixels(PIN_CS_2);
 
     if(update_region & DRAW_TITLE)
     {
         // Title area
+        entity_get_value(entity_find_name("=W01=PHA01"), title, ENTITY_VALUE_LENGTH);
         st7789_set_fgcolor(st7789_rgb_to_colour(asm_text));
-        st7789_draw_string_centred(snon_get_value("=W01=PHA01"), B612_BMA_32, 0, SCREEN_WIDTH, 190);
+        st7789_draw_string_centred(title, B612_BMA_32, 0, SCREEN_WIDTH, 190);
     }
 
     if(update_region & DRAW_PHASE_1)
     {
         // Value indicators
-        asm_draw_value_indicator(1, snon_get_value_as_double("L1 Current LoLo"),
-                                    snon_get_value_as_double("L1 Current Lo"),
-                                    snon_get_value_as_double("L1 Current"),
-                                    snon_get_value_as_double("L1 Current Hi"),
-                                    snon_get_value_as_double("L1 Current HiHi"),
-                                    snon_get_value_as_double("L1 Current SP"));
+        asm_draw_value_indicator(1, gen_value("L1 Current LoLo"),
+                                    gen_value("L1 Current Lo"),
+                                    gen_value("L1 Current"),
+                                    gen_value("L1 Current Hi"),
+                                    gen_value("L1 Current HiHi"),
+                                    gen_value("L1 Current SP"));
 
-        asm_draw_flow_value(1, snon_get_value_as_double("L1 Current"), "A");
+        asm_draw_flow_value(1, gen_value("L1 Current"), "A");
 
         // Flow area
-        if(snon_get_value_as_double("L1 Current") >=0)
+        if(gen_value("L1 Current") >=0)
         {
             asm_draw_flow_arrow(1, asm_flow_up);
         }
@@ -254,17 +291,17 @@ void draw_gen_bottom(uint8_t update_region)
     if(update_region & DRAW_PHASE_2)
     {
         // Value indicators
-        asm_draw_value_indicator(2, snon_get_value_as_double("L2 Current LoLo"),
-                                    snon_get_value_as_double("L2 Current Lo"),
-                                    snon_get_value_as_double("L2 Current"),
-                                    snon_get_value_as_double("L2 Current Hi"),
-                                    snon_get_value_as_double("L2 Current HiHi"),
-                                    snon_get_value_as_double("L2 Current SP"));
+        asm_draw_value_indicator(2, gen_value("L2 Current LoLo"),
+                                    gen_value("L2 Current Lo"),
+                                    gen_value("L2 Current"),
+                                    gen_value("L2 Current Hi"),
+                                    gen_value("L2 Current HiHi"),
+                                    gen_value("L2 Current SP"));
 
-        asm_draw_flow_value(2, snon_get_value_as_double("L2 Current"), "A");
+        asm_draw_flow_value(2, gen_value("L2 Current"), "A");
 
         // Flow area
-        if(snon_get_value_as_double("L2 Current") >=0)
+        if(gen_value("L2 Current") >=0)
         {
             asm_draw_flow_arrow(2, asm_flow_up);
         }
@@ -276,18 +313,18 @@ void draw_gen_bottom(uint8_t update_region)
 
     if(update_region & DRAW_PHASE_3)
     {
-        asm_draw_value_indicator(3, snon_get_value_as_double("L2 Current LoLo"),
-                                    snon_get_value_as_double("L2 Current Lo"),
-                                    snon_get_value_as_double("L2 Current"),
-                                    snon_get_value_as_double("L2 Current Hi"),
-                                    snon_get_value_as_double("L2 Current HiHi"),
-                                    snon_get_value_as_double("L2 Current SP"));
+        asm_draw_value_indicator(3, gen_value("L2 Current LoLo"),
+                                    gen_value("L2 Current Lo"),
+                                    gen_value("L2 Current"),
+                                    gen_value("L2 Current Hi"),
+                                    gen_value("L2 Current HiHi"),
+                                    gen_value("L2 Current SP"));
 
         // Value area
-        asm_draw_flow_value(3, snon_get_value_as_double("L3 Current"), "A");
+        asm_draw_flow_value(3, gen_value("L3 Current"), "A");
 
         // Flow area
-        if(snon_get_value_as_double("L3 Current") >=0)
+        if(gen_value("L3 Current") >=0)
         {
             asm_draw_flow_arrow(3, asm_flow_up);
         }
@@ -306,166 +343,25 @@ void draw_gen_bottom(uint8_t update_region)
 
 bool draw_gen_leds(struct repeating_timer *t)
 {
-    uint32_t    led_values[FRONT_PANEL_LED_COUNT];
-    uint16_t    counter = 0;
-
-    // Update LED values
-    led_values[0] = vita40_to_urgb(snon_get_value("=W01=WBA03=PFA01"), led_update_counter);
-    led_values[1] = vita40_to_urgb(snon_get_value("=W01=WBA02=PFA01"), led_update_counter);
-    led_values[2] = vita40_to_urgb(snon_get_value("=W01=WBA01=PFA01"), led_update_counter);
-
-    led_values[3] = vita40_to_urgb(snon_get_value("=W01=WBA01=PFA02"), led_update_counter);
-    led_values[4] = vita40_to_urgb(snon_get_value("=W01=WBA02=PFA02"), led_update_counter);
-    led_values[5] = vita40_to_urgb(snon_get_value("=W01=WBA03=PFA02"), led_update_counter);
-
-    led_values[6] = vita40_to_urgb(snon_get_value("=W01=WBA01=PFA03"), led_update_counter);
-    led_values[7] = vita40_to_urgb(snon_get_value("=W01=WBA02=PFA03"), led_update_counter);
-    led_values[8] = vita40_to_urgb(snon_get_value("=W01=WBA03=PFA03"), led_update_counter);
-
-    led_values[9] = vita40_to_urgb(snon_get_value("=Q21=PFA01"), led_update_counter);
-    led_values[10] = vita40_to_urgb(snon_get_value("=Q21=QBA01=PFA01"), led_update_counter);
-    led_values[11] = vita40_to_urgb(snon_get_value("=Q21=QBA02=PFA01"), led_update_counter);
-    led_values[12] = vita40_to_urgb(snon_get_value("=Q21=QBA03=PFA01"), led_update_counter);
-
-    led_values[13] = vita40_to_urgb(snon_get_value("=W02=WBA01=PGC01=PFA01"), led_update_counter);
-    led_values[14] = vita40_to_urgb(snon_get_value("=W02=WBA02=PGC01=PFA01"), led_update_counter);
-    led_values[15] = vita40_to_urgb(snon_get_value("=W02=WBA03=PGC01=PFA01"), led_update_counter);
-
-    led_values[16] = vita40_to_urgb(snon_get_value("=W02=WBA01=PGA01=PFA01"), led_update_counter);
-    led_values[17] = vita40_to_urgb(snon_get_value("=W02=WBA02=PGA01=PFA01"), led_update_counter);
-    led_values[18] = vita40_to_urgb(snon_get_value("=W02=WBA03=PGA01=PFA01"), led_update_counter);
-
-    led_values[19] = vita40_to_urgb(snon_get_value("=W02=WBA01=PFA01"), led_update_counter);
-    led_values[20] = vita40_to_urgb(snon_get_value("=W02=WBA02=PFA01"), led_update_counter);
-    led_values[21] = vita40_to_urgb(snon_get_value("=W02=WBA03=PFA01"), led_update_counter);
-
-    led_values[22] = vita40_to_urgb(snon_get_value("=Q20=PFA01"), led_update_counter);
-    led_values[23] = vita40_to_urgb(snon_get_value("=Q20=QBA01=PFA01"), led_update_counter);
-    led_values[24] = vita40_to_urgb(snon_get_value("=Q20=QBA02=PFA01"), led_update_counter);
-    led_values[25] = vita40_to_urgb(snon_get_value("=Q20=QBA03=PFA01"), led_update_counter);
-
-    led_values[26] = vita40_to_urgb(snon_get_value("=W03=WBA01=PFA01"), led_update_counter);
-    led_values[27] = vita40_to_urgb(snon_get_value("=W03=WBA02=PFA01"), led_update_counter);
-    led_values[28] = vita40_to_urgb(snon_get_value("=W03=WBA03=PFA01"), led_update_counter);
-
-    led_values[29] = vita40_to_urgb(snon_get_value("=W03=WBA01=PGA01=PFA01"), led_update_counter);
-    led_values[30] = vita40_to_urgb(snon_get_value("=W03=WBA02=PGA01=PFA01"), led_update_counter);
-    led_values[31] = vita40_to_urgb(snon_get_value("=W03=WBA03=PGA01=PFA01"), led_update_counter);
-
-    led_values[32] = vita40_to_urgb(snon_get_value("=W03=WBA01=PGC01=PFA01"), led_update_counter);
-    led_values[33] = vita40_to_urgb(snon_get_value("=W03=WBA02=PGC01=PFA01"), led_update_counter);
-    led_values[34] = vita40_to_urgb(snon_get_value("=W03=WBA03=PGC01=PFA01"), led_update_counter);
-
-    led_values[35] = vita40_to_urgb(snon_get_value("=Q22=PFA01"), led_update_counter);
-    led_values[36] = vita40_to_urgb(snon_get_value("=Q22=QBA01=PFA01"), led_update_counter);
-    led_values[37] = vita40_to_urgb(snon_get_value("=Q22=QBA02=PFA01"), led_update_counter);
-    led_values[38] = vita40_to_urgb(snon_get_value("=Q22=QBA03=PFA01"), led_update_counter);
-
-    led_values[39] = vita40_to_urgb(snon_get_value("=W04=WBA01=PFA01"), led_update_counter);
-    led_values[40] = vita40_to_urgb(snon_get_value("=W04=WBA02=PFA01"), led_update_counter);
-    led_values[41] = vita40_to_urgb(snon_get_value("=W04=WBA03=PFA01"), led_update_counter);
-
-    led_values[42] = vita40_to_urgb("vita40_off", led_update_counter);
-
-    led_values[43] = vita40_to_urgb(snon_get_value("=T01=TAA01=PFA01"), led_update_counter);
-    led_values[44] = vita40_to_urgb(snon_get_value("=T01=TAA01=PFA02"), led_update_counter);
-    led_values[45] = vita40_to_urgb(snon_get_value("=T01=TAA01=PFA03"), led_update_counter);
-
-    led_values[46] = vita40_to_urgb("vita40_off", led_update_counter);
-    led_values[47] = vita40_to_urgb("vita40_off", led_update_counter);
-    led_values[48] = vita40_to_urgb("vita40_off", led_update_counter);
-    led_values[49] = vita40_to_urgb("vita40_off", led_update_counter);
-    led_values[50] = vita40_to_urgb("vita40_off", led_update_counter);
-    led_values[51] = vita40_to_urgb("vita40_off", led_update_counter);
-
-    led_values[52] = vita40_to_urgb(snon_get_value("=W05=WBA01=PFA01"), led_update_counter);
-    led_values[53] = vita40_to_urgb(snon_get_value("=W05=WBA02=PFA01"), led_update_counter);
-    led_values[54] = vita40_to_urgb(snon_get_value("=W05=WBA03=PFA01"), led_update_counter);
-
-    led_values[55] = vita40_to_urgb(snon_get_value("=Q12=PFA01"), led_update_counter);
-    led_values[56] = vita40_to_urgb(snon_get_value("=Q12=QBA01=PFA01"), led_update_counter);
-    led_values[57] = vita40_to_urgb(snon_get_value("=Q12=QBA02=PFA01"), led_update_counter);
-    led_values[58] = vita40_to_urgb(snon_get_value("=Q12=QBA03=PFA01"), led_update_counter);
-
-    led_values[59] = vita40_to_urgb(snon_get_value("=W06=WBA01=PFA01"), led_update_counter);
-    led_values[60] = vita40_to_urgb(snon_get_value("=W06=WBA02=PFA01"), led_update_counter);
-    led_values[61] = vita40_to_urgb(snon_get_value("=W06=WBA03=PFA01"), led_update_counter);
+    uint32_t    start_us = time_us_32();
+    bool        changed = false;
 
-    led_values[62] = vita40_to_urgb(snon_get_value("=W06=WBA01=PGA01=PFA01"), led_update_counter);
-    led_values[63] = vita40_to_urgb(snon_get_value("=W06=WBA02=PGA01=PFA01"), led_update_counter);
-    led_values[64] = vita40_to_urgb(snon_get_value("=W06=WBA03=PGA01=PFA01"), led_update_counter);
+    ledstats_tick(start_us, GEN_LED_PERIOD_MS * 1000);
 
-    led_values[65] = vita40_to_urgb(snon_get_value("=W06=WBA01=PGC01=PFA01"), led_update_counter);
-    led_values[66] = vita40_to_urgb(snon_get_value("=W06=WBA02=PGC01=PFA01"), led_update_counter);
-    led_values[67] = vita40_to_urgb(snon_get_value("=W06=WBA03=PGC01=PFA01"), led_update_counter);
+    // Draw the colours that changed, and only send the frame if any did
+    changed = ledmap_render(&gen_led_map, indicator_phase(led_update_counter), ledstrip_back_buffer(&gen_led_strip));
+    indicator_frame_done(time_us_32() - start_us, gen_led_map.recomputed, changed);
 
-    led_values[68] = vita40_to_urgb(snon_get_value("=Q10=PFA01"), led_update_counter);
-    led_values[69] = vita40_to_urgb(snon_get_value("=Q10=QBA01=PFA01"), led_update_counter);
-    led_values[70] = vita40_to_urgb(snon_get_value("=Q10=QBA02=PFA01"), led_update_counter);
-    led_values[71] = vita40_to_urgb(snon_get_value("=Q10=QBA03=PFA01"), led_update_counter);
-
-    led_values[72] = vita40_to_urgb(snon_get_value("=W07=WBA01=PFA01"), led_update_counter);
-    led_values[73] = vita40_to_urgb(snon_get_value("=W07=WBA02=PFA01"), led_update_counter);
-    led_values[74] = vita40_to_urgb(snon_get_value("=W07=WBA03=PFA01"), led_update_counter);
-
-    led_values[75] = vita40_to_urgb(snon_get_value("=Q11=PFA01"), led_update_counter);
-    led_values[76] = vita40_to_urgb(snon_get_value("=Q11=QBA01=PFA01"), led_update_counter);
-    led_values[77] = vita40_to_urgb(snon_get_value("=Q11=QBA02=PFA01"), led_update_counter);
-    led_values[78] = vita40_to_urgb(snon_get_value("=Q11=QBA03=PFA01"), led_update_counter);
-
-    led_values[79] = vita40_to_urgb(snon_get_value("=W08=WBA01=PGC01=PFA01"), led_update_counter);
-    led_values[80] = vita40_to_urgb(snon_get_value("=W08=WBA02=PGC01=PFA01"), led_update_counter);
-    led_values[81] = vita40_to_urgb(snon_get_value("=W08=WBA03=PGC01=PFA01"), led_update_counter);
-
-    led_values[82] = vita40_to_urgb(snon_get_value("=W08=WBA01=PGA01=PFA01"), led_update_counter);
-    led_values[83] = vita40_to_urgb(snon_get_value("=W08=WBA02=PGA01=PFA01"), led_update_counter);
-    led_values[84] = vita40_to_urgb(snon_get_value("=W08=WBA03=PGA01=PFA01"), led_update_counter);
-
-    led_values[85] = vita40_to_urgb(snon_get_value("=W08=WBA01=PFA01"), led_update_counter);
-    led_values[86] = vita40_to_urgb(snon_get_value("=W08=WBA02=PFA01"), led_update_counter);
-    led_values[87] = vita40_to_urgb(snon_get_value("=W08=WBA03=PFA01"), led_update_counter);
-
-    led_values[88] = vita40_to_urgb(snon_get_value("=G01=GAA01=RBA01=PFA01"), led_update_counter);
-
-    led_values[89] = vita40_to_urgb(snon_get_value("=G01=GAA01=PFA01"), led_update_counter);
-    led_values[90] = vita40_to_urgb(snon_get_value("=G01=GAA01=PFA02"), led_update_counter);
-    led_values[91] = vita40_to_urgb(snon_get_value("=G01=GAA01=PFA03"), led_update_counter);
-
-    led_values[92] = vita40_to_urgb(snon_get_value("=W09=WBA01=PFA01"), led_update_counter);
-    led_values[93] = vita40_to_urgb(snon_get_value("=W09=WBA02=PFA01"), led_update_counter);
-    led_values[94] = vita40_to_urgb(snon_get_value("=W09=WBA03=PFA01"), led_update_counter);
-
-    led_values[95] = vita40_to_urgb(snon_get_value("=W09=WBA01=PGA01=PFA01"), led_update_counter);
-    led_values[96] = vita40_to_urgb(snon_get_value("=W09=WBA02=PGA01=PFA01"), led_update_counter);
-    led_values[97] = vita40_to_urgb(snon_get_value("=W09=WBA03=PGA01=PFA01"), led_update_counter);
-
-    led_values[98] = vita40_to_urgb(snon_get_value("=W09=WBA01=PGC01=PFA01"), led_update_counter);
-    led_values[99] = vita40_to_urgb(snon_get_value("=W09=WBA02=PGC01=PFA01"), led_update_counter);
-    led_values[100] = vita40_to_urgb(snon_get_value("=W09=WBA03=PGC01=PFA01"), led_update_counter);
-
-    led_values[101] = vita40_to_urgb("vita40_off", led_update_counter);
-    led_values[102] = vita40_to_urgb("vita40_off", led_update_counter);
-
-    led_values[103] = vita40_to_urgb(snon_get_value("=G01=T02=TAA01=PFA01"), led_update_counter);
-    led_values[104] = vita40_to_urgb(snon_get_value("=G01=T02=TAA01=RAC01=PFA01"), led_update_counter);
-
-    led_values[105] = vita40_to_urgb("vita40_off", led_update_counter);
-
-    led_values[106] = vita40_to_urgb(snon_get_value("=W10=WEA01=PFA01"), led_update_counter);
-    led_values[107] = vita40_to_urgb(snon_get_value("=G01=T02=TAA01=PGC01=PFA01"), led_update_counter);
-
-    ws2812_program_init(pio1, pio_sm, pio_sm_offset, 18, 800000, false);
-
-    while(counter < FRONT_PANEL_LED_COUNT)
+    if((changed == true) && (ledstrip_show(&gen_led_strip) == false))
     {
-        put_pixel(led_values[counter]);
-
-        counter = counter + 1;
+        // Still sending the last frame, so try again on the next tick
+        ledmap_invalidate(&gen_led_map);
     }
 
-    busy_wait_us(200);
-
     led_update_counter = led_update_counter + 1;
+    ledstrip_callback_done(time_us_32() - start_us);
+
+    return(true);
 }
 
 
@@ -8,7 +8,12 @@
 // SPDX-License-Identifier: CERN-OHL-S-2.0
 // ---------------------------------------------------------------------------------
 
+// Constants
+#define GEN_LED_PERIOD_MS       100     // LED timer period
+
 // Utility routines
+void init_gen_entities(void);
+void init_gen_leds(void);
 void init_gen_screens(void);
 void update_gen_screens(void);
 bool draw_gen_leds(struct repeating_timer *t);
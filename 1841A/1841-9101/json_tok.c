@@ -0,0 +1,359 @@
+// ---------------------------------------------------------------------------------
+// JSON tokenizer
+// ---------------------------------------------------------------------------------
+// Single pass, allocation free tokenizer for inbound SNON fragments. Tokens are
+// slices of the original string, which is never modified.
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+#include <stdio.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+
+#include "json_tok.h"
+
+// Private prototypes
+int16_t json_tok_new(json_tok_t* tokens, uint16_t token_count, int16_t* next, uint8_t type, uint16_t start, int16_t parent);
+int16_t json_tok_string(const char* json, uint16_t length, uint16_t* position);
+int16_t json_tok_primitive(const char* json, uint16_t length, uint16_t* position);
+
+// =================================================================================
+
+int16_t json_tok_new(json_tok_t* tokens, uint16_t token_count, int16_t* next, uint8_t type, uint16_t start, int16_t parent)
+{
+    json_tok_t* token = NULL;
+
+    if(*next >= token_count)
+    {
+        return(JSON_TOK_ERROR_NOMEM);
+    }
+
+    token = &tokens[*next];
+    token->type = type;
+    token->start = start;
+    token->end = start;
+    token->size = 0;
+    token->parent = parent;
+
+    *next = *next + 1;
+
+    return(*next - 1);
+}
+
+// Leaves position on the closing quote
+int16_t json_tok_string(const char* json, uint16_t length, uint16_t* position)
+{
+    uint16_t    counter = *position + 1;
+
+    while((counter < length) && (json[counter] != 0))
+    {
+        if(json[counter] == '"')
+        {
+            *position = counter;
+            return(0);
+        }
+
+        if(json[counter] == '\\')
+        {
+            counter = counter + 1;
+
+            if((counter >= length) || (strchr("\"\\/bfnrtu", json[counter]) == NULL) || (json[counter] == 0))
+            {
+                return(JSON_TOK_ERROR_INVALID);
+            }
+        }
+        else if((uint8_t) json[counter] < 0x20)
+        {
+            return(JSON_TOK_ERROR_INVALID);
+        }
+
+        counter = counter + 1;
+    }
+
+    return(JSON_TOK_ERROR_PARTIAL);
+}
+
+// Leaves position on the last character of the primitive
+int16_t json_tok_primitive(const char* json, uint16_t length, uint16_t* position)
+{
+    uint16_t    counter = *position;
+
+    while((counter < length) && (json[counter] != 0))
+    {
+        if(strchr(" \t\r\n,]}:", json[counter]) != NULL)
+        {
+            break;
+        }
+
+        if(((uint8_t) json[counter] < 0x20) || ((uint8_t) json[counter] > 0x7E) || (strchr("{[\"", json[counter]) != NULL))
+        {
+            return(JSON_TOK_ERROR_INVALID);
+        }
+
+        counter = counter + 1;
+    }
+
+    *position = counter - 1;
+
+    return(0);
+}
+
+// Tokenizes a JSON document. Returns the number of tokens, or a negative error.
+int16_t json_tok_parse(const char* json, uint16_t length, json_tok_t* tokens, uint16_t token_count)
+{
+    uint16_t    position = 0;
+    int16_t     next = 0;
+    int16_t     parent = -1;            // Innermost open object or array
+    int16_t     token = 0;
+    int16_t     result = 0;
+    bool        expect_value = true;
+    bool        expect_key = false;
+    char        character = 0;
+
+    while((position < length) && (json[position] != 0))
+    {
+        character = json[position];
+
+        if((character == ' ') || (character == '\t') || (character == '\r') || (character == '\n'))
+        {
+            // Whitespace
+        }
+        else if((character == '{') || (character == '['))
+        {
+            if(expect_value == false)
+            {
+                return(JSON_TOK_ERROR_INVALID);
+            }
+
+            token = json_tok_new(tokens, token_count, &next, (character == '{') ? JSON_TOK_OBJECT : JSON_TOK_ARRAY, position, parent);
+            if(token < 0)
+            {
+                return(token);
+            }
+
+            if(parent != -1)
+            {
+                tokens[parent].size = tokens[parent].size + 1;
+            }
+
+            parent = token;
+            expect_value = (character == '[');
+            expect_key = (character == '{');
+        }
+        else if((character == '}') || (character == ']'))
+        {
+            // A key, or a value straight after a comma, is missing
+            if((parent == -1) || (tokens[parent].type != ((character == '}') ? JSON_TOK_OBJECT : JSON_TOK_ARRAY)))
+            {
+                return(JSON_TOK_ERROR_INVALID);
+            }
+
+            if((expect_value == true) && (tokens[parent].size != 0))
+            {
+                return(JSON_TOK_ERROR_INVALID);
+            }
+
+            if((expect_key == true) && (tokens[parent].size != 0))
+            {
+                return(JSON_TOK_ERROR_INVALID);
+            }
+
+            tokens[parent].end = position + 1;
+            parent = tokens[parent].parent;
+
+            // Closing the value of a key also closes the key
+            if((parent != -1) && (tokens[parent].type == JSON_TOK_STRING))
+            {
+                parent = tokens[parent].parent;
+            }
+
+            expect_value = false;
+            expect_key = false;
+        }
+        else if(character == '"')
+        {
+            if((expect_value == false) && (expect_key == false))
+            {
+                return(JSON_TOK_ERROR_INVALID);
+            }
+
+            token = json_tok_new(tokens, token_count, &next, JSON_TOK_STRING, position + 1, parent);
+            if(token < 0)
+            {
+                return(token);
+            }
+
+            result = json_tok_string(json, length, &position);
+            if(result < 0)
+            {
+                return(result);
+            }
+
+            tokens[token].end = position;
+
+            if(parent != -1)
+            {
+                tokens[parent].size = tokens[parent].size + 1;
+            }
+
+            if(expect_key == true)
+            {
+                // Values that follow are children of the key
+                parent = token;
+                expect_key = false;
+                expect_value = false;
+            }
+            else
+            {
+                expect_value = false;
+
+                if((parent != -1) && (tokens[parent].type == JSON_TOK_STRING))
+                {
+                    parent = tokens[parent].parent;
+                }
+            }
+        }
+        else if(character == ':')
+        {
+            // Only one colon between a key and its value
+            if((parent == -1) || (expect_value == true) || (tokens[parent].type != JSON_TOK_STRING) || (tokens[parent].size != 0))
+            {
+                return(JSON_TOK_ERROR_INVALID);
+            }
+
+            expect_value = true;
+        }
+        else if(character == ',')
+        {
+            // A key that hasn't had its value yet is still the innermost open token
+            if((parent == -1) || (expect_value == true) || (expect_key == true) || (tokens[parent].type == JSON_TOK_STRING))
+            {
+                return(JSON_TOK_ERROR_INVALID);
+            }
+
+            expect_key = (tokens[parent].type == JSON_TOK_OBJECT);
+            expect_value = (tokens[parent].type == JSON_TOK_ARRAY);
+        }
+        else
+        {
+            if(expect_value == false)
+            {
+                return(JSON_TOK_ERROR_INVALID);
+            }
+
+            token = json_tok_new(tokens, token_count, &next, JSON_TOK_PRIMITIVE, position, parent);
+            if(token < 0)
+            {
+                return(token);
+            }
+
+            result = json_tok_primitive(json, length, &position);
+            if(result < 0)
+            {
+                return(result);
+            }
+
+            tokens[token].end = position + 1;
+
+            if(parent != -1)
+            {
+                tokens[parent].size = tokens[parent].size + 1;
+
+                if(tokens[parent].type == JSON_TOK_STRING)
+                {
+                    parent = tokens[parent].parent;
+                }
+            }
+
+            expect_value = false;
+        }
+
+        position = position + 1;
+    }
+
+    // Everything opened must have been closed
+    if((parent != -1) || (next == 0) || (expect_value == true))
+    {
+        return(JSON_TOK_ERROR_PARTIAL);
+    }
+
+    return(next);
+}
+
+// =================================================================================
+
+// Returns the index of the token following a token and everything inside it
+int16_t json_tok_skip(const json_tok_t* tokens, int16_t count, int16_t token)
+{
+    uint16_t    pending = 1;
+
+    while((pending != 0) && (token < count))
+    {
+        pending = pending - 1 + tokens[token].size;
+        token = token + 1;
+    }
+
+    return(token);
+}
+
+// Returns the value token of a key in an object, or -1
+int16_t json_tok_find_key(const char* json, const json_tok_t* tokens, int16_t count, int16_t object, const char* key)
+{
+    uint16_t    member = 0;
+    int16_t     token = object + 1;
+
+    if((object < 0) || (object >= count) || (tokens[object].type != JSON_TOK_OBJECT))
+    {
+        return(-1);
+    }
+
+    while((member != tokens[object].size) && (token + 1 < count))
+    {
+        if(json_tok_equals(json, &tokens[token], key) == true)
+        {
+            return(token + 1);
+        }
+
+        // Skip the key and its value
+        token = json_tok_skip(tokens, count, token);
+        member = member + 1;
+    }
+
+    return(-1);
+}
+
+bool json_tok_equals(const char* json, const json_tok_t* token, const char* string)
+{
+    uint16_t    length = token->end - token->start;
+
+    if((token->type != JSON_TOK_STRING) || (strlen(string) != length))
+    {
+        return(false);
+    }
+
+    return(strncmp(&json[token->start], string, length) == 0);
+}
+
+// Copies the text of a token, without the quotes of a string. Returns the length copied.
+uint16_t json_tok_copy(const char* json, const json_tok_t* token, char* buffer, uint16_t size)
+{
+    uint16_t    length = token->end - token->start;
+
+    if(size == 0)
+    {
+        return(0);
+    }
+
+    if(length > size - 1)
+    {
+        length = size - 1;
+    }
+
+    memcpy(buffer, &json[token->start], length);
+    buffer[length] = 0;
+
+    return(length);
+}
@@ -0,0 +1,49 @@
+// ---------------------------------------------------------------------------------
+// JSON tokenizer - Header
+// ---------------------------------------------------------------------------------
+// Single pass, allocation free tokenizer for inbound SNON fragments. Tokens are
+// slices of the original string, which is never modified.
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+
+#pragma once
+#ifndef JSON_TOK_H
+#define JSON_TOK_H
+
+#include "pico/stdlib.h"
+
+// Token types
+#define JSON_TOK_UNDEFINED      0
+#define JSON_TOK_OBJECT         1
+#define JSON_TOK_ARRAY          2
+#define JSON_TOK_STRING         3       // Slice excludes the quotes
+#define JSON_TOK_PRIMITIVE      4       // Number, true, false or null
+
+// Errors returned by json_tok_parse()
+#define JSON_TOK_ERROR_NOMEM    -1      // More tokens than the caller provided
+#define JSON_TOK_ERROR_INVALID  -2      // Unexpected character
+#define JSON_TOK_ERROR_PARTIAL  -3      // String ended inside a value
+
+// Types
+typedef struct
+{
+    uint8_t     type;
+    uint16_t    start;                  // Offset of the first character
+    uint16_t    end;                    // Offset past the last character
+    uint16_t    size;                   // Members of an object, items of an array, 1 for a key
+    int16_t     parent;
+} json_tok_t;
+
+// Parsing
+int16_t json_tok_parse(const char* json, uint16_t length, json_tok_t* tokens, uint16_t token_count);
+
+// Walking the tokens
+int16_t json_tok_skip(const json_tok_t* tokens, int16_t count, int16_t token);
+int16_t json_tok_find_key(const char* json, const json_tok_t* tokens, int16_t count, int16_t object, const char* key);
+bool json_tok_equals(const char* json, const json_tok_t* token, const char* string);
+uint16_t json_tok_copy(const char* json, const json_tok_t* token, char* buffer, uint16_t size);
+
+#endif // JSON_TOK_H
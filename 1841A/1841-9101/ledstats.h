@@ -0,0 +1,59 @@
+// ---------------------------------------------------------------------------------
+// LED timing statistics - Header
+// ---------------------------------------------------------------------------------
+// Histograms of how late each LED timer tick starts, how long it takes to work
+// out the frame, and how long the frame takes to send and latch. They are shown
+// by "get ledstats", and copied to SNON values.
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+
+#pragma once
+#ifndef LEDSTATS_H
+#define LEDSTATS_H
+
+#include "pico/stdlib.h"
+
+// Build options
+//  LEDSTATS_PUBLISH_MS=<n>     How often changed histograms are copied to SNON
+#ifndef LEDSTATS_PUBLISH_MS
+#define LEDSTATS_PUBLISH_MS     5000
+#endif
+
+// Histograms
+#define LEDSTATS_JITTER         0       // Tick start, early or late
+#define LEDSTATS_COMPUTE        1       // Time in the LED timer callback
+#define LEDSTATS_TRANSMIT       2       // From ledstrip_show() until the pixels have latched
+#define LEDSTATS_COUNT          3
+
+// Constants
+#define LEDSTATS_BUCKETS        16      // Bucket n holds 2^n to 2^(n+1) - 1 us, and the last holds anything longer
+#define LEDSTATS_VALUES_LENGTH  256
+
+// Types
+typedef struct
+{
+    const char* name;                   // SNON value the histogram is copied to
+    uint32_t    buckets[LEDSTATS_BUCKETS];
+    uint32_t    count;
+    uint32_t    last_us;
+    uint32_t    max_us;
+    uint64_t    total_us;
+    uint32_t    published;              // Count when last copied to SNON
+} ledstats_histogram_t;
+
+// Setup (core 0, after the SNON device is registered)
+void ledstats_initialize(void);
+
+// LED timer and DMA interrupts
+void ledstats_tick(uint32_t start_us, uint32_t period_us);
+void ledstats_record(uint8_t histogram, uint32_t elapsed_us);
+
+// Core 0
+void ledstats_publish(void);
+uint8_t ledstats_bucket(uint32_t elapsed_us);
+const ledstats_histogram_t* ledstats_get(uint8_t histogram);
+
+#endif // LEDSTATS_H
@@ -0,0 +1,190 @@
+// ---------------------------------------------------------------------------------
+// Deferred logging
+// ---------------------------------------------------------------------------------
+// Log records are queued as a format string and its arguments, and only
+// formatted and printed later from the command loop. Safe to call from
+// interrupt handlers and from either core.
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+
+#include "logger.h"
+
+// Constants
+#define LOGGER_RING_MASK        (LOGGER_RING_SIZE - 1)
+#define LOGGER_CORE_COUNT       2
+
+// Types
+typedef struct
+{
+    uint32_t    time_us;
+    const char* format;
+    uint8_t     level;
+    bool        has_text;
+    uint32_t    args[LOGGER_MAX_ARGS];
+    char        text[LOGGER_TEXT_LENGTH];
+} logger_record_t;
+
+// Each core only adds records to its own ring, with interrupts disabled, so the
+// command loop on core 0 is the only reader.
+typedef struct
+{
+    logger_record_t     records[LOGGER_RING_SIZE];
+    volatile uint16_t   head;
+    volatile uint16_t   tail;
+    logger_stats_t      stats;
+} logger_ring_t;
+
+// Global variables
+logger_ring_t       logger_rings[LOGGER_CORE_COUNT];
+volatile uint8_t    logger_level = LOGGER_INFO;
+
+// Private prototypes
+void logger_queue(uint8_t level, const char* format, const char* text, uint8_t count, va_list args);
+
+// =================================================================================
+
+// Copies a record into the ring of the calling core. Bounded: no formatting,
+// and at most LOGGER_TEXT_LENGTH bytes of text.
+void logger_queue(uint8_t level, const char* format, const char* text, uint8_t count, va_list args)
+{
+    logger_ring_t*      ring = &logger_rings[get_core_num()];
+    logger_record_t*    record = NULL;
+    uint32_t            interrupts = 0;
+    uint8_t             counter = 0;
+
+    if(level > logger_level)
+    {
+        ring->stats.filtered = ring->stats.filtered + 1;
+        return;
+    }
+
+    interrupts = save_and_disable_interrupts();
+
+    if(((ring->head + 1) & LOGGER_RING_MASK) == ring->tail)
+    {
+        ring->stats.dropped = ring->stats.dropped + 1;
+        restore_interrupts(interrupts);
+        return;
+    }
+
+    record = &ring->records[ring->head];
+    record->time_us = time_us_32();
+    record->format = format;
+    record->level = level;
+    record->has_text = (text != NULL);
+
+    if(count > LOGGER_MAX_ARGS)
+    {
+        count = LOGGER_MAX_ARGS;
+    }
+
+    counter = 0;
+    while(counter != LOGGER_MAX_ARGS)
+    {
+        record->args[counter] = (counter < count) ? va_arg(args, uint32_t) : 0;
+        counter = counter + 1;
+    }
+
+    if(text != NULL)
+    {
+        strncpy(record->text, text, LOGGER_TEXT_LENGTH - 1);
+        record->text[LOGGER_TEXT_LENGTH - 1] = 0;
+
+        // Text that didn't fit ends in "...", so it isn't taken for the whole string
+        if((record->text[LOGGER_TEXT_LENGTH - 2] != 0) && (text[LOGGER_TEXT_LENGTH - 1] != 0))
+        {
+            memcpy(&record->text[LOGGER_TEXT_LENGTH - 4], "...", 3);
+        }
+    }
+
+    // Publish the record only once it is complete
+    __dmb();
+    ring->head = (ring->head + 1) & LOGGER_RING_MASK;
+    ring->stats.queued = ring->stats.queued + 1;
+
+    restore_interrupts(interrupts);
+}
+
+void logger_log(uint8_t level, const char* format, uint8_t count, ...)
+{
+    va_list args;
+
+    va_start(args, count);
+    logger_queue(level, format, NULL, count, args);
+    va_end(args);
+}
+
+void logger_log_text(uint8_t level, const char* format, const char* text, uint8_t count, ...)
+{
+    va_list args;
+
+    va_start(args, count);
+    logger_queue(level, format, (text != NULL) ? text : "", count, args);
+    va_end(args);
+}
+
+// Prints up to count queued records from each core
+void logger_drain(uint8_t count)
+{
+    logger_ring_t*      ring = NULL;
+    logger_record_t*    record = NULL;
+    uint8_t             core = 0;
+    uint8_t             printed = 0;
+
+    while(core != LOGGER_CORE_COUNT)
+    {
+        ring = &logger_rings[core];
+        printed = 0;
+
+        while((ring->tail != ring->head) && (printed != count))
+        {
+            __dmb();
+            record = &ring->records[ring->tail];
+
+            printf("[%lu.%06lu %u] ", (unsigned long) (record->time_us / 1000000), (unsigned long) (record->time_us % 1000000), core);
+
+            if(record->has_text == true)
+            {
+                printf(record->format, record->text, record->args[0], record->args[1], record->args[2], record->args[3], record->args[4], record->args[5]);
+            }
+            else
+            {
+                printf(record->format, record->args[0], record->args[1], record->args[2], record->args[3], record->args[4], record->args[5]);
+            }
+
+            printf("\n");
+
+            // Hand the slot back only once it has been printed
+            __dmb();
+            ring->tail = (ring->tail + 1) & LOGGER_RING_MASK;
+            ring->stats.printed = ring->stats.printed + 1;
+            printed = printed + 1;
+        }
+
+        core = core + 1;
+    }
+}
+
+void logger_set_level(uint8_t level)
+{
+    logger_level = level;
+}
+
+uint8_t logger_get_level(void)
+{
+    return(logger_level);
+}
+
+const logger_stats_t* logger_get_stats(uint8_t core)
+{
+    return(&logger_rings[core % LOGGER_CORE_COUNT].stats);
+}
@@ -24,6 +24,16 @@
 #include "pins.h"
 #include "pico-utils/ws2812.h"
 #include "uart.h"
+#include "logger.h"
+#include "writer.h"
+#include "commands.h"
+#include "reply.h"
+#include "json_tok.h"
+#include "subscribe.h"
+#include "entities.h"
+#include "indicators.h"
+#include "ledstrip.h"
+#include "ledstats.h"
 #include "build.h"
 #include "sensors.h"
 #include "hmi.h"
@@ -33,15 +43,18 @@
 #include "snon/sha1.h"
 #include "snon/snon_utils.h"
 #include "mem_utils.h"
+#include "arena.h"
+#include "store.h"
 #include "asm_hmi.h"
 
 // Local Constants
 #define SNPRINTF_BUFFER_SIZE    80
 
 // Global Variables
-uint            pio_sm = 0;
-uint            pio_sm_offset = 0;
+ledstrip_t      debug_led_strip;
+uint32_t        debug_led_frames[2][1];
 bool            refresh_needed = false;
+bool            debug_led_pending = false;
 
 // =================================================================================
 // Local Functions
@@ -93,10 +106,31 @@ void hmi_main(void)
 }
 
 
+void command_get_hmi(writer_t* writer, const char* arguments)
+{
+    const entity_stats_t*   stats = entity_get_stats();
+    uint64_t                elapsed_us = time_us_64() - stats->start_us;
+    char                    buffer[COMMAND_BUFFER_SIZE];
+
+    snprintf(buffer, COMMAND_BUFFER_SIZE, "\r\nUpdates: %lu, Records: %lu", stats->updates, stats->records);
+    writer_puts(writer, buffer);
+    snprintf(buffer, COMMAND_BUFFER_SIZE, "\r\nDuplicates: %lu, Overflows: %lu, Values truncated: %lu", stats->duplicates, stats->overflows, stats->truncated);
+    writer_puts(writer, buffer);
+    snprintf(buffer, COMMAND_BUFFER_SIZE, "\r\nSet-to-glass latency: %lu us (max %lu us)", stats->latency_last_us, stats->latency_max_us);
+    writer_puts(writer, buffer);
+
+    if((stats->start_us != 0) && (elapsed_us != 0))
+    {
+        snprintf(buffer, COMMAND_BUFFER_SIZE, "\r\nCore 1 idle: %lu%%", (uint32_t) ((stats->idle_us * 100) / elapsed_us));
+        writer_puts(writer, buffer);
+    }
+
+    writer_puts(writer, "\r\n");
+}
+
 // Interrupt Service Routine
 void button_isr(uint gpio, uint32_t events)
 {
-    char        snprintf_buffer[SNPRINTF_BUFFER_SIZE];
 uint8_t value1 = 0;
 uint8_t value2 = 0;
 uint8_t value3 = 0;
@@ -112,19 +146,16 @@ mcp23017_read_register(i2c1, I2C_ADDR_3, REG_GPIOB, &value3);
 
 int_value2 = gpio_get(I2C_IRQ_PIN);
 
-snprintf(snprintf_buffer, SNPRINTF_BUFFER_SIZE, "\r\nISR: 1:%u 2:%u 3:%u / b: %u a: %u", value1, value2, value3, int_value1, int_value2);
-uart_puts(uart1, snprintf_buffer); 
+logger_log(LOGGER_DEBUG, "ISR: 1:%lu 2:%lu 3:%lu / b: %lu a: %lu", 5, (uint32_t) value1, (uint32_t) value2, (uint32_t) value3, (uint32_t) int_value1, (uint32_t) int_value2);
 
 }
 
 
 int main() {
     struct  repeating_timer ledTimer;
-    datetime_t  t;
-    bool        get_time_valid = false;
     char        snprintf_buffer[SNPRINTF_BUFFER_SIZE];
     uint16_t    counter = 0;
-    char*       json_output = NULL;
+    const char* json_output = NULL;
     int         ret = PICO_ERROR_NONE;
 
     stdio_init_all();
@@ -136,13 +167,13 @@ int main() {
     printf("---------------------------------------------------------------------------------\n");
     printf("Enable debug LED...\n");
 
-    // Get first free state machine in PIO 1
-    pio_sm = pio_claim_unused_sm(pio1, true);
-    pio_sm_offset = pio_add_program(pio1, &ws2812_program);
+    // The debug LED is a strip of one pixel, with its own state machine
+    ledstrip_init(&debug_led_strip, pio1, DEBUG_WS2812, 1200000, debug_led_frames[0], debug_led_frames[1], 1);
+    ledstrip_set_timed(&debug_led_strip, false);
 
     // Set the debug LED to purple
-    ws2812_program_init(pio1, pio_sm, pio_sm_offset, DEBUG_WS2812, 1200000, false);
-    put_pixel(urgb_u32(10, 0, 10));
+    ledstrip_back_buffer(&debug_led_strip)[0] = LEDSTRIP_WORD(urgb_u32(10, 0, 10));
+    ledstrip_show(&debug_led_strip);
 
     // Wait for the PIO to finish writing out data
     sleep_ms(1);
@@ -170,12 +201,18 @@ int main() {
 
     // ===========================================================================================
     printf("Initializing SNON entities (%lu)\n", get_free_ram_2());
+    arena_initialize();
     sensors_initialize_device();
+    ledstats_initialize();
     sensors_initialize_displays();
+    store_initialize();
+    indicators_initialize();
+    init_gen_leds();
     printf("SNON entities initialized. (%lu)\n", get_free_ram_2());
 
     // ===========================================================================================
     printf("Front Panel init...\n");
+    init_gen_entities();
     multicore_launch_core1(&hmi_main);
 
     printf("Front Panel initialized...\n");
@@ -184,6 +221,13 @@ int main() {
     printf("Initializing Serial I/O...\n");
     uart_setup();
 
+    // The multi-drop address comes from the device eID
+    snon_name_to_eid("device", snprintf_buffer);
+    uart_set_address(uart_address_from_eid(snprintf_buffer));
+
+    commands_initialize();
+    command_register("get hmi", NULL, "Display LCD update statistics", command_get_hmi);
+
     gpio_pull_up(I2C_SDA_PIN);
     gpio_pull_up(I2C_SCL_PIN);
     gpio_set_function(I2C_SDA_PIN, GPIO_FUNC_I2C);
@@ -207,370 +251,150 @@ int main() {
     printf("Ready for commands\n");
     while (true)
     {
+        // Carry on with any response too long for the TX ring. No command is
+        // taken until it has all gone.
+        writer_resume();
+
         // Check if there are any commands pending
         const char* command = uart_command_get();
         if(strcmp(command, "") != 0)
         {
             if(command[0] == '{')
             {
-                char*       json_output = NULL;
+                // Tokenized once, for subscription requests and the request ID
+                json_tok_t  tokens[REPLY_TOKEN_MAX];
+                int16_t     token_count = json_tok_parse(command, strlen(command), tokens, REPLY_TOKEN_MAX);
                 char        eid[SNON_URN_LENGTH];
+                reply_rid_t rid;
+                writer_t    writer;
 
-                printf("Received SNON fragment \"%s\"\n", command);
+                logger_log_text(LOGGER_INFO, "Received SNON fragment \"%s\" (%lu characters)", command, 1, (uint32_t) strlen(command));
+                writer_init_uart(&writer, WRITER_MODE_RAW);
 
                 if(command[1] == '}')
                 {
                     // Display all entities
-                    char*       entity_output = NULL;
-                    uint16_t    counter = 0;
-                    uint16_t    json_output_length = 0;
-
-                    json_output = snon_get_values("Entities");
+                    write_entities_json(&writer, ",");
+                }
+                else if(subscribe_fragment(&writer, command, tokens, token_count) == true)
+                {
+                    // Subscription requests are answered by subscribe_fragment()
+                }
+                else
+                {
+                    reply_get_rid(command, tokens, token_count, 0, &rid);
 
-                    if(json_output != NULL)
+                    if(json_has_eid(command, snprintf_buffer) == true)
                     {
-                        json_output_length = strlen(json_output);
+                        uint8_t error = 0;
 
-                        counter = 0;
-                        uart_puts(uart1, "[");
-
-                        while(json_output[counter] != 0)
+                        // Copy over the eID
+                        strncpy(eid, snprintf_buffer, SNON_URN_LENGTH);
+                        eid[SNON_URN_LENGTH - 1] = 0;
+                        
+                        if(json_has_value(command, snprintf_buffer) == true)
                         {
-                            if(json_output[counter] == '"')
+                            if(indicator_check_values(eid, snprintf_buffer) == false)
+                            {
+                                logger_log_text(LOGGER_WARNING, "Invalid indicator state for eID %s", eid, 0);
+                                error = REPLY_ERROR_BAD_VALUE;
+                            }
+                            else
                             {
-                                sscanf(&json_output[counter + 1], "%45s", &snprintf_buffer);
-                                entity_output = snon_get_json(snprintf_buffer);
+                                // Update the value
+                                logger_log_text(LOGGER_INFO, "New value for eID %s (%lu characters)", eid, 1, (uint32_t) strlen(snprintf_buffer));
 
-                                if(entity_output != NULL)
+                                if(entity_set_values(eid, snprintf_buffer) == true)
                                 {
-                                    uart_puts(uart1, entity_output);
-                                    free(entity_output);
+                                    refresh_needed = true;
                                 }
-                                else
+                                else if(store_find(eid) == STORE_INVALID)
                                 {
-                                    uart_puts(uart1, "{}");
+                                    error = REPLY_ERROR_NOT_FOUND;
                                 }
-                                
-                                if(counter + 50 < json_output_length)
+                                else
                                 {
-                                    uart_puts(uart1, ",");
+                                    logger_log_text(LOGGER_WARNING, "Unable to store the value of %s", eid, 0);
+                                    error = REPLY_ERROR_NO_MEMORY;
                                 }
-
-                                counter = counter + SNON_URN_LENGTH;
                             }
-
-                            counter = counter + 1;
-                        }
-
-                        uart_puts(uart1, "]");
-                        free(json_output);
-                    }
-                }
-                else
-                {
-                    if(json_has_eid(command, snprintf_buffer) == true)
-                    {
-                        // Copy over the eID
-                        strncpy(eid, snprintf_buffer, SNON_URN_LENGTH);
-                        eid[SNON_URN_LENGTH - 1] = 0;
-                        
-                        if(json_has_value(command, snprintf_buffer) == true)
-                        {
-                            // Update the value
-                            printf("New Value %s\n", snprintf_buffer);
-                            snon_set_values(eid, snprintf_buffer);
-                            refresh_needed = true;
                         }
 
-                        json_output = snon_get_json(eid);
-
-                        if(json_output != NULL)
+                        if(error != 0)
                         {
-                            uart_puts(uart1, json_output);
-                            free(json_output);
+                            reply_error(&writer, error, &rid);
                         }
-                        else
+                        else if(reply_entity(&writer, eid, &rid) == false)
                         {
-                            printf("Unable to find entity with eID %s\r\n", eid);
-                            uart_puts(uart1, "{}");
+                            logger_log_text(LOGGER_WARNING, "Unable to find entity with eID %s", eid, 0);
+                            reply_error(&writer, REPLY_ERROR_NOT_FOUND, &rid);
                         }
                     }
                     else
                     {
-                        printf("Unable to find eID\r\n");
-                        uart_puts(uart1, "{}");
+                        logger_log(LOGGER_WARNING, "Unable to find eID", 0);
+                        reply_error(&writer, REPLY_ERROR_NO_EID, &rid);
                     }
                 }
 
-                uart_puts(uart1, "\r\n");
+                writer_puts(&writer, "\r\n");
+                writer_flush(&writer);
                 uart_command_clear();
             }
             else
             {
+                writer_t    writer;
+
+                // Anything else is only accepted in command mode
                 if(uart_in_command_mode())
                 {
-                    printf("Received Command \"%s\"\n", command);
-
-                    if(strcmp(command, "help") == 0)
-                    {
-                        uart_puts(uart1, "\r\nCommands:");
-                        uart_puts(uart1, "\r\n\"help\"                - Displays list of commands");
-                        uart_puts(uart1, "\r\n\"clear\"               - Clear the serial terminal");
-                        uart_puts(uart1, "\r\n\"ls\"                  - List SNON entites");
-                        uart_puts(uart1, "\r\n\"cat <entity>\"        - Display the value of an SNON entity");
-                        uart_puts(uart1, "\r\n\"get time\"            - Get the current time");
-                        uart_puts(uart1, "\r\n\"set time\"            - Set the current time");
-                        uart_command_clear();
-                    }
-                    else if(strcmp(command, "clear") == 0)
-                    {
-                        uart_puts(uart1, "\033[2J");
-                        uart_command_clear();
-                    }
-                    else if(strcmp(command, "ls") == 0)
-                    {
-                        // List all entities
-                        char*       entity_name = NULL;
-                        uint16_t    counter = 0;
-                        uint16_t    json_output_length = 0;
-
-                        json_output = snon_get_values("Entities");
-
-                        if(json_output != NULL)
-                        {
-                            json_output_length = strlen(json_output);
-
-                            counter = 0;
-                            uart_puts(uart1, "\r\n");
-
-                            while(json_output[counter] != 0)
-                            {
-                                if(json_output[counter] == '"')
-                                {
-                                    sscanf(&json_output[counter + 1], "%45s", &snprintf_buffer);
-
-                                    uart_puts(uart1, snprintf_buffer);
-                                    uart_puts(uart1, " - ");
-
-                                    entity_name = snon_get_name(snprintf_buffer);
-
-                                    if(entity_name != NULL)
-                                    {
-                                        uart_puts(uart1, entity_name);
-                                    }
-                                    else
-                                    {
-                                        uart_puts(uart1, "Unknown entity name");
-                                    }
-                                        
-                                    if(counter + 50 < json_output_length)
-                                    {
-                                        uart_puts(uart1, "\r\n");
-                                    }
-
-                                    counter = counter + SNON_URN_LENGTH;
-                                }
-
-                                counter = counter + 1;
-                            }
-
-                            uart_puts(uart1, "\r\n");
-                            free(json_output);
-                        }
-                        else
-                        {
-                            uart_puts(uart1, "\r\nError: Out of memory.\r\n");
-                        }
-
-                        uart_command_clear();
-                    }
-                    else if(strncmp(command, "cat ", 4) == 0)
-                    {
-                        char* json_output = snon_get_json((char*) &(command[4]));
-
-                        if(json_output != NULL)
-                        {
-                            uart_puts(uart1, "\r\n");
+                    logger_log_text(LOGGER_INFO, "Received Command \"%s\" (%lu characters)", command, 1, (uint32_t) strlen(command));
+                    writer_init_uart(&writer, WRITER_MODE_RAW);
 
-                            counter = 0;
-                            while(json_output[counter] != 0)
-                            {
-                                uart_putc(uart1, json_output[counter]);
-
-                                if(json_output[counter] == ',')
-                                {
-                                    uart_putc(uart1, '\r');
-                                    uart_putc(uart1, '\n');
-                                }
-
-                                counter = counter + 1;
-                            }
-
-                            uart_puts(uart1, "\r\n");
-                            free(json_output);
-                        }
-                        else
-                        {
-                            uart_puts(uart1, "\r\nEntity not found\r\n");
-                        }
-
-                        uart_command_clear();
-                    }
-                    else if(strncmp(command, "dump", 4) == 0)
-                    {
-                        char* json_output = snon_get_dump();
-
-                        if(json_output != NULL)
-                        {
-                            uart_puts(uart1, "\r\n");
-
-                            counter = 0;
-                            while(json_output[counter] != 0)
-                            {
-                                if(json_output[counter] == '\n')
-                                {
-                                    uart_putc(uart1, '\r');
-                                }
-
-                                uart_putc(uart1, json_output[counter]);
-
-                                counter = counter + 1;
-                            }
-
-                            uart_puts(uart1, "\r\n");
-                            free(json_output);
-                        }
-                        else
-                        {
-                            uart_puts(uart1, "\r\nError: Out of memory.\r\n");
-                        }
-
-                        uart_command_clear();
-                    }
-                    else if(strcmp(command, "get mem") == 0)
+                    if(command_dispatch(&writer, command) == false)
                     {
-                        snprintf(snprintf_buffer, SNPRINTF_BUFFER_SIZE, "\r\nFree memory: %lu bytes\r\n", get_free_ram_2());
-                        uart_puts(uart1, snprintf_buffer);
-
-                        uart_command_clear();
+                        writer_puts(&writer, "\r\nUnknown command\r\n");
                     }
-                    else if(strcmp(command, "get time") == 0)
-                    {
-                        get_time_valid = rtc_counter_to_iso8601(snprintf_buffer, time_us_64());
 
-                        if(get_time_valid == true)
-                        {
-                            uart_puts(uart1, "\r\nThe time is: ");
-                            uart_puts(uart1, snprintf_buffer);
-                        }
-                        else
-                        {
-                            uart_puts(uart1, "\r\nRTC not running. Use the \"set time\" command to set the current time.");
-                        }
-                        uart_command_clear();
-                    }
-                    else if(strncmp(command, "set time ", 9) == 0)
-                    {
-                        unsigned int    year = 0;
-                        unsigned int    month = 0;
-                        unsigned int    day = 0;
-                        unsigned int    hours = 0;
-                        unsigned int    minutes = 0;
-                        unsigned int    seconds = 0;
-                        bool            set_valid = false;
-
-                        sscanf(command, "set time %4u-%2u-%2uT%2u:%2u:%2uZ", &year, &month, &day, &hours, &minutes, &seconds);
-                        if(year < 2022 || year > 2055)
-                        {
-                            snprintf(snprintf_buffer, SNPRINTF_BUFFER_SIZE, "\r\nInvalid year %04d. Must be between 2022 and 2055", year);
-                            uart_puts(uart1, snprintf_buffer);
-                        }
-                        else if(month < 1 || month > 12)
-                        {
-                            snprintf(snprintf_buffer, SNPRINTF_BUFFER_SIZE, "\r\nInvalid month %02d. Must be between 1 and 12", month);
-                            uart_puts(uart1, snprintf_buffer);
-                        }
-                        else if(day < 1 || day > 31)
-                        {
-                            snprintf(snprintf_buffer, SNPRINTF_BUFFER_SIZE, "\r\nInvalid day %02d. Must be between 1 and 31", day);
-                            uart_puts(uart1, snprintf_buffer);
-                        }
-                        else if(hours < 0 || hours > 23)
-                        {
-                            snprintf(snprintf_buffer, SNPRINTF_BUFFER_SIZE, "\r\nInvalid hour %02d. Must be between 0 and 23", hours);
-                            uart_puts(uart1, snprintf_buffer);
-                        }
-                        else if(minutes < 0 || minutes > 59)
-                        {
-                            snprintf(snprintf_buffer, SNPRINTF_BUFFER_SIZE, "\r\nInvalid minute %02d. Must be between 0 and 59", minutes);
-                            uart_puts(uart1, snprintf_buffer);
-                        }
-                        else if(seconds < 0 || seconds > 59)
-                        {
-                            snprintf(snprintf_buffer, SNPRINTF_BUFFER_SIZE, "\r\nInvalid second %02d. Must be between 0 and 59", hours);
-                            uart_puts(uart1, snprintf_buffer);
-                        }
-                        else
-                        {
-                            t.year = year;
-                            t.month = month;
-                            t.day = day;
-                            t.hour = hours;
-                            t.min = minutes;
-                            t.sec = seconds;
-                            t.dotw = 0;
+                    writer_flush(&writer);
+                }
 
-                            snprintf(snprintf_buffer, SNPRINTF_BUFFER_SIZE, "%04d-%02d-%02dT%02d:%02d:%02dZ", t.year, t.month, t.day, t.hour, t.min, t.sec);
+                uart_command_clear();
+            }
+        }
 
-                            set_valid = rtc_set_time(snprintf_buffer);
-                            sleep_us(64);
+        // Push any subscribed values that have changed
+        subscribe_service();
 
-                            if(set_valid == true)
-                            {
-                                uart_puts(uart1, "\r\nTime set to ");
-                                uart_puts(uart1, snprintf_buffer);
-                            }
-                            else
-                            {
-                                uart_puts(uart1, "\r\nError setting time to ");
-                                uart_puts(uart1, snprintf_buffer);
-                            }
-                        }
+        // Copy the LED timing histograms to SNON now and again
+        ledstats_publish();
 
-                        uart_command_clear();
-                    }
-                    else if(strcmp(command, "exit") == 0)
-                    {
-                        uart_command_exit();
-                        uart_command_clear();
-                    }
-                    else
-                    {
-                        uart_puts(uart1, "\r\nUnknown command\r\n");
-                        uart_command_clear();
-                    }
-                }
-            }
-        }
+        // Print anything logged since the last pass, a few records at a time
+        logger_drain(LOGGER_DRAIN_COUNT);
 
 
         if(refresh_needed == true)
         {
-            json_output = snon_get_values("Debug LED RGB");
+            refresh_needed = false;
+            json_output = store_get_values(store_find("Debug LED RGB"));
 
             if(json_output)
             {
-                uint8_t r_value = 0;
-                uint8_t g_value = 0;
-                uint8_t b_value = 0;
+                unsigned int r_value = 0;
+                unsigned int g_value = 0;
+                unsigned int b_value = 0;
 
                 sscanf(json_output, "[\"%2X%2X%2X\"]", &r_value, &g_value, &b_value);
-                ws2812_program_init(pio1, pio_sm, pio_sm_offset, DEBUG_WS2812, 1200000, false);
-                put_pixel(urgb_u32(r_value, g_value, b_value));
-                free(json_output);
+                ledstrip_back_buffer(&debug_led_strip)[0] = LEDSTRIP_WORD(urgb_u32(r_value, g_value, b_value));
+                debug_led_pending = true;
             }
+        }
 
-            refresh_needed = false;
+        // The back buffer keeps the colour while the last one is still being sent,
+        // so a retry on the next pass doesn't need the value parsing again
+        if((debug_led_pending == true) && (ledstrip_show(&debug_led_strip) == true))
+        {
+            debug_led_pending = false;
         }
 
         //sleep_ms(100);
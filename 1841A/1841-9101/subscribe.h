@@ -0,0 +1,51 @@
+// ---------------------------------------------------------------------------------
+// Change subscriptions - Header
+// ---------------------------------------------------------------------------------
+// Pushes the values of subscribed entities to the host when they change, so it
+// doesn't have to poll for them
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+
+#pragma once
+#ifndef SUBSCRIBE_H
+#define SUBSCRIBE_H
+
+#include "pico/stdlib.h"
+#include "json_tok.h"
+#include "writer.h"
+
+// Constants
+#define SUBSCRIBE_MAX               32
+#define SUBSCRIBE_INTERVAL_MS       100     // Default minimum time between pushes of one entity
+#define SUBSCRIBE_INTERVAL_MIN_MS   10
+#define SUBSCRIBE_INTERVAL_MAX_MS   3600000 // Longer intervals are clamped to this
+#define SUBSCRIBE_CHECK_COUNT       4       // Changed entities fetched per call to subscribe_service()
+#define SUBSCRIBE_TX_RESERVE        256     // Pushes wait while less than this is free in the TX ring
+
+// Types
+typedef struct
+{
+    uint32_t    pushes;
+    uint32_t    deferred;           // Changes held back by the rate limit
+    uint32_t    sequence;
+} subscribe_stats_t;
+
+// Requests from the host, as {"subscribe":[...],"interval":<ms>} or {"unsubscribe":[...]}.
+// Returns false if the fragment isn't a subscription request.
+bool subscribe_fragment(writer_t* writer, const char* fragment, const json_tok_t* tokens, int16_t token_count);
+
+// Subscriptions, by eID or by entity name prefix (such as an IEC 81346 "=P01")
+uint8_t subscribe_add(const char* target, uint32_t interval_ms, bool* full);
+uint8_t subscribe_remove(const char* target);
+void subscribe_clear(void);
+
+// Change detection (command loop)
+void subscribe_changed(const char* entity);
+void subscribe_service(void);
+void subscribe_list(writer_t* writer);
+const subscribe_stats_t* subscribe_get_stats(void);
+
+#endif // SUBSCRIBE_H
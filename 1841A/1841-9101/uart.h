@@ -12,8 +12,32 @@
 #ifndef UART_H
 #define UART_H
 
-// Globals
-extern volatile uint8_t collect_active;
+// Build options
+//  UART_MULTIDROP=1        Start with multi-drop addressing enabled
+//  UART_RS485_DE_PIN=<n>   GPIO driving the RS-485 transceiver's driver enable
+#ifndef UART_MULTIDROP
+#define UART_MULTIDROP          0
+#endif
+
+// Constants
+#define UART_ADDRESS_LENGTH     4           // Hex digits
+#define UART_RESPONSE_SPACE     2048        // TX ring room needed before the next command is handed out
+
+// Types
+typedef struct
+{
+    uint32_t    rx_bytes;           // Bytes received
+    uint32_t    rx_overflows;       // Lines dropped because the receive ring was full
+    uint32_t    rx_high_water;      // Most bytes waiting in the receive ring
+    uint32_t    lines;              // Lines and frames taken off the queue
+    uint32_t    line_overflows;     // Lines dropped because the line queue was full
+    uint32_t    lines_truncated;    // Lines dropped for being too long
+    uint32_t    lines_other;        // Multi-drop lines addressed to other panels
+    uint32_t    tx_high_water;      // Most bytes waiting in the transmit ring
+    uint32_t    tx_stalls;          // Writes that found the transmit ring full
+    uint32_t    tx_deferred;        // Responses finished from the command loop
+    uint32_t    loop_gap_max_us;    // Longest time between checks for commands
+} uart_stats_t;
 
 // UART Setup
 void uart_setup(void);
@@ -22,4 +46,29 @@ void uart_command_clear(void);
 bool uart_in_command_mode(void);
 void uart_command_exit(void);
 
+// Output
+uint16_t uart_write(const char* data, uint16_t length);
+uint16_t uart_send_data(const char* data, uint16_t length);
+void uart_send(const char* string);
+void uart_send_char(char character);
+uint16_t uart_tx_free(void);
+void uart_tx_flush(void);
+void uart_set_response_pending(bool pending);
+bool uart_response_pending(void);
+
+// Binary framing
+uint16_t uart_frame_get(const uint8_t** frame);
+void uart_set_binary_mode(bool enabled);
+bool uart_in_binary_mode(void);
+
+// Multi-drop addressing
+uint16_t uart_address_from_eid(const char* eid);
+void uart_set_address(uint16_t address);
+uint16_t uart_get_address(void);
+void uart_set_multidrop_mode(bool enabled);
+bool uart_in_multidrop_mode(void);
+
+// Statistics
+const uart_stats_t* uart_get_stats(void);
+
 #endif // UART_H
\ No newline at end of file
@@ -0,0 +1,530 @@
+// ---------------------------------------------------------------------------------
+// ISA-18.1 annunciator sequences
+// ---------------------------------------------------------------------------------
+// Each window follows the process input set by the host, and is acknowledged and
+// reset from the serial terminal. Only the windows that an event affects are
+// visited, so an alarm flood costs no more than the windows that change.
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+
+#include "annunciator.h"
+#include "indicators.h"
+#include "subscribe.h"
+#include "store.h"
+#include "snon/snon_utils.h"
+
+// Constants
+#define ANNUNCIATOR_INPUT_NORMAL        0
+#define ANNUNCIATOR_INPUT_ALARM         1
+#define ANNUNCIATOR_INPUT_INVALID       0xFF
+#define ANNUNCIATOR_INPUT_LENGTH        8       // Longest input value, plus the terminator
+#define ANNUNCIATOR_VALUES_LENGTH       32
+
+// Types
+typedef struct
+{
+    char                eid[SNON_URN_LENGTH];       // Window drawn by the sequence
+    char                input_eid[SNON_URN_LENGTH]; // Process input set by the host
+    uint32_t            input_hash;
+    indicator_handle_t  handle;
+    uint8_t             state;
+    uint16_t            position;                   // Place in the list for its state
+} annunciator_window_t;
+
+// Windows that an acknowledge or a reset has to visit
+typedef struct
+{
+    uint16_t    windows[ANNUNCIATOR_MAX_COUNT];
+    uint16_t    count;
+} annunciator_list_t;
+
+// Global variables
+
+// Indicator drawn for each window state. Under first-out, windows that alarm
+// after the first one are drawn steady until they are acknowledged.
+const uint8_t annunciator_displays[ANNUNCIATOR_STATE_COUNT] =
+{
+    INDICATOR_OFF,              // Normal
+    INDICATOR_WHITE_FAST,       // Alert
+    INDICATOR_WHITE_FAST,       // Alert, cleared
+    INDICATOR_WHITE_STEADY,     // Acknowledged
+    INDICATOR_WHITE_STEADY,     // Acknowledged, cleared
+    INDICATOR_AMBER_SLOW        // Ringback
+};
+
+const char* annunciator_state_names[ANNUNCIATOR_STATE_COUNT] =
+{
+    "normal",
+    "alert",
+    "alert, cleared",
+    "acknowledged",
+    "acknowledged, cleared",
+    "ringback"
+};
+
+const char* annunciator_sequence_names[ANNUNCIATOR_SEQUENCE_COUNT] = { "A", "M", "R" };
+
+annunciator_window_t    annunciator_windows[ANNUNCIATOR_MAX_COUNT];
+uint16_t                annunciator_count = 0;
+annunciator_list_t      annunciator_unacknowledged;
+annunciator_list_t      annunciator_waiting;
+uint8_t                 annunciator_sequence = ANNUNCIATOR_SEQUENCE;
+bool                    annunciator_first_out_enabled = ANNUNCIATOR_FIRST_OUT;
+uint16_t                annunciator_first_out = ANNUNCIATOR_NONE;
+annunciator_stats_t     annunciator_stats;
+
+// Private prototypes
+uint32_t annunciator_hash(const char* eid);
+uint16_t annunciator_find_input(const char* eid);
+uint8_t annunciator_parse_values(const char* values);
+annunciator_list_t* annunciator_list(uint8_t state);
+uint8_t annunciator_returned(void);
+void annunciator_input(uint16_t window, bool alarm);
+void annunciator_enter(uint16_t window, uint8_t state);
+void annunciator_show(uint16_t window);
+void annunciator_done(uint32_t start_us);
+
+// =================================================================================
+// Setup
+
+void annunciator_initialize(void)
+{
+    annunciator_count = 0;
+    annunciator_unacknowledged.count = 0;
+    annunciator_waiting.count = 0;
+    annunciator_sequence = ANNUNCIATOR_SEQUENCE;
+    annunciator_first_out_enabled = ANNUNCIATOR_FIRST_OUT;
+    annunciator_first_out = ANNUNCIATOR_NONE;
+}
+
+// Adds a window, which must already be drawn as an indicator. The window keeps
+// the value it was registered with until its input is first set.
+bool annunciator_add_window(const char* window, const char* input)
+{
+    annunciator_window_t*   entry = NULL;
+
+    if(annunciator_count == ANNUNCIATOR_MAX_COUNT)
+    {
+        printf("Annunciator full, unable to add \"%s\"\n", window);
+        return(false);
+    }
+
+    entry = &annunciator_windows[annunciator_count];
+    snon_name_to_eid((char*) window, entry->eid);
+    snon_name_to_eid((char*) input, entry->input_eid);
+
+    entry->handle = indicator_find_eid(entry->eid);
+    if(entry->handle == INDICATOR_NONE)
+    {
+        printf("Annunciator window \"%s\" isn't an indicator\n", window);
+        return(false);
+    }
+
+    entry->input_hash = annunciator_hash(entry->input_eid);
+    entry->state = ANNUNCIATOR_NORMAL;
+    entry->position = 0;
+    annunciator_count = annunciator_count + 1;
+
+    return(true);
+}
+
+// FNV-1a hash of an eID, as used for indicator lookups
+uint32_t annunciator_hash(const char* eid)
+{
+    uint32_t hash = 2166136261u;
+
+    while(*eid != 0)
+    {
+        hash = (hash ^ (uint8_t) *eid) * 16777619u;
+        eid = eid + 1;
+    }
+
+    return(hash);
+}
+
+uint16_t annunciator_find_input(const char* eid)
+{
+    uint32_t    hash = annunciator_hash(eid);
+    uint16_t    window = 0;
+
+    while(window != annunciator_count)
+    {
+        if((annunciator_windows[window].input_hash == hash) && (strcmp(annunciator_windows[window].input_eid, eid) == 0))
+        {
+            return(window);
+        }
+
+        window = window + 1;
+    }
+
+    return(ANNUNCIATOR_NONE);
+}
+
+// Parses the first string in a values array
+uint8_t annunciator_parse_values(const char* values)
+{
+    char        input[ANNUNCIATOR_INPUT_LENGTH];
+    const char* start = strchr(values, '"');
+    const char* end = NULL;
+
+    if(start == NULL)
+    {
+        return(ANNUNCIATOR_INPUT_INVALID);
+    }
+
+    start = start + 1;
+    end = strchr(start, '"');
+
+    if((end == NULL) || ((end - start) >= ANNUNCIATOR_INPUT_LENGTH))
+    {
+        return(ANNUNCIATOR_INPUT_INVALID);
+    }
+
+    memcpy(input, start, end - start);
+    input[end - start] = 0;
+
+    if(strcmp(input, "normal") == 0)
+    {
+        return(ANNUNCIATOR_INPUT_NORMAL);
+    }
+
+    if(strcmp(input, "alarm") == 0)
+    {
+        return(ANNUNCIATOR_INPUT_ALARM);
+    }
+
+    return(ANNUNCIATOR_INPUT_INVALID);
+}
+
+// =================================================================================
+// Sequences
+
+// The list a window in this state belongs to, or NULL if it needs no operator action
+annunciator_list_t* annunciator_list(uint8_t state)
+{
+    if((state == ANNUNCIATOR_ALERT) || (state == ANNUNCIATOR_ALERT_CLEARED))
+    {
+        return(&annunciator_unacknowledged);
+    }
+
+    if((state == ANNUNCIATOR_ACKED_CLEARED) || (state == ANNUNCIATOR_RINGBACK))
+    {
+        return(&annunciator_waiting);
+    }
+
+    return(NULL);
+}
+
+// Where an acknowledged window goes once its process is back to normal
+uint8_t annunciator_returned(void)
+{
+    if(annunciator_sequence == ANNUNCIATOR_SEQUENCE_M)
+    {
+        return(ANNUNCIATOR_ACKED_CLEARED);
+    }
+
+    if(annunciator_sequence == ANNUNCIATOR_SEQUENCE_R)
+    {
+        return(ANNUNCIATOR_RINGBACK);
+    }
+
+    return(ANNUNCIATOR_NORMAL);
+}
+
+void annunciator_input(uint16_t window, bool alarm)
+{
+    uint8_t     state = annunciator_windows[window].state;
+
+    if(alarm == true)
+    {
+        if(state == ANNUNCIATOR_ALERT_CLEARED)
+        {
+            annunciator_enter(window, ANNUNCIATOR_ALERT);
+        }
+        else if((state == ANNUNCIATOR_NORMAL) || (state == ANNUNCIATOR_ACKED_CLEARED) || (state == ANNUNCIATOR_RINGBACK))
+        {
+            // A new alarm, which is the first out if no other is waiting to be acknowledged
+            if((annunciator_first_out_enabled == true) && (annunciator_first_out == ANNUNCIATOR_NONE))
+            {
+                annunciator_first_out = window;
+            }
+
+            annunciator_enter(window, ANNUNCIATOR_ALERT);
+        }
+    }
+    else
+    {
+        // An alert keeps flashing until it is acknowledged
+        if(state == ANNUNCIATOR_ALERT)
+        {
+            annunciator_enter(window, ANNUNCIATOR_ALERT_CLEARED);
+        }
+        else if(state == ANNUNCIATOR_ACKED)
+        {
+            annunciator_enter(window, annunciator_returned());
+        }
+    }
+}
+
+// Moves a window to a new state, keeping the acknowledge and reset lists up to
+// date. Windows leave a list by swapping with its last entry.
+void annunciator_enter(uint16_t window, uint8_t state)
+{
+    annunciator_window_t*   entry = &annunciator_windows[window];
+    annunciator_list_t*     from = annunciator_list(entry->state);
+    annunciator_list_t*     to = annunciator_list(state);
+    uint16_t                last = 0;
+
+    if(from != to)
+    {
+        if(from != NULL)
+        {
+            from->count = from->count - 1;
+            last = from->windows[from->count];
+            from->windows[entry->position] = last;
+            annunciator_windows[last].position = entry->position;
+        }
+
+        if(to != NULL)
+        {
+            entry->position = to->count;
+            to->windows[to->count] = window;
+            to->count = to->count + 1;
+        }
+    }
+
+    if(entry->state != state)
+    {
+        entry->state = state;
+        annunciator_stats.transitions = annunciator_stats.transitions + 1;
+    }
+
+    annunciator_show(window);
+}
+
+// Draws the window, and updates its SNON value if it changed
+void annunciator_show(uint16_t window)
+{
+    annunciator_window_t*   entry = &annunciator_windows[window];
+    uint8_t                 display = annunciator_displays[entry->state];
+    char                    values[ANNUNCIATOR_VALUES_LENGTH];
+
+    if((annunciator_first_out_enabled == true) && (annunciator_first_out != window) &&
+       ((entry->state == ANNUNCIATOR_ALERT) || (entry->state == ANNUNCIATOR_ALERT_CLEARED)))
+    {
+        display = annunciator_displays[ANNUNCIATOR_ACKED];
+    }
+
+    if(indicator_get_state(entry->handle) == display)
+    {
+        return;
+    }
+
+    indicator_set_state(entry->handle, display);
+
+    snprintf(values, ANNUNCIATOR_VALUES_LENGTH, "[\"%s\"]", indicator_state_name(display));
+    store_set_values(store_find(entry->eid), values);
+    subscribe_changed(entry->eid);
+}
+
+void annunciator_done(uint32_t start_us)
+{
+    annunciator_stats.last_us = time_us_32() - start_us;
+
+    if(annunciator_stats.last_us > annunciator_stats.max_us)
+    {
+        annunciator_stats.max_us = annunciator_stats.last_us;
+    }
+}
+
+// =================================================================================
+// Updates
+
+// Unknown inputs are refused, rather than being taken as normal
+bool annunciator_check_values(const char* eid, const char* values)
+{
+    if(annunciator_find_input(eid) == ANNUNCIATOR_NONE)
+    {
+        return(true);
+    }
+
+    if(annunciator_parse_values(values) == ANNUNCIATOR_INPUT_INVALID)
+    {
+        annunciator_stats.rejected = annunciator_stats.rejected + 1;
+        return(false);
+    }
+
+    return(true);
+}
+
+bool annunciator_set_values(const char* eid, const char* values)
+{
+    uint32_t    start_us = time_us_32();
+    uint16_t    window = annunciator_find_input(eid);
+    uint8_t     input = 0;
+
+    if(window == ANNUNCIATOR_NONE)
+    {
+        return(true);
+    }
+
+    input = annunciator_parse_values(values);
+
+    if(input == ANNUNCIATOR_INPUT_INVALID)
+    {
+        annunciator_stats.rejected = annunciator_stats.rejected + 1;
+        return(false);
+    }
+
+    annunciator_stats.inputs = annunciator_stats.inputs + 1;
+    annunciator_input(window, input == ANNUNCIATOR_INPUT_ALARM);
+
+    // Also takes over a window the host drew directly
+    annunciator_show(window);
+    annunciator_done(start_us);
+
+    return(true);
+}
+
+// Acknowledges every window waiting for it, which ends the first-out group
+void annunciator_acknowledge(void)
+{
+    uint32_t    start_us = time_us_32();
+    uint16_t    window = 0;
+
+    annunciator_first_out = ANNUNCIATOR_NONE;
+
+    while(annunciator_unacknowledged.count != 0)
+    {
+        window = annunciator_unacknowledged.windows[annunciator_unacknowledged.count - 1];
+
+        if(annunciator_windows[window].state == ANNUNCIATOR_ALERT)
+        {
+            annunciator_enter(window, ANNUNCIATOR_ACKED);
+        }
+        else
+        {
+            annunciator_enter(window, annunciator_returned());
+        }
+
+        annunciator_stats.acknowledged = annunciator_stats.acknowledged + 1;
+    }
+
+    annunciator_done(start_us);
+}
+
+// Resets every window whose process is back to normal. Windows still in alarm
+// aren't affected.
+void annunciator_reset(void)
+{
+    uint32_t    start_us = time_us_32();
+    uint16_t    window = 0;
+
+    while(annunciator_waiting.count != 0)
+    {
+        window = annunciator_waiting.windows[annunciator_waiting.count - 1];
+        annunciator_enter(window, ANNUNCIATOR_NORMAL);
+        annunciator_stats.reset = annunciator_stats.reset + 1;
+    }
+
+    annunciator_done(start_us);
+}
+
+// Windows keep their state, and follow the new sequence from their next event.
+// Windows waiting to be acknowledged are redrawn for the first-out setting.
+bool annunciator_set_sequence(uint8_t sequence, bool first_out)
+{
+    uint16_t    counter = 0;
+
+    if(sequence >= ANNUNCIATOR_SEQUENCE_COUNT)
+    {
+        return(false);
+    }
+
+    annunciator_sequence = sequence;
+
+    if(first_out != annunciator_first_out_enabled)
+    {
+        annunciator_first_out_enabled = first_out;
+        annunciator_first_out = ANNUNCIATOR_NONE;
+
+        while(counter != annunciator_unacknowledged.count)
+        {
+            annunciator_show(annunciator_unacknowledged.windows[counter]);
+            counter = counter + 1;
+        }
+    }
+
+    return(true);
+}
+
+// =================================================================================
+// Status
+
+uint8_t annunciator_get_sequence(void)
+{
+    return(annunciator_sequence);
+}
+
+bool annunciator_get_first_out(void)
+{
+    return(annunciator_first_out_enabled);
+}
+
+uint16_t annunciator_window_count(void)
+{
+    return(annunciator_count);
+}
+
+uint16_t annunciator_unacknowledged_count(void)
+{
+    return(annunciator_unacknowledged.count);
+}
+
+uint16_t annunciator_waiting_reset_count(void)
+{
+    return(annunciator_waiting.count);
+}
+
+uint8_t annunciator_window_state(uint16_t window)
+{
+    if(window >= annunciator_count)
+    {
+        return(ANNUNCIATOR_NORMAL);
+    }
+
+    return(annunciator_windows[window].state);
+}
+
+const char* annunciator_state_name(uint8_t state)
+{
+    if(state >= ANNUNCIATOR_STATE_COUNT)
+    {
+        return("unknown");
+    }
+
+    return(annunciator_state_names[state]);
+}
+
+const char* annunciator_sequence_name(uint8_t sequence)
+{
+    if(sequence >= ANNUNCIATOR_SEQUENCE_COUNT)
+    {
+        return("unknown");
+    }
+
+    return(annunciator_sequence_names[sequence]);
+}
+
+const annunciator_stats_t* annunciator_get_stats(void)
+{
+    return(&annunciator_stats);
+}
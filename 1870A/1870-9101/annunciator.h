@@ -0,0 +1,85 @@
+// ---------------------------------------------------------------------------------
+// ISA-18.1 annunciator sequences - Header
+// ---------------------------------------------------------------------------------
+// Each window follows the process input set by the host, and is acknowledged and
+// reset from the serial terminal. Only the windows that an event affects are
+// visited, so an alarm flood costs no more than the windows that change.
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+
+#pragma once
+#ifndef ANNUNCIATOR_H
+#define ANNUNCIATOR_H
+
+#include "pico/stdlib.h"
+#include "indicators.h"
+
+// Sequences
+#define ANNUNCIATOR_SEQUENCE_A          0       // Automatic reset
+#define ANNUNCIATOR_SEQUENCE_M          1       // Manual reset
+#define ANNUNCIATOR_SEQUENCE_R          2       // Ringback
+#define ANNUNCIATOR_SEQUENCE_COUNT      3
+
+// Build options
+//  ANNUNCIATOR_SEQUENCE=<n>    Sequence used from power up
+//  ANNUNCIATOR_FIRST_OUT=<0|1> Only flash the first window of each alarm group
+#ifndef ANNUNCIATOR_SEQUENCE
+#define ANNUNCIATOR_SEQUENCE            ANNUNCIATOR_SEQUENCE_A
+#endif
+#ifndef ANNUNCIATOR_FIRST_OUT
+#define ANNUNCIATOR_FIRST_OUT           0
+#endif
+
+// Window states
+#define ANNUNCIATOR_NORMAL              0
+#define ANNUNCIATOR_ALERT               1       // Not acknowledged, process abnormal
+#define ANNUNCIATOR_ALERT_CLEARED       2       // Not acknowledged, process back to normal
+#define ANNUNCIATOR_ACKED               3       // Acknowledged, process abnormal
+#define ANNUNCIATOR_ACKED_CLEARED       4       // Acknowledged, process back to normal, waiting for reset
+#define ANNUNCIATOR_RINGBACK            5       // As above, for sequence R
+#define ANNUNCIATOR_STATE_COUNT         6
+
+// Constants
+#define ANNUNCIATOR_MAX_COUNT           64
+#define ANNUNCIATOR_NONE                0xFFFF
+
+// Types
+typedef struct
+{
+    uint32_t    inputs;                 // Process inputs set
+    uint32_t    transitions;            // Window state changes
+    uint32_t    acknowledged;           // Windows acknowledged
+    uint32_t    reset;                  // Windows reset
+    uint32_t    rejected;               // Process inputs refused because they aren't normal or alarm
+    uint32_t    last_us;                // Time taken by the last input, acknowledge or reset
+    uint32_t    max_us;
+} annunciator_stats_t;
+
+// Setup (core 0, after the windows are registered as indicators)
+void annunciator_initialize(void);
+bool annunciator_add_window(const char* window, const char* input);
+
+// Updates (core 0). Values are a JSON array, either ["normal"] or ["alarm"].
+// Both return true for entities that aren't process inputs. Values are checked
+// before they are stored in SNON, and set once SNON has them.
+bool annunciator_check_values(const char* eid, const char* values);
+bool annunciator_set_values(const char* eid, const char* values);
+void annunciator_acknowledge(void);
+void annunciator_reset(void);
+bool annunciator_set_sequence(uint8_t sequence, bool first_out);
+
+// Status
+uint8_t annunciator_get_sequence(void);
+bool annunciator_get_first_out(void);
+uint16_t annunciator_window_count(void);
+uint16_t annunciator_unacknowledged_count(void);
+uint16_t annunciator_waiting_reset_count(void);
+uint8_t annunciator_window_state(uint16_t window);
+const char* annunciator_state_name(uint8_t state);
+const char* annunciator_sequence_name(uint8_t sequence);
+const annunciator_stats_t* annunciator_get_stats(void);
+
+#endif // ANNUNCIATOR_H
@@ -0,0 +1,218 @@
+// ---------------------------------------------------------------------------------
+// Arena and pool allocators
+// ---------------------------------------------------------------------------------
+// Fixed-size allocators for SNON entity storage, values and per-command scratch
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+#include <stdio.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+
+#include "arena.h"
+
+// Constants
+#define VALUE_POOL_16_COUNT     256
+#define VALUE_POOL_32_COUNT     256
+#define VALUE_POOL_64_COUNT     64
+#define VALUE_POOL_256_COUNT    16
+
+// Global variables
+arena_t         boot_arena;
+arena_t         scratch_arena;
+pool_t          value_pools[VALUE_POOL_COUNT];
+
+// Backing storage
+uint32_t        boot_arena_storage[BOOT_ARENA_SIZE / 4];
+uint32_t        scratch_arena_storage[SCRATCH_ARENA_SIZE / 4];
+uint32_t        value_pool_16_storage[(16 * VALUE_POOL_16_COUNT) / 4];
+uint32_t        value_pool_32_storage[(32 * VALUE_POOL_32_COUNT) / 4];
+uint32_t        value_pool_64_storage[(64 * VALUE_POOL_64_COUNT) / 4];
+uint32_t        value_pool_256_storage[(256 * VALUE_POOL_256_COUNT) / 4];
+
+// =================================================================================
+// Arenas
+
+void arena_init(arena_t* arena, const char* name, void* base, uint32_t size)
+{
+    arena->name = name;
+    arena->base = (uint8_t*) base;
+    arena->size = size;
+    arena->used = 0;
+    arena->high_water = 0;
+    arena->failures = 0;
+}
+
+// Bump allocation, word aligned
+void* arena_alloc(arena_t* arena, uint32_t size)
+{
+    void*   block = NULL;
+
+    size = (size + 3) & ~3u;
+
+    if(arena->used + size > arena->size)
+    {
+        arena->failures = arena->failures + 1;
+        return(NULL);
+    }
+
+    block = &arena->base[arena->used];
+    arena->used = arena->used + size;
+
+    if(arena->used > arena->high_water)
+    {
+        arena->high_water = arena->used;
+    }
+
+    return(block);
+}
+
+char* arena_strdup(arena_t* arena, const char* string)
+{
+    uint32_t    length = strlen(string) + 1;
+    char*       copy = arena_alloc(arena, length);
+
+    if(copy != NULL)
+    {
+        memcpy(copy, string, length);
+    }
+
+    return(copy);
+}
+
+void arena_reset(arena_t* arena)
+{
+    arena->used = 0;
+}
+
+// =================================================================================
+// Pools
+
+void pool_init(pool_t* pool, const char* name, void* base, uint16_t block_size, uint16_t block_count)
+{
+    uint16_t    counter = 0;
+
+    pool->name = name;
+    pool->base = (uint8_t*) base;
+    pool->block_size = block_size;
+    pool->block_count = block_count;
+    pool->free_list = NULL;
+    pool->in_use = 0;
+    pool->high_water = 0;
+    pool->failures = 0;
+
+    // Thread every block onto the free list, lowest address first
+    counter = block_count;
+    while(counter != 0)
+    {
+        counter = counter - 1;
+
+        *(void**) &pool->base[counter * block_size] = pool->free_list;
+        pool->free_list = &pool->base[counter * block_size];
+    }
+}
+
+void* pool_alloc(pool_t* pool)
+{
+    void*   block = pool->free_list;
+
+    if(block == NULL)
+    {
+        pool->failures = pool->failures + 1;
+        return(NULL);
+    }
+
+    pool->free_list = *(void**) block;
+    pool->in_use = pool->in_use + 1;
+
+    if(pool->in_use > pool->high_water)
+    {
+        pool->high_water = pool->in_use;
+    }
+
+    return(block);
+}
+
+void pool_free(pool_t* pool, void* block)
+{
+    *(void**) block = pool->free_list;
+    pool->free_list = block;
+    pool->in_use = pool->in_use - 1;
+}
+
+// =================================================================================
+// Firmware allocators
+
+void arena_initialize(void)
+{
+    arena_init(&boot_arena, "Boot", boot_arena_storage, sizeof(boot_arena_storage));
+    arena_init(&scratch_arena, "Scratch", scratch_arena_storage, sizeof(scratch_arena_storage));
+
+    pool_init(&value_pools[0], "Values 16", value_pool_16_storage, 16, VALUE_POOL_16_COUNT);
+    pool_init(&value_pools[1], "Values 32", value_pool_32_storage, 32, VALUE_POOL_32_COUNT);
+    pool_init(&value_pools[2], "Values 64", value_pool_64_storage, 64, VALUE_POOL_64_COUNT);
+    pool_init(&value_pools[3], "Values 256", value_pool_256_storage, 256, VALUE_POOL_256_COUNT);
+}
+
+// Allocates a value string of up to length bytes (including the terminator)
+// from the smallest size class with a free block
+char* value_alloc(uint16_t length)
+{
+    char*   value = NULL;
+    uint8_t counter = 0;
+
+    while((value == NULL) && (counter != VALUE_POOL_COUNT))
+    {
+        if(value_pools[counter].block_size >= length)
+        {
+            value = pool_alloc(&value_pools[counter]);
+        }
+
+        counter = counter + 1;
+    }
+
+    return(value);
+}
+
+void value_free(char* value)
+{
+    uint8_t counter = 0;
+    pool_t* pool = NULL;
+
+    while(counter != VALUE_POOL_COUNT)
+    {
+        pool = &value_pools[counter];
+
+        if(((uint8_t*) value >= pool->base) && ((uint8_t*) value < pool->base + (pool->block_size * pool->block_count)))
+        {
+            pool_free(pool, value);
+            return;
+        }
+
+        counter = counter + 1;
+    }
+}
+
+// Returns the size of the block holding a value, or zero if it isn't from a pool
+uint16_t value_block_size(const char* value)
+{
+    uint8_t counter = 0;
+    pool_t* pool = NULL;
+
+    while(counter != VALUE_POOL_COUNT)
+    {
+        pool = &value_pools[counter];
+
+        if(((uint8_t*) value >= pool->base) && ((uint8_t*) value < pool->base + (pool->block_size * pool->block_count)))
+        {
+            return(pool->block_size);
+        }
+
+        counter = counter + 1;
+    }
+
+    return(0);
+}
@@ -0,0 +1,73 @@
+// ---------------------------------------------------------------------------------
+// Arena and pool allocators - Header
+// ---------------------------------------------------------------------------------
+// Fixed-size allocators for SNON entity storage, values and per-command scratch
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+
+#pragma once
+#ifndef ARENA_H
+#define ARENA_H
+
+#include "pico/stdlib.h"
+
+// Build options
+//  BOOT_ARENA_SIZE=<n>     Bytes for the entity table and the SNON JSON kept by the store
+#ifndef BOOT_ARENA_SIZE
+#define BOOT_ARENA_SIZE         65536       // Never freed
+#endif
+
+// Constants
+#define SCRATCH_ARENA_SIZE      4096        // Reset after every UART command
+#define VALUE_POOL_COUNT        4           // 16, 32, 64 and 256 byte value blocks
+#define VALUE_MAX_LENGTH        256
+
+// Types
+typedef struct
+{
+    const char* name;
+    uint8_t*    base;
+    uint32_t    size;
+    uint32_t    used;
+    uint32_t    high_water;
+    uint32_t    failures;
+} arena_t;
+
+typedef struct
+{
+    const char* name;
+    uint8_t*    base;
+    uint16_t    block_size;
+    uint16_t    block_count;
+    void*       free_list;
+    uint16_t    in_use;
+    uint16_t    high_water;
+    uint32_t    failures;
+} pool_t;
+
+// Allocators used by the firmware
+extern arena_t  boot_arena;
+extern arena_t  scratch_arena;
+extern pool_t   value_pools[VALUE_POOL_COUNT];
+
+// Arenas
+void arena_init(arena_t* arena, const char* name, void* base, uint32_t size);
+void* arena_alloc(arena_t* arena, uint32_t size);
+char* arena_strdup(arena_t* arena, const char* string);
+void arena_reset(arena_t* arena);
+
+// Pools
+void pool_init(pool_t* pool, const char* name, void* base, uint16_t block_size, uint16_t block_count);
+void* pool_alloc(pool_t* pool);
+void pool_free(pool_t* pool, void* block);
+
+// Firmware allocators
+void arena_initialize(void);
+char* value_alloc(uint16_t length);
+void value_free(char* value);
+uint16_t value_block_size(const char* value);
+
+#endif // ARENA_H
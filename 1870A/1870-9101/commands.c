@@ -0,0 +1,705 @@
+// ---------------------------------------------------------------------------------
+// Command registry
+// ---------------------------------------------------------------------------------
+// Serial terminal commands, kept in a table sorted by name. Each firmware
+// registers the shared commands, then any of its own.
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "hardware/rtc.h"
+
+#include "commands.h"
+#include "writer.h"
+#include "uart.h"
+#include "logger.h"
+#include "subscribe.h"
+#include "reply.h"
+#include "indicators.h"
+#include "ledstrip.h"
+#include "animation.h"
+#include "ledstats.h"
+#include "mem_utils.h"
+#include "arena.h"
+#include "store.h"
+#include "snon/snon_utils.h"
+
+// Constants
+#define COMMAND_HELP_WIDTH      22
+
+// Global variables
+command_t   commands[COMMAND_MAX];
+uint8_t     command_count = 0;
+
+// Private prototypes
+int16_t command_find(const char* name, uint16_t length);
+bool write_entities_next(writer_t* writer, uint32_t* cursor, const void* separator);
+bool command_help_next(writer_t* writer, uint32_t* cursor, const void* unused);
+bool command_ls_next(writer_t* writer, uint32_t* cursor, const void* unused);
+void command_help(writer_t* writer, const char* arguments);
+void command_clear(writer_t* writer, const char* arguments);
+void command_ls(writer_t* writer, const char* arguments);
+void command_cat(writer_t* writer, const char* arguments);
+void command_dump(writer_t* writer, const char* arguments);
+void command_get_mem(writer_t* writer, const char* arguments);
+void command_get_uart(writer_t* writer, const char* arguments);
+void command_get_log(writer_t* writer, const char* arguments);
+void command_get_leds(writer_t* writer, const char* arguments);
+void command_get_ledstats(writer_t* writer, const char* arguments);
+void command_log_level(writer_t* writer, const char* arguments);
+void command_get_time(writer_t* writer, const char* arguments);
+void command_set_time(writer_t* writer, const char* arguments);
+void command_get_subs(writer_t* writer, const char* arguments);
+void command_get_address(writer_t* writer, const char* arguments);
+void command_set_address(writer_t* writer, const char* arguments);
+void command_multidrop(writer_t* writer, const char* arguments);
+void command_exit(writer_t* writer, const char* arguments);
+
+// =================================================================================
+// Registry
+
+void commands_initialize(void)
+{
+    command_count = 0;
+
+    command_register("help", NULL, "Displays list of commands", command_help);
+    command_register("clear", NULL, "Clear the serial terminal", command_clear);
+    command_register("ls", NULL, "List SNON entites", command_ls);
+    command_register("cat", "<entity>", "Display the value of an SNON entity", command_cat);
+    command_register("dump", NULL, "Display all SNON entities", command_dump);
+    command_register("get mem", NULL, "Display free memory, arena, value pool and store usage", command_get_mem);
+    command_register("get uart", NULL, "Display serial statistics", command_get_uart);
+    command_register("get log", NULL, "Display logging statistics", command_get_log);
+    command_register("get leds", NULL, "Display indicator statistics", command_get_leds);
+    command_register("get ledstats", NULL, "Display LED timer jitter and timing histograms", command_get_ledstats);
+    command_register("log level", "<0-3>", "Set the logging level (error, warning, info, debug)", command_log_level);
+    command_register("get time", NULL, "Get the current time", command_get_time);
+    command_register("set time", "<iso8601>", "Set the current time", command_set_time);
+    command_register("get subs", NULL, "Display change subscriptions", command_get_subs);
+    command_register("get address", NULL, "Display the multi-drop address", command_get_address);
+    command_register("set address", "<hex>", "Set the multi-drop address", command_set_address);
+    command_register("multidrop", "<on|off>", "Only accept lines starting with \"@<address> \"", command_multidrop);
+    command_register("exit", NULL, "Leave command mode", command_exit);
+}
+
+// Adds a command, keeping the table sorted. A command registered under an
+// existing name replaces it, so a panel can provide its own version.
+bool command_register(const char* name, const char* usage, const char* help, command_handler_t handler)
+{
+    int16_t     index = command_find(name, strlen(name));
+    uint8_t     position = 0;
+
+    if(index == -1)
+    {
+        if(command_count == COMMAND_MAX)
+        {
+            return(false);
+        }
+
+        // Shift later names up to make room
+        position = command_count;
+        while((position != 0) && (strcmp(commands[position - 1].name, name) > 0))
+        {
+            commands[position] = commands[position - 1];
+            position = position - 1;
+        }
+
+        command_count = command_count + 1;
+        index = position;
+    }
+
+    commands[index].name = name;
+    commands[index].usage = usage;
+    commands[index].help = help;
+    commands[index].handler = handler;
+
+    return(true);
+}
+
+// Binary search for the first length characters of name. Returns -1 if not found.
+int16_t command_find(const char* name, uint16_t length)
+{
+    int16_t     low = 0;
+    int16_t     high = command_count - 1;
+    int16_t     middle = 0;
+    int         compare = 0;
+
+    while(low <= high)
+    {
+        middle = (low + high) / 2;
+        compare = strncmp(commands[middle].name, name, length);
+
+        // A longer name with the same start sorts after it
+        if((compare == 0) && (commands[middle].name[length] != 0))
+        {
+            compare = 1;
+        }
+
+        if(compare == 0)
+        {
+            return(middle);
+        }
+        else if(compare < 0)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle - 1;
+        }
+    }
+
+    return(-1);
+}
+
+// Runs the command with the longest name that matches the leading words of the
+// line. Returns false if there isn't one.
+bool command_dispatch(writer_t* writer, const char* line)
+{
+    uint16_t    length = strlen(line);
+    int16_t     index = 0;
+    const char* arguments = NULL;
+
+    while(length != 0)
+    {
+        index = command_find(line, length);
+
+        if(index != -1)
+        {
+            arguments = &line[length];
+            while(*arguments == ' ')
+            {
+                arguments = arguments + 1;
+            }
+
+            commands[index].handler(writer, arguments);
+            return(true);
+        }
+
+        // Drop the last word and try again
+        while((length != 0) && (line[length - 1] != ' '))
+        {
+            length = length - 1;
+        }
+
+        while((length != 0) && (line[length - 1] == ' '))
+        {
+            length = length - 1;
+        }
+    }
+
+    return(false);
+}
+
+// =================================================================================
+// Shared helpers
+
+// Writes out the SNON JSON of an entity, given by eID or name, from the store
+bool write_entity_json(writer_t* writer, const char* entity)
+{
+    return(store_write_json(writer, store_find(entity), true));
+}
+
+// Writes entities from the cursor on, with the separator between them, until
+// the writer is busy. Returns true once the array has been closed.
+bool write_entities_next(writer_t* writer, uint32_t* cursor, const void* separator)
+{
+    while(*cursor != store_get_count())
+    {
+        if(writer_busy(writer) == true)
+        {
+            return(false);
+        }
+
+        if(*cursor != 0)
+        {
+            writer_puts(writer, (const char*) separator);
+        }
+
+        store_write_json(writer, *cursor, true);
+
+        *cursor = *cursor + 1;
+    }
+
+    writer_putc(writer, ']');
+
+    return(true);
+}
+
+// Writes out a JSON array of every entity, in the order of the SNON "Entities"
+// list, with the separator between them. Each entity is written straight from
+// the store, so nothing is allocated however many entities there are. Whatever
+// the TX ring has no room for is finished from the command loop, so the
+// separator has to be a constant.
+void write_entities_json(writer_t* writer, const char* separator)
+{
+    uint32_t    cursor = 0;
+
+    writer_putc(writer, '[');
+
+    if(write_entities_next(writer, &cursor, separator) == false)
+    {
+        writer_defer(writer, write_entities_next, cursor, separator);
+    }
+}
+
+// =================================================================================
+// Shared commands
+
+// One line per command, from the cursor on, until the writer is busy
+bool command_help_next(writer_t* writer, uint32_t* cursor, const void* unused)
+{
+    uint16_t    length = 0;
+
+    (void) unused;
+
+    while(*cursor != command_count)
+    {
+        if(writer_busy(writer) == true)
+        {
+            return(false);
+        }
+
+        writer_puts(writer, "\r\n\"");
+        writer_puts(writer, commands[*cursor].name);
+        length = strlen(commands[*cursor].name) + 2;
+
+        if(commands[*cursor].usage != NULL)
+        {
+            writer_putc(writer, ' ');
+            writer_puts(writer, commands[*cursor].usage);
+            length = length + strlen(commands[*cursor].usage) + 1;
+        }
+
+        writer_putc(writer, '"');
+
+        while(length < COMMAND_HELP_WIDTH)
+        {
+            writer_putc(writer, ' ');
+            length = length + 1;
+        }
+
+        writer_puts(writer, " - ");
+        writer_puts(writer, commands[*cursor].help);
+
+        *cursor = *cursor + 1;
+    }
+
+    return(true);
+}
+
+void command_help(writer_t* writer, const char* arguments)
+{
+    uint32_t    cursor = 0;
+
+    (void) arguments;
+
+    writer_puts(writer, "\r\nCommands:");
+
+    if(command_help_next(writer, &cursor, NULL) == false)
+    {
+        writer_defer(writer, command_help_next, cursor, NULL);
+    }
+}
+
+void command_clear(writer_t* writer, const char* arguments)
+{
+    (void) arguments;
+
+    writer_puts(writer, "\033[2J\033[H");
+}
+
+// One line per entity, from the cursor on, until the writer is busy
+bool command_ls_next(writer_t* writer, uint32_t* cursor, const void* unused)
+{
+    (void) unused;
+
+    while(*cursor != store_get_count())
+    {
+        if(writer_busy(writer) == true)
+        {
+            return(false);
+        }
+
+        writer_puts(writer, store_get_eid(*cursor));
+        writer_puts(writer, " - ");
+        writer_puts(writer, store_get_name(*cursor));
+        writer_putc(writer, '\n');
+
+        *cursor = *cursor + 1;
+    }
+
+    return(true);
+}
+
+void command_ls(writer_t* writer, const char* arguments)
+{
+    uint32_t    cursor = 0;
+
+    (void) arguments;
+
+    writer_putc(writer, '\n');
+
+    if(command_ls_next(writer, &cursor, NULL) == false)
+    {
+        writer_defer(writer, command_ls_next, cursor, NULL);
+    }
+}
+
+void command_cat(writer_t* writer, const char* arguments)
+{
+    uint8_t mode = writer->mode;
+
+    writer_puts(writer, "\r\n");
+
+    // Break the entity onto one line per field
+    writer->mode = WRITER_MODE_COMMA_BREAK;
+
+    if(write_entity_json(writer, arguments) == true)
+    {
+        writer->mode = mode;
+        writer_puts(writer, "\r\n");
+    }
+    else
+    {
+        writer->mode = mode;
+        writer_puts(writer, "Entity not found\r\n");
+    }
+}
+
+// One entity per line, in the same array that "{}" returns
+void command_dump(writer_t* writer, const char* arguments)
+{
+    (void) arguments;
+
+    writer_putc(writer, '\n');
+    write_entities_json(writer, ",\r\n");
+    writer_putc(writer, '\n');
+}
+
+// Shows the free heap, along with the boot and scratch arenas, the value pools
+// and the value store
+void command_get_mem(writer_t* writer, const char* arguments)
+{
+    char    buffer[COMMAND_BUFFER_SIZE];
+    uint8_t pool = 0;
+
+    (void) arguments;
+
+    snprintf(buffer, COMMAND_BUFFER_SIZE, "\r\nFree memory: %lu bytes", get_free_ram_2());
+    writer_puts(writer, buffer);
+    snprintf(buffer, COMMAND_BUFFER_SIZE, "\r\n%s arena: %lu of %lu bytes, %lu failed", boot_arena.name, boot_arena.used, boot_arena.size, boot_arena.failures);
+    writer_puts(writer, buffer);
+    snprintf(buffer, COMMAND_BUFFER_SIZE, "\r\n%s arena: %lu of %lu bytes peak, %lu failed", scratch_arena.name, scratch_arena.high_water, scratch_arena.size, scratch_arena.failures);
+    writer_puts(writer, buffer);
+
+    while(pool != VALUE_POOL_COUNT)
+    {
+        snprintf(buffer, COMMAND_BUFFER_SIZE, "\r\n%s: %u of %u in use (peak %u), %lu failed", value_pools[pool].name, value_pools[pool].in_use, value_pools[pool].block_count, value_pools[pool].high_water, value_pools[pool].failures);
+        writer_puts(writer, buffer);
+
+        pool = pool + 1;
+    }
+
+    snprintf(buffer, COMMAND_BUFFER_SIZE, "\r\nValue store: %u entities, %lu sets, %lu refused", store_get_count(), store_get_stats()->sets, store_get_stats()->refused);
+    writer_puts(writer, buffer);
+    writer_puts(writer, "\r\n");
+}
+
+void command_get_uart(writer_t* writer, const char* arguments)
+{
+    const uart_stats_t* stats = uart_get_stats();
+    char                buffer[COMMAND_BUFFER_SIZE];
+
+    (void) arguments;
+
+    snprintf(buffer, COMMAND_BUFFER_SIZE, "\r\nReceived: %lu bytes, %lu lines", stats->rx_bytes, stats->lines);
+    writer_puts(writer, buffer);
+    snprintf(buffer, COMMAND_BUFFER_SIZE, "\r\nReceive ring: %lu bytes peak", stats->rx_high_water);
+    writer_puts(writer, buffer);
+    snprintf(buffer, COMMAND_BUFFER_SIZE, "\r\nLines dropped: %lu ring full, %lu queue full, %lu too long", stats->rx_overflows, stats->line_overflows, stats->lines_truncated);
+    writer_puts(writer, buffer);
+    snprintf(buffer, COMMAND_BUFFER_SIZE, "\r\nLines for other panels: %lu", stats->lines_other);
+    writer_puts(writer, buffer);
+    snprintf(buffer, COMMAND_BUFFER_SIZE, "\r\nTransmit ring: %lu bytes peak, %lu stalls, %lu deferred", stats->tx_high_water, stats->tx_stalls, stats->tx_deferred);
+    writer_puts(writer, buffer);
+    snprintf(buffer, COMMAND_BUFFER_SIZE, "\r\nLongest command loop gap: %lu us\r\n", stats->loop_gap_max_us);
+    writer_puts(writer, buffer);
+}
+
+void command_get_log(writer_t* writer, const char* arguments)
+{
+    const logger_stats_t*   stats = NULL;
+    uint8_t                 core = 0;
+    char                    buffer[COMMAND_BUFFER_SIZE];
+
+    (void) arguments;
+
+    snprintf(buffer, COMMAND_BUFFER_SIZE, "\r\nLog level: %u", logger_get_level());
+    writer_puts(writer, buffer);
+
+    while(core != 2)
+    {
+        stats = logger_get_stats(core);
+        snprintf(buffer, COMMAND_BUFFER_SIZE, "\r\nCore %u: %lu queued, %lu printed, %lu dropped, %lu filtered", core, stats->queued, stats->printed, stats->dropped, stats->filtered);
+        writer_puts(writer, buffer);
+        core = core + 1;
+    }
+
+    writer_puts(writer, "\r\n");
+}
+
+void command_get_leds(writer_t* writer, const char* arguments)
+{
+    const indicator_stats_t*    stats = indicator_get_stats();
+    const ledstrip_stats_t*     strip_stats = ledstrip_get_stats();
+    const animation_stats_t*    fade_stats = animation_get_stats();
+    const ledstrip_t*           strip = NULL;
+    uint32_t                    average_us = 0;
+    uint32_t                    recomputed = 0;         // Hundredths of an indicator per frame
+    uint32_t                    running = 0;            // Hundredths of a fade per frame
+    uint8_t                     counter = 0;
+    char                        buffer[COMMAND_BUFFER_SIZE];
+
+    (void) arguments;
+
+    if(stats->frames != 0)
+    {
+        average_us = stats->total_us / stats->frames;
+        recomputed = ((uint64_t) stats->recomputed * 100) / stats->frames;
+    }
+
+    if(fade_stats->frames != 0)
+    {
+        running = ((uint64_t) fade_stats->running * 100) / fade_stats->frames;
+    }
+
+    snprintf(buffer, COMMAND_BUFFER_SIZE, "\r\nFrames: %lu, %lu unchanged and not sent", stats->frames, stats->unchanged);
+    writer_puts(writer, buffer);
+    snprintf(buffer, COMMAND_BUFFER_SIZE, "\r\nIndicators recomputed: %lu.%02lu per frame", recomputed / 100, recomputed % 100);
+    writer_puts(writer, buffer);
+    snprintf(buffer, COMMAND_BUFFER_SIZE, "\r\nColour time: %lu us last, %lu us average, %lu us max", stats->last_us, average_us, stats->max_us);
+    writer_puts(writer, buffer);
+    snprintf(buffer, COMMAND_BUFFER_SIZE, "\r\nFades: %lu.%02lu per frame, %lu us last, %lu us max", running / 100, running % 100, fade_stats->last_us, fade_stats->max_us);
+    writer_puts(writer, buffer);
+    snprintf(buffer, COMMAND_BUFFER_SIZE, "\r\nFade frames over %u us budget: %lu", ANIMATION_BUDGET_US, fade_stats->over_budget);
+    writer_puts(writer, buffer);
+    snprintf(buffer, COMMAND_BUFFER_SIZE, "\r\nLED timer: %lu us last, %lu us max", strip_stats->last_us, strip_stats->max_us);
+    writer_puts(writer, buffer);
+
+    while(counter != ledstrip_get_count())
+    {
+        strip = ledstrip_get(counter);
+        snprintf(buffer, COMMAND_BUFFER_SIZE, "\r\nStrip on pin %u: %lu frames sent, %lu skipped while busy", strip->pin, strip->frames, strip->skipped);
+        writer_puts(writer, buffer);
+        counter = counter + 1;
+    }
+
+    snprintf(buffer, COMMAND_BUFFER_SIZE, "\r\nInvalid states refused: %lu\r\n", stats->rejected);
+    writer_puts(writer, buffer);
+}
+
+void command_get_ledstats(writer_t* writer, const char* arguments)
+{
+    const ledstats_histogram_t* stats = NULL;
+    uint32_t                    average_us = 0;
+    char                        buffer[COMMAND_BUFFER_SIZE];
+    uint8_t                     histogram = 0;
+    uint8_t                     bucket = 0;
+
+    (void) arguments;
+
+    while(histogram != LEDSTATS_COUNT)
+    {
+        stats = ledstats_get(histogram);
+        average_us = 0;
+
+        if(stats->count != 0)
+        {
+            average_us = stats->total_us / stats->count;
+        }
+
+        snprintf(buffer, COMMAND_BUFFER_SIZE, "\r\n%s: %lu samples, %lu us last, %lu us average, %lu us max", stats->name, stats->count, stats->last_us, average_us, stats->max_us);
+        writer_puts(writer, buffer);
+
+        // Only the buckets that were used
+        bucket = 0;
+        while(bucket != LEDSTATS_BUCKETS)
+        {
+            if(stats->buckets[bucket] != 0)
+            {
+                if(bucket == LEDSTATS_BUCKETS - 1)
+                {
+                    snprintf(buffer, COMMAND_BUFFER_SIZE, "\r\n  %6lu us and up: %lu", 1UL << bucket, stats->buckets[bucket]);
+                }
+                else
+                {
+                    snprintf(buffer, COMMAND_BUFFER_SIZE, "\r\n  %6lu-%lu us: %lu", (bucket == 0) ? 0 : 1UL << bucket, (2UL << bucket) - 1, stats->buckets[bucket]);
+                }
+
+                writer_puts(writer, buffer);
+            }
+
+            bucket = bucket + 1;
+        }
+
+        histogram = histogram + 1;
+    }
+
+    writer_puts(writer, "\r\n");
+}
+
+void command_log_level(writer_t* writer, const char* arguments)
+{
+    int     level = 0;
+    char    buffer[COMMAND_BUFFER_SIZE];
+
+    if((sscanf(arguments, "%d", &level) == 1) && (level >= LOGGER_ERROR) && (level <= LOGGER_DEBUG))
+    {
+        logger_set_level(level);
+        snprintf(buffer, COMMAND_BUFFER_SIZE, "\r\nLog level set to %d\r\n", level);
+        writer_puts(writer, buffer);
+    }
+    else
+    {
+        writer_puts(writer, "\r\nInvalid log level. Must be between 0 and 3\r\n");
+    }
+}
+
+void command_get_time(writer_t* writer, const char* arguments)
+{
+    char    buffer[COMMAND_BUFFER_SIZE];
+
+    (void) arguments;
+
+    if(rtc_counter_to_iso8601(buffer, time_us_64()) == true)
+    {
+        writer_puts(writer, "\r\nThe time is: ");
+        writer_puts(writer, buffer);
+    }
+    else
+    {
+        writer_puts(writer, "\r\nRTC not running. Use the \"set time\" command to set the current time.");
+    }
+}
+
+void command_set_time(writer_t* writer, const char* arguments)
+{
+    unsigned int    year = 0;
+    unsigned int    month = 0;
+    unsigned int    day = 0;
+    unsigned int    hours = 0;
+    unsigned int    minutes = 0;
+    unsigned int    seconds = 0;
+    char            buffer[COMMAND_BUFFER_SIZE];
+
+    sscanf(arguments, "%4u-%2u-%2uT%2u:%2u:%2uZ", &year, &month, &day, &hours, &minutes, &seconds);
+
+    if(year < 2022 || year > 2055)
+    {
+        snprintf(buffer, COMMAND_BUFFER_SIZE, "\r\nInvalid year %04u. Must be between 2022 and 2055", year);
+    }
+    else if(month < 1 || month > 12)
+    {
+        snprintf(buffer, COMMAND_BUFFER_SIZE, "\r\nInvalid month %02u. Must be between 1 and 12", month);
+    }
+    else if(day < 1 || day > 31)
+    {
+        snprintf(buffer, COMMAND_BUFFER_SIZE, "\r\nInvalid day %02u. Must be between 1 and 31", day);
+    }
+    else if(hours > 23)
+    {
+        snprintf(buffer, COMMAND_BUFFER_SIZE, "\r\nInvalid hour %02u. Must be between 0 and 23", hours);
+    }
+    else if(minutes > 59)
+    {
+        snprintf(buffer, COMMAND_BUFFER_SIZE, "\r\nInvalid minute %02u. Must be between 0 and 59", minutes);
+    }
+    else if(seconds > 59)
+    {
+        snprintf(buffer, COMMAND_BUFFER_SIZE, "\r\nInvalid second %02u. Must be between 0 and 59", seconds);
+    }
+    else
+    {
+        snprintf(buffer, COMMAND_BUFFER_SIZE, "%04u-%02u-%02uT%02u:%02u:%02uZ", year, month, day, hours, minutes, seconds);
+
+        if(rtc_set_time(buffer) == true)
+        {
+            writer_puts(writer, "\r\nTime set to ");
+        }
+        else
+        {
+            writer_puts(writer, "\r\nError setting time to ");
+        }
+
+        sleep_us(64);
+    }
+
+    writer_puts(writer, buffer);
+}
+
+void command_get_subs(writer_t* writer, const char* arguments)
+{
+    (void) arguments;
+
+    subscribe_list(writer);
+}
+
+void command_get_address(writer_t* writer, const char* arguments)
+{
+    char    buffer[COMMAND_BUFFER_SIZE];
+
+    (void) arguments;
+
+    snprintf(buffer, COMMAND_BUFFER_SIZE, "\r\nAddress: %04X, multi-drop %s\r\n", uart_get_address(), (uart_in_multidrop_mode() == true) ? "on" : "off");
+    writer_puts(writer, buffer);
+}
+
+void command_set_address(writer_t* writer, const char* arguments)
+{
+    unsigned int    address = 0;
+
+    if((sscanf(arguments, "%4x", &address) == 1) && (strlen(arguments) <= UART_ADDRESS_LENGTH))
+    {
+        uart_set_address(address);
+        command_get_address(writer, "");
+    }
+    else
+    {
+        writer_puts(writer, "\r\nInvalid address. Must be up to four hex digits\r\n");
+    }
+}
+
+void command_multidrop(writer_t* writer, const char* arguments)
+{
+    if(strcmp(arguments, "on") == 0)
+    {
+        uart_set_multidrop_mode(true);
+    }
+    else if(strcmp(arguments, "off") == 0)
+    {
+        uart_set_multidrop_mode(false);
+    }
+    else
+    {
+        writer_puts(writer, "\r\nUsage: multidrop <on|off>\r\n");
+        return;
+    }
+
+    command_get_address(writer, "");
+}
+
+void command_exit(writer_t* writer, const char* arguments)
+{
+    (void) arguments;
+
+    // Anything already written goes out before the exit message
+    writer_flush(writer);
+    uart_command_exit();
+}
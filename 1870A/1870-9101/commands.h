@@ -0,0 +1,45 @@
+// ---------------------------------------------------------------------------------
+// Command registry - Header
+// ---------------------------------------------------------------------------------
+// Serial terminal commands, kept in a table sorted by name. Each firmware
+// registers the shared commands, then any of its own.
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+
+#pragma once
+#ifndef COMMANDS_H
+#define COMMANDS_H
+
+#include "pico/stdlib.h"
+#include "writer.h"
+
+// Constants
+#define COMMAND_MAX             32
+#define COMMAND_BUFFER_SIZE     80
+
+// Types
+
+// Called with everything after the command name, with leading spaces removed
+typedef void (*command_handler_t)(writer_t* writer, const char* arguments);
+
+typedef struct
+{
+    const char*         name;           // One or more words, e.g. "get time"
+    const char*         usage;          // Arguments shown in the help, or NULL
+    const char*         help;
+    command_handler_t   handler;
+} command_t;
+
+// Registry
+void commands_initialize(void);
+bool command_register(const char* name, const char* usage, const char* help, command_handler_t handler);
+bool command_dispatch(writer_t* writer, const char* line);
+
+// Shared helpers
+bool write_entity_json(writer_t* writer, const char* entity);
+void write_entities_json(writer_t* writer, const char* separator);
+
+#endif // COMMANDS_H
@@ -0,0 +1,37 @@
+// ---------------------------------------------------------------------------------
+// LED map - Generated by 1840-9110/led-map.rb from front_panel_leds.csv. Do not edit.
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+
+#pragma once
+#ifndef FRONT_PANEL_LEDS_H
+#define FRONT_PANEL_LEDS_H
+
+#include "ledmap.h"
+
+#define FRONT_PANEL_LEDS_PIXELS      270
+#define FRONT_PANEL_LEDS_ENTRIES     15
+
+static const ledmap_entry_t front_panel_leds[FRONT_PANEL_LEDS_ENTRIES] =
+{
+    { "=P01=PFA01",                    0,    18,  LEDMAP_FULL },
+    { "=P01=PFA02",                    18,   18,  LEDMAP_FULL },
+    { "=P01=PFA03",                    36,   18,  LEDMAP_FULL },
+    { "=P01=PFA04",                    54,   18,  LEDMAP_FULL },
+    { "=P01=PFA05",                    72,   18,  LEDMAP_FULL },
+    { "=P01=PFA06",                    90,   18,  LEDMAP_FULL },
+    { "=P01=PFA07",                    108,  18,  LEDMAP_FULL },
+    { "=P01=PFA08",                    126,  18,  LEDMAP_FULL },
+    { "=P01=PFA09",                    144,  18,  LEDMAP_FULL },
+    { "=P01=PFA10",                    162,  18,  LEDMAP_FULL },
+    { "=P01=PFA11",                    180,  18,  LEDMAP_FULL },
+    { "=P01=PFA12",                    198,  18,  LEDMAP_FULL },
+    { "=P01=PFA13",                    216,  18,  LEDMAP_FULL },
+    { "=P01=PFA14",                    234,  18,  LEDMAP_FULL },
+    { "=P01=PFA15",                    252,  18,  LEDMAP_FULL }
+};
+
+#endif // FRONT_PANEL_LEDS_H
@@ -0,0 +1,82 @@
+// ---------------------------------------------------------------------------------
+// VITA 40 indicators - Header
+// ---------------------------------------------------------------------------------
+// Indicator states are checked and turned into a small state number when they
+// are set, so the LED timer only has to look up a colour in a blink table
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+
+#pragma once
+#ifndef INDICATORS_H
+#define INDICATORS_H
+
+#include "pico/stdlib.h"
+#include "json_tok.h"
+
+// States
+#define INDICATOR_OFF               0
+#define INDICATOR_RED_STEADY        1
+#define INDICATOR_WHITE_STEADY      2
+#define INDICATOR_WHITE_FAST        3
+#define INDICATOR_BLUE_STEADY       4
+#define INDICATOR_AMBER_STEADY      5
+#define INDICATOR_AMBER_SLOW        6
+#define INDICATOR_GREEN_STEADY      7
+#define INDICATOR_GREEN_SLOW        8
+#define INDICATOR_GREEN_STANDBY     9
+#define INDICATOR_GREEN_FEEDBACK    10
+#define INDICATOR_STATE_COUNT       11
+#define INDICATOR_STATE_INVALID     0xFF
+
+// Constants
+#define INDICATOR_MAX_COUNT         112
+#define INDICATOR_NONE              0xFFFF
+#define INDICATOR_PHASE_COUNT       10      // Phases in one blink cycle
+#define INDICATOR_PHASE_MS          100     // Length of a phase
+#define INDICATOR_VALUES_LENGTH     48      // Longest values array that can hold a state
+
+// Types
+typedef uint16_t indicator_handle_t;
+
+typedef struct
+{
+    uint32_t    frames;
+    uint32_t    unchanged;          // Frames that matched the last one, so weren't sent
+    uint32_t    recomputed;         // Colours worked out, over all frames
+    uint32_t    last_us;            // Time taken to work out the colours of the last frame
+    uint32_t    max_us;
+    uint64_t    total_us;
+    uint32_t    rejected;           // Values refused because they aren't a state
+} indicator_stats_t;
+
+// Setup (core 0, before the LED timer is started)
+void indicators_initialize(void);
+indicator_handle_t indicator_register(const char* name);
+
+// States
+uint8_t indicator_parse(const char* state);
+const char* indicator_state_name(uint8_t state);
+
+// Updates (core 0). Values are a JSON array, such as ["vita40_red_steady"].
+// All return true for entities that aren't indicators. Values are checked
+// before they are stored, and set once the store has them.
+bool indicator_check_values(const char* eid, const char* values);
+bool indicator_check_tokens(const char* eid, const char* json, const json_tok_t* tokens, int16_t count, int16_t values);
+bool indicator_set_values(const char* eid, const char* values);
+indicator_handle_t indicator_find_eid(const char* eid);
+bool indicator_set_state(indicator_handle_t handle, uint8_t state);
+uint8_t indicator_get_state(indicator_handle_t handle);
+
+// LED timer
+uint8_t indicator_phase(uint32_t counter);
+bool indicator_needs_update(indicator_handle_t handle, uint8_t phase, bool new_phase);
+uint32_t indicator_colour(indicator_handle_t handle, uint8_t phase);
+uint32_t indicator_state_colour(uint8_t state, uint8_t phase);
+uint16_t indicator_fade_ms(indicator_handle_t handle);
+void indicator_frame_done(uint32_t elapsed_us, uint16_t recomputed, bool changed);
+const indicator_stats_t* indicator_get_stats(void);
+
+#endif // INDICATORS_H
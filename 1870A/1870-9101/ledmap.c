@@ -0,0 +1,216 @@
+// ---------------------------------------------------------------------------------
+// LED maps
+// ---------------------------------------------------------------------------------
+// Draws indicators onto an LED chain from a table of pixel runs, so that each
+// panel only has to provide its map
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+
+#include "ledmap.h"
+
+// Private prototypes
+uint32_t ledmap_scale(uint32_t colour, uint8_t brightness);
+
+// =================================================================================
+// Setup
+
+// Registers the indicator of every entry, and checks that the runs cover every
+// pixel once. Returns false if they don't, in which case the chain is drawn off.
+bool ledmap_initialize(ledmap_t* map)
+{
+    const ledmap_entry_t*   entry = NULL;
+    uint16_t                counter = 0;
+    uint16_t                next_pixel = 0;
+
+    map->redraw = true;
+    map->phase = INDICATOR_PHASE_COUNT;
+
+    while(counter != map->entry_count)
+    {
+        entry = &map->entries[counter];
+
+        if(entry->first != next_pixel)
+        {
+            printf("LED map entry %u starts at pixel %u, expected %u\n", counter, entry->first, next_pixel);
+            map->entry_count = 0;
+            return(false);
+        }
+
+        if(entry->name != NULL)
+        {
+            map->handles[counter] = indicator_register(entry->name);
+        }
+        else
+        {
+            map->handles[counter] = INDICATOR_NONE;
+        }
+
+        map->colours[counter] = LEDSTRIP_WORD(indicator_state_colour(INDICATOR_OFF, 0));
+
+        if(map->animations != NULL)
+        {
+            animation_hold(&map->animations[counter], map->colours[counter]);
+        }
+
+        next_pixel = next_pixel + entry->count;
+        counter = counter + 1;
+    }
+
+    if(next_pixel != map->pixel_count)
+    {
+        printf("LED map covers %u pixels, expected %u\n", next_pixel, map->pixel_count);
+        map->entry_count = 0;
+        return(false);
+    }
+
+    return(true);
+}
+
+// Sends each entry as one run of a run-length strip, which needs a run for every
+// entry. The colours from ledmap_update() are then passed to ledstrip_show_runs().
+// A refused map sets no runs, so the chain is left off.
+bool ledmap_runs(const ledmap_t* map, ledstrip_t* strip)
+{
+    uint16_t    counter = 0;
+
+    if(map->entry_count > strip->run_count)
+    {
+        printf("LED map has %u entries, but the strip only has %u runs\n", map->entry_count, strip->run_count);
+        return(false);
+    }
+
+    while(counter != map->entry_count)
+    {
+        ledstrip_set_run(strip, counter, map->entries[counter].count);
+        counter = counter + 1;
+    }
+
+    return(true);
+}
+
+// =================================================================================
+// LED timer
+
+// Scales the three colour bytes, whatever order the chain wants them in
+uint32_t ledmap_scale(uint32_t colour, uint8_t brightness)
+{
+    uint32_t    scaled = 0;
+    uint8_t     shift = 0;
+
+    while(shift != 24)
+    {
+        scaled = scaled | (((((colour >> shift) & 0xFF) * brightness) / LEDMAP_FULL) << shift);
+        shift = shift + 8;
+    }
+
+    return(scaled);
+}
+
+// Works out the colours that may have changed since the last frame, leaving one
+// for each entry in map->colours. Returns false if none did. The LED timer may
+// run several frames per phase, and blinking indicators are only looked at on
+// the first of them.
+bool ledmap_update(ledmap_t* map, uint8_t phase)
+{
+    const ledmap_entry_t*   entry = map->entries;
+    uint32_t                colour = 0;
+    uint16_t                counter = 0;
+    bool                    changed = map->redraw;
+    bool                    new_phase = (phase != map->phase);
+
+    map->recomputed = 0;
+    map->phase = phase;
+
+    while(counter != map->entry_count)
+    {
+        if(indicator_needs_update(map->handles[counter], phase, new_phase) == true)
+        {
+            colour = indicator_colour(map->handles[counter], phase);
+
+            if(entry[counter].brightness != LEDMAP_FULL)
+            {
+                colour = ledmap_scale(colour, entry[counter].brightness);
+            }
+
+            colour = LEDSTRIP_WORD(colour);
+            map->recomputed = map->recomputed + 1;
+
+            if(map->animations != NULL)
+            {
+                animation_start(&map->animations[counter], map->colours[counter], colour, indicator_fade_ms(map->handles[counter]));
+            }
+            else if(colour != map->colours[counter])
+            {
+                map->colours[counter] = colour;
+                changed = true;
+            }
+        }
+
+        counter = counter + 1;
+    }
+
+    // Fades change the colours in one pass over the map
+    if((map->animations != NULL) && (animation_step(map->animations, map->colours, map->entry_count) == true))
+    {
+        changed = true;
+    }
+
+    map->redraw = false;
+
+    return(changed);
+}
+
+// Returns false, leaving the frame alone, if no colour changed. Otherwise the
+// whole frame is drawn, as a double buffered strip hands back the buffer from two
+// frames ago.
+bool ledmap_render(ledmap_t* map, uint8_t phase, uint32_t* frame)
+{
+    const ledmap_entry_t*   entry = map->entries;
+    uint32_t                colour = 0;
+    uint32_t*               pixel = frame;
+    uint32_t*               run_end = NULL;
+    uint16_t                counter = 0;
+
+    if(ledmap_update(map, phase) == false)
+    {
+        return(false);
+    }
+
+    while(counter != map->entry_count)
+    {
+        colour = map->colours[counter];
+
+        run_end = pixel + entry[counter].count;
+        while(pixel != run_end)
+        {
+            *pixel = colour;
+            pixel = pixel + 1;
+        }
+
+        counter = counter + 1;
+    }
+
+    // Only left over if the map was refused
+    run_end = frame + map->pixel_count;
+    while(pixel != run_end)
+    {
+        *pixel = LEDSTRIP_WORD(indicator_state_colour(INDICATOR_OFF, phase));
+        pixel = pixel + 1;
+    }
+
+    return(true);
+}
+
+// Has the next frame drawn in full, such as when the last one couldn't be sent
+void ledmap_invalidate(ledmap_t* map)
+{
+    map->redraw = true;
+}
@@ -0,0 +1,61 @@
+// ---------------------------------------------------------------------------------
+// LED maps - Header
+// ---------------------------------------------------------------------------------
+// An LED map lists which indicator is drawn on each run of pixels in an LED
+// chain. Maps are generated from a CSV file by 1840-9110/led-map.rb.
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+
+#pragma once
+#ifndef LEDMAP_H
+#define LEDMAP_H
+
+#include "pico/stdlib.h"
+#include "indicators.h"
+#include "ledstrip.h"
+#include "animation.h"
+
+// Constants
+#define LEDMAP_FULL             255     // Brightness that leaves colours unchanged
+
+// Types
+typedef struct
+{
+    const char* name;                   // Indicator entity, or NULL for pixels that are always off
+    uint16_t    first;                  // First pixel of the run
+    uint16_t    count;                  // Pixels in the run
+    uint8_t     brightness;             // Out of LEDMAP_FULL
+} ledmap_entry_t;
+
+typedef struct
+{
+    const ledmap_entry_t*   entries;    // In pixel order, covering every pixel once
+    uint16_t                entry_count;
+    uint16_t                pixel_count;
+    indicator_handle_t*     handles;    // One for each entry, filled in by ledmap_initialize()
+    uint32_t*               colours;    // One for each entry, as last drawn
+    animation_t*            animations; // One for each entry to fade between colours, or NULL
+    uint16_t                recomputed; // Colours worked out for the last frame
+    bool                    redraw;     // Draw the next frame even if no colour changed
+    uint8_t                 phase;      // Blink phase of the last frame
+} ledmap_t;
+
+// Setup (core 0, after indicators_initialize() and before the LED timer is started).
+// Animated maps also need animation_initialize(), and are drawn every
+// ANIMATION_FRAME_MS.
+bool ledmap_initialize(ledmap_t* map);
+
+// Sets up a run-length strip, after ledmap_initialize()
+bool ledmap_runs(const ledmap_t* map, ledstrip_t* strip);
+
+// LED timer. Frame must hold pixel_count words, and is filled in the
+// LEDSTRIP_WORD() format. Returns false if the frame hasn't changed. Run-length
+// strips only need ledmap_update(), and are sent map->colours.
+bool ledmap_update(ledmap_t* map, uint8_t phase);
+bool ledmap_render(ledmap_t* map, uint8_t phase, uint32_t* frame);
+void ledmap_invalidate(ledmap_t* map);
+
+#endif // LEDMAP_H
@@ -0,0 +1,162 @@
+// ---------------------------------------------------------------------------------
+// LED timing statistics
+// ---------------------------------------------------------------------------------
+// Histograms of how late each LED timer tick starts, how long it takes to work
+// out the frame, and how long the frame takes to send and latch
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+
+#include "ledstats.h"
+#include "subscribe.h"
+#include "store.h"
+#include "snon/snon_utils.h"
+
+// Global variables
+ledstats_histogram_t    ledstats[LEDSTATS_COUNT] =
+{
+    { "LED Timer Jitter", { 0 }, 0, 0, 0, 0, 0 },
+    { "LED Frame Compute Time", { 0 }, 0, 0, 0, 0, 0 },
+    { "LED Frame Transmit Time", { 0 }, 0, 0, 0, 0, 0 }
+};
+
+uint32_t    ledstats_due_us = 0;            // When the next tick should start
+bool        ledstats_started = false;
+uint32_t    ledstats_published_us = 0;
+
+// =================================================================================
+// Setup
+
+void ledstats_initialize(void)
+{
+    uint8_t     histogram = 0;
+
+    while(histogram != LEDSTATS_COUNT)
+    {
+        snon_register((char*) ledstats[histogram].name, SNON_CLASS_VALUE, NULL);
+        snon_add_relationship((char*) ledstats[histogram].name, SNON_REL_CHILD_OF, "Device");
+        histogram = histogram + 1;
+    }
+
+    ledstats_published_us = time_us_32();
+}
+
+// =================================================================================
+// LED timer and DMA interrupts
+
+// Powers of two, so that a histogram covers 1 us to 32 ms
+uint8_t ledstats_bucket(uint32_t elapsed_us)
+{
+    uint8_t     bucket = 0;
+
+    while((elapsed_us > 1) && (bucket != LEDSTATS_BUCKETS - 1))
+    {
+        elapsed_us = elapsed_us >> 1;
+        bucket = bucket + 1;
+    }
+
+    return(bucket);
+}
+
+void ledstats_record(uint8_t histogram, uint32_t elapsed_us)
+{
+    ledstats_histogram_t*   stats = &ledstats[histogram];
+    uint8_t                 bucket = ledstats_bucket(elapsed_us);
+
+    stats->buckets[bucket] = stats->buckets[bucket] + 1;
+    stats->count = stats->count + 1;
+    stats->last_us = elapsed_us;
+    stats->total_us = stats->total_us + elapsed_us;
+
+    if(elapsed_us > stats->max_us)
+    {
+        stats->max_us = elapsed_us;
+    }
+}
+
+// Records how far the tick started from when it was due, early or late. Ticks are
+// due a period apart, so a late tick doesn't make the next one look early.
+void ledstats_tick(uint32_t start_us, uint32_t period_us)
+{
+    int32_t     late_us = 0;
+
+    if(ledstats_started == false)
+    {
+        ledstats_due_us = start_us;
+        ledstats_started = true;
+        return;
+    }
+
+    ledstats_due_us = ledstats_due_us + period_us;
+    late_us = (int32_t) (start_us - ledstats_due_us);
+
+    if(late_us < 0)
+    {
+        late_us = -late_us;
+    }
+
+    ledstats_record(LEDSTATS_JITTER, late_us);
+
+    // A whole tick was lost, so start counting again from this one
+    if((uint32_t) late_us >= period_us)
+    {
+        ledstats_due_us = start_us;
+    }
+}
+
+// =================================================================================
+// Core 0
+
+// Copies the bucket counts of each histogram that changed to its SNON value, at
+// most every LEDSTATS_PUBLISH_MS
+void ledstats_publish(void)
+{
+    char                    values[LEDSTATS_VALUES_LENGTH];
+    ledstats_histogram_t*   stats = NULL;
+    uint16_t                length = 0;
+    uint8_t                 histogram = 0;
+    uint8_t                 bucket = 0;
+
+    if((time_us_32() - ledstats_published_us) < (LEDSTATS_PUBLISH_MS * 1000))
+    {
+        return;
+    }
+
+    ledstats_published_us = time_us_32();
+
+    while(histogram != LEDSTATS_COUNT)
+    {
+        stats = &ledstats[histogram];
+
+        if(stats->count != stats->published)
+        {
+            stats->published = stats->count;
+
+            length = 0;
+            bucket = 0;
+            while(bucket != LEDSTATS_BUCKETS)
+            {
+                length = length + snprintf(&values[length], LEDSTATS_VALUES_LENGTH - length, "%s\"%lu\"", (bucket == 0) ? "[" : ",", (unsigned long) stats->buckets[bucket]);
+                bucket = bucket + 1;
+            }
+
+            snprintf(&values[length], LEDSTATS_VALUES_LENGTH - length, "]");
+            store_set_values(store_find(stats->name), values);
+            subscribe_changed(stats->name);
+        }
+
+        histogram = histogram + 1;
+    }
+}
+
+const ledstats_histogram_t* ledstats_get(uint8_t histogram)
+{
+    return(&ledstats[histogram]);
+}
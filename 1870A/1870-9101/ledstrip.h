@@ -0,0 +1,121 @@
+// ---------------------------------------------------------------------------------
+// WS2812 LED strips - Header
+// ---------------------------------------------------------------------------------
+// Each strip keeps its own PIO state machine and DMA channel. Frames are drawn
+// into a back buffer, and DMA sends them while the next one is drawn. A frame
+// can also be split across up to eight chains on neighbouring pins, which are
+// sent at the same time by the ws2812_parallel program. A run-length strip has no
+// frame buffer: DMA sends each run of pixels from a single colour word.
+// The strips own the PIO programs they load, and the debug LED is a strip of one
+// pixel, so frames can be submitted to any strip without setting up its state
+// machine again.
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+
+#pragma once
+#ifndef LEDSTRIP_H
+#define LEDSTRIP_H
+
+#include "pico/stdlib.h"
+#include "hardware/pio.h"
+
+// Build options
+//  LEDSTRIP_LANES=<n>      Split the front panel LEDs across n chains, on the LED
+//                          pin and the n - 1 pins after it
+#ifndef LEDSTRIP_LANES
+#define LEDSTRIP_LANES          1
+#endif
+
+// Constants
+#define LEDSTRIP_MAX            4
+#define LEDSTRIP_LATCH_US       300     // Time the line is held low to latch the pixels
+#define LEDSTRIP_FIFO_DEPTH     8       // Joined TX FIFO, still being sent when DMA finishes
+#define LEDSTRIP_MAX_LANES      8       // Chains driven in parallel
+#define LEDSTRIP_BITS           24
+
+// Frame buffers hold words as the state machine takes them, with the GRB colour
+// from urgb_u32() in the top 24 bits
+#define LEDSTRIP_WORD(colour)   ((colour) << 8)
+
+// Words in the bit plane buffer of a parallel strip. Each word holds one bit of
+// one pixel for every chain, so there are 24 words for each pixel of a chain.
+#define LEDSTRIP_LANE_PIXELS(pixel_count, lanes)    (((pixel_count) + (lanes) - 1) / (lanes))
+#define LEDSTRIP_PLANE_WORDS(pixel_count, lanes)    (LEDSTRIP_LANE_PIXELS(pixel_count, lanes) * LEDSTRIP_BITS)
+
+// Types
+
+// DMA control block for one run. The control channel writes it to the data
+// channel, which then sends the colour word count times. A count of 0 ends the
+// frame.
+typedef struct
+{
+    uint32_t        count;              // Pixels in the run
+    const uint32_t* colour;             // Word sent for every pixel of the run
+} ledstrip_run_t;
+
+typedef struct
+{
+    PIO             pio;
+    uint            sm;
+    int             dma_channel;
+    int             control_channel;    // Loads the runs into dma_channel, for run-length strips only
+    uint32_t        latch_us;           // FIFO drain time plus the latch time
+    uint32_t*       buffers[2];
+    uint32_t*       planes;             // Bit planes sent by DMA, for parallel strips only
+    ledstrip_run_t* runs;               // Control blocks, for run-length strips only
+    uint32_t*       run_colours;        // Colour of each run, as being sent
+    uint16_t        run_count;
+    uint16_t        pixel_count;
+    uint16_t        lane_pixels;        // Pixels on each chain
+    uint8_t         lanes;              // Chains, which are one for a serial strip
+    uint8_t         back;               // Buffer being drawn into
+    uint8_t         pin;                // First pin
+    uint32_t        show_us;            // When the frame being sent was started
+    volatile bool   busy;               // From ledstrip_show() until the pixels have latched
+    bool            timed;              // Send times go into the LEDSTATS_TRANSMIT histogram
+    uint32_t        frames;             // Frames sent
+    uint32_t        skipped;            // Frames not sent because the last one was still going out
+} ledstrip_t;
+
+typedef struct
+{
+    uint32_t    last_us;                // Time spent in the LED timer callback
+    uint32_t    max_us;
+} ledstrip_stats_t;
+
+// Setup (core 0, before the LED timer is started). The ws2812 program is loaded if
+// it isn't already. Each buffer must hold pixel_count words.
+bool ledstrip_init(ledstrip_t* strip, PIO pio, uint pin, float freq, uint32_t* buffer_a, uint32_t* buffer_b, uint16_t pixel_count);
+
+// Splits pixel_count pixels evenly across lanes chains on pin_base onwards, with
+// the first pixels on the chain on pin_base. The frame buffer holds pixel_count
+// words, and planes holds LEDSTRIP_PLANE_WORDS(pixel_count, lanes) words. The
+// ws2812_parallel program is loaded if it isn't already.
+bool ledstrip_init_parallel(ledstrip_t* strip, PIO pio, uint pin_base, uint8_t lanes, float freq, uint32_t* frame, uint32_t* planes, uint16_t pixel_count);
+void ledstrip_transpose(const uint32_t* frame, uint16_t pixel_count, uint8_t lanes, uint32_t* planes);
+
+// Sends up to run_count runs of one colour each, which are set by
+// ledstrip_set_run(). Runs holds run_count + 1 blocks, and colours holds
+// run_count words. Uses a second DMA channel.
+bool ledstrip_init_runs(ledstrip_t* strip, PIO pio, uint pin, float freq, ledstrip_run_t* runs, uint32_t* colours, uint16_t run_count);
+void ledstrip_set_run(ledstrip_t* strip, uint16_t run, uint16_t count);
+
+// Strips that aren't sent by the LED timer, such as the debug LED, are left out
+// of the LEDSTATS_TRANSMIT histogram
+void ledstrip_set_timed(ledstrip_t* strip, bool timed);
+
+// LED timer, or any other context. Each strip takes one frame at a time: a frame
+// submitted while the last one is still being sent is refused, and the caller
+// tries again later.
+uint32_t* ledstrip_back_buffer(ledstrip_t* strip);
+bool ledstrip_show(ledstrip_t* strip);
+bool ledstrip_show_runs(ledstrip_t* strip, const uint32_t* colours);
+void ledstrip_callback_done(uint32_t elapsed_us);
+const ledstrip_stats_t* ledstrip_get_stats(void);
+uint8_t ledstrip_get_count(void);
+const ledstrip_t* ledstrip_get(uint8_t strip);
+
+#endif // LEDSTRIP_H
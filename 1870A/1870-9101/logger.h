@@ -0,0 +1,55 @@
+// ---------------------------------------------------------------------------------
+// Deferred logging - Header
+// ---------------------------------------------------------------------------------
+// Log records are queued as a format string and its arguments, and only
+// formatted and printed later from the command loop. Safe to call from
+// interrupt handlers and from either core.
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+
+#pragma once
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include "pico/stdlib.h"
+
+// Levels
+#define LOGGER_ERROR            0
+#define LOGGER_WARNING          1
+#define LOGGER_INFO             2
+#define LOGGER_DEBUG            3
+
+// Constants
+#define LOGGER_RING_SIZE        32          // Records per core, must be a power of two
+#define LOGGER_MAX_ARGS         6
+#define LOGGER_TEXT_LENGTH      48          // Longest string argument kept, including the terminator (fits an eID)
+#define LOGGER_DRAIN_COUNT      4           // Records printed per call to logger_drain()
+
+// Types
+typedef struct
+{
+    uint32_t    queued;             // Records accepted
+    uint32_t    dropped;            // Records lost because the ring was full
+    uint32_t    filtered;           // Records below the current log level
+    uint32_t    printed;
+} logger_stats_t;
+
+// Logging (any core, including interrupt handlers)
+// The format must be a string literal. Arguments are passed as 32 bit integers.
+void logger_log(uint8_t level, const char* format, uint8_t count, ...);
+
+// As above, with a string argument copied into the record. The format uses %s
+// for the string, before any %u or %lu for the integers. Strings that don't fit
+// in LOGGER_TEXT_LENGTH are cut short and end in "...".
+void logger_log_text(uint8_t level, const char* format, const char* text, uint8_t count, ...);
+
+// Output and control (core 0 command loop)
+void logger_drain(uint8_t count);
+void logger_set_level(uint8_t level);
+uint8_t logger_get_level(void);
+const logger_stats_t* logger_get_stats(uint8_t core);
+
+#endif // LOGGER_H
@@ -22,8 +22,20 @@
 #include "pins.h"
 #include "build.h"
 #include "uart.h"
+#include "logger.h"
+#include "writer.h"
+#include "commands.h"
+#include "reply.h"
+#include "json_tok.h"
+#include "subscribe.h"
+#include "indicators.h"
+#include "annunciator.h"
+#include "ledstrip.h"
+#include "ledstats.h"
 #include "sensors.h"
 #include "mem_utils.h"
+#include "arena.h"
+#include "store.h"
 #include "pico-utils/ws2812.h"
 #include "snon/sha1.h"
 #include "snon/snon_utils.h"
@@ -32,12 +44,17 @@
 #define SNPRINTF_BUFFER_SIZE    80
 
 // Global Variables
-uint    pio_sm;
-uint    pio_sm_offset;
+ledstrip_t  debug_led_strip;
+uint32_t    debug_led_frames[2][1];
 bool    refresh_needed = false;
+bool    debug_led_pending = false;
 
 // Prototypes
 void command_loop(void);
+void command_ack(writer_t* writer, const char* arguments);
+void command_reset(writer_t* writer, const char* arguments);
+void command_get_alarms(writer_t* writer, const char* arguments);
+void command_set_sequence(writer_t* writer, const char* arguments);
 
 // =================================================================================
 // Local Functions
@@ -81,18 +98,20 @@ int main() {
 
     printf("Enable debug LED...\n");
 
-    // Get first free state machine in PIO 1
-    pio_sm = pio_claim_unused_sm(pio1, true);
-    pio_sm_offset = pio_add_program(pio1, &ws2812_program);
+    // The debug LED is a strip of one pixel, with its own state machine
+    ledstrip_init(&debug_led_strip, pio1, DEBUG_WS2812, 1200000, debug_led_frames[0], debug_led_frames[1], 1);
+    ledstrip_set_timed(&debug_led_strip, false);
 
     // Set the debug LED to purple
-    ws2812_program_init(pio1, pio_sm, pio_sm_offset, DEBUG_WS2812, 1200000, false);
-    put_pixel(urgb_u32(10, 0, 10));
+    ledstrip_back_buffer(&debug_led_strip)[0] = LEDSTRIP_WORD(urgb_u32(10, 0, 10));
+    ledstrip_show(&debug_led_strip);
 
    // ===========================================================================================
 
     printf("Initializing core SNON entities (%lu)\n", get_free_ram_2());
+    arena_initialize();
     sensors_initialize_device();
+    ledstats_initialize();
     printf("Core SNON entities initialized. (%lu)\n", get_free_ram_2());
     sensors_initialize_hmi();
     printf("HMI SNON entities initialized.  (%lu)\n", get_free_ram_2());
@@ -100,12 +119,23 @@ int main() {
     // ===========================================================================================
     printf("Front Panel init...\n");
 
-    add_repeating_timer_ms(100, draw_anc_leds, NULL, &ledTimer);
+    // Negative, so ticks are a fixed time apart however long each one takes
+    add_repeating_timer_ms(-ANC_LED_PERIOD_MS, draw_anc_leds, NULL, &ledTimer);
 
     // ===========================================================================================
     printf("Initializing Serial I/O...\n");
     uart_setup();
 
+    // The multi-drop address comes from the device eID
+    snon_name_to_eid("device", snprintf_buffer);
+    uart_set_address(uart_address_from_eid(snprintf_buffer));
+
+    commands_initialize();
+    command_register("ack", NULL, "Acknowledge annunciator alarms", command_ack);
+    command_register("reset", NULL, "Reset acknowledged alarms that are back to normal", command_reset);
+    command_register("get alarms", NULL, "Display annunciator window states", command_get_alarms);
+    command_register("set sequence", "<a|m|r> [fo]", "Set the ISA-18.1 sequence, with first-out", command_set_sequence);
+
     printf("Ready for commands\n");
 
     while (true)
@@ -120,378 +150,257 @@ int main() {
 void command_loop(void)
 {
     char        snprintf_buffer[SNPRINTF_BUFFER_SIZE];
-    datetime_t  t;
-    bool        get_time_valid = false;
-    char*       json_output = NULL;
-    uint16_t    counter = 0;
+    const char* json_output = NULL;
 
     while (true)
     {
+        // Carry on with any response too long for the TX ring. No command is
+        // taken until it has all gone.
+        writer_resume();
+
         // Check if there are any commands pending
         const char* command = uart_command_get();
         if(strcmp(command, "") != 0)
         {
             if(command[0] == '{')
             {
-                char*       json_output = NULL;
+                // Tokenized once, for subscription requests and the request ID
+                json_tok_t  tokens[REPLY_TOKEN_MAX];
+                int16_t     token_count = json_tok_parse(command, strlen(command), tokens, REPLY_TOKEN_MAX);
                 char        eid[SNON_URN_LENGTH];
+                reply_rid_t rid;
+                writer_t    writer;
 
-                printf("Received SNON fragment \"%s\"\n", command);
+                logger_log_text(LOGGER_INFO, "Received SNON fragment \"%s\" (%lu characters)", command, 1, (uint32_t) strlen(command));
+                writer_init_uart(&writer, WRITER_MODE_RAW);
 
                 if(command[1] == '}')
                 {
                     // Display all entities
-                    char*       entity_output = NULL;
-                    uint16_t    counter = 0;
-                    uint16_t    json_output_length = 0;
-
-                    json_output = snon_get_values("Entities");
+                    write_entities_json(&writer, ",");
+                }
+                else if(subscribe_fragment(&writer, command, tokens, token_count) == true)
+                {
+                    // Subscription requests are answered by subscribe_fragment()
+                }
+                else
+                {
+                    reply_get_rid(command, tokens, token_count, 0, &rid);
 
-                    if(json_output != NULL)
+                    if(json_has_eid(command, snprintf_buffer) == true)
                     {
-                        json_output_length = strlen(json_output);
-
-                        counter = 0;
-                        uart_puts(uart1, "[");
+                        uint8_t error = 0;
 
-                        while(json_output[counter] != 0)
+                        // Copy over the eID
+                        strncpy(eid, snprintf_buffer, SNON_URN_LENGTH);
+                        eid[SNON_URN_LENGTH - 1] = 0;
+                        
+                        if(json_has_value(command, snprintf_buffer) == true)
                         {
-                            if(json_output[counter] == '"')
+                            if(indicator_check_values(eid, snprintf_buffer) == false)
+                            {
+                                logger_log_text(LOGGER_WARNING, "Invalid indicator state for eID %s", eid, 0);
+                                error = REPLY_ERROR_BAD_VALUE;
+                            }
+                            else if(annunciator_check_values(eid, snprintf_buffer) == false)
+                            {
+                                logger_log_text(LOGGER_WARNING, "Invalid process input for eID %s", eid, 0);
+                                error = REPLY_ERROR_BAD_VALUE;
+                            }
+                            else
                             {
-                                sscanf(&json_output[counter + 1], "%45s", &snprintf_buffer);
-                                entity_output = snon_get_json(snprintf_buffer);
+                                // Update the value
+                                logger_log_text(LOGGER_INFO, "New value for eID %s (%lu characters)", eid, 1, (uint32_t) strlen(snprintf_buffer));
 
-                                if(entity_output != NULL)
+                                // The LEDs and the annunciator only change once the store has the value
+                                if(store_set_values(store_find(eid), snprintf_buffer) == true)
                                 {
-                                    uart_puts(uart1, entity_output);
-                                    free(entity_output);
+                                    indicator_set_values(eid, snprintf_buffer);
+                                    annunciator_set_values(eid, snprintf_buffer);
+                                    subscribe_changed(eid);
+                                    refresh_needed = true;
                                 }
-                                else
+                                else if(store_find(eid) == STORE_INVALID)
                                 {
-                                    uart_puts(uart1, "{}");
+                                    error = REPLY_ERROR_NOT_FOUND;
                                 }
-                                
-                                if(counter + 50 < json_output_length)
+                                else
                                 {
-                                    uart_puts(uart1, ",");
+                                    logger_log_text(LOGGER_WARNING, "Unable to store the value of %s", eid, 0);
+                                    error = REPLY_ERROR_NO_MEMORY;
                                 }
-
-                                counter = counter + SNON_URN_LENGTH;
                             }
-
-                            counter = counter + 1;
                         }
 
-                        uart_puts(uart1, "]");
-                        free(json_output);
-                    }
-                }
-                else
-                {
-                    if(json_has_eid(command, snprintf_buffer) == true)
-                    {
-                        // Copy over the eID
-                        strncpy(eid, snprintf_buffer, SNON_URN_LENGTH);
-                        eid[SNON_URN_LENGTH - 1] = 0;
-                        
-                        if(json_has_value(command, snprintf_buffer) == true)
-                        {
-                            // Update the value
-                            printf("New Value %s\n", snprintf_buffer);
-                            snon_set_values(eid, snprintf_buffer);
-                            refresh_needed = true;
-                        }
-
-                        json_output = snon_get_json(eid);
-
-                        if(json_output != NULL)
+                        if(error != 0)
                         {
-                            uart_puts(uart1, json_output);
-                            free(json_output);
+                            reply_error(&writer, error, &rid);
                         }
-                        else
+                        else if(reply_entity(&writer, eid, &rid) == false)
                         {
-                            printf("Unable to find entity with eID %s\r\n", eid);
-                            uart_puts(uart1, "{}");
+                            logger_log_text(LOGGER_WARNING, "Unable to find entity with eID %s", eid, 0);
+                            reply_error(&writer, REPLY_ERROR_NOT_FOUND, &rid);
                         }
                     }
                     else
                     {
-                        printf("Unable to find eID\r\n");
-                        uart_puts(uart1, "{}");
+                        logger_log(LOGGER_WARNING, "Unable to find eID", 0);
+                        reply_error(&writer, REPLY_ERROR_NO_EID, &rid);
                     }
                 }
 
-                uart_puts(uart1, "\r\n");
+                writer_puts(&writer, "\r\n");
+                writer_flush(&writer);
                 uart_command_clear();
             }
             else
             {
+                writer_t    writer;
+
+                // Anything else is only accepted in command mode
                 if(uart_in_command_mode())
                 {
-                    printf("Received Command \"%s\"\n", command);
+                    logger_log_text(LOGGER_INFO, "Received Command \"%s\" (%lu characters)", command, 1, (uint32_t) strlen(command));
+                    writer_init_uart(&writer, WRITER_MODE_RAW);
 
-                    if(strcmp(command, "help") == 0)
-                    {
-                        uart_puts(uart1, "\r\nCommands:");
-                        uart_puts(uart1, "\r\n\"help\"                - Displays list of commands");
-                        uart_puts(uart1, "\r\n\"clear\"               - Clear the serial terminal");
-                        uart_puts(uart1, "\r\n\"ls\"                  - List SNON entites");
-                        uart_puts(uart1, "\r\n\"cat <entity>\"        - Display the value of an SNON entity");
-                        uart_puts(uart1, "\r\n\"get time\"            - Get the current time");
-                        uart_puts(uart1, "\r\n\"set time\"            - Set the current time");
-                        uart_command_clear();
-                    }
-                    else if(strcmp(command, "clear") == 0)
+                    if(command_dispatch(&writer, command) == false)
                     {
-                        uart_puts(uart1, "\033[2J\033[H");
-                        uart_command_clear();
+                        writer_puts(&writer, "\r\nUnknown command\r\n");
                     }
-                    else if(strcmp(command, "ls") == 0)
-                    {
-                        // List all entities
-                        char*       entity_name = NULL;
-                        uint16_t    counter = 0;
-                        uint16_t    json_output_length = 0;
-
-                        json_output = snon_get_values("Entities");
 
-                        if(json_output != NULL)
-                        {
-                            json_output_length = strlen(json_output);
-
-                            counter = 0;
-                            uart_puts(uart1, "\r\n");
+                    writer_flush(&writer);
+                }
 
-                            while(json_output[counter] != 0)
-                            {
-                                if(json_output[counter] == '"')
-                                {
-                                    sscanf(&json_output[counter + 1], "%45s", &snprintf_buffer);
-
-                                    uart_puts(uart1, snprintf_buffer);
-                                    uart_puts(uart1, " - ");
-
-                                    entity_name = snon_get_name(snprintf_buffer);
-
-                                    if(entity_name != NULL)
-                                    {
-                                        uart_puts(uart1, entity_name);
-                                    }
-                                    else
-                                    {
-                                        uart_puts(uart1, "Unknown entity name");
-                                    }
-                                        
-                                    if(counter + 50 < json_output_length)
-                                    {
-                                        uart_puts(uart1, "\r\n");
-                                    }
-
-                                    counter = counter + SNON_URN_LENGTH;
-                                }
+                uart_command_clear();
+            }
+        }
 
-                                counter = counter + 1;
-                            }
+        // Push any subscribed values that have changed
+        subscribe_service();
 
-                            uart_puts(uart1, "\r\n");
-                            free(json_output);
-                        }
-                        else
-                        {
-                            uart_puts(uart1, "\r\nError: Out of memory.\r\n");
-                        }
+        // Copy the LED timing histograms to SNON now and again
+        ledstats_publish();
 
-                        uart_command_clear();
-                    }
-                    else if(strncmp(command, "cat ", 4) == 0)
-                    {
-                        char* json_output = snon_get_json((char*) &(command[4]));
+        // Print anything logged since the last pass, a few records at a time
+        logger_drain(LOGGER_DRAIN_COUNT);
 
-                        if(json_output != NULL)
-                        {
-                            uart_puts(uart1, "\r\n");
+        if(refresh_needed == true)
+        {
+            refresh_needed = false;
+            json_output = store_get_values(store_find("Debug LED RGB"));
 
-                            counter = 0;
-                            while(json_output[counter] != 0)
-                            {
-                                uart_putc(uart1, json_output[counter]);
+            if(json_output)
+            {
+                unsigned int r_value = 0;
+                unsigned int g_value = 0;
+                unsigned int b_value = 0;
 
-                                if(json_output[counter] == ',')
-                                {
-                                    uart_putc(uart1, '\r');
-                                    uart_putc(uart1, '\n');
-                                }
+                sscanf(json_output, "[\"%2X%2X%2X\"]", &r_value, &g_value, &b_value);
+                ledstrip_back_buffer(&debug_led_strip)[0] = LEDSTRIP_WORD(urgb_u32(r_value, g_value, b_value));
+                debug_led_pending = true;
+            }
+        }
 
-                                counter = counter + 1;
-                            }
+        // The back buffer keeps the colour while the last one is still being sent,
+        // so a retry on the next pass doesn't need the value parsing again
+        if((debug_led_pending == true) && (ledstrip_show(&debug_led_strip) == true))
+        {
+            debug_led_pending = false;
+        }
 
-                            uart_puts(uart1, "\r\n");
-                            free(json_output);
-                        }
-                        else
-                        {
-                            uart_puts(uart1, "\r\nEntity not found\r\n");
-                        }
+        //sleep_ms(1);
+    }    
+}
 
-                        uart_command_clear();
-                    }
-                    else if(strncmp(command, "dump", 4) == 0)
-                    {
-                        char* json_output = snon_get_dump();
+// =================================================================================
+// Annunciator commands
 
-                        if(json_output != NULL)
-                        {
-                            uart_puts(uart1, "\r\n");
+void command_ack(writer_t* writer, const char* arguments)
+{
+    char    buffer[COMMAND_BUFFER_SIZE];
 
-                            counter = 0;
-                            while(json_output[counter] != 0)
-                            {
-                                if(json_output[counter] == '\n')
-                                {
-                                    uart_putc(uart1, '\r');
-                                }
+    snprintf(buffer, COMMAND_BUFFER_SIZE, "\r\nAcknowledged %u windows", annunciator_unacknowledged_count());
+    annunciator_acknowledge();
+    writer_puts(writer, buffer);
+    writer_puts(writer, "\r\n");
+}
 
-                                uart_putc(uart1, json_output[counter]);
+void command_reset(writer_t* writer, const char* arguments)
+{
+    char    buffer[COMMAND_BUFFER_SIZE];
 
-                                counter = counter + 1;
-                            }
+    snprintf(buffer, COMMAND_BUFFER_SIZE, "\r\nReset %u windows", annunciator_waiting_reset_count());
+    annunciator_reset();
+    writer_puts(writer, buffer);
+    writer_puts(writer, "\r\n");
+}
 
-                            uart_puts(uart1, "\r\n");
-                            free(json_output);
-                        }
-                        else
-                        {
-                            uart_puts(uart1, "\r\nError: Out of memory.\r\n");
-                        }
+void command_get_alarms(writer_t* writer, const char* arguments)
+{
+    const annunciator_stats_t*  stats = annunciator_get_stats();
+    char                        buffer[COMMAND_BUFFER_SIZE];
+    uint16_t                    window = 0;
 
-                        uart_command_clear();
-                    }
-                    else if(strcmp(command, "get mem") == 0)
-                    {
-                        snprintf(snprintf_buffer, SNPRINTF_BUFFER_SIZE, "\r\nFree memory: %lu bytes\r\n", get_free_ram_2());
-                        uart_puts(uart1, snprintf_buffer);
+    snprintf(buffer, COMMAND_BUFFER_SIZE, "\r\nSequence %s%s, %u unacknowledged, %u waiting for reset", annunciator_sequence_name(annunciator_get_sequence()),
+             (annunciator_get_first_out() == true) ? " with first-out" : "", annunciator_unacknowledged_count(), annunciator_waiting_reset_count());
+    writer_puts(writer, buffer);
 
-                        uart_command_clear();
-                    }
-                    else if(strcmp(command, "get time") == 0)
-                    {
-                        get_time_valid = rtc_counter_to_iso8601(snprintf_buffer, time_us_64());
+    while(window != annunciator_window_count())
+    {
+        snprintf(buffer, COMMAND_BUFFER_SIZE, "\r\n  Window %u: %s", window + 1, annunciator_state_name(annunciator_window_state(window)));
+        writer_puts(writer, buffer);
+        window = window + 1;
+    }
 
-                        if(get_time_valid == true)
-                        {
-                            uart_puts(uart1, "\r\nThe time is: ");
-                            uart_puts(uart1, snprintf_buffer);
-                        }
-                        else
-                        {
-                            uart_puts(uart1, "\r\nRTC not running. Use the \"set time\" command to set the current time.");
-                        }
-                        uart_command_clear();
-                    }
-                    else if(strncmp(command, "set time ", 9) == 0)
-                    {
-                        unsigned int    year = 0;
-                        unsigned int    month = 0;
-                        unsigned int    day = 0;
-                        unsigned int    hours = 0;
-                        unsigned int    minutes = 0;
-                        unsigned int    seconds = 0;
-                        bool            set_valid = false;
-
-                        sscanf(command, "set time %4u-%2u-%2uT%2u:%2u:%2uZ", &year, &month, &day, &hours, &minutes, &seconds);
-                        if(year < 2022 || year > 2055)
-                        {
-                            snprintf(snprintf_buffer, SNPRINTF_BUFFER_SIZE, "\r\nInvalid year %04d. Must be between 2022 and 2055", year);
-                            uart_puts(uart1, snprintf_buffer);
-                        }
-                        else if(month < 1 || month > 12)
-                        {
-                            snprintf(snprintf_buffer, SNPRINTF_BUFFER_SIZE, "\r\nInvalid month %02d. Must be between 1 and 12", month);
-                            uart_puts(uart1, snprintf_buffer);
-                        }
-                        else if(day < 1 || day > 31)
-                        {
-                            snprintf(snprintf_buffer, SNPRINTF_BUFFER_SIZE, "\r\nInvalid day %02d. Must be between 1 and 31", day);
-                            uart_puts(uart1, snprintf_buffer);
-                        }
-                        else if(hours < 0 || hours > 23)
-                        {
-                            snprintf(snprintf_buffer, SNPRINTF_BUFFER_SIZE, "\r\nInvalid hour %02d. Must be between 0 and 23", hours);
-                            uart_puts(uart1, snprintf_buffer);
-                        }
-                        else if(minutes < 0 || minutes > 59)
-                        {
-                            snprintf(snprintf_buffer, SNPRINTF_BUFFER_SIZE, "\r\nInvalid minute %02d. Must be between 0 and 59", minutes);
-                            uart_puts(uart1, snprintf_buffer);
-                        }
-                        else if(seconds < 0 || seconds > 59)
-                        {
-                            snprintf(snprintf_buffer, SNPRINTF_BUFFER_SIZE, "\r\nInvalid second %02d. Must be between 0 and 59", hours);
-                            uart_puts(uart1, snprintf_buffer);
-                        }
-                        else
-                        {
-                            t.year = year;
-                            t.month = month;
-                            t.day = day;
-                            t.hour = hours;
-                            t.min = minutes;
-                            t.sec = seconds;
-                            t.dotw = 0;
+    snprintf(buffer, COMMAND_BUFFER_SIZE, "\r\nInputs: %lu, Transitions: %lu, Refused: %lu", stats->inputs, stats->transitions, stats->rejected);
+    writer_puts(writer, buffer);
+    snprintf(buffer, COMMAND_BUFFER_SIZE, "\r\nAcknowledged: %lu, Reset: %lu", stats->acknowledged, stats->reset);
+    writer_puts(writer, buffer);
+    snprintf(buffer, COMMAND_BUFFER_SIZE, "\r\nEvent time: %lu us (max %lu us)", stats->last_us, stats->max_us);
+    writer_puts(writer, buffer);
+    writer_puts(writer, "\r\n");
+}
 
-                            snprintf(snprintf_buffer, SNPRINTF_BUFFER_SIZE, "%04d-%02d-%02dT%02d:%02d:%02dZ", t.year, t.month, t.day, t.hour, t.min, t.sec);
+void command_set_sequence(writer_t* writer, const char* arguments)
+{
+    uint8_t     sequence = ANNUNCIATOR_SEQUENCE_COUNT;
+    bool        first_out = false;
 
-                            set_valid = rtc_set_time(snprintf_buffer);
-                            sleep_us(64);
+    if((arguments[0] == 'a') || (arguments[0] == 'A'))
+    {
+        sequence = ANNUNCIATOR_SEQUENCE_A;
+    }
+    else if((arguments[0] == 'm') || (arguments[0] == 'M'))
+    {
+        sequence = ANNUNCIATOR_SEQUENCE_M;
+    }
+    else if((arguments[0] == 'r') || (arguments[0] == 'R'))
+    {
+        sequence = ANNUNCIATOR_SEQUENCE_R;
+    }
 
-                            if(set_valid == true)
-                            {
-                                uart_puts(uart1, "\r\nTime set to ");
-                                uart_puts(uart1, snprintf_buffer);
-                            }
-                            else
-                            {
-                                uart_puts(uart1, "\r\nError setting time to ");
-                                uart_puts(uart1, snprintf_buffer);
-                            }
-                        }
+    if((sequence != ANNUNCIATOR_SEQUENCE_COUNT) && (arguments[1] != 0) && (arguments[1] != ' '))
+    {
+        sequence = ANNUNCIATOR_SEQUENCE_COUNT;
+    }
 
-                        uart_command_clear();
-                    }
-                    else if(strcmp(command, "exit") == 0)
-                    {
-                        uart_command_exit();
-                        uart_command_clear();
-                    }
-                    else
-                    {
-                        uart_puts(uart1, "\r\nUnknown command\r\n");
-                        uart_command_clear();
-                    }
-                }
-            }
+    if((sequence != ANNUNCIATOR_SEQUENCE_COUNT) && (arguments[1] == ' '))
+    {
+        if(strcmp(&arguments[2], "fo") == 0)
+        {
+            first_out = true;
         }
-
-        if(refresh_needed == true)
+        else
         {
-            json_output = snon_get_values("Debug LED RGB");
-
-            if(json_output)
-            {
-                uint8_t r_value = 0;
-                uint8_t g_value = 0;
-                uint8_t b_value = 0;
-
-                sscanf(json_output, "[\"%2X%2X%2X\"]", &r_value, &g_value, &b_value);
-                ws2812_program_init(pio1, pio_sm, pio_sm_offset, DEBUG_WS2812, 1200000, false);
-                put_pixel(urgb_u32(r_value, g_value, b_value));
-                free(json_output);
-            }
-
-            refresh_needed = false;
+            sequence = ANNUNCIATOR_SEQUENCE_COUNT;
         }
+    }
 
-        //sleep_ms(1);
-    }    
+    if(annunciator_set_sequence(sequence, first_out) == false)
+    {
+        writer_puts(writer, "\r\nUsage: set sequence <a|m|r> [fo]\r\n");
+        return;
+    }
+
+    command_get_alarms(writer, "");
 }
@@ -0,0 +1,49 @@
+// ---------------------------------------------------------------------------------
+// SNON replies - Header
+// ---------------------------------------------------------------------------------
+// Replies to SNON fragments, echoing the optional request ID ("rID") so that a
+// host can keep several requests in flight, and reporting failures as error
+// objects instead of an empty fragment.
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+
+#pragma once
+#ifndef REPLY_H
+#define REPLY_H
+
+#include "pico/stdlib.h"
+#include "json_tok.h"
+#include "writer.h"
+
+// Error codes, sent as {"rID":<id>,"error":<code>,"message":"<text>"}
+#define REPLY_ERROR_INVALID     1       // Fragment is not valid JSON
+#define REPLY_ERROR_NO_EID      2       // Fragment has no "eID"
+#define REPLY_ERROR_NOT_FOUND   3       // No entity with that eID
+#define REPLY_ERROR_NO_MEMORY   4       // Out of memory while setting a value or replying
+#define REPLY_ERROR_TABLE_FULL  5       // No room for another subscription
+#define REPLY_ERROR_BAD_VALUE   6       // Value isn't allowed for that entity
+#define REPLY_ERROR_COUNT       7
+
+// Constants
+#define REPLY_TOKEN_MAX         64      // Used by reply_find_rid()
+
+// Types
+typedef struct
+{
+    bool        present;
+    uint32_t    id;
+} reply_rid_t;
+
+// Request IDs
+bool reply_get_rid(const char* fragment, const json_tok_t* tokens, int16_t count, int16_t object, reply_rid_t* rid);
+bool reply_find_rid(const char* fragment, reply_rid_t* rid);
+
+// Replies
+bool reply_entity(writer_t* writer, const char* eid, const reply_rid_t* rid);
+void reply_error(writer_t* writer, uint8_t error, const reply_rid_t* rid);
+void reply_count(writer_t* writer, const char* key, uint32_t count, const reply_rid_t* rid);
+
+#endif // REPLY_H
@@ -11,18 +11,41 @@
 #include "sensors.h"
 #include "build.h"
 #include "pins.h"
-#include "vita40/vita40.h"
+#include "indicators.h"
+#include "annunciator.h"
+#include "ledmap.h"
+#include "front_panel_leds.h"
+#include "ledstrip.h"
+#include "ledstats.h"
+#include "store.h"
 #include "snon/snon_utils.h"
 #include "pico-utils/ws2812.h"
 
 #include "mem_utils.h"
 
 #define INIT_VALUE              "vita40_white_steady"
-#define FRONT_PANEL_LED_COUNT   9 * 30
+#define ANC_WINDOW_COUNT        15
 
-uint32_t        led_update_counter = 0;
-extern uint     pio_sm;
-extern uint     pio_sm_offset;
+// Process input of each window, in front_panel_leds order
+const char* anc_inputs[ANC_WINDOW_COUNT] =
+{
+    "=P01=PFA01 Input", "=P01=PFA02 Input", "=P01=PFA03 Input", "=P01=PFA04 Input", "=P01=PFA05 Input",
+    "=P01=PFA06 Input", "=P01=PFA07 Input", "=P01=PFA08 Input", "=P01=PFA09 Input", "=P01=PFA10 Input",
+    "=P01=PFA11 Input", "=P01=PFA12 Input", "=P01=PFA13 Input", "=P01=PFA14 Input", "=P01=PFA15 Input"
+};
+
+uint32_t            led_update_counter = 0;
+indicator_handle_t  anc_window_handles[FRONT_PANEL_LEDS_ENTRIES];
+uint32_t            anc_window_colours[FRONT_PANEL_LEDS_ENTRIES];
+ledmap_t            anc_led_map = { front_panel_leds, FRONT_PANEL_LEDS_ENTRIES, FRONT_PANEL_LEDS_PIXELS, anc_window_handles, anc_window_colours };
+ledstrip_t          anc_led_strip;
+#if LEDSTRIP_LANES > 1
+uint32_t            anc_led_frame[FRONT_PANEL_LEDS_PIXELS];
+uint32_t            anc_led_planes[LEDSTRIP_PLANE_WORDS(FRONT_PANEL_LEDS_PIXELS, LEDSTRIP_LANES)];
+#else
+ledstrip_run_t      anc_led_runs[FRONT_PANEL_LEDS_ENTRIES + 1];
+uint32_t            anc_led_run_colours[FRONT_PANEL_LEDS_ENTRIES];
+#endif
 
 void sensors_initialize_device(void)
 {
@@ -77,6 +100,8 @@ void sensors_initialize_device(void)
 
 void sensors_initialize_hmi(void)
 {
+    uint8_t counter = 0;
+
     snon_register("=P01", SNON_CLASS_DEVICE, NULL);
     snon_add_relationship("=P01", SNON_REL_CHILD_OF, "Device");
 
@@ -96,166 +121,66 @@ void sensors_initialize_hmi(void)
     snon_register_81346("=P01=PFA13", SNON_CLASS_VALUE, INIT_VALUE);
     snon_register_81346("=P01=PFA14", SNON_CLASS_VALUE, INIT_VALUE);
     snon_register_81346("=P01=PFA15", SNON_CLASS_VALUE, INIT_VALUE);
-}
-
-bool draw_anc_leds(struct repeating_timer *t)
-{
-    uint32_t    led_values[FRONT_PANEL_LED_COUNT];
-    uint32_t    led_value = 0;
-    uint16_t    led_counter = 0;
-    uint16_t    anc_counter = 0;
-
-    // Update LED values
-    anc_counter = anc_counter + 18;
-
-    led_value = vita40_to_urgb(snon_get_value("=P01=PFA01"), led_update_counter);
-
-    while(led_counter != anc_counter)
-    {
-        led_values[led_counter++] = led_value;
-    }
-
-    anc_counter = anc_counter + 18;
-
-    led_value = vita40_to_urgb(snon_get_value("=P01=PFA02"), led_update_counter);
-
-    while(led_counter != anc_counter)
-    {
-        led_values[led_counter++] = led_value;
-    }
-
-    anc_counter = anc_counter + 18;
-    
-    led_value = vita40_to_urgb(snon_get_value("=P01=PFA03"), led_update_counter);
-
-    while(led_counter != anc_counter)
-    {
-        led_values[led_counter++] = led_value;
-    }
-
-    anc_counter = anc_counter + 18;
-
-    led_value = vita40_to_urgb(snon_get_value("=P01=PFA04"), led_update_counter);
-
-    while(led_counter != anc_counter)
-    {
-        led_values[led_counter++] = led_value;
-    }
-
-    anc_counter = anc_counter + 18;
-
-    led_value = vita40_to_urgb(snon_get_value("=P01=PFA05"), led_update_counter);
-
-    while(led_counter != anc_counter)
-    {
-        led_values[led_counter++] = led_value;
-    }
-
-    anc_counter = anc_counter + 18;
-
-    led_value = vita40_to_urgb(snon_get_value("=P01=PFA06"), led_update_counter);
-
-    while(led_counter != anc_counter)
-    {
-        led_values[led_counter++] = led_value;
-    }
-
-    anc_counter = anc_counter + 18;
-
-    led_value = vita40_to_urgb(snon_get_value("=P01=PFA07"), led_update_counter);
-
-    while(led_counter != anc_counter)
-    {
-        led_values[led_counter++] = led_value;
-    }
-
-    anc_counter = anc_counter + 18;
-
-    led_value = vita40_to_urgb(snon_get_value("=P01=PFA08"), led_update_counter);
-
-    while(led_counter != anc_counter)
-    {
-        led_values[led_counter++] = led_value;
-    }
-
-    anc_counter = anc_counter + 18;
-
-    led_value = vita40_to_urgb(snon_get_value("=P01=PFA09"), led_update_counter);
-
-    while(led_counter != anc_counter)
-    {
-        led_values[led_counter++] = led_value;
-    }
-
-    anc_counter = anc_counter + 18;
-
-    led_value = vita40_to_urgb(snon_get_value("=P01=PFA10"), led_update_counter);
-
-    while(led_counter != anc_counter)
-    {
-        led_values[led_counter++] = led_value;
-    }
-
-    anc_counter = anc_counter + 18;
-
-    led_value = vita40_to_urgb(snon_get_value("=P01=PFA11"), led_update_counter);
 
-    while(led_counter != anc_counter)
+    // Add the process inputs that drive the annunciator sequences
+    while(counter != ANC_WINDOW_COUNT)
     {
-        led_values[led_counter++] = led_value;
+        snon_register((char*) anc_inputs[counter], SNON_CLASS_VALUE, NULL);
+        snon_add_relationship((char*) anc_inputs[counter], SNON_REL_CHILD_OF, (char*) front_panel_leds[counter].name);
+        snon_set_value((char*) anc_inputs[counter], "normal");
+        counter = counter + 1;
     }
 
-    anc_counter = anc_counter + 18;
+    // The values are kept by the store from here on
+    store_initialize();
 
-    led_value = vita40_to_urgb(snon_get_value("=P01=PFA12"), led_update_counter);
+    // Draw them as indicators
+    indicators_initialize();
+    ledmap_initialize(&anc_led_map);
 
-    while(led_counter != anc_counter)
+    annunciator_initialize();
+    counter = 0;
+    while(counter != ANC_WINDOW_COUNT)
     {
-        led_values[led_counter++] = led_value;
+        annunciator_add_window(front_panel_leds[counter].name, anc_inputs[counter]);
+        counter = counter + 1;
     }
 
-    anc_counter = anc_counter + 18;
-
-    led_value = vita40_to_urgb(snon_get_value("=P01=PFA13"), led_update_counter);
-
-    while(led_counter != anc_counter)
-    {
-        led_values[led_counter++] = led_value;
-    }
-
-    anc_counter = anc_counter + 18;
-
-    led_value = vita40_to_urgb(snon_get_value("=P01=PFA14"), led_update_counter);
-
-    while(led_counter != anc_counter)
-    {
-        led_values[led_counter++] = led_value;
-    }
-
-    anc_counter = anc_counter + 18;
-
-    led_value = vita40_to_urgb(snon_get_value("=P01=PFA15"), led_update_counter);
+#if LEDSTRIP_LANES > 1
+    ledstrip_init_parallel(&anc_led_strip, pio1, DISPLAY_PIN, LEDSTRIP_LANES, 800000, anc_led_frame, anc_led_planes, FRONT_PANEL_LEDS_PIXELS);
+#else
+    // Each window is one run of LEDs, sent from its colour without a frame buffer
+    ledstrip_init_runs(&anc_led_strip, pio1, DISPLAY_PIN, 800000, anc_led_runs, anc_led_run_colours, FRONT_PANEL_LEDS_ENTRIES);
+    ledmap_runs(&anc_led_map, &anc_led_strip);
+#endif
+}
 
-    while(led_counter != anc_counter)
-    {
-        led_values[led_counter++] = led_value;
-    }
+bool draw_anc_leds(struct repeating_timer *t)
+{
+    uint32_t    start_us = time_us_32();
+    bool        changed = false;
 
-    anc_counter = anc_counter + 18;
+    ledstats_tick(start_us, ANC_LED_PERIOD_MS * 1000);
 
+    // Draw the colours that changed, and only send the frame if any did. Every LED behind a window shows the same colour.
+#if LEDSTRIP_LANES > 1
+    changed = ledmap_render(&anc_led_map, indicator_phase(led_update_counter), ledstrip_back_buffer(&anc_led_strip));
+    indicator_frame_done(time_us_32() - start_us, anc_led_map.recomputed, changed);
 
-    // Set LED values
-    ws2812_program_init(pio1, pio_sm, pio_sm_offset, DISPLAY_PIN, 800000, false);
+    if((changed == true) && (ledstrip_show(&anc_led_strip) == false))
+#else
+    changed = ledmap_update(&anc_led_map, indicator_phase(led_update_counter));
+    indicator_frame_done(time_us_32() - start_us, anc_led_map.recomputed, changed);
 
-    led_counter = 0;
-    while(led_counter < (FRONT_PANEL_LED_COUNT))
+    if((changed == true) && (ledstrip_show_runs(&anc_led_strip, anc_led_map.colours) == false))
+#endif
     {
-        put_pixel(led_values[led_counter]);
-
-        led_counter = led_counter + 1;
+        // Still sending the last frame, so try again on the next tick
+        ledmap_invalidate(&anc_led_map);
     }
 
-    busy_wait_us(200);
-
     led_update_counter = led_update_counter + 1;
+    ledstrip_callback_done(time_us_32() - start_us);
+
+    return(true);
 }
@@ -9,6 +9,9 @@
 // ---------------------------------------------------------------------------------
 #include <pico/stdlib.h>
 
+// Constants
+#define ANC_LED_PERIOD_MS       100     // LED timer period
+
 // Utility routines
 void sensors_initialize_device(void);
 void sensors_initialize_hmi(void);
@@ -0,0 +1,60 @@
+// ---------------------------------------------------------------------------------
+// SNON value store - Header
+// ---------------------------------------------------------------------------------
+// Holds the values of every SNON entity in value pool blocks, with the rest of
+// each entity's SNON JSON kept from boot, so that entities can be written out
+// and their values set without using the heap
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+
+#pragma once
+#ifndef STORE_H
+#define STORE_H
+
+#include "pico/stdlib.h"
+#include "json_tok.h"
+#include "writer.h"
+
+// Build options
+//  STORE_MAX_COUNT=<n>     Most SNON entities the store holds
+#ifndef STORE_MAX_COUNT
+#define STORE_MAX_COUNT         320
+#endif
+
+// Constants
+#define STORE_INVALID           0xFFFF
+#define STORE_TOKEN_MAX         64          // Items in a values array set by store_set_values(), plus one
+
+// Types
+typedef uint16_t store_handle_t;
+
+typedef struct
+{
+    uint32_t    sets;
+    uint32_t    refused;            // Values that weren't an array, or had no room
+    uint32_t    boot_failures;      // Entities left out, as the boot arena or table was full
+} store_stats_t;
+
+// Setup (core 0, once every SNON entity has been registered and given its first values)
+void store_initialize(void);
+
+// Lookups (core 0), by eID or name
+store_handle_t store_find(const char* key);
+uint16_t store_get_count(void);
+const char* store_get_eid(store_handle_t handle);
+const char* store_get_name(store_handle_t handle);
+
+// Values (core 0)
+const char* store_get_values(store_handle_t handle);
+const char* store_get_value(store_handle_t handle);
+bool store_set_values(store_handle_t handle, const char* values);
+bool store_set_tokens(store_handle_t handle, const char* json, const json_tok_t* tokens, int16_t count, int16_t values);
+
+// Output (core 0)
+bool store_write_json(writer_t* writer, store_handle_t handle, bool close);
+const store_stats_t* store_get_stats(void);
+
+#endif // STORE_H
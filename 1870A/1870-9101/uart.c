@@ -11,27 +11,100 @@
 // Standard Library Includes
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 // Target Includes
 #include "pico/stdlib.h"
 #include "hardware/uart.h"
 #include "hardware/irq.h"
+#include "hardware/sync.h"
 
 // Project Includes
 #include "uart.h"
 
 // Constants
-#define COMMAND_STRING_MAX_LENGTH    254
+#define COMMAND_STRING_MAX_LENGTH    1024
+#define RX_RING_SIZE                 4096       // Must be a power of two
+#define RX_RING_MASK                 (RX_RING_SIZE - 1)
+#define LINE_QUEUE_SIZE              32         // Must be a power of two
+#define LINE_QUEUE_MASK              (LINE_QUEUE_SIZE - 1)
+#define TX_RING_SIZE                 8192       // Must be a power of two
+#define TX_RING_MASK                 (TX_RING_SIZE - 1)
+#define TX_CHUNK_LENGTH              64         // Most bytes copied with interrupts disabled
+#define TX_CHARACTER_US              87         // 10 bits at 115200 baud
+
+// Multi-drop line states, interrupt handler only
+#define RX_LINE_START                0          // Waiting for "@"
+#define RX_LINE_ADDRESS              1          // Matching the address
+#define RX_LINE_ACCEPT               2          // Queueing the line for this panel
+#define RX_LINE_DISCARD              3          // Dropping a line for another panel
+
+#define LINE_FLAG_BROADCAST          0x01
 
 // Globals
-volatile char collect_string[COMMAND_STRING_MAX_LENGTH];
-volatile char command_string[COMMAND_STRING_MAX_LENGTH];
-volatile uint8_t collect_string_pos = 0;
-volatile bool    command_mode=false;
 
+// Received bytes. The interrupt handler only ever moves rx_head and line_head,
+// and the command loop only ever moves rx_tail and line_tail.
+volatile uint8_t  rx_ring[RX_RING_SIZE];
+volatile uint16_t rx_head = 0;
+volatile uint16_t rx_tail = 0;
+
+// Ring positions just past the end of each complete line or frame
+volatile uint16_t line_ends[LINE_QUEUE_SIZE];
+volatile uint8_t  line_flags[LINE_QUEUE_SIZE];
+volatile uint16_t line_head = 0;
+volatile uint16_t line_tail = 0;
+
+char              command_string[COMMAND_STRING_MAX_LENGTH];
+uint16_t          command_length = 0;
+bool              command_pending = false;
+bool              command_broadcast = false;    // Replies to broadcasts are not sent
+bool              response_pending = false;     // A long response is still going out
+bool              prompt_waiting = false;       // Shown once it has
+
+// Multi-drop addressing. Lines start with "@<address> " or, for every panel, "@* ".
+volatile bool     multidrop_mode = UART_MULTIDROP;
+uint16_t          device_address = 0;
+char              address_text[UART_ADDRESS_LENGTH + 1] = "0000";
+uint8_t           rx_line_state = RX_LINE_START;
+uint8_t           rx_address_position = 0;
+bool              rx_broadcast = false;
+bool              rx_line_dropped = false;      // Discarding the rest of a line that didn't fit
+
+// Echo and editing state, command loop only
+uint16_t          echo_position = 0;
+uint16_t          echo_line_length = 0;
+
+// Bytes to send. Writers move tx_head with interrupts disabled, and only the
+// drain moves tx_tail.
+volatile uint8_t  tx_ring[TX_RING_SIZE];
+volatile uint16_t tx_head = 0;
+volatile uint16_t tx_tail = 0;
+volatile bool     tx_active = false;        // TX interrupt enabled
+volatile uint8_t  tx_last = 0;              // Last character sent, for newline translation
+uint32_t          command_get_us = 0;
+
+#ifdef UART_RS485_DE_PIN
+volatile bool     tx_de_enabled = false;    // Transceiver driving the bus
+volatile bool     tx_de_alarm = false;      // Waiting for the last byte to go out
+#endif
+
+volatile bool     command_mode = false;
+volatile bool     binary_mode = false;
+
+uart_stats_t      uart_stats;
 
 // Private prototypes
+void uart_isr(void);
 void uart_rx_isr(void);
+void uart_tx_drain(void);
+#ifdef UART_RS485_DE_PIN
+int64_t uart_de_release(alarm_id_t id, void* user_data);
+#endif
+bool uart_rx_address(uint8_t character);
+void uart_rx_drop_line(void);
+void uart_service(void);
+bool uart_next_line(void);
 
 // =================================================================================
 
@@ -48,12 +121,19 @@ void uart_setup(void)
     // Disable FIFOs on the UART
     uart_set_fifo_enabled(uart1, true);
 
-    collect_string[0] = 0;
     command_string[0] = 0;
-    collect_string_pos = 0;
+    command_length = 0;
+    command_pending = false;
+
+#ifdef UART_RS485_DE_PIN
+    // The transceiver only drives the bus while there is something to send
+    gpio_init(UART_RS485_DE_PIN);
+    gpio_set_dir(UART_RS485_DE_PIN, GPIO_OUT);
+    gpio_put(UART_RS485_DE_PIN, 0);
+#endif
 
     // Set up UART interrupts
-    irq_set_exclusive_handler(UART1_IRQ, uart_rx_isr);
+    irq_set_exclusive_handler(UART1_IRQ, uart_isr);
     irq_set_enabled(UART1_IRQ, true);
     irq_set_priority(UART1_IRQ, 0);
     uart_set_irq_enables(uart1, true, false);
@@ -66,77 +146,261 @@ void uart_display_prompt(void)
 {
     if(command_mode == true)
     {
-        uart_puts(uart1, "\r\n1840A > ");    
+        uart_send("\r\n1840A > ");
     }
 }
 
 // UART Interrupt Handler
+void uart_isr(void)
+{
+    uart_rx_isr();
+    uart_tx_drain();
+}
+
+// Receive
+// Only queues bytes, and notes where each line (or binary frame) ends
 void uart_rx_isr(void)
 {
-    uint8_t character = 0;
-    uint8_t copy_counter = 0;
+    uint8_t     character = 0;
+    uint16_t    next_head = 0;
+    uint16_t    used = 0;
+    bool        line_end = false;
 
     while(uart_is_readable(uart1))
     {
         character = uart_getc(uart1);
+        uart_stats.rx_bytes = uart_stats.rx_bytes + 1;
 
-//if(character == '\r') printf("\n");
-//printf("%x ", character);
+        // On a shared bus, lines for other panels never reach the ring
+        if((multidrop_mode == true) && (binary_mode == false) && (uart_rx_address(character) == false))
+        {
+            continue;
+        }
 
-        // Handle CR
-        if(character == 0x0D)
+        // Text commands end at the carriage return, so line feeds take no room
+        if((binary_mode == false) && (character == 0x0A))
         {
-            if(collect_string_pos == 0)
+            continue;
+        }
+
+        line_end = ((binary_mode == true) && (character == 0x00)) || ((binary_mode == false) && (character == 0x0D));
+
+        if(rx_line_dropped == true)
+        {
+            // Nothing is queued until the dropped line has ended
+            if(line_end == true)
             {
-                uart_display_prompt();
+                rx_line_dropped = false;
+                rx_broadcast = false;
+            }
+
+            continue;
+        }
+
+        next_head = (rx_head + 1) & RX_RING_MASK;
+
+        if(next_head == rx_tail)
+        {
+            // No room for the rest of the line, so drop all of it rather than run
+            // what was received together with the next line
+            uart_stats.rx_overflows = uart_stats.rx_overflows + 1;
+            uart_rx_drop_line();
+
+            if(line_end == false)
+            {
+                rx_line_dropped = true;
             }
             else
             {
-                copy_counter = 0;
+                rx_broadcast = false;
+            }
 
-                // Copy over to the command string
-                while(collect_string[copy_counter] != 0)
-                {
-                    command_string[copy_counter] = collect_string[copy_counter];
-                    copy_counter = copy_counter + 1;
-                }
+            continue;
+        }
+
+        rx_ring[rx_head] = character;
+        rx_head = next_head;
 
-                command_string[copy_counter] = 0;
+        used = (rx_head - rx_tail) & RX_RING_MASK;
+        if(used > uart_stats.rx_high_water)
+        {
+            uart_stats.rx_high_water = used;
+        }
 
-                // Clear the collections string
-                collect_string_pos = 0;
-                collect_string[0] = 0;
+        if(line_end == true)
+        {
+            if(((line_head + 1) & LINE_QUEUE_MASK) == line_tail)
+            {
+                // No room to queue it, so drop the whole line
+                uart_stats.line_overflows = uart_stats.line_overflows + 1;
+                uart_rx_drop_line();
+            }
+            else
+            {
+                line_ends[line_head] = rx_head;
+                line_flags[line_head] = (rx_broadcast == true) ? LINE_FLAG_BROADCAST : 0;
+                line_head = (line_head + 1) & LINE_QUEUE_MASK;
             }
+
+            rx_broadcast = false;
         }
+    }
+}
 
-        // Only add printable characters to the command string
+// Moves rx_head back to the end of the last queued line, forgetting the line
+// being received. Called from the interrupt handler.
+void uart_rx_drop_line(void)
+{
+    if(line_head != line_tail)
+    {
+        rx_head = line_ends[(line_head - 1) & LINE_QUEUE_MASK];
+    }
+    else
+    {
+        rx_head = rx_tail;
+    }
+}
+
+// Strips the address from the start of each line, and returns false for every
+// character that shouldn't be queued. Called from the interrupt handler.
+bool uart_rx_address(uint8_t character)
+{
+    if(rx_line_state == RX_LINE_ACCEPT)
+    {
+        if(character == 0x0D)
+        {
+            rx_line_state = RX_LINE_START;
+        }
+
+        return(true);
+    }
+
+    if(rx_line_state == RX_LINE_DISCARD)
+    {
+        if(character == 0x0D)
+        {
+            uart_stats.lines_other = uart_stats.lines_other + 1;
+            rx_line_state = RX_LINE_START;
+        }
+
+        return(false);
+    }
+
+    if(rx_line_state == RX_LINE_START)
+    {
+        // Line feeds and empty lines between requests are ignored
+        if((character == 0x0D) || (character == 0x0A))
+        {
+            return(false);
+        }
+
+        rx_broadcast = false;
+        rx_address_position = 0;
+        rx_line_state = (character == '@') ? RX_LINE_ADDRESS : RX_LINE_DISCARD;
+
+        return(false);
+    }
+
+    // RX_LINE_ADDRESS
+    if(character == 0x0D)
+    {
+        // Ended before the address did
+        uart_stats.lines_other = uart_stats.lines_other + 1;
+        rx_line_state = RX_LINE_START;
+    }
+    else if((rx_address_position == 0) && (character == '*'))
+    {
+        rx_broadcast = true;
+        rx_address_position = UART_ADDRESS_LENGTH;
+    }
+    else if(rx_address_position < UART_ADDRESS_LENGTH)
+    {
+        // Accept lower case hex digits too
+        if((character >= 'a') && (character <= 'f'))
+        {
+            character = character - 'a' + 'A';
+        }
+
+        if(character == address_text[rx_address_position])
+        {
+            rx_address_position = rx_address_position + 1;
+        }
+        else
+        {
+            rx_line_state = RX_LINE_DISCARD;
+        }
+    }
+    else if(character == ' ')
+    {
+        rx_line_state = RX_LINE_ACCEPT;
+    }
+    else
+    {
+        rx_line_state = RX_LINE_DISCARD;
+    }
+
+    return(false);
+}
+
+// Echoes and handles editing keys for anything received since the last call.
+// This runs in the command loop so the interrupt handler never waits on the UART.
+void uart_service(void)
+{
+    uint8_t     character = 0;
+    uint16_t    head = rx_head;
+
+    // The interrupt handler may have dropped bytes that were already echoed
+    if(((echo_position - rx_tail) & RX_RING_MASK) > ((head - rx_tail) & RX_RING_MASK))
+    {
+        echo_position = head;
+    }
+
+    // Typed characters are echoed once a pending response has gone, rather than
+    // in the middle of it
+    while((echo_position != head) && (response_pending == false))
+    {
+        character = rx_ring[echo_position];
+        echo_position = (echo_position + 1) & RX_RING_MASK;
+
+        if(binary_mode == true)
+        {
+            continue;
+        }
+
+        // Handle CR
+        if(character == 0x0D)
+        {
+            if(echo_line_length == 0)
+            {
+                uart_display_prompt();
+            }
+
+            echo_line_length = 0;
+        }
+
+        // Only echo printable characters
         if((character >= 0x20) && (character <= 0x7E))
         {
-            if(collect_string_pos < COMMAND_STRING_MAX_LENGTH)
+            if(echo_line_length < COMMAND_STRING_MAX_LENGTH - 1)
             {
-                collect_string[collect_string_pos] = character;
-                collect_string[collect_string_pos + 1] = 0;
-                
                 if(command_mode == true)
                 {
-                    uart_putc(uart1, character);
+                    uart_send_char(character);
                 }
 
-                collect_string_pos = collect_string_pos + 1;
+                echo_line_length = echo_line_length + 1;
             }
         }
 
         // Handle backspace
-        if(character == 0x08 || character == 0x7F)
+        if((character == 0x08) || (character == 0x7F))
         {
             if(command_mode == true)
             {
-                if(collect_string_pos != 0)
+                if(echo_line_length != 0)
                 {
-                    collect_string_pos = collect_string_pos - 1;
-                    collect_string[collect_string_pos] = 0;
-                    
-                    uart_puts(uart1, "\033[1D \033[1D");
+                    echo_line_length = echo_line_length - 1;
+                    uart_send("\033[1D \033[1D");
                 }
             }
         }
@@ -145,21 +409,137 @@ void uart_rx_isr(void)
         if(character == 0x1B)
         {
             command_mode = true;
-            uart_puts(uart1, "\r\nEntering Command Mode\r\n");
+            uart_send("\r\nEntering Command Mode\r\n");
             uart_display_prompt();
         }
     }
 }
 
+// Takes the oldest complete line off the queue into command_string
+bool uart_next_line(void)
+{
+    uint16_t    line_end = 0;
+    uint8_t     character = 0;
+    bool        truncated = false;
+
+    if(line_tail == line_head)
+    {
+        return(false);
+    }
+
+    line_end = line_ends[line_tail];
+    command_length = 0;
+
+    while(rx_tail != line_end)
+    {
+        character = rx_ring[rx_tail];
+        rx_tail = (rx_tail + 1) & RX_RING_MASK;
+
+        if(binary_mode == true)
+        {
+            // Frames are passed on as received, without the delimiter
+            if(character != 0x00)
+            {
+                if(command_length < COMMAND_STRING_MAX_LENGTH)
+                {
+                    command_string[command_length] = character;
+                    command_length = command_length + 1;
+                }
+                else
+                {
+                    truncated = true;
+                }
+            }
+        }
+        else if((character >= 0x20) && (character <= 0x7E))
+        {
+            if(command_length < COMMAND_STRING_MAX_LENGTH - 1)
+            {
+                command_string[command_length] = character;
+                command_length = command_length + 1;
+            }
+            else
+            {
+                truncated = true;
+            }
+        }
+        else if((character == 0x08) || (character == 0x7F))
+        {
+            if((command_mode == true) && (command_length != 0))
+            {
+                command_length = command_length - 1;
+            }
+        }
+    }
+
+    command_broadcast = ((line_flags[line_tail] & LINE_FLAG_BROADCAST) != 0);
+    line_tail = (line_tail + 1) & LINE_QUEUE_MASK;
+
+    if(truncated == true)
+    {
+        // A partial command or frame is worse than none
+        uart_stats.lines_truncated = uart_stats.lines_truncated + 1;
+        command_length = 0;
+    }
+
+    if(binary_mode == false)
+    {
+        command_string[command_length] = 0;
+    }
+
+    uart_stats.lines = uart_stats.lines + 1;
+
+    return(command_length != 0);
+}
+
 const char* uart_command_get(void)
 {
+    uint32_t    now_us = time_us_32();
+
+    // How long the command loop was away, which grows when it is blocked on output
+    if((command_get_us != 0) && (now_us - command_get_us > uart_stats.loop_gap_max_us))
+    {
+        uart_stats.loop_gap_max_us = now_us - command_get_us;
+    }
+    command_get_us = now_us;
+
+    uart_service();
+
+    // The next command waits until the last response has gone, and there is room
+    // for its own
+    if((command_pending == false) && ((response_pending == true) || (uart_tx_free() < UART_RESPONSE_SPACE)))
+    {
+        return("");
+    }
+
+    while((command_pending == false) && (binary_mode == false) && (line_tail != line_head))
+    {
+        command_pending = uart_next_line();
+    }
+
+    if(command_pending == false)
+    {
+        return("");
+    }
+
     return((const char*) command_string);
 }
 
 void uart_command_clear(void)
 {
     command_string[0] = 0;
-    uart_display_prompt();
+    command_length = 0;
+    command_pending = false;
+    command_broadcast = false;
+
+    if(response_pending == true)
+    {
+        prompt_waiting = true;
+    }
+    else
+    {
+        uart_display_prompt();
+    }
 }
 
 bool uart_in_command_mode(void)
@@ -170,5 +550,320 @@ bool uart_in_command_mode(void)
 void uart_command_exit(void)
 {
     command_mode = false;
-    uart_puts(uart1, "\r\nExiting Command Mode\r\n");
-}
\ No newline at end of file
+    uart_send("\r\nExiting Command Mode\r\n");
+}
+
+// Returns the length of the pending binary frame, or zero if there isn't one
+uint16_t uart_frame_get(const uint8_t** frame)
+{
+    uart_service();
+
+    if((command_pending == false) && ((response_pending == true) || (uart_tx_free() < UART_RESPONSE_SPACE)))
+    {
+        *frame = (const uint8_t*) command_string;
+        return(0);
+    }
+
+    while((command_pending == false) && (binary_mode == true) && (line_tail != line_head))
+    {
+        command_pending = uart_next_line();
+    }
+
+    *frame = (const uint8_t*) command_string;
+
+    if(command_pending == false)
+    {
+        return(0);
+    }
+
+    return(command_length);
+}
+
+// Switches between text commands and binary frames. Lines already queued are
+// handed out in the new mode.
+void uart_set_binary_mode(bool enabled)
+{
+    command_mode = false;
+    binary_mode = enabled;
+}
+
+bool uart_in_binary_mode(void)
+{
+    return(binary_mode);
+}
+
+const uart_stats_t* uart_get_stats(void)
+{
+    return(&uart_stats);
+}
+
+// =================================================================================
+// Transmit
+
+// Moves bytes from the TX ring into the UART FIFO. Called from the UART interrupt,
+// or with interrupts disabled. Lone "\n" is sent as "\r\n" in text mode.
+void uart_tx_drain(void)
+{
+    uint8_t     character = 0;
+
+    while((tx_tail != tx_head) && uart_is_writable(uart1))
+    {
+        character = tx_ring[tx_tail];
+
+        if((character == '\n') && (tx_last != '\r') && (binary_mode == false))
+        {
+            character = '\r';
+        }
+        else
+        {
+            tx_tail = (tx_tail + 1) & TX_RING_MASK;
+        }
+
+#ifdef UART_RS485_DE_PIN
+        gpio_put(UART_RS485_DE_PIN, 1);
+        tx_de_enabled = true;
+#endif
+
+        uart_get_hw(uart1)->dr = character;
+        tx_last = character;
+    }
+
+    // The TX interrupt only fires again once the FIFO has drained, so keep it
+    // enabled for as long as there is more to send
+    if((tx_tail != tx_head) && (tx_active == false))
+    {
+        tx_active = true;
+        uart_set_irq_enables(uart1, true, true);
+    }
+    else if((tx_tail == tx_head) && (tx_active == true))
+    {
+        tx_active = false;
+        uart_set_irq_enables(uart1, true, false);
+    }
+
+#ifdef UART_RS485_DE_PIN
+    // The UART has no interrupt for the last stop bit, so the bus is released
+    // from an alarm once the bytes left in the FIFO have gone out
+    if((tx_tail == tx_head) && (tx_de_enabled == true) && (tx_de_alarm == false))
+    {
+        tx_de_alarm = (add_alarm_in_us(TX_CHARACTER_US, uart_de_release, NULL, true) >= 0);
+    }
+#endif
+}
+
+#ifdef UART_RS485_DE_PIN
+// Alarm callback. Releases the bus once the UART has finished sending, checking
+// again a character later while it hasn't. If more has been queued meanwhile, the
+// drain sets the alarm again once that has gone.
+int64_t uart_de_release(alarm_id_t id, void* user_data)
+{
+    uint32_t    interrupts = save_and_disable_interrupts();
+    int64_t     reschedule_us = 0;
+
+    (void) id;
+    (void) user_data;
+
+    if((tx_tail == tx_head) && ((uart_get_hw(uart1)->fr & UART_UARTFR_BUSY_BITS) != 0))
+    {
+        reschedule_us = -TX_CHARACTER_US;
+    }
+    else
+    {
+        if(tx_tail == tx_head)
+        {
+            gpio_put(UART_RS485_DE_PIN, 0);
+            tx_de_enabled = false;
+        }
+
+        tx_de_alarm = false;
+    }
+
+    restore_interrupts(interrupts);
+
+    return(reschedule_us);
+}
+#endif
+
+// Queues up to length bytes without waiting. Returns the number queued, which is
+// less than length when the ring is full.
+uint16_t uart_write(const char* data, uint16_t length)
+{
+    uint32_t    interrupts = 0;
+    uint16_t    free_space = 0;
+    uint16_t    used = 0;
+    uint16_t    counter = 0;
+
+    // Every panel receives a broadcast, so none of them answer it
+    if(command_broadcast == true)
+    {
+        return(length);
+    }
+
+    if(length > TX_CHUNK_LENGTH)
+    {
+        length = TX_CHUNK_LENGTH;
+    }
+
+    interrupts = save_and_disable_interrupts();
+
+    free_space = (tx_tail - tx_head - 1) & TX_RING_MASK;
+    if(length > free_space)
+    {
+        length = free_space;
+        uart_stats.tx_stalls = uart_stats.tx_stalls + 1;
+    }
+
+    while(counter != length)
+    {
+        tx_ring[tx_head] = data[counter];
+        tx_head = (tx_head + 1) & TX_RING_MASK;
+        counter = counter + 1;
+    }
+
+    used = (tx_head - tx_tail) & TX_RING_MASK;
+    if(used > uart_stats.tx_high_water)
+    {
+        uart_stats.tx_high_water = used;
+    }
+
+    uart_tx_drain();
+    restore_interrupts(interrupts);
+
+    return(length);
+}
+
+// Queues as much of the data as the ring has room for, without waiting. Returns
+// the number of bytes queued.
+uint16_t uart_send_data(const char* data, uint16_t length)
+{
+    uint16_t    sent = 0;
+    uint16_t    written = 0;
+
+    do
+    {
+        written = uart_write(&data[sent], length - sent);
+        sent = sent + written;
+    }
+    while((written != 0) && (sent != length));
+
+    return(sent);
+}
+
+void uart_send(const char* string)
+{
+    uart_send_data(string, strlen(string));
+}
+
+void uart_send_char(char character)
+{
+    uart_send_data(&character, 1);
+}
+
+// Returns the room left in the TX ring
+uint16_t uart_tx_free(void)
+{
+    return((tx_tail - tx_head - 1) & TX_RING_MASK);
+}
+
+// Waits until everything queued has left the UART
+void uart_tx_flush(void)
+{
+    while(tx_tail != tx_head)
+    {
+        tight_loop_contents();
+    }
+
+    uart_tx_wait_blocking(uart1);
+}
+
+// Set while a response too long for the TX ring is finished from the command
+// loop. No command is handed out, and the prompt isn't shown, until it is clear.
+void uart_set_response_pending(bool pending)
+{
+    if((pending == true) && (response_pending == false))
+    {
+        uart_stats.tx_deferred = uart_stats.tx_deferred + 1;
+    }
+
+    response_pending = pending;
+
+    if((pending == false) && (prompt_waiting == true))
+    {
+        prompt_waiting = false;
+        uart_display_prompt();
+    }
+}
+
+bool uart_response_pending(void)
+{
+    return(response_pending);
+}
+
+// =================================================================================
+// Multi-drop addressing
+
+// Takes the address from the first four hex digits of an eID, such as the
+// device eID "urn:uuid:26FB922F-..." giving 26FB
+uint16_t uart_address_from_eid(const char* eid)
+{
+    uint16_t    address = 0;
+    uint8_t     counter = 0;
+    char        character = 0;
+
+    if(strncmp(eid, "urn:uuid:", 9) == 0)
+    {
+        eid = eid + 9;
+    }
+
+    while((counter != UART_ADDRESS_LENGTH) && (eid[counter] != 0))
+    {
+        character = eid[counter];
+
+        if((character >= '0') && (character <= '9'))
+        {
+            address = (address << 4) | (character - '0');
+        }
+        else if((character >= 'A') && (character <= 'F'))
+        {
+            address = (address << 4) | (character - 'A' + 10);
+        }
+        else if((character >= 'a') && (character <= 'f'))
+        {
+            address = (address << 4) | (character - 'a' + 10);
+        }
+
+        counter = counter + 1;
+    }
+
+    return(address);
+}
+
+void uart_set_address(uint16_t address)
+{
+    uint32_t    interrupts = save_and_disable_interrupts();
+
+    device_address = address;
+    snprintf(address_text, sizeof(address_text), "%04X", address);
+
+    restore_interrupts(interrupts);
+}
+
+uint16_t uart_get_address(void)
+{
+    return(device_address);
+}
+
+void uart_set_multidrop_mode(bool enabled)
+{
+    uint32_t    interrupts = save_and_disable_interrupts();
+
+    multidrop_mode = enabled;
+    rx_line_state = RX_LINE_START;
+
+    restore_interrupts(interrupts);
+}
+
+bool uart_in_multidrop_mode(void)
+{
+    return(multidrop_mode);
+}
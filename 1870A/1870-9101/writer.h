@@ -0,0 +1,74 @@
+// ---------------------------------------------------------------------------------
+// Streaming output writer - Header
+// ---------------------------------------------------------------------------------
+// Emits command responses and JSON incrementally through a small fixed buffer
+// into a bounded sink, without using the heap
+// ---------------------------------------------------------------------------------
+// SPDX-FileCopyrightText: Copyright 2023 David Slik (VE7FIM)
+// SPDX-FileAttributionText: https://github.com/dslik/powersim/
+// SPDX-License-Identifier: CERN-OHL-S-2.0
+// ---------------------------------------------------------------------------------
+
+#pragma once
+#ifndef WRITER_H
+#define WRITER_H
+
+#include "pico/stdlib.h"
+
+// Constants
+#define WRITER_BUFFER_SIZE      64
+#define WRITER_TAIL_SIZE        64      // Output after a response was deferred, until it has finished
+#define WRITER_UNIT_SPACE       1024    // TX ring room a long response needs to write another entity or line
+
+// Output translation modes
+#define WRITER_MODE_RAW         0x00
+#define WRITER_MODE_CRLF        0x01    // "\n" is sent as "\r\n" (the UART does this itself in text mode)
+#define WRITER_MODE_COMMA_BREAK 0x02    // "," is followed by "\r\n"
+
+// Types
+typedef struct writer_s writer_t;
+
+// Called with each full buffer. Returns how much of the data was taken. If that's
+// less than all of it, a UART writer keeps the rest to send once the TX ring has
+// drained. Any other writer fails, after which everything else written is
+// discarded.
+typedef uint16_t (*writer_sink_t)(writer_t* writer, const char* data, uint16_t length);
+
+// Writes more of a deferred response, from the cursor on, until writer_busy().
+// Returns true once the response is finished.
+typedef bool (*writer_resume_t)(writer_t* writer, uint32_t* cursor, const void* argument);
+
+struct writer_s
+{
+    writer_sink_t   sink;
+    void*           context;
+    uint8_t         mode;
+    bool            retry;              // What the sink doesn't take is kept for later
+    bool            failed;
+    uint16_t        length;
+    uint32_t        total;              // Bytes accepted by the sink
+    uint32_t        capacity;           // Buffer sinks only
+    char            buffer[WRITER_BUFFER_SIZE];
+};
+
+// Sinks
+void writer_init_uart(writer_t* writer, uint8_t mode);
+void writer_init_buffer(writer_t* writer, char* buffer, uint32_t size, uint8_t mode);
+
+// Output
+void writer_putc(writer_t* writer, char character);
+void writer_puts(writer_t* writer, const char* string);
+void writer_putn(writer_t* writer, const char* string, uint16_t length);
+void writer_json_string(writer_t* writer, const char* string);
+void writer_uint(writer_t* writer, uint32_t value);
+bool writer_flush(writer_t* writer);
+
+// Long responses to the UART (core 0). A response that could fill the TX ring
+// checks writer_busy() between entities or lines, and hands the rest to
+// writer_defer(). The command loop then calls writer_resume() to write it as the
+// ring drains, and no other command is taken until it has all gone.
+bool writer_busy(writer_t* writer);
+void writer_defer(writer_t* writer, writer_resume_t resume, uint32_t cursor, const void* argument);
+bool writer_resume(void);
+
+#endif // WRITER_H